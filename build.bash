@@ -37,21 +37,21 @@ if [[ $1 == "--help" ]]; then
 elif [[ $1 == "--asan" ]]; then
 
     printf "\n${MAG}Generating Makefile with ${GRN}ASAN${MAG} options enabled${RST}\n\n"
-    #STDOPTS="-fPIE -lm -I. -std=c++14 -O1 -Wswitch-enum -g -fsanitize=address"
-    STDOPTS="-fPIE -lm -I. -std=c++14 -O1 -g -fsanitize=address"
+    #STDOPTS="-fPIE -lm -I. -std=c++14 -ldl -pthread -O1 -Wswitch-enum -g -fsanitize=address"
+    STDOPTS="-fPIE -lm -I. -std=c++14 -ldl -pthread -O1 -g -fsanitize=address"
 
 elif [[ $1 == "--valgrind" ]]; then
 
     printf "\n${MAG}Generating Makefile with debug options compatible with ${GRN}Valgrind${RST}\n\n"
-    #STDOPTS="-fPIE -lm -I. -std=c++14 -O0 -Wswitch-enum -DTRACE_ON_EXIT -g"
-    STDOPTS="-fPIE -lm -I. -std=c++14 -O0 -DTRACE_ON_EXIT -g"
+    #STDOPTS="-fPIE -lm -I. -std=c++14 -ldl -pthread -O0 -Wswitch-enum -DTRACE_ON_EXIT -g"
+    STDOPTS="-fPIE -lm -I. -std=c++14 -ldl -pthread -O0 -DTRACE_ON_EXIT -g"
 
 
 elif [[ $1 == "--release" ]]; then
 
     printf "\n${MAG}Generating Makefile with standard build options enabled${RST}\n\n"
-    #STDOPTS="-fPIE -lm -I. -std=c++14 -O2 -Wswitch-enum"
-    STDOPTS="-fPIE -lm -I. -std=c++14 -O2"
+    #STDOPTS="-fPIE -lm -I. -std=c++14 -ldl -pthread -O2 -Wswitch-enum"
+    STDOPTS="-fPIE -lm -I. -std=c++14 -ldl -pthread -O2"
 
 else
     printf "\nrun build script with option ${BLU}--help${RST} to see available options\n\n"
@@ -99,10 +99,10 @@ echo "" >> Makefile
 
 if [[ $1 == "--valgrind" ]]; then
     echo "run:" >> Makefile
-    printf "\tvalgrind -s --leak-check=yes --num-callers=500 ./main\n\n" >> Makefile
+    printf "\tvalgrind -s --leak-check=yes --num-callers=500 ./main hdl/util/comparator.chdl\n\n" >> Makefile
 else
     echo "run:" >> Makefile
-    printf "\t./main\n\n" >> Makefile
+    printf "\t./main hdl/util/comparator.chdl\n\n" >> Makefile
 fi
 
 printf "\n    to run program: '${GRN}make${RST}' and '${GRN}make run${RST}'\n\n"
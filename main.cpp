@@ -1,53 +1,543 @@
 #include "src/lexer.h"
+#include "src/lexer-simd.h"
 #include "src/file-reader.h"
 #include "src/error-util.h"
+#include "src/thread-pool.h"
+#include "src/memory-stats.h"
 #include "src/semantic-analysis/parser.h"
+#include "src/runtime/runtime-env.h"
+#include "src/runtime/module-desc.h"
+#include "src/runtime/elaborate.h"
+#include "src/runtime/netlist.h"
+#include "src/runtime/simulate.h"
+#include "src/runtime/simulate-bench.h"
+#include "src/runtime/waveform.h"
 
 #include <vector>
+#include <string>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 using namespace std;
 
 static std::string left_pad(const std::string& input_str, int len);
 static std::string right_pad(const std::string& input_str, int len);
 
-int main(int argc, char* argv[]) {
+//
+// everything produced while lexing and parsing a single file. each unit is
+// handled by exactly one thread, the results are merged afterwards in the
+// order the files were given on the command line
+//
+struct compile_unit_t {
+    std::string filename;
 
-    std::string filename = "hdl/util/comparator.chdl";
-//    std::string filename = "hdl/riscv-inst-unmarshall.chdl";
-//    std::string filename = "hdl/riscv-decoder.chdl";
-//    std::string filename = "hdl/adders.chdl";
+    // errors hold references into the mapped source, so the
+    // mapping has to live as long as the unit
+    src_buffer_t src;
+    token_buffer_t tkns;
+    runtime_env_t renv;
 
-    runtime_env_t* renv = NULL;
+    std::ostringstream out; // listings and errors, printed once everything is done
+    bool ok = false;
 
-    try {
-        auto src    = read_hdl_file_contents(filename);
-        std::vector<token_t> tkns;
-        lexical_analyze(src, filename, tkns);
-//        print_lexer_tokens(tkns);
+    // time spent in each phase, only reported with -t
+    double read_ms  = 0.0;
+    double lex_ms   = 0.0;
+    double parse_ms = 0.0;
+};
+
+struct driver_options_t {
+    std::vector<std::string> inputs;
+    size_t threads = 0ul; // 0 = one per hardware thread
+    bool quiet = false;
+    bool timing = false;
+    parse_options_t parse;
+
+    std::string top; // module to elaborate, empty for none
+    bool print_netlist = false;
+    elaborate_options_t elaborate;
+
+    simulate_bench_options_t sim; // simulated when sim.steps is not 0
+    bool sim_check = false; // test and time the simulation kernels, no input files needed
+    bool lex_check = false; // test and time the lexer scanners on the inputs and generated ones
+    bool sweep_check = false; // simulate random netlists before and after the sweep, no input files needed
+    std::string wave_in, vcd_out; // waveform to convert, no input files needed
+};
+
+static void print_usage(std::ostream& os, const char* argv0) {
+    os << "usage: " << argv0 << " [options] <file.chdl | directory> ...\n"
+       << "options:\n"
+       << "    -j <n>      number of threads used to lex, parse and elaborate (default: one per hardware thread)\n"
+       << "    -q          do not print module listings\n"
+       << "    -t          print time spent in each phase and memory used elaborating\n"
+       << "    -O0         do not optimize module bytecode\n"
+       << "    --lex-check lex the input files, a large generated design and random input at every SIMD level the\n"
+       << "                cpu supports, check they give the same tokens and time them\n"
+       << "    --top <m>   elaborate module m into a netlist, m is written like an instance: adder(32)\n"
+       << "    --netlist   print every gate of the elaborated netlist\n"
+       << "    --no-memo   elaborate every module instance from its bytecode, do not reuse earlier instances\n"
+       << "    --no-strash keep gates that have the same type and inputs as another gate\n"
+       << "    --no-sweep  keep constant and unused logic in the netlist\n"
+       << "    --sweep-check\n"
+       << "                sweep random netlists and flipflops with constant clocks and inputs, check each one\n"
+       << "                simulates the same before and after, with two and with four states\n"
+       << "    --sim <n>   simulate the netlist for n steps of random inputs and report the gate evaluation rate\n"
+       << "    --sim-64    simulate 64 patterns of random inputs per step, one per bit of a machine word\n"
+       << "    --sim-4state\n"
+       << "                simulate with 0, 1, X and Z, flipflops start out as X and undriven nets are Z\n"
+       << "    --sim-kernel <scalar | avx2 | avx512>\n"
+       << "                gate kernels used with --sim-64 (default: the best the cpu supports)\n"
+       << "    --sim-check compare every simulation kernel the cpu supports against the portable one and time them\n"
+       << "    --sim-engine <levelized | event>\n"
+       << "                evaluate every gate in level order (default) or only the gates behind a changed net\n"
+       << "    --sim-delay <name>=<n>\n"
+       << "                delay of the gates of a type (and, xor, ...) or built by a module, for the event engine\n"
+       << "    --sim-flips <n>\n"
+       << "                flip n input bits chosen at random each step instead of setting all of them\n"
+       << "    --sim-threads <n>\n"
+       << "                split the levels of the levelized engine over n threads (default: 1)\n"
+       << "    --sim-scaling\n"
+       << "                simulate again with 1, 2, 4, ... up to --sim-threads threads (default: one per hardware\n"
+       << "                thread), report the speedup of each and check they all agree\n"
+       << "    --sim-compile <path>\n"
+       << "                generate C++ for the netlist in path.cpp, build path.so with $CXX (default: c++) and\n"
+       << "                simulate with it, then again with the interpreter to check they agree\n"
+       << "    --sim-vcd <file>\n"
+       << "                simulate again writing a value change dump after every step, report its throughput\n"
+       << "    --sim-vcd-scope <ports | all | scope>\n"
+       << "                signals in the dump: the top level ports (default), everything, or every signal in and\n"
+       << "                below one instance, named from the top like adder.full_adder_3\n"
+       << "    --sim-wave <file>\n"
+       << "                simulate again recording a compressed waveform of the same signals, then time reading\n"
+       << "                it back at one point in time and for one whole signal. with --sim-vcd as well the\n"
+       << "                waveform converted to a VCD has to match the dump\n"
+       << "    --sim-wave-check\n"
+       << "                simulate again writing a dump and a waveform of the same signals to temporary files,\n"
+       << "                check the waveform converts to the dump and that reading it back at any time and over\n"
+       << "                any range gives what the dump has\n"
+       << "    --wave-to-vcd <file> <vcd>\n"
+       << "                convert a waveform written with --sim-wave to a value change dump\n"
+       << "    -h, --help  print this help text\n"
+       << "directories are searched recursively for .chdl files\n";
+}
+
+static bool parse_options(int argc, char* argv[], driver_options_t& opts) {
+
+    for(int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+
+        if(arg == "-h" || arg == "--help") {
+            print_usage(std::cout, argv[0]);
+            exit(0);
+        } else if(arg == "-q") {
+            opts.quiet = true;
+        } else if(arg == "-t") {
+            opts.timing = true;
+        } else if(arg == "-O0") {
+            opts.parse.optimize = false;
+        } else if(arg == "--top") {
+            if(i + 1 >= argc) {
+                std::cout << "--top expects a module\n";
+                return false;
+            }
+            opts.top = argv[++i];
+        } else if(arg == "--netlist") {
+            opts.print_netlist = true;
+        } else if(arg == "--no-memo") {
+            opts.elaborate.memoize = false;
+        } else if(arg == "--no-strash") {
+            opts.elaborate.strash = false;
+        } else if(arg == "--no-sweep") {
+            opts.elaborate.sweep = false;
+        } else if(arg == "--sweep-check") {
+            opts.sweep_check = true;
+        } else if(arg == "--sim") {
+            char* end = NULL;
+            const long v = i + 1 < argc ? strtol(argv[i + 1], &end, 10) : 0l;
+            if(v <= 0 || *end != '\0') {
+                std::cout << "--sim expects a number of steps\n";
+                return false;
+            }
+            opts.sim.steps = v;
+            i++;
+        } else if(arg == "--sim-64") {
+            opts.sim.width = simulate_width_t::parallel64;
+        } else if(arg == "--sim-4state") {
+            opts.sim.logic = simulate_logic_t::four_state;
+            opts.elaborate.four_state = true;
+        } else if(arg == "--sim-kernel") {
+            const std::string level = i + 1 < argc ? argv[++i] : "";
+            if(level == "scalar")
+                simulate_simd_select(simulate_simd_level_t::scalar);
+            else if(level == "avx2")
+                simulate_simd_select(simulate_simd_level_t::avx2);
+            else if(level == "avx512")
+                simulate_simd_select(simulate_simd_level_t::avx512);
+            else {
+                std::cout << "unknown simulation kernel '" << level << "'\n";
+                return false;
+            }
+        } else if(arg == "--sim-check") {
+            opts.sim_check = true;
+        } else if(arg == "--lex-check") {
+            opts.lex_check = true;
+        } else if(arg == "--sim-engine") {
+            const std::string engine = i + 1 < argc ? argv[++i] : "";
+            if(engine == "levelized")
+                opts.sim.engine = simulate_engine_t::levelized;
+            else if(engine == "event")
+                opts.sim.engine = simulate_engine_t::event;
+            else {
+                std::cout << "unknown simulation engine '" << engine << "'\n";
+                return false;
+            }
+        } else if(arg == "--sim-delay") {
+            const std::string delay = i + 1 < argc ? argv[++i] : "";
+            const size_t eq = delay.find('=');
+            if(eq == std::string::npos || eq == 0ul || strtol(delay.c_str() + eq + 1, NULL, 10) <= 0) {
+                std::cout << "--sim-delay expects <name>=<n>\n";
+                return false;
+            }
+            opts.sim.delays.push_back(delay);
+        } else if(arg == "--sim-flips") {
+            char* end = NULL;
+            const long v = i + 1 < argc ? strtol(argv[i + 1], &end, 10) : 0l;
+            if(v <= 0 || *end != '\0') {
+                std::cout << "--sim-flips expects a number of input bits\n";
+                return false;
+            }
+            opts.sim.flips = v;
+            i++;
+        } else if(arg == "--sim-threads") {
+            char* end = NULL;
+            const long v = i + 1 < argc ? strtol(argv[i + 1], &end, 10) : 0l;
+            if(v <= 0 || *end != '\0') {
+                std::cout << "--sim-threads expects a number of threads\n";
+                return false;
+            }
+            opts.sim.threads = v;
+            i++;
+        } else if(arg == "--sim-scaling") {
+            opts.sim.scaling = true;
+        } else if(arg == "--sim-compile") {
+            if(i + 1 >= argc) {
+                std::cout << "--sim-compile expects a path\n";
+                return false;
+            }
+            opts.sim.compile = argv[++i];
+        } else if(arg == "--sim-vcd") {
+            if(i + 1 >= argc) {
+                std::cout << "--sim-vcd expects a file\n";
+                return false;
+            }
+            opts.sim.vcd = argv[++i];
+        } else if(arg == "--sim-wave") {
+            if(i + 1 >= argc) {
+                std::cout << "--sim-wave expects a file\n";
+                return false;
+            }
+            opts.sim.wave = argv[++i];
+        } else if(arg == "--sim-wave-check") {
+            opts.sim.wave_check = true;
+        } else if(arg == "--wave-to-vcd") {
+            if(i + 2 >= argc) {
+                std::cout << "--wave-to-vcd expects a waveform file and a VCD file\n";
+                return false;
+            }
+            opts.wave_in = argv[++i];
+            opts.vcd_out = argv[++i];
+        } else if(arg == "--sim-vcd-scope") {
+            const std::string scope = i + 1 < argc ? argv[++i] : "";
+            if(scope.empty()) {
+                std::cout << "--sim-vcd-scope expects ports, all or a scope\n";
+                return false;
+            }
+            opts.sim.vcd_opts.select = scope == "ports" ? simulate_vcd_select_t::ports :
+                                       scope == "all"   ? simulate_vcd_select_t::all : simulate_vcd_select_t::subtree;
+            opts.sim.vcd_opts.scope = scope;
+        } else if(arg == "-j" || (arg.size() > 2ul && arg.compare(0, 2, "-j") == 0)) {
+            const std::string n = (arg == "-j") ? (i + 1 < argc ? argv[++i] : "") : arg.substr(2);
+            char* end = NULL;
+            const long v = strtol(n.c_str(), &end, 10);
+            if(n.empty() || *end != '\0' || v <= 0) {
+                std::cout << "invalid thread count '" << n << "'\n";
+                return false;
+            }
+            opts.threads = v;
+        } else if(arg.size() > 1ul && arg[0] == '-') {
+            std::cout << "unknown option '" << arg << "'\n";
+            return false;
+        } else {
+            opts.inputs.push_back(arg);
+        }
+    }
+
+    return opts.inputs.size() > 0ul || opts.sim_check || opts.lex_check || opts.sweep_check || !opts.wave_in.empty();
+}
+
+static bool has_hdl_extension(const std::string& name) {
+    const std::string ext = ".chdl";
+    return name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+//
+// appends every .chdl file below dirname. entries are sorted so the file
+// order (and therefore the output) does not depend on the filesystem
+//
+static void collect_directory(const std::string& dirname, std::vector<std::string>& files) {
+
+    DIR* dir = opendir(dirname.c_str());
+    if(dir == NULL)
+        throw std::runtime_error("unable to open directory '" + dirname + "' : " + strerror(errno));
+
+    std::vector<std::string> entries;
+    while(struct dirent* ent = readdir(dir)) {
+        if(strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0)
+            entries.push_back(ent->d_name);
+    }
+    closedir(dir);
+
+    std::sort(entries.begin(), entries.end());
 
-        renv = new runtime_env_t;
+    for(const std::string& e : entries) {
+        const std::string path = (dirname.back() == '/') ? dirname + e : dirname + "/" + e;
 
-        parser_analyze(renv, src, filename, tkns);
+        struct stat sb;
+        if(stat(path.c_str(), &sb) != 0)
+            continue;
 
-        delete renv;
+        if(S_ISDIR(sb.st_mode))
+            collect_directory(path, files);
+        else if(S_ISREG(sb.st_mode) && has_hdl_extension(e))
+            files.push_back(path);
+    }
+}
+
+static std::vector<std::string> collect_inputs(const std::vector<std::string>& inputs) {
+
+    std::vector<std::string> files;
+
+    for(const std::string& in : inputs) {
+        struct stat sb;
+        if(stat(in.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode))
+            collect_directory(in, files);
+        else
+            files.push_back(in); // missing files are reported by the reader
+    }
+
+    return files;
+}
+
+static void compile_unit(compile_unit_t& unit, const driver_options_t& opts) {
+
+    std::ostream null_os(NULL);
+    std::ostream& listing = opts.quiet ? null_os : unit.out;
+
+    typedef std::chrono::steady_clock clock_type;
+    auto elapsed_ms = [](clock_type::time_point since) {
+        return std::chrono::duration<double, std::milli>(clock_type::now() - since).count();
+    };
+
+    try {
+        auto t = clock_type::now();
+        unit.src = read_hdl_file_contents(unit.filename);
+        unit.read_ms = elapsed_ms(t);
+
+        t = clock_type::now();
+        lexical_analyze(unit.src, unit.filename, unit.tkns);
+        unit.lex_ms = elapsed_ms(t);
+//        print_lexer_tokens(unit.tkns, unit.src);
+
+        t = clock_type::now();
+        parser_analyze(&unit.renv, unit.src, unit.filename, unit.tkns, listing, opts.parse);
+        unit.parse_ms = elapsed_ms(t);
+        unit.ok = true;
     }
     catch(ParserError_t& parse_error) {
-        handle_parse_error(std::cout, parse_error);
-        delete renv;
-        return 1;
+        handle_parse_error(unit.out, parse_error);
     }
     catch(LexerError_t& lexer_error) {
-        handle_lexer_error(std::cout, lexer_error);
-        delete renv;
+        handle_lexer_error(unit.out, lexer_error);
+    }
+    catch(std::runtime_error& err) {
+        unit.out << "\nError : " << err.what() << std::endl;
+    }
+}
+
+//
+// phase times are summed over all files, so with more than one thread they
+// can add up to more than the wall clock time
+//
+static void print_timing(std::ostream& os, const std::vector<compile_unit_t>& units, size_t threads, double wall_ms) {
+
+    double read_ms = 0.0, lex_ms = 0.0, parse_ms = 0.0;
+    size_t bytes = 0ul, tokens = 0ul;
+
+    for(const compile_unit_t& unit : units) {
+        read_ms  += unit.read_ms;
+        lex_ms   += unit.lex_ms;
+        parse_ms += unit.parse_ms;
+        bytes    += unit.src.size();
+        tokens   += unit.tkns.size();
+    }
+
+    auto rate = [](double n, double ms) { return ms > 0.0 ? n / (ms / 1000.0) : 0.0; };
+
+    os << "\ntiming (" << units.size() << " files, " << bytes << " bytes, " << tokens << " tokens, " << threads << " threads)\n";
+    os << "    read  : " << right_pad(std::to_string(read_ms), 14) << " ms\n";
+    os << "    lex   : " << right_pad(std::to_string(lex_ms), 14) << " ms  " << rate(bytes / 1.0e6, lex_ms) << " MB/s\n";
+    os << "    parse : " << right_pad(std::to_string(parse_ms), 14) << " ms  " << rate(tokens / 1.0e6, parse_ms) << " Mtokens/s\n";
+    os << "    wall  : " << right_pad(std::to_string(wall_ms), 14) << " ms\n";
+}
+
+static bool elaborate(runtime_env_t& renv, const driver_options_t& opts) {
+
+    netlist_t nl;
+    thread_pool_t pool(opts.threads);
+
+    elaborate_options_t eopts = opts.elaborate;
+    eopts.pool = &pool;
+
+    try {
+        const memory_stats_t before = memory_stats();
+        const auto start = std::chrono::steady_clock::now();
+        const elaborate_stats_t stats = elaborate_top(&renv, opts.top, nl, std::cout, eopts);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const memory_stats_t after = memory_stats();
+
+        std::cout << "\n" << stats << nl;
+        if(opts.timing) {
+            std::cout << "    elaborate : " << right_pad(std::to_string(ms), 14) << " ms\n";
+            std::cout << "    allocations : " << after.allocations - before.allocations << " ("
+                      << after.allocated_bytes - before.allocated_bytes << " bytes) while elaborating, peak rss "
+                      << after.peak_rss_bytes / 1024ul << " KB\n";
+        }
+        if(opts.print_netlist)
+            netlist_print(std::cout, nl);
+        if(opts.sim.steps > 0ul)
+            simulate_bench(std::cout, nl, opts.sim);
+    }
+    catch(std::runtime_error& err) {
+        std::cout << "\nError : " << err.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+
+    driver_options_t opts;
+    if(!parse_options(argc, argv, opts)) {
+        print_usage(std::cout, argv[0]);
+        return 1;
+    }
+
+    if(opts.sim_check && !simulate_simd_check(std::cout))
         return 1;
+    if(opts.sweep_check && !simulate_sweep_check(std::cout))
+        return 1;
+
+    if(!opts.wave_in.empty()) {
+        try {
+            waveform_reader_t reader;
+            waveform_read_open(&reader, opts.wave_in);
+            std::ofstream vcd(opts.vcd_out, std::ios::binary);
+            if(!vcd)
+                throw std::runtime_error("can not create '" + opts.vcd_out + "'");
+            waveform_to_vcd(&reader, vcd);
+            if(!vcd.flush())
+                throw std::runtime_error("writing '" + opts.vcd_out + "' failed");
+            std::cout << opts.wave_in << " : " << reader.signals.size() << " signals, " << reader.blocks.size()
+                      << " blocks, written to " << opts.vcd_out << "\n";
+        }
+        catch(std::runtime_error& err) {
+            std::cout << "\nError : " << err.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::string> files;
+    try {
+        files = collect_inputs(opts.inputs);
+
+        // before the compile driver, the check switches the scanners every thread uses
+        if(opts.lex_check && !lexer_simd_check(std::cout, files))
+            return 1;
     }
+    catch(std::runtime_error& err) {
+        std::cout << "\nError : " << err.what() << std::endl;
+        return 1;
+    }
+
+    if(opts.inputs.empty())
+        return 0;
+
+    // units are never moved once created, errors point into them
+    std::vector<compile_unit_t> units(files.size());
+    for(size_t i = 0ul; i < files.size(); i++)
+        units[i].filename = files[i];
+
+    const auto wall_start = std::chrono::steady_clock::now();
+    size_t threads_used = 1ul;
+
+    {
+        thread_pool_t pool(std::min(opts.threads == 0ul ? thread_pool_hardware_threads() : opts.threads, std::max(files.size(), (size_t)1ul)));
+        thread_pool_parallel_for(&pool, units.size(), [&](size_t i) { compile_unit(units[i], opts); });
+        threads_used = thread_pool_size(&pool);
+    }
+
+    const double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wall_start).count();
+
+    //
+    // merge in command line order. later definitions of a module name are
+    // reported against the file that defined it first
+    //
+    runtime_env_t renv;
+    bool success = true;
+
+    for(compile_unit_t& unit : units) {
+        std::cout << unit.out.str();
+
+        if(!unit.ok) {
+            success = false;
+            continue;
+        }
+
+        for(module_desc_t* dup : runtime_env_merge(&renv, &unit.renv)) {
+            ParserError_t err(unit.src);
+            err.error_desc     = "module with name '" + dup->name + "' already defined in file '" + renv.modules.at(dup->name)->filename + "'";
+            err.filename       = unit.filename;
+            err.error_location = dup->name_token.start;
+            err.token          = dup->name_token;
+            handle_parse_error(std::cout, err);
+            unit.ok = false;
+            success = false;
+        }
+
+#       ifndef TRACE_ON_EXIT
+        if(unit.ok)
+            std::cout << "processing of '" << unit.filename << "' successful" << std::endl;
+#       endif
+    }
+
+    if(opts.timing)
+        print_timing(std::cout, units, threads_used, wall_ms);
 
-#   ifndef TRACE_ON_EXIT
-    std::cout << "processing of '" << filename << "' successful" << std::endl;
-#   endif
+    if(success && !opts.top.empty())
+        success = elaborate(renv, opts);
 
-    return 0;
+    return success ? 0 : 1;
 }
 
 static std::string left_pad(const std::string& input_str, int len) {
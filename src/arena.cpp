@@ -0,0 +1,94 @@
+#include <src/arena.h>
+#include <src/error-util.h>
+
+#include <string.h>
+
+#include <vector>
+#include <new>
+
+arena_t::~arena_t() {
+    for(arena_block_t& b : this->blocks)
+        ::operator delete(b.data);
+}
+
+static inline size_t arena_align(size_t n, size_t align) {
+    return (n + align - 1ul) & ~(align - 1ul);
+}
+
+void* arena_alloc(arena_t* arena, size_t bytes, size_t align) {
+
+    if(align == 0ul || (align & (align - 1ul)) != 0ul)
+        INTERNAL_ERR();
+
+    if(!arena->blocks.empty()) {
+        arena_block_t& b = arena->blocks[arena->current];
+        const size_t offset = arena_align(arena->used, align);
+        if(offset + bytes <= b.size) {
+            arena->used = offset + bytes;
+            arena->top  = b.data + offset;
+            return arena->top;
+        }
+    }
+
+    // the next block is used when it is big enough, otherwise a new one goes
+    // in front of it so blocks before the current one never move
+    const size_t next = arena->blocks.empty() ? 0ul : arena->current + 1ul;
+    if(next >= arena->blocks.size() || arena->blocks[next].size < bytes) {
+        arena_block_t b;
+        b.size = bytes > arena_block_size ? bytes : arena_block_size;
+        b.data = static_cast<char*>(::operator new(b.size));
+        arena->blocks.insert(arena->blocks.begin() + next, b);
+        arena->reserved += b.size;
+    }
+
+    arena->current = next;
+    arena->used    = bytes;
+    arena->top     = arena->blocks[next].data;
+    return arena->top;
+}
+
+void* arena_grow(arena_t* arena, void* p, size_t old_bytes, size_t new_bytes, size_t align) {
+
+    if(p != NULL && p == arena->top) {
+        const arena_block_t& b = arena->blocks[arena->current];
+        const size_t offset = (size_t)(arena->top - b.data);
+        if(offset + new_bytes <= b.size) {
+            arena->used = offset + new_bytes;
+            return p;
+        }
+    }
+
+    void* q = arena_alloc(arena, new_bytes, align);
+    if(old_bytes > 0ul)
+        memcpy(q, p, old_bytes < new_bytes ? old_bytes : new_bytes);
+    return q;
+}
+
+arena_mark_t arena_mark(const arena_t* arena) {
+    arena_mark_t m;
+    m.block = arena->current;
+    m.used  = arena->used;
+    return m;
+}
+
+void arena_release(arena_t* arena, const arena_mark_t& mark) {
+    arena->current = mark.block;
+    arena->used    = mark.used;
+    arena->top     = NULL;
+}
+
+void arena_reset(arena_t* arena, size_t keep_bytes) {
+
+    size_t kept = 0ul, i = 0ul;
+    for(; i < arena->blocks.size() && kept < keep_bytes; i++)
+        kept += arena->blocks[i].size;
+
+    for(size_t j = i; j < arena->blocks.size(); j++)
+        ::operator delete(arena->blocks[j].data);
+
+    arena->blocks.resize(i);
+    arena->reserved = kept;
+    arena->current  = 0ul;
+    arena->used     = 0ul;
+    arena->top      = NULL;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+//
+// bump allocator. allocating moves a pointer forward inside the current block,
+// nothing is freed on its own. everything allocated after a mark goes away at
+// once when the arena is released back to that mark, and all of it when the
+// arena is reset. blocks are kept for reuse in both cases, so an arena that is
+// reset and filled again over and over stops asking the system for memory
+//
+// objects in an arena never have their destructors run, only put trivially
+// destructible types in one
+//
+const size_t arena_block_size = 64ul * 1024ul;
+
+struct arena_block_t {
+    char*  data;
+    size_t size;
+};
+
+struct arena_t {
+
+    arena_t(void) = default;
+    arena_t(const arena_t&) = delete;
+    arena_t& operator=(const arena_t&) = delete;
+    ~arena_t();
+
+    std::vector<arena_block_t> blocks;
+    size_t current = 0ul; // block being filled
+    size_t used    = 0ul; // bytes used in blocks[current]
+
+    // the last allocation, it can grow in place
+    char* top = NULL;
+
+    size_t reserved = 0ul; // bytes in all blocks
+};
+
+struct arena_mark_t {
+    size_t block;
+    size_t used;
+};
+
+//
+// align must be a power of two
+//
+void* arena_alloc(arena_t* arena, size_t bytes, size_t align);
+
+//
+// returns a block of new_bytes that starts with the first old_bytes of p. p
+// must be the last allocation or a copy is made (the old bytes stay where they
+// are until the arena is released)
+//
+void* arena_grow(arena_t* arena, void* p, size_t old_bytes, size_t new_bytes, size_t align);
+
+arena_mark_t arena_mark(const arena_t* arena);
+
+//
+// frees everything allocated after the mark was taken
+//
+void arena_release(arena_t* arena, const arena_mark_t& mark);
+
+//
+// frees everything. blocks past the first keep_bytes are handed back to the
+// system so one unusually big user does not pin its memory forever
+//
+void arena_reset(arena_t* arena, size_t keep_bytes = ~0ul);
+
+template<typename T>
+T* arena_new_array(arena_t* arena, size_t n) {
+    return static_cast<T*>(arena_alloc(arena, n * sizeof(T), alignof(T)));
+}
+
+template<typename T>
+T* arena_grow_array(arena_t* arena, T* p, size_t old_n, size_t new_n) {
+    return static_cast<T*>(arena_grow(arena, p, old_n * sizeof(T), new_n * sizeof(T), alignof(T)));
+}
+
+//
+// releases back to the mark taken at construction when it goes out of scope
+//
+struct arena_scope_t {
+
+    arena_scope_t(arena_t* arena) : arena(arena), mark(arena_mark(arena)) {}
+    ~arena_scope_t() { arena_release(this->arena, this->mark); }
+
+    arena_scope_t(const arena_scope_t&) = delete;
+    arena_scope_t& operator=(const arena_scope_t&) = delete;
+
+    arena_t*     arena;
+    arena_mark_t mark;
+};
@@ -32,18 +32,18 @@ void disassemble_bytecode(std::ostream& os, struct module_desc_t* modptr) {
         switch(dis_get_opcode(opc_iter)) {
         case opcode_t::clear_stack: os << "clear_stack\n"; break;
 
-        case opcode_t::jump_exe: { // <opc> <label>
-            os << "jump [" << dis_get_jump_target(modptr, opc_iter, opc_end) << "]\n";
+        case opcode_t::jump_exe: { // <opc> <offset:4>
+            os << "jump [" << dis_get_jump_target(modptr, opc_iter, opc_end) << "\n";
             break;
         }
 
-        case opcode_t::jump_false: { // <opc> <label>
-            os << "jump_false [" << dis_get_jump_target(modptr, opc_iter, opc_end) << "]\n";
+        case opcode_t::jump_false: { // <opc> <offset:4>
+            os << "jump_false [" << dis_get_jump_target(modptr, opc_iter, opc_end) << "\n";
             break;
         }
 
-        case opcode_t::jump_true: { // <opc> <label>
-            os << "jump_true [" << dis_get_jump_target(modptr, opc_iter, opc_end) << "]\n";
+        case opcode_t::jump_true: { // <opc> <offset:4>
+            os << "jump_true [" << dis_get_jump_target(modptr, opc_iter, opc_end) << "\n";
             break;
         }
 
@@ -240,12 +240,16 @@ static std::string dis_get_jump_target(
         std::vector<uint8_t>::iterator& iter,
         std::vector<uint8_t>::iterator& end) {
 
-    const size_t imag_ref = dis_get_ref(iter, end);
-    const size_t target = modptr->jump_targets.at(imag_ref);
+    // operand follows the single byte jump opcode
+    const long int inst = (iter - modptr->bytecode.begin()) - 1l;
 
-    if(target == ~0ul)
-        return "UNDEFINED";
-    return std::to_string(target);
+    if(end - iter < (long int)opc_jump_operand_size)
+        INTERNAL_ERR();
+
+    const int32_t offset = (int32_t)opc_read_jump_operand(&*iter);
+    iter += opc_jump_operand_size;
+
+    return std::to_string(inst + offset) + "] (" + (offset < 0 ? "" : "+") + std::to_string(offset) + ")";
 }
 
 static std::string dis_get_ref_name(
@@ -0,0 +1,143 @@
+#include <src/bytecode-data/instruction.h>
+#include <src/bytecode-data/opcodes.h>
+#include <src/error-util.h>
+
+#include <vector>
+
+opc_operand_t opc_operand_type(opcode_t op) {
+    switch(op) {
+    case opcode_t::jump_exe:
+    case opcode_t::jump_true:
+    case opcode_t::jump_false:
+        return opc_operand_t::jump;
+
+    case opcode_t::function_call:
+        return opc_operand_t::byte;
+
+    case opcode_t::push_in_ref:
+    case opcode_t::push_out_ref:
+    case opcode_t::push_new_local_ref:
+    case opcode_t::push_local_ref:
+    case opcode_t::push_uinteger:
+    case opcode_t::push_bit_literal:
+    case opcode_t::module_call:
+    case opcode_t::push_new_local_any:
+    case opcode_t::push_new_local_integer:
+    case opcode_t::push_new_local_uinteger:
+    case opcode_t::push_new_local_string:
+    case opcode_t::push_new_local_vector:
+    case opcode_t::push_new_local_module:
+        return opc_operand_t::size_const;
+
+    default:
+        return opc_operand_t::none;
+    }
+}
+
+static size_t bytecode_decode_varint(const std::vector<uint8_t>& bytecode, size_t& offset) {
+    size_t v = 0ul;
+
+    while(offset < bytecode.size()) {
+        const uint8_t u8 = bytecode[offset++];
+        v = (v << 7) | (u8 & 0x7F);
+        if(!(u8 & 0x80))
+            return v;
+    }
+
+    INTERNAL_ERR();
+}
+
+size_t bytecode_decode(const std::vector<uint8_t>& bytecode, size_t offset, bytecode_inst_t& inst) {
+
+    const size_t start = offset;
+    inst.op      = static_cast<opcode_t>(bytecode_decode_varint(bytecode, offset));
+    inst.operand = 0ul;
+
+    switch(opc_operand_type(inst.op)) {
+    case opc_operand_t::none:
+        break;
+
+    case opc_operand_t::size_const:
+        inst.operand = bytecode_decode_varint(bytecode, offset);
+        break;
+
+    case opc_operand_t::byte:
+        if(offset >= bytecode.size())
+            INTERNAL_ERR();
+        inst.operand = bytecode[offset++];
+        break;
+
+    case opc_operand_t::jump: {
+        if(bytecode.size() - offset < opc_jump_operand_size)
+            INTERNAL_ERR();
+
+        const int32_t rel = (int32_t)opc_read_jump_operand(bytecode.data() + offset);
+        inst.operand = (size_t)((long int)start + rel);
+        offset += opc_jump_operand_size;
+        break;
+    }
+    }
+
+    return offset;
+}
+
+void bytecode_decode_all(
+        const std::vector<uint8_t>& bytecode,
+        std::vector<bytecode_inst_t>& insts,
+        std::vector<size_t>& offsets) {
+
+    insts.clear();
+    offsets.clear();
+
+    size_t offset = 0ul;
+    while(offset < bytecode.size()) {
+        bytecode_inst_t inst;
+        offsets.push_back(offset);
+        offset = bytecode_decode(bytecode, offset, inst);
+        insts.push_back(inst);
+    }
+}
+
+static size_t bytecode_varint_size(size_t v) {
+    size_t n = 1ul;
+    while(v >>= 7)
+        n++;
+    return n;
+}
+
+size_t bytecode_inst_size(const bytecode_inst_t& inst) {
+    const size_t opsize = bytecode_varint_size(static_cast<size_t>(inst.op));
+
+    switch(opc_operand_type(inst.op)) {
+    case opc_operand_t::size_const: return opsize + bytecode_varint_size(inst.operand);
+    case opc_operand_t::byte:       return opsize + 1ul;
+    case opc_operand_t::jump:       return opsize + opc_jump_operand_size;
+    default:                        return opsize;
+    }
+}
+
+void bytecode_encode(std::vector<uint8_t>& bytecode, const bytecode_inst_t& inst) {
+
+    const size_t start = bytecode.size();
+    opc_encode_opcode(bytecode, inst.op);
+
+    switch(opc_operand_type(inst.op)) {
+    case opc_operand_t::none:
+        break;
+
+    case opc_operand_t::size_const:
+        opc_encode_size_const(bytecode, inst.operand);
+        break;
+
+    case opc_operand_t::byte:
+        bytecode.push_back((uint8_t)inst.operand);
+        break;
+
+    case opc_operand_t::jump: {
+        const long int rel = (long int)inst.operand - (long int)start;
+        bytecode.resize(bytecode.size() + opc_jump_operand_size);
+        opc_write_jump_operand(&bytecode.back() - (opc_jump_operand_size - 1ul), (uint32_t)(int32_t)rel);
+        break;
+    }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <src/bytecode-data/opcodes.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+//
+// decoded form of a single instruction, used by passes that need to look at
+// the bytecode as a list instead of a byte stream
+//
+
+enum class opc_operand_t : uint8_t {
+    none,
+    size_const, // 7-bit varint
+    byte,       // single byte (function_type_t)
+    jump,       // fixed 4 byte relative offset
+};
+
+opc_operand_t opc_operand_type(opcode_t op);
+
+struct bytecode_inst_t {
+    opcode_t op;
+
+    // varint or byte operand. for jumps this is the absolute bytecode offset
+    // of the target, not the relative offset that is stored
+    size_t operand = 0ul;
+};
+
+//
+// decodes the instruction starting at offset and returns the offset of the
+// next one. expects linked bytecode. throws on truncated input
+//
+size_t bytecode_decode(const std::vector<uint8_t>& bytecode, size_t offset, bytecode_inst_t& inst);
+
+//
+// decodes a whole module, offsets[i] is the bytecode offset of insts[i]
+//
+void bytecode_decode_all(
+        const std::vector<uint8_t>& bytecode,
+        std::vector<bytecode_inst_t>& insts,
+        std::vector<size_t>& offsets);
+
+//
+// encoded size of inst, jumps are always the same size
+//
+size_t bytecode_inst_size(const bytecode_inst_t& inst);
+
+//
+// appends inst to bytecode. a jump operand is converted into an offset
+// relative to where the instruction lands
+//
+void bytecode_encode(std::vector<uint8_t>& bytecode, const bytecode_inst_t& inst);
@@ -0,0 +1,45 @@
+#include <src/bytecode-data/link.h>
+#include <src/bytecode-data/opcodes.h>
+#include <src/runtime/module-desc.h>
+#include <src/error-util.h>
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+void link_bytecode(struct module_desc_t* modptr) {
+
+    const size_t unused = ~0ul;
+
+    for(const size_t operand : modptr->jump_fixups) {
+        uint8_t* ptr = modptr->bytecode.data() + operand;
+
+        const size_t label = opc_read_jump_operand(ptr);
+        if(label >= modptr->jump_targets.size())
+            INTERNAL_ERR();
+
+        const size_t target = modptr->jump_targets[label];
+        if(target == unused) {
+            throw std::runtime_error(
+                    "jump label " + std::to_string(label) + " in module '" +
+                    modptr->name + "' was never defined");
+        }
+
+        if(target > modptr->bytecode.size())
+            INTERNAL_ERR();
+
+        // jump opcodes are one byte, the offset is relative to the opcode
+        const size_t inst = operand - 1ul;
+        const int64_t offset = (int64_t)target - (int64_t)inst;
+        if(offset < INT32_MIN || offset > INT32_MAX)
+            INTERNAL_ERR();
+
+        opc_write_jump_operand(ptr, (uint32_t)(int32_t)offset);
+    }
+
+    modptr->jump_fixups.clear();
+    modptr->jump_fixups.shrink_to_fit();
+    modptr->jump_targets.clear();
+    modptr->jump_targets.shrink_to_fit();
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <src/runtime/module-desc.h>
+
+//
+// rewrites every jump operand from a label id into the signed offset from the
+// jump instruction to its target, so executing a branch never has to look a
+// label up. throws if a jump refers to a label that was never defined.
+// afterwards the module no longer carries any label information
+//
+void link_bytecode(struct module_desc_t* modptr);
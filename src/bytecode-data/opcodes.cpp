@@ -3,21 +3,21 @@
 
 #include <stdexcept>
 
-static void opc_inst(struct module_desc_t* modptr, opcode_t opc) {
+void opc_encode_opcode(std::vector<uint8_t>& bytecode, opcode_t opc) {
     uint16_t u16 = static_cast<uint16_t>(opc);
     if(u16 < 0b01111111) {
-        modptr->bytecode.push_back((uint8_t)(u16 & 0xFF));
+        bytecode.push_back((uint8_t)(u16 & 0xFF));
     } else if(u16 < 0b0011111111111111) {
-        modptr->bytecode.push_back((uint8_t)(((u16 >> 7) & 0xFF) | 0x80));
-        modptr->bytecode.push_back((uint8_t)(u16 & 0xFF));
+        bytecode.push_back((uint8_t)(((u16 >> 7) & 0xFF) | 0x80));
+        bytecode.push_back((uint8_t)(u16 & 0xFF));
     } else {
-        modptr->bytecode.push_back((uint8_t)(((u16 >> 14) & 0xFF) | 0x80));
-        modptr->bytecode.push_back((uint8_t)(((u16 >>  7) & 0xFF) | 0x80));
-        modptr->bytecode.push_back((uint8_t)(u16 & 0xFF));
+        bytecode.push_back((uint8_t)(((u16 >> 14) & 0xFF) | 0x80));
+        bytecode.push_back((uint8_t)(((u16 >>  7) & 0xFF) | 0x80));
+        bytecode.push_back((uint8_t)(u16 & 0xFF));
     }
 }
 
-static void opc_size_const(struct module_desc_t* modptr, const size_t u64) {
+void opc_encode_size_const(std::vector<uint8_t>& bytecode, const size_t u64) {
     // stores large ints in big-endian order, 7 bits at a time
     static_assert(sizeof(size_t) == 8);
 
@@ -34,10 +34,29 @@ static void opc_size_const(struct module_desc_t* modptr, const size_t u64) {
     for(; chunks > 0; chunks--) {
         const size_t shftamt = 7ul * chunks;
         const size_t tmp = ((u64 >> shftamt) & 0b01111111) | 0b10000000; // intermediate chunks always prepended with 1
-        modptr->bytecode.push_back((uint8_t)(tmp & 0xFF));
+        bytecode.push_back((uint8_t)(tmp & 0xFF));
     }
 
-    modptr->bytecode.push_back((uint8_t)(u64 & 0x7F)); // last chunk always prepended with 0 to indicate end
+    bytecode.push_back((uint8_t)(u64 & 0x7F)); // last chunk always prepended with 0 to indicate end
+}
+
+static void opc_inst(struct module_desc_t* modptr, opcode_t opc) {
+    opc_encode_opcode(modptr->bytecode, opc);
+}
+
+static void opc_size_const(struct module_desc_t* modptr, const size_t u64) {
+    opc_encode_size_const(modptr->bytecode, u64);
+}
+
+static void opc_jump_label(struct module_desc_t* modptr, const size_t jump_label) {
+    if(jump_label > 0xFFFFFFFFul)
+        INTERNAL_ERR();
+
+    // remember where the operand is so the link pass can find it
+    modptr->jump_fixups.push_back(modptr->bytecode.size());
+
+    modptr->bytecode.resize(modptr->bytecode.size() + opc_jump_operand_size);
+    opc_write_jump_operand(&modptr->bytecode.back() - (opc_jump_operand_size - 1ul), (uint32_t)jump_label);
 }
 
 void opc::UNIMPLEMENTED(struct module_desc_t*) {
@@ -50,17 +69,17 @@ void opc::clear_stack(struct module_desc_t* modptr) {
 
 void opc::jump_exe(struct module_desc_t* modptr, const size_t jump_label) {
     opc_inst(modptr, opcode_t::jump_exe);
-    opc_size_const(modptr, jump_label);
+    opc_jump_label(modptr, jump_label);
 }
 
 void opc::jump_on_false(struct module_desc_t* modptr, const size_t jump_label) {
     opc_inst(modptr, opcode_t::jump_false);
-    opc_size_const(modptr, jump_label);
+    opc_jump_label(modptr, jump_label);
 }
 
 void opc::jump_on_true(struct module_desc_t* modptr, const size_t jump_label) {
     opc_inst(modptr, opcode_t::jump_true);
-    opc_size_const(modptr, jump_label);
+    opc_jump_label(modptr, jump_label);
 }
 
 void opc::push_true(struct module_desc_t* modptr) {
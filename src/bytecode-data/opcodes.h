@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include <vector>
+
 enum class opcode_t : uint16_t {
     clear_stack,
 
@@ -68,6 +70,33 @@ enum class opcode_t : uint16_t {
 
 };
 
+//
+// raw encoders shared by the opc:: emitters and the optimizer. opcodes and
+// most operands are stored big-endian, 7 bits per byte, high bit set on every
+// byte but the last
+//
+void opc_encode_opcode(std::vector<uint8_t>& bytecode, opcode_t opc);
+void opc_encode_size_const(std::vector<uint8_t>& bytecode, const size_t u64);
+
+//
+// jump operands are a fixed 4 bytes (big-endian) so the link pass can patch
+// them in place. until the module is linked they hold the jump label, after
+// that the signed offset from the first byte of the jump instruction to the
+// target. every jump opcode encodes in a single byte
+//
+const size_t opc_jump_operand_size = 4ul;
+
+inline void opc_write_jump_operand(uint8_t* dst, uint32_t u32) {
+    dst[0] = (uint8_t)(u32 >> 24);
+    dst[1] = (uint8_t)(u32 >> 16);
+    dst[2] = (uint8_t)(u32 >>  8);
+    dst[3] = (uint8_t)(u32);
+}
+
+inline uint32_t opc_read_jump_operand(const uint8_t* src) {
+    return ((uint32_t)src[0] << 24) | ((uint32_t)src[1] << 16) | ((uint32_t)src[2] << 8) | (uint32_t)src[3];
+}
+
 namespace opc {
 
     void UNIMPLEMENTED(struct module_desc_t*);
@@ -0,0 +1,402 @@
+#include <src/bytecode-data/optimize.h>
+#include <src/bytecode-data/instruction.h>
+#include <src/bytecode-data/opcodes.h>
+#include <src/runtime/module-desc.h>
+#include <src/error-util.h>
+
+#include <stdint.h>
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+//
+// while optimizing, jump operands hold the index of the target instruction.
+// an index equal to insts.size() means the end of the module
+//
+struct opt_state_t {
+    std::vector<bytecode_inst_t> insts;
+    std::vector<bool>            is_target;
+    std::vector<bool>            dead;
+};
+
+static bool opt_is_jump(opcode_t op) {
+    return op == opcode_t::jump_exe || op == opcode_t::jump_true || op == opcode_t::jump_false;
+}
+
+static bool opt_is_cond_jump(opcode_t op) {
+    return op == opcode_t::jump_true || op == opcode_t::jump_false;
+}
+
+static void opt_mark_targets(opt_state_t& st) {
+    st.is_target.assign(st.insts.size() + 1ul, false);
+    for(const bytecode_inst_t& inst : st.insts) {
+        if(opt_is_jump(inst.op))
+            st.is_target[inst.operand] = true;
+    }
+}
+
+//
+// drops every instruction marked dead. jumps to a dead instruction are moved
+// to the next live one, which is what would have executed after it
+//
+static bool opt_compact(opt_state_t& st) {
+
+    const size_t n = st.insts.size();
+    std::vector<size_t> remap(n + 1ul);
+
+    size_t live = 0ul;
+    for(size_t i = 0ul; i < n; i++) {
+        remap[i] = live;
+        if(!st.dead[i])
+            live++;
+    }
+    remap[n] = live;
+
+    if(live == n)
+        return false;
+
+    std::vector<bytecode_inst_t> insts;
+    insts.reserve(live);
+    for(size_t i = 0ul; i < n; i++) {
+        if(st.dead[i])
+            continue;
+
+        bytecode_inst_t inst = st.insts[i];
+        if(opt_is_jump(inst.op))
+            inst.operand = remap[inst.operand];
+        insts.push_back(inst);
+    }
+
+    st.insts.swap(insts);
+    st.dead.assign(st.insts.size(), false);
+    opt_mark_targets(st);
+    return true;
+}
+
+static bool opt_fold(opcode_t op, size_t a, size_t b, bytecode_inst_t& result) {
+    result.operand = 0ul;
+
+    switch(op) {
+    case opcode_t::operator_add:
+        if(a + b < a)
+            return false;
+        result.op = opcode_t::push_uinteger;
+        result.operand = a + b;
+        return true;
+
+    case opcode_t::operator_subtract:
+        if(b > a)
+            return false;
+        result.op = opcode_t::push_uinteger;
+        result.operand = a - b;
+        return true;
+
+    case opcode_t::operator_multiply:
+        if(a != 0ul && (a * b) / a != b)
+            return false;
+        result.op = opcode_t::push_uinteger;
+        result.operand = a * b;
+        return true;
+
+    case opcode_t::operator_divide:
+        if(b == 0ul)
+            return false;
+        result.op = opcode_t::push_uinteger;
+        result.operand = a / b;
+        return true;
+
+    case opcode_t::operator_cmp_lt: result.op = (a <  b) ? opcode_t::push_true : opcode_t::push_false; return true;
+    case opcode_t::operator_cmp_le: result.op = (a <= b) ? opcode_t::push_true : opcode_t::push_false; return true;
+    case opcode_t::operator_cmp_gt: result.op = (a >  b) ? opcode_t::push_true : opcode_t::push_false; return true;
+    case opcode_t::operator_cmp_ge: result.op = (a >= b) ? opcode_t::push_true : opcode_t::push_false; return true;
+
+    default:
+        return false;
+    }
+}
+
+static bool opt_fold_constants(opt_state_t& st) {
+
+    bool changed = false;
+    const size_t n = st.insts.size();
+
+    for(size_t i = 0ul; i + 2ul < n; i++) {
+        bytecode_inst_t& lhs = st.insts[i];
+        const bytecode_inst_t& rhs = st.insts[i + 1ul];
+        const bytecode_inst_t& op  = st.insts[i + 2ul];
+
+        if(lhs.op != opcode_t::push_uinteger || rhs.op != opcode_t::push_uinteger)
+            continue;
+        if(st.is_target[i + 1ul] || st.is_target[i + 2ul])
+            continue;
+
+        bytecode_inst_t result;
+        if(!opt_fold(op.op, lhs.operand, rhs.operand, result))
+            continue;
+
+        lhs = result;
+        st.dead[i + 1ul] = true;
+        st.dead[i + 2ul] = true;
+        changed = true;
+        i += 2ul;
+    }
+
+    return changed;
+}
+
+static bool opt_const_branches(opt_state_t& st) {
+
+    bool changed = false;
+    const size_t n = st.insts.size();
+
+    for(size_t i = 1ul; i < n; i++) {
+        bytecode_inst_t& jmp = st.insts[i];
+        const opcode_t push  = st.insts[i - 1ul].op;
+
+        if(!opt_is_cond_jump(jmp.op) || st.is_target[i])
+            continue;
+        if(push != opcode_t::push_true && push != opcode_t::push_false)
+            continue;
+
+        const bool taken = (push == opcode_t::push_true) == (jmp.op == opcode_t::jump_true);
+        if(taken)
+            jmp.op = opcode_t::jump_exe;
+        else
+            st.dead[i] = true;
+        changed = true;
+    }
+
+    // jumps to the very next instruction do nothing, conditional ones only peek
+    for(size_t i = 0ul; i < n; i++) {
+        if(!st.dead[i] && opt_is_jump(st.insts[i].op) && st.insts[i].operand == i + 1ul) {
+            st.dead[i] = true;
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+//
+// successors of instruction i in the control flow graph
+//
+static size_t opt_successors(const opt_state_t& st, size_t i, size_t succ[2]) {
+    const bytecode_inst_t& inst = st.insts[i];
+
+    switch(inst.op) {
+    case opcode_t::return_:
+        return 0ul;
+
+    case opcode_t::jump_exe:
+        succ[0] = inst.operand;
+        return 1ul;
+
+    case opcode_t::jump_true:
+    case opcode_t::jump_false: {
+        succ[0] = inst.operand;
+
+        // both outcomes of the same TOS have already been handled
+        const bool paired =
+                i > 0ul && !st.is_target[i] &&
+                opt_is_cond_jump(st.insts[i - 1ul].op) &&
+                st.insts[i - 1ul].op != inst.op;
+        if(paired)
+            return 1ul;
+
+        succ[1] = i + 1ul;
+        return 2ul;
+    }
+
+    default:
+        succ[0] = i + 1ul;
+        return 1ul;
+    }
+}
+
+static bool opt_remove_unreachable(opt_state_t& st) {
+
+    const size_t n = st.insts.size();
+    std::vector<bool> reached(n + 1ul, false);
+    std::vector<size_t> work;
+
+    if(n == 0ul)
+        return false;
+
+    reached[0] = true;
+    work.push_back(0ul);
+
+    while(work.size() > 0ul) {
+        const size_t i = work.back();
+        work.pop_back();
+
+        size_t succ[2];
+        const size_t count = opt_successors(st, i, succ);
+        for(size_t s = 0ul; s < count; s++) {
+            if(!reached[succ[s]]) {
+                reached[succ[s]] = true;
+                if(succ[s] < n)
+                    work.push_back(succ[s]);
+            }
+        }
+    }
+
+    bool changed = false;
+    for(size_t i = 0ul; i < n; i++) {
+        if(!reached[i] && !st.dead[i]) {
+            st.dead[i] = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+//
+// forward dataflow: is the operand stack known to be empty before each
+// instruction? only clear_stack empties it, and only scope and jump
+// instructions are known to leave an empty stack alone
+//
+static bool opt_remove_clear_stack(opt_state_t& st) {
+
+    const size_t n = st.insts.size();
+    if(n == 0ul)
+        return false;
+
+    // optimistic start, every state only ever moves from empty to unknown
+    std::vector<bool> empty_in(n + 1ul, true);
+    std::vector<bool> queued(n, true);
+    std::vector<size_t> work;
+    for(size_t i = n; i > 0ul; i--)
+        work.push_back(i - 1ul);
+
+    while(work.size() > 0ul) {
+        const size_t i = work.back();
+        work.pop_back();
+        queued[i] = false;
+
+        bool out;
+        switch(st.insts[i].op) {
+        case opcode_t::clear_stack:
+            out = true;
+            break;
+        case opcode_t::pop_scope:
+        case opcode_t::push_scope_for:
+        case opcode_t::push_scope_if:
+        case opcode_t::jump_exe:
+        case opcode_t::jump_true:
+        case opcode_t::jump_false:
+            out = empty_in[i];
+            break;
+        default:
+            out = false;
+            break;
+        }
+
+        size_t succ[2];
+        const size_t count = opt_successors(st, i, succ);
+        for(size_t s = 0ul; s < count; s++) {
+            const size_t j = succ[s];
+            if(empty_in[j] && !out) {
+                empty_in[j] = false;
+                if(j < n && !queued[j]) {
+                    queued[j] = true;
+                    work.push_back(j);
+                }
+            }
+        }
+    }
+
+    bool changed = false;
+    for(size_t i = 0ul; i < n; i++) {
+        if(st.insts[i].op == opcode_t::clear_stack && empty_in[i] && !st.dead[i]) {
+            st.dead[i] = true;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+optimize_stats_t optimize_bytecode(struct module_desc_t* modptr) {
+
+    optimize_stats_t stats;
+    stats.bytes_before = modptr->bytecode.size();
+
+    if(modptr->jump_fixups.size() > 0ul)
+        INTERNAL_ERR(); // must be linked first
+
+    opt_state_t st;
+    std::vector<size_t> offsets;
+    bytecode_decode_all(modptr->bytecode, st.insts, offsets);
+    stats.insts_before = st.insts.size();
+
+    // jump operands : byte offset -> instruction index
+    for(bytecode_inst_t& inst : st.insts) {
+        if(!opt_is_jump(inst.op))
+            continue;
+
+        if(inst.operand == modptr->bytecode.size()) {
+            inst.operand = st.insts.size();
+        } else {
+            auto iter = std::lower_bound(offsets.begin(), offsets.end(), inst.operand);
+            if(iter == offsets.end() || *iter != inst.operand)
+                INTERNAL_ERR(); // jump into the middle of an instruction
+            inst.operand = iter - offsets.begin();
+        }
+    }
+
+    st.dead.assign(st.insts.size(), false);
+    opt_mark_targets(st);
+
+    // each pass can expose work for the others
+    bool changed = true;
+    while(changed) {
+        changed = false;
+
+        changed |= opt_fold_constants(st);
+        opt_compact(st);
+
+        changed |= opt_const_branches(st);
+        opt_compact(st);
+
+        changed |= opt_remove_unreachable(st);
+        opt_compact(st);
+
+        changed |= opt_remove_clear_stack(st);
+        opt_compact(st);
+    }
+
+    //
+    // instruction indices -> byte offsets, then encode. jumps are fixed size
+    // so offsets can be computed in one pass
+    //
+    offsets.resize(st.insts.size() + 1ul);
+    size_t offset = 0ul;
+    for(size_t i = 0ul; i < st.insts.size(); i++) {
+        offsets[i] = offset;
+        offset += bytecode_inst_size(st.insts[i]);
+    }
+    offsets[st.insts.size()] = offset;
+
+    std::vector<uint8_t> bytecode;
+    bytecode.reserve(offset);
+    for(bytecode_inst_t inst : st.insts) {
+        if(opt_is_jump(inst.op))
+            inst.operand = offsets[inst.operand];
+        bytecode_encode(bytecode, inst);
+    }
+
+    modptr->bytecode.swap(bytecode);
+
+    stats.bytes_after = modptr->bytecode.size();
+    stats.insts_after = st.insts.size();
+    return stats;
+}
+
+std::ostream& operator<<(std::ostream& os, const optimize_stats_t& stats) {
+    os << "optimizer: "
+       << stats.insts_before << " -> " << stats.insts_after << " instructions ("
+       << (stats.insts_before - stats.insts_after) << " removed), "
+       << stats.bytes_before << " -> " << stats.bytes_after << " bytes ("
+       << (stats.bytes_before - stats.bytes_after) << " removed)\n";
+    return os;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <src/runtime/module-desc.h>
+
+#include <stddef.h>
+
+struct optimize_stats_t {
+    size_t bytes_before = 0ul;
+    size_t bytes_after  = 0ul;
+    size_t insts_before = 0ul;
+    size_t insts_after  = 0ul;
+};
+
+//
+// peephole and cleanup passes over linked bytecode, repeated until nothing
+// changes:
+//
+//  - push_uinteger a, push_uinteger b, <arith or compare> is folded into a
+//    single push. subtraction that would underflow, overflowing multiplies
+//    and division by zero are left for the runtime to report
+//  - push_true/push_false followed by a conditional jump becomes an
+//    unconditional jump or disappears
+//  - unreachable instructions and jumps to the next instruction are removed
+//  - clear_stack is removed where the stack is already empty on every path
+//
+// conditional jumps peek at TOS, so a jump_true directly followed by a
+// jump_false (or the reverse) never falls through. nothing is ever folded
+// across a jump target. jumps are re-encoded afterwards
+//
+optimize_stats_t optimize_bytecode(struct module_desc_t* modptr);
+
+std::ostream& operator<<(std::ostream& os, const optimize_stats_t& stats);
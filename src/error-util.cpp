@@ -5,13 +5,13 @@
 
 #include <execinfo.h>
 
-ParserError_t::ParserError_t(const std::vector<char>& src) : src_ref(src) {
+ParserError_t::ParserError_t(src_t& src) : src_ref(src) {
 }
 
 void throw_parse_error(
         const std::string& error_desc, 
         const std::string& filename, 
-        const std::vector<char>& src, 
+        src_t& src, 
         int src_idx, 
         const token_t& token) {
 
@@ -34,18 +34,18 @@ void throw_parse_error(
 void throw_parse_error(
         const std::string& error_desc,
         const std::string& filename,
-        const std::vector<char>& src,
+        src_t& src,
         const token_t& token) {
     throw_parse_error(error_desc, filename, src, token.start, token);
 }
 
-LexerError_t::LexerError_t(const std::vector<char>& src) : src_ref(src) {
+LexerError_t::LexerError_t(src_t& src) : src_ref(src) {
 }
 
 void throw_lexer_error(
         const std::string& error_desc,
         const std::string& filename,
-        const std::vector<char>& src,
+        src_t& src,
         int src_idx) {
 
     LexerError_t lexer_error(src);
@@ -80,11 +80,18 @@ void handle_lexer_error(std::ostream& os, LexerError_t& lexer_error) {
     print_error_source(os, lexer_error.error_location, lexer_error.src_ref, 1);
 }
 
-void print_error_source(std::ostream& os, int src_idx, const std::vector<char>& src, const int error_len) {
+void print_error_source(std::ostream& os, int src_idx, src_t& src, const int error_len) {
 
     //os << std::string(src.begin(), src.end()) << std::endl;
     //os << "Error index: " << src_idx << std::endl;
 
+    if(src.size() == 0ul)
+        return;
+
+    // mapped source has no trailing terminator. never read past the last byte
+    if(src_idx >= (int)src.size())
+        src_idx = src.size() - 1;
+
     const auto src_iter = src.begin();
     auto error_iter = src_iter + src_idx;
 
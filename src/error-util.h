@@ -4,18 +4,19 @@
 
 #include <vector>
 #include <string>
+#include <stdexcept>
 
 #define STR(s) std::to_string(s)
 
 #define INTERNAL_ERR() throw std::runtime_error("Unknown internal error\n    file : " + std::string(__FILE__) + "\n    line : " + std::to_string(__LINE__))
 
-void print_error_source(std::ostream& os, int src_idx, const std::vector<char>& src, const int error_len);
+void print_error_source(std::ostream& os, int src_idx, src_t& src, const int error_len);
 
 struct ParserError_t {
 
-    ParserError_t(const std::vector<char>& src);
+    ParserError_t(src_t& src);
 
-    const std::vector<char>& src_ref;
+    src_t& src_ref;
     std::string error_desc;
     std::string filename;
     int error_location;
@@ -25,21 +26,21 @@ struct ParserError_t {
 void throw_parse_error(
         const std::string& error_desc, 
         const std::string& filename, 
-        const std::vector<char>& src, 
+        src_t& src, 
         int src_idx, 
         const token_t& token);
 
 void throw_parse_error(
         const std::string& error_desc,
         const std::string& filename,
-        const std::vector<char>& src,
+        src_t& src,
         const token_t& token);
 
 struct LexerError_t {
 
-    LexerError_t(const std::vector<char>& src);
+    LexerError_t(src_t& src);
 
-    const std::vector<char> src_ref;
+    src_t& src_ref;
     std::string error_desc;
     std::string filename;
     int error_location; 
@@ -50,7 +51,7 @@ void handle_lexer_error(std::ostream& os, LexerError_t& lexer_error);
 void throw_lexer_error(
         const std::string& error_desc,
         const std::string& filename,
-        const std::vector<char>& src,
+        src_t& src,
         int src_idx);
 
 void handle_parse_error(std::ostream& os, ParserError_t& parse_error);
@@ -2,68 +2,76 @@
 
 #include <vector>
 #include <string>
-#include <iostream>
-
-std::vector<char> read_hdl_file_contents(const std::string& filename) {
-
-    std::vector<char> v;
-
-    FILE* fptr = fopen(filename.c_str(), "rb");
-
-    const int SRC_BUF_SIZE = 512;
-    char src_buf[SRC_BUF_SIZE];
-
-    const int state_default         = 0;
-    const int state_first_fwd_slash = 1;
-    const int state_comment         = 2;
-
-    int state_current = state_default;
-
-    int rd_sz = fread(src_buf, 1, SRC_BUF_SIZE, fptr);
-    while(rd_sz > 0) {
-
-        for(int i = 0; i < rd_sz; i++) {
-            const char c = src_buf[i];
-
-            switch(state_current) {
-            case state_default:
-                if(c == '/') {
-                    state_current = state_first_fwd_slash;
-                }
-                else {
-                    if(c != '\r')
-                        v.push_back(c);
-                }
-                break;
-            case state_first_fwd_slash:
-                if(c == '/') {
-                    state_current = state_comment;
-                }
-                else {
-                    v.push_back('/');
-                    if(c != '\r')
-                        v.push_back(c);
-                    state_current = state_default;
-                }
-                break;
-            case state_comment:
-                if(c == '\n') {
-                    v.push_back('\n');
-                    state_current = state_default;
-                }
-                break;
-            }
-        }
-
-        rd_sz = fread(src_buf, 1, SRC_BUF_SIZE, fptr);
-    }
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+src_buffer_t::src_buffer_t(void) : data_ptr(""), data_len(0ul), mapped(false) {
+}
+
+src_buffer_t::src_buffer_t(src_buffer_t&& other)
+        : data_ptr(other.data_ptr), data_len(other.data_len), mapped(other.mapped) {
 
-    fclose(fptr);
+    other.data_ptr = "";
+    other.data_len = 0ul;
+    other.mapped   = false;
+}
+
+src_buffer_t& src_buffer_t::operator=(src_buffer_t&& other) {
+    if(this != &other) {
+        if(this->mapped)
+            munmap((void*)this->data_ptr, this->data_len);
+
+        this->data_ptr = other.data_ptr;
+        this->data_len = other.data_len;
+        this->mapped   = other.mapped;
+
+        other.data_ptr = "";
+        other.data_len = 0ul;
+        other.mapped   = false;
+    }
+    return *this;
+}
 
-    v.push_back('\n');
-    v.push_back('\0');
-    std::cout << v.data();
-    v.pop_back();
-    return v;
+src_buffer_t::~src_buffer_t() {
+    if(this->mapped)
+        munmap((void*)this->data_ptr, this->data_len);
 }
 
+src_buffer_t read_hdl_file_contents(const std::string& filename) {
+
+    src_buffer_t buf;
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw std::runtime_error("unable to open source file '" + filename + "'");
+
+    struct stat st;
+    if(fstat(fd, &st) < 0) {
+        close(fd);
+        throw std::runtime_error("unable to stat source file '" + filename + "'");
+    }
+
+    // mmap refuses zero-length mappings. an empty file is just an empty buffer
+    if(st.st_size == 0) {
+        close(fd);
+        return buf;
+    }
+
+    void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // mapping stays valid after the descriptor is closed
+
+    if(ptr == MAP_FAILED)
+        throw std::runtime_error("unable to map source file '" + filename + "'");
+
+    // the lexer makes a single forward pass over the file
+    madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+
+    buf.data_ptr = (const char*)ptr;
+    buf.data_len = st.st_size;
+    buf.mapped   = true;
+    return buf;
+}
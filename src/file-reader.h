@@ -1,7 +1,36 @@
 #pragma once
 
 #include <stdio.h>
+#include <stddef.h>
 #include <vector>
 #include <string>
 
-std::vector<char> read_hdl_file_contents(const std::string& filename);
+//
+// read-only view of a source file. the file is mapped directly into memory so
+// the lexer works on the original bytes: no copy is made and every offset into
+// the buffer is an offset into the file on disk
+//
+struct src_buffer_t {
+
+    src_buffer_t(void);
+    src_buffer_t(src_buffer_t&& other);
+    src_buffer_t(const src_buffer_t&) = delete;
+    src_buffer_t& operator=(const src_buffer_t&) = delete;
+    src_buffer_t& operator=(src_buffer_t&& other);
+    ~src_buffer_t();
+
+    const char* begin(void) const { return this->data_ptr; }
+    const char* end(void) const   { return this->data_ptr + this->data_len; }
+    size_t size(void) const       { return this->data_len; }
+
+    const char& operator[](size_t idx) const { return this->data_ptr[idx]; }
+
+    const char* data_ptr;
+    size_t      data_len;
+    bool        mapped; // false for empty files, nothing to unmap
+};
+
+//
+// throws std::runtime_error if the file can not be opened or mapped
+//
+src_buffer_t read_hdl_file_contents(const std::string& filename);
@@ -0,0 +1,492 @@
+#include <src/lexer-simd.h>
+#include <src/lexer.h>
+#include <src/file-reader.h>
+#include <src/error-util.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#   define LEXER_SIMD_X86 1
+#   include <emmintrin.h>
+#   include <immintrin.h>
+#endif
+
+//
+// character classes. each one knows how to test a single byte and, on x86,
+// how to test 16 (SSE2) or 32 (AVX2) bytes at once. vector tests produce 0xFF
+// in every lane that belongs to the class
+//
+
+#ifdef LEXER_SIMD_X86
+
+// unsigned lo <= v <= hi, SSE2 has no unsigned byte compare so go through min
+static inline __m128i sse2_in_range(__m128i v, char lo, char hi) {
+    const __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(hi - lo)), t);
+}
+
+static inline __m128i sse2_eq(__m128i v, char c) {
+    return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_in_range(__m256i v, char lo, char hi) {
+    const __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(hi - lo)), t);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_eq(__m256i v, char c) {
+    return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+#endif // LEXER_SIMD_X86
+
+struct class_whitespace_t {
+    static inline bool in_class(const char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+#ifdef LEXER_SIMD_X86
+    static inline __m128i in_class(__m128i v) {
+        return _mm_or_si128(
+                _mm_or_si128(sse2_eq(v, ' '), sse2_eq(v, '\n')),
+                _mm_or_si128(sse2_eq(v, '\r'), sse2_eq(v, '\t')));
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i in_class(__m256i v) {
+        return _mm256_or_si256(
+                _mm256_or_si256(avx2_eq(v, ' '), avx2_eq(v, '\n')),
+                _mm256_or_si256(avx2_eq(v, '\r'), avx2_eq(v, '\t')));
+    }
+#endif
+};
+
+struct class_word_t {
+    static inline bool in_class(const char c) {
+        return (c == '_') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+    }
+
+#ifdef LEXER_SIMD_X86
+    // setting bit 5 folds upper case onto lower case without creating new letters
+    static inline __m128i in_class(__m128i v) {
+        const __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        return _mm_or_si128(
+                _mm_or_si128(sse2_in_range(lower, 'a', 'z'), sse2_in_range(v, '0', '9')),
+                sse2_eq(v, '_'));
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i in_class(__m256i v) {
+        const __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        return _mm256_or_si256(
+                _mm256_or_si256(avx2_in_range(lower, 'a', 'z'), avx2_in_range(v, '0', '9')),
+                avx2_eq(v, '_'));
+    }
+#endif
+};
+
+struct class_decimal_t {
+    static inline bool in_class(const char c) {
+        return (c >= '0' && c <= '9') || c == '_';
+    }
+
+#ifdef LEXER_SIMD_X86
+    static inline __m128i in_class(__m128i v) {
+        return _mm_or_si128(sse2_in_range(v, '0', '9'), sse2_eq(v, '_'));
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i in_class(__m256i v) {
+        return _mm256_or_si256(avx2_in_range(v, '0', '9'), avx2_eq(v, '_'));
+    }
+#endif
+};
+
+struct class_binary_t {
+    static inline bool in_class(const char c) {
+        return c == '0' || c == '1' || c == '_';
+    }
+
+#ifdef LEXER_SIMD_X86
+    static inline __m128i in_class(__m128i v) {
+        return _mm_or_si128(sse2_in_range(v, '0', '1'), sse2_eq(v, '_'));
+    }
+
+    __attribute__((target("avx2")))
+    static inline __m256i in_class(__m256i v) {
+        return _mm256_or_si256(avx2_in_range(v, '0', '1'), avx2_eq(v, '_'));
+    }
+#endif
+};
+
+template<class char_class_t>
+static const char* scan_scalar(const char* ptr, const char* end) {
+    while(ptr < end && char_class_t::in_class(*ptr))
+        ptr++;
+    return ptr;
+}
+
+#ifdef LEXER_SIMD_X86
+
+template<class char_class_t>
+static const char* scan_sse2(const char* ptr, const char* end) {
+    while(end - ptr >= 16) {
+        const __m128i v  = _mm_loadu_si128((const __m128i*)ptr);
+        const unsigned m = (unsigned)_mm_movemask_epi8(char_class_t::in_class(v));
+        if(m != 0xFFFFu)
+            return ptr + __builtin_ctz(~m);
+        ptr += 16;
+    }
+    return scan_scalar<char_class_t>(ptr, end);
+}
+
+template<class char_class_t>
+__attribute__((target("avx2")))
+static const char* scan_avx2(const char* ptr, const char* end) {
+    while(end - ptr >= 32) {
+        const __m256i v  = _mm256_loadu_si256((const __m256i*)ptr);
+        const unsigned m = (unsigned)_mm256_movemask_epi8(char_class_t::in_class(v));
+        if(m != 0xFFFFFFFFu)
+            return ptr + __builtin_ctz(~m);
+        ptr += 32;
+    }
+    return scan_sse2<char_class_t>(ptr, end);
+}
+
+#endif // LEXER_SIMD_X86
+
+typedef const char* (*scan_fn_t)(const char*, const char*);
+
+struct scan_table_t {
+    lexer_simd_level_t level;
+    scan_fn_t whitespace;
+    scan_fn_t word;
+    scan_fn_t decimal;
+    scan_fn_t binary;
+};
+
+static scan_table_t scan_table_for(lexer_simd_level_t level) {
+    switch(level) {
+#ifdef LEXER_SIMD_X86
+    case lexer_simd_level_t::avx2:
+        return {
+            level,
+            scan_avx2<class_whitespace_t>, scan_avx2<class_word_t>,
+            scan_avx2<class_decimal_t>,    scan_avx2<class_binary_t> };
+    case lexer_simd_level_t::sse2:
+        return {
+            level,
+            scan_sse2<class_whitespace_t>, scan_sse2<class_word_t>,
+            scan_sse2<class_decimal_t>,    scan_sse2<class_binary_t> };
+#endif
+    default:
+        return {
+            lexer_simd_level_t::scalar,
+            scan_scalar<class_whitespace_t>, scan_scalar<class_word_t>,
+            scan_scalar<class_decimal_t>,    scan_scalar<class_binary_t> };
+    }
+}
+
+static lexer_simd_level_t best_supported_level(void) {
+#ifdef LEXER_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return lexer_simd_level_t::avx2;
+    return lexer_simd_level_t::sse2; // always present on x86-64
+#else
+    return lexer_simd_level_t::scalar;
+#endif
+}
+
+static scan_table_t current_table = scan_table_for(best_supported_level());
+
+const char* lexer_scan_whitespace(const char* ptr, const char* end) { return current_table.whitespace(ptr, end); }
+const char* lexer_scan_word(const char* ptr, const char* end)       { return current_table.word(ptr, end);       }
+const char* lexer_scan_decimal(const char* ptr, const char* end)    { return current_table.decimal(ptr, end);    }
+const char* lexer_scan_binary(const char* ptr, const char* end)     { return current_table.binary(ptr, end);     }
+
+lexer_simd_level_t lexer_simd_select(lexer_simd_level_t level) {
+    const lexer_simd_level_t best = best_supported_level();
+    if(static_cast<int>(level) > static_cast<int>(best))
+        level = best;
+
+    current_table = scan_table_for(level);
+    return current_table.level;
+}
+
+lexer_simd_level_t lexer_simd_level(void) {
+    return current_table.level;
+}
+
+const std::string lexer_simd_level_name(lexer_simd_level_t level) {
+    switch(level) {
+    case lexer_simd_level_t::scalar: return "scalar";
+    case lexer_simd_level_t::sse2:   return "sse2";
+    case lexer_simd_level_t::avx2:   return "avx2";
+    default: return "unknown";
+    }
+}
+
+//
+// checking. lex_result_t is what lexing one input gives, the tokens up to the
+// error if there is one
+//
+
+struct lex_result_t {
+    token_buffer_t tkns;
+    std::string error;
+    int error_at = -1;
+};
+
+struct lex_input_t {
+    std::string name;
+    std::vector<std::string> texts; // lexed one by one
+    size_t bytes = 0ul;
+};
+
+static void lex_text(const std::string& text, lex_result_t& r) {
+
+    // a view of the string, nothing to unmap
+    src_buffer_t src;
+    src.data_ptr = text.data();
+    src.data_len = text.size();
+
+    r.error.clear();
+    r.error_at = -1;
+    try {
+        lexical_analyze(src, "<check>", r.tkns);
+    }
+    catch(LexerError_t& err) {
+        r.error    = err.error_desc;
+        r.error_at = err.error_location;
+    }
+}
+
+static bool lex_same(const lex_result_t& a, const lex_result_t& b) {
+    return a.error == b.error && a.error_at == b.error_at &&
+           a.tkns.types == b.tkns.types && a.tkns.starts == b.tkns.starts && a.tkns.aux == b.tkns.aux;
+}
+
+struct lex_rng_t {
+    uint64_t state = 0x9e3779b97f4a7c15ul;
+
+    uint64_t next(void) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    size_t below(size_t n) { return (size_t)(next() % n); }
+};
+
+static const char lex_word_chars[]   = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
+static const char lex_space_chars[]  = " \t\n\r";
+static const char lex_syntax_chars[] = ";.,|&^+*~[](){}$-:><!=";
+
+static void lex_run(lex_rng_t& rng, std::string& out, const char* chars, size_t n_chars, size_t n) {
+    for(size_t i = 0ul; i < n; i++)
+        out.push_back(chars[rng.below(n_chars)]);
+}
+
+//
+// one token and the whitespace after it. runs go up to 100 bytes so they
+// start and end anywhere within the 16 and 32 byte blocks of the scanners
+//
+static void lex_soup_token(lex_rng_t& rng, std::string& out) {
+
+    switch(rng.below(8)) {
+    case 0:
+    case 1:
+        out.push_back(lex_word_chars[rng.below(52)]);
+        lex_run(rng, out, lex_word_chars, 63, rng.below(100));
+        break;
+    case 2:
+        out.push_back("123456789"[rng.below(9)]);
+        lex_run(rng, out, "0123456789_", 11, rng.below(100));
+        break;
+    case 3:
+        out += "0b";
+        lex_run(rng, out, "01_", 3, rng.below(100));
+        break;
+    case 4:
+        out.push_back('@');
+        lex_run(rng, out, "01_", 3, rng.below(100));
+        break;
+    case 5:
+        out.push_back('"');
+        lex_run(rng, out, lex_word_chars, 63, rng.below(40));
+        out.push_back('"');
+        break;
+    case 6:
+        out += "//";
+        lex_run(rng, out, lex_word_chars, 63, rng.below(60));
+        out.push_back('\n');
+        break;
+    default:
+        out.push_back(lex_syntax_chars[rng.below(sizeof(lex_syntax_chars) - 1ul)]);
+        break;
+    }
+
+    lex_run(rng, out, lex_space_chars, 4, 1ul + rng.below(100));
+}
+
+//
+// modules in the style of the example designs, with long names, long
+// literals and deep indentation
+//
+static std::string lex_large_design(lex_rng_t& rng, size_t bytes) {
+
+    std::string out;
+    out.reserve(bytes + 4096ul);
+
+    auto name = [&](void) {
+        std::string n(1ul, lex_word_chars[rng.below(52)]);
+        lex_run(rng, n, lex_word_chars, 63, 4ul + rng.below(40));
+        return n;
+    };
+
+    for(size_t m = 0ul; out.size() < bytes; m++) {
+        out += "module gen_" + std::to_string(m) + "(width : integer)\n    in: a, b[width];\n    out: q[width];\nstart\n";
+        for(size_t i = 0ul; i < 64ul; i++) {
+            out += std::string(4ul + rng.below(40), ' ') + "local " + name() + " = and(in.a, 0b";
+            lex_run(rng, out, "01_", 3, 8ul + rng.below(64));
+            out += ", @";
+            lex_run(rng, out, "01", 2, 1ul + rng.below(64));
+            out += ", " + std::to_string(rng.next()) + ");";
+            if(rng.below(4) == 0ul)
+                out += "    // " + name() + " " + name();
+            out += "\n";
+        }
+        out += "end\n\n";
+    }
+    return out;
+}
+
+//
+// every scanner from every offset of bytes that are mostly in the classes,
+// with a few of every other value, against the scalar ones
+//
+static bool lex_check_scanners(lex_rng_t& rng, const scan_table_t& scalar, const scan_table_t& table) {
+
+    const char* fill[] = { " \t\n\r", "abcXYZ019_", "0123456789_", "01_" };
+
+    for(size_t c = 0ul; c < 4ul; c++) {
+        std::string bytes;
+        for(size_t i = 0ul; i < 4096ul; i++)
+            bytes.push_back(rng.below(16) == 0ul ? (char)rng.below(256) : fill[c][rng.below(strlen(fill[c]))]);
+
+        const scan_fn_t expect = c == 0ul ? scalar.whitespace : c == 1ul ? scalar.word : c == 2ul ? scalar.decimal : scalar.binary;
+        const scan_fn_t got    = c == 0ul ? table.whitespace  : c == 1ul ? table.word  : c == 2ul ? table.decimal  : table.binary;
+
+        const char* end = bytes.data() + bytes.size();
+        for(const char* p = bytes.data(); p < end; p++) {
+            const char* stop = p + rng.below((size_t)(end - p) + 1ul);
+            if(got(p, end) != expect(p, end) || got(p, stop) != expect(p, stop))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool lexer_simd_check(std::ostream& os, const std::vector<std::string>& files) {
+
+    lex_rng_t rng;
+    std::vector<lex_input_t> inputs(3);
+
+    inputs[0].name = "files";
+    for(const std::string& file : files) {
+        const src_buffer_t src = read_hdl_file_contents(file);
+        inputs[0].texts.emplace_back(src.begin(), src.end());
+    }
+
+    inputs[1].name = "generated";
+    inputs[1].texts.push_back(lex_large_design(rng, 8ul << 20));
+
+    // many short soups so a few stop at an unknown byte early, the rest run
+    // to the end
+    inputs[2].name = "random";
+    for(size_t i = 0ul; i < 256ul; i++) {
+        std::string text;
+        while(text.size() < 8192ul)
+            lex_soup_token(rng, text);
+        if(i % 8ul == 0ul)
+            text[rng.below(text.size())] = (char)(0x80ul + rng.below(128));
+        inputs[2].texts.push_back(text);
+    }
+
+    for(lex_input_t& in : inputs)
+        for(const std::string& text : in.texts)
+            in.bytes += text.size();
+
+    const lexer_simd_level_t best = best_supported_level();
+    const scan_table_t saved = current_table;
+    const scan_table_t scalar = scan_table_for(lexer_simd_level_t::scalar);
+
+    bool ok = true;
+
+    os << "lexer, " << lexer_simd_level_name(saved.level) << " selected, MB/s\n";
+    os << "    input        bytes";
+    for(int l = 0; l <= static_cast<int>(best); l++)
+        os << std::setw(10) << lexer_simd_level_name(static_cast<lexer_simd_level_t>(l));
+    os << "\n" << std::fixed << std::setprecision(1);
+
+    for(const lex_input_t& in : inputs) {
+        if(in.bytes == 0ul)
+            continue;
+
+        os << "    " << std::left << std::setw(10) << in.name << std::right << std::setw(8) << in.bytes;
+
+        std::vector<lex_result_t> expected(in.texts.size());
+        lex_result_t r;
+
+        // at least 32 MB lexed for the rate, in whole passes
+        const size_t repeat = std::max((size_t)1ul, (32ul << 20) / in.bytes);
+
+        for(int l = 0; l <= static_cast<int>(best); l++) {
+            current_table = scan_table_for(static_cast<lexer_simd_level_t>(l));
+
+            bool same = true;
+            for(size_t i = 0ul; i < in.texts.size(); i++) {
+                lex_text(in.texts[i], l == 0 ? expected[i] : r);
+                if(l != 0 && !lex_same(expected[i], r))
+                    same = false;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            for(size_t k = 0ul; k < repeat; k++)
+                for(const std::string& text : in.texts)
+                    lex_text(text, r);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if(!same) {
+                os << std::setw(10) << "MISMATCH";
+                ok = false;
+            } else {
+                os << std::setw(10) << (ms > 0.0 ? in.bytes * repeat / (ms * 1000.0) : 0.0);
+            }
+        }
+        os << "\n";
+    }
+
+    os << "    scanners from every offset :";
+    for(int l = 1; l <= static_cast<int>(best); l++) {
+        const bool same = lex_check_scanners(rng, scalar, scan_table_for(static_cast<lexer_simd_level_t>(l)));
+        os << " " << lexer_simd_level_name(static_cast<lexer_simd_level_t>(l)) << (same ? " ok" : " MISMATCH");
+        ok = ok && same;
+    }
+    os << "\n" << std::defaultfloat;
+
+    current_table = saved;
+    return ok;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//
+// vectorized scanners used by the lexer. each returns a pointer to the first byte
+// in [ptr, end) that does NOT belong to the given character class, or end if every
+// byte does. none of them read past end
+//
+// SSE2 is the baseline on x86-64, AVX2 is selected at runtime when the cpu has it.
+// other targets use the scalar versions
+//
+
+enum class lexer_simd_level_t {
+    scalar,
+    sse2,
+    avx2,
+};
+
+const char* lexer_scan_whitespace(const char* ptr, const char* end); // ' ' '\n' '\r' '\t'
+const char* lexer_scan_word(const char* ptr, const char* end);       // a-z A-Z 0-9 _
+const char* lexer_scan_decimal(const char* ptr, const char* end);    // 0-9 _
+const char* lexer_scan_binary(const char* ptr, const char* end);     // 0 1 _
+
+//
+// best level is chosen automatically. forcing a level the cpu does not support
+// falls back to the best supported one. returns the level actually in use
+//
+// the level is a plain global every lexing thread reads without a lock, so
+// select it (and run lexer_simd_check) only while no file is being lexed,
+// not while the compile driver has units in flight
+//
+lexer_simd_level_t lexer_simd_select(lexer_simd_level_t level);
+lexer_simd_level_t lexer_simd_level(void);
+const std::string lexer_simd_level_name(lexer_simd_level_t level);
+
+//
+// lexes files, a large generated design and random token soup at every level
+// the cpu supports, compares the tokens (or the error lexing stopped at) with
+// the scalar level and prints the rate of each one. the scanners are also run
+// from every offset of random bytes. returns false if anything differs. leaves
+// the selected level alone
+//
+bool lexer_simd_check(std::ostream& os, const std::vector<std::string>& files);
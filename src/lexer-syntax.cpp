@@ -9,11 +9,11 @@ static const bool lexer_syntax_multichar(const char c) {
     return c == ':' || c == '>' || c == '<' || c == '!' || c == '=';
 }
 
-void lexer_consume_syntax(src_iter_t& iter, src_t& src, const std::string& filename, std::vector<token_t>& tkns) {
+void lexer_consume_syntax(src_iter_t& iter, src_t& src, const std::string& filename, token_buffer_t& tkns) {
 
     auto src_end = src.end();
     const char c0 = *iter;
-    const char c1 = *(iter + 1);
+    const char c1 = (iter + 1 < src_end) ? *(iter + 1) : '\0';
 
     token_t tok;
     tok.start = iter - src.begin();
@@ -5,5 +5,5 @@
 #include <vector>
 #include <string>
 
-void lexer_consume_syntax(src_iter_t& iter, src_t& src, const std::string& filename, std::vector<token_t>& tkns);
+void lexer_consume_syntax(src_iter_t& iter, src_t& src, const std::string& filename, token_buffer_t& tkns);
 
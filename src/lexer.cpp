@@ -1,5 +1,6 @@
 #include <src/lexer.h>
 #include <src/lexer-syntax.h>
+#include <src/lexer-simd.h>
 #include <src/error-util.h>
 #include <src/semantic-analysis/parser.h>
 
@@ -9,88 +10,396 @@
 #include <iostream>
 #include <algorithm>
 
-static std::string filename;
-static const std::vector<char>* srcptr;
-static src_iter_t srcbegin;
-static src_iter_t srcend;
+#include <string.h>
+
+//
+// everything the lexer needs while scanning one file. lives on the stack of
+// lexical_analyze so several files can be lexed at the same time
+//
+struct lexer_ctx_t {
+    const std::string&    filename;
+    src_t&                src;
+    src_iter_t            begin;
+    src_iter_t            end;
+    token_buffer_t&       tkns;
+};
 
-static const bool is_word_char(const char c);
 static const bool is_number_char(const char c);
-static const bool is_whitespace(const char c);
 static const bool is_hex_digit(const char c);
 
-static const bool lexer_seek(src_iter_t& iter);
+static const bool lexer_seek(lexer_ctx_t& lx, src_iter_t& iter);
+static void lexer_skip_line_comment(lexer_ctx_t& lx, src_iter_t& iter);
 
-static void lexer_consume_string(src_iter_t& iter, std::vector<token_t>& tkns);
-static void lexer_consume_bitliteral(src_iter_t& iter, std::vector<token_t>& tkns);
+static void lexer_consume_string(lexer_ctx_t& lx, src_iter_t& iter);
+static void lexer_consume_bitliteral(lexer_ctx_t& lx, src_iter_t& iter);
 
-static void lexer_consume_number(src_iter_t& iter, std::vector<token_t>& tkns);
-static void lexer_consume_binary_number(src_iter_t& iter, std::vector<token_t>& tkns);
-static void lexer_consume_hex_number(src_iter_t& iter, std::vector<token_t>& tkns);
-static void lexer_consume_decimal_number(src_iter_t& iter, std::vector<token_t>& tkns);
+static void lexer_consume_number(lexer_ctx_t& lx, src_iter_t& iter);
+static void lexer_consume_binary_number(lexer_ctx_t& lx, src_iter_t& iter);
+static void lexer_consume_hex_number(lexer_ctx_t& lx, src_iter_t& iter);
+static void lexer_consume_decimal_number(lexer_ctx_t& lx, src_iter_t& iter);
 
-static void lexer_consume_word(src_iter_t& iter, std::vector<token_t>& tkns);
-static void lexer_word_eval(token_t& token, std::vector<token_t>& tkns);
+static void lexer_consume_word(lexer_ctx_t& lx, src_iter_t& iter);
+static void lexer_word_eval(lexer_ctx_t& lx, token_t& token);
 
 static const bool lexer_is_var_char(const char c);
 
+//
+// first-byte classification for the main lexer loop. replaces a chain of
+// range checks and a linear search over the syntax characters
+//
+enum char_class_t : uint8_t {
+    char_class_invalid,
+    char_class_word,
+    char_class_number,
+    char_class_string,
+    char_class_bitliteral,
+    char_class_whitespace,
+    char_class_syntax,
+};
+
+struct char_class_table_t {
+    uint8_t cls[256];
+};
+
+static constexpr char_class_table_t make_char_class_table(void) {
+    char_class_table_t t = {};
+    for(int c = 'a'; c <= 'z'; c++) t.cls[c] = char_class_word;
+    for(int c = 'A'; c <= 'Z'; c++) t.cls[c] = char_class_word;
+    for(int c = '0'; c <= '9'; c++) t.cls[c] = char_class_number;
+    t.cls[(int)'_'] = char_class_word;
+    t.cls[(int)'"'] = char_class_string;
+    t.cls[(int)'@'] = char_class_bitliteral;
+    t.cls[(int)' '] = t.cls[(int)'\n'] = t.cls[(int)'\r'] = t.cls[(int)'\t'] = char_class_whitespace;
+
+    const char syntax_chars[] = "><$^*&+-=/:;.,()[]{}|~!";
+    for(int i = 0; syntax_chars[i] != '\0'; i++)
+        t.cls[(uint8_t)syntax_chars[i]] = char_class_syntax;
+    return t;
+}
+
+static constexpr char_class_table_t char_class_table = make_char_class_table();
+
+//
+// keywords and builtin functions share one table. identifiers are matched against it
+// with a perfect hash generated at compile time: one multiply over the length and
+// three characters of the word picks the only slot it could possibly occupy
+//
+struct keyword_entry_t {
+    const char*     name;
+    size_t          len;
+    token_type_t    type; // token_type_t::function for builtin functions
+    function_type_t fn;
+};
+
+static constexpr size_t const_strlen(const char* s) {
+    size_t n = 0ul;
+    while(s[n] != '\0')
+        n++;
+    return n;
+}
+
+static constexpr keyword_entry_t kw(const char* name, token_type_t type, function_type_t fn = function_type_t::UNKNOWN) {
+    return { name, const_strlen(name), type, fn };
+}
+
+static constexpr keyword_entry_t fn(const char* name, function_type_t fn) {
+    return kw(name, token_type_t::function, fn);
+}
+
+static constexpr keyword_entry_t keyword_entries[] = {
+    kw("integer",  token_type_t::keyword_integer  ),
+    kw("uinteger", token_type_t::keyword_uinteger ),
+    kw("string",   token_type_t::keyword_string   ),
+    kw("bit",      token_type_t::keyword_bit      ),
+    kw("module",   token_type_t::keyword_module   ),
+    kw("out",      token_type_t::keyword_out      ),
+    kw("in",       token_type_t::keyword_in       ),
+    kw("start",    token_type_t::keyword_start    ),
+    kw("end",      token_type_t::keyword_end      ),
+    kw("void",     token_type_t::keyword_void     ),
+    kw("local",    token_type_t::keyword_local    ),
+    kw("ref",      token_type_t::keyword_ref      ),
+    kw("builtin",  token_type_t::keyword_builtin  ),
+    kw("for",      token_type_t::keyword_for      ),
+    kw("true",     token_type_t::keyword_true_    ),
+    kw("false",    token_type_t::keyword_false_   ),
+    kw("vector",   token_type_t::keyword_vector, function_type_t::vector ),
+
+    fn("push",    function_type_t::push  ),
+    fn("last",    function_type_t::last  ),
+    fn("print",   function_type_t::print ),
+    fn("cast",    function_type_t::cast  ),
+
+    fn("cmpeq",   function_type_t::cmpeq   ),
+    fn("match",   function_type_t::match   ),
+    fn("decoder", function_type_t::decoder ),
+    fn("signal",  function_type_t::signal  ),
+
+    fn("wire",      function_type_t::wire      ),
+    fn("and",       function_type_t::and_      ),
+    fn("nand",      function_type_t::nand      ),
+    fn("or",        function_type_t::or_       ),
+    fn("nor",       function_type_t::nor_      ),
+    fn("xor",       function_type_t::xor_      ),
+    fn("xnor",      function_type_t::xnor_     ),
+    fn("flipflop",  function_type_t::flipflop  ),
+    fn("set_ff_data",  function_type_t::set_ff_data  ),
+    fn("set_ff_clock", function_type_t::set_ff_clock ),
+
+    fn("tristate",            function_type_t::tristate            ),
+    fn("set_tristate_data",   function_type_t::set_tristate_data   ),
+    fn("set_tristate_enable", function_type_t::set_tristate_enable ),
+
+    fn("size",      function_type_t::size      ),
+    fn("not",       function_type_t::not_ ),
+};
+
+static constexpr size_t keyword_count      = sizeof(keyword_entries) / sizeof(keyword_entries[0]);
+static constexpr size_t keyword_table_bits = 7;
+static constexpr size_t keyword_table_size = 1ul << keyword_table_bits;
+
+static_assert(keyword_count < keyword_table_size, "keyword hash table too small");
+
+static constexpr uint32_t keyword_hash(const char* s, size_t len, uint32_t seed) {
+    const uint32_t key =
+            (uint32_t)(uint8_t)len |
+            ((uint32_t)(uint8_t)s[0]         <<  8) |
+            ((uint32_t)(uint8_t)s[len / 2]   << 16) |
+            ((uint32_t)(uint8_t)s[len - 1]   << 24);
+    return (key * seed) >> (32 - keyword_table_bits);
+}
+
+static constexpr size_t keyword_min_len(void) {
+    size_t n = ~0ul;
+    for(size_t i = 0ul; i < keyword_count; i++)
+        n = keyword_entries[i].len < n ? keyword_entries[i].len : n;
+    return n;
+}
+
+static constexpr size_t keyword_max_len(void) {
+    size_t n = 0ul;
+    for(size_t i = 0ul; i < keyword_count; i++)
+        n = keyword_entries[i].len > n ? keyword_entries[i].len : n;
+    return n;
+}
+
+static constexpr bool keyword_seed_is_perfect(uint32_t seed) {
+    bool used[keyword_table_size] = {};
+    for(size_t i = 0ul; i < keyword_count; i++) {
+        const uint32_t h = keyword_hash(keyword_entries[i].name, keyword_entries[i].len, seed);
+        if(used[h])
+            return false;
+        used[h] = true;
+    }
+    return true;
+}
+
+// walk an LCG until a multiplier separates every entry. 0 means none was found
+static constexpr uint32_t keyword_find_seed(void) {
+    uint64_t state = 0x9E3779B97F4A7C15ul;
+    for(int attempt = 0; attempt < 100000; attempt++) {
+        state = state * 6364136223846793005ul + 1442695040888963407ul;
+        const uint32_t seed = (uint32_t)(state >> 32) | 1u;
+        if(keyword_seed_is_perfect(seed))
+            return seed;
+    }
+    return 0u;
+}
+
+static constexpr uint32_t keyword_seed = keyword_find_seed();
+static_assert(keyword_seed != 0u, "unable to find perfect hash for keyword table");
+
+struct keyword_table_t {
+    uint8_t slot[keyword_table_size]; // index into keyword_entries plus one, 0 is empty
+};
+
+static constexpr keyword_table_t make_keyword_table(void) {
+    keyword_table_t t = {};
+    for(size_t i = 0ul; i < keyword_count; i++)
+        t.slot[keyword_hash(keyword_entries[i].name, keyword_entries[i].len, keyword_seed)] = i + 1;
+    return t;
+}
+
+static constexpr keyword_table_t keyword_table   = make_keyword_table();
+static constexpr size_t          keyword_min     = keyword_min_len();
+static constexpr size_t          keyword_max     = keyword_max_len();
+
+//
+// returns NULL if word is not a keyword or builtin function. does not allocate
+//
+static inline const keyword_entry_t* lexer_keyword_lookup(const char* word, size_t len) {
+    if(len < keyword_min || len > keyword_max)
+        return NULL;
+
+    const uint8_t slot = keyword_table.slot[keyword_hash(word, len, keyword_seed)];
+    if(slot == 0)
+        return NULL;
+
+    const keyword_entry_t* kw = &keyword_entries[slot - 1];
+    if(kw->len != len || memcmp(kw->name, word, len) != 0)
+        return NULL;
+    return kw;
+}
+
+//
+// lengths of tokens whose text is fixed by their type, used to derive the end
+// offset of tokens in a token_buffer_t. everything not listed is a single
+// character of syntax
+//
+struct token_length_table_t {
+    uint8_t by_type[256];
+    uint8_t by_fn[256];
+};
+
+static constexpr token_length_table_t make_token_length_table(void) {
+    token_length_table_t t = {};
+    for(size_t i = 0ul; i < 256ul; i++)
+        t.by_type[i] = 1;
+
+    t.by_type[(size_t)token_type_t::greater_eq] = 2;
+    t.by_type[(size_t)token_type_t::less_eq]    = 2;
+    t.by_type[(size_t)token_type_t::equiv]      = 2;
+    t.by_type[(size_t)token_type_t::not_equiv]  = 2;
+    t.by_type[(size_t)token_type_t::bit_assign] = 2;
+
+    for(size_t i = 0ul; i < keyword_count; i++) {
+        const keyword_entry_t& e = keyword_entries[i];
+        if(e.type == token_type_t::function)
+            t.by_fn[(size_t)e.fn] = e.len;
+        else
+            t.by_type[(size_t)e.type] = e.len;
+    }
+    return t;
+}
+
+static constexpr token_length_table_t token_length_table = make_token_length_table();
+
+void token_buffer_t::clear(void) {
+    this->types.clear();
+    this->starts.clear();
+    this->aux.clear();
+}
+
+void token_buffer_t::reserve(size_t n) {
+    this->types.reserve(n);
+    this->starts.reserve(n);
+    this->aux.reserve(n);
+}
+
+void token_buffer_t::push_back(const token_t& tok) {
+    uint32_t a = 0u;
+
+    switch(tok.type) {
+    case token_type_t::variable_name:
+    case token_type_t::bit_literal:
+        a = tok.sym;
+        break;
+    case token_type_t::function:
+        a = (uint32_t)tok.fn;
+        break;
+    case token_type_t::number_dec:
+    case token_type_t::number_hex:
+    case token_type_t::number_bin:
+    case token_type_t::string_literal:
+        a = tok.end - tok.start;
+        break;
+    default:
+        break;
+    }
+
+    this->types.push_back((uint8_t)tok.type);
+    this->starts.push_back(tok.start);
+    this->aux.push_back(a);
+}
+
+token_t token_buffer_t::operator[](size_t idx) const {
+    token_t tok;
+    tok.type  = (token_type_t)this->types[idx];
+    tok.start = this->starts[idx];
+
+    const uint32_t a = this->aux[idx];
+    uint32_t len;
+
+    switch(tok.type) {
+    case token_type_t::variable_name:
+    case token_type_t::bit_literal:
+        tok.sym = a;
+        len = string_pool_len(global_string_pool(), a);
+        break;
+    case token_type_t::function:
+        tok.fn = (function_type_t)a;
+        len = token_length_table.by_fn[a & 0xFFu];
+        break;
+    case token_type_t::keyword_vector:
+        tok.fn = function_type_t::vector;
+        len = token_length_table.by_type[(size_t)tok.type];
+        break;
+    case token_type_t::number_dec:
+    case token_type_t::number_hex:
+    case token_type_t::number_bin:
+    case token_type_t::string_literal:
+        len = a;
+        break;
+    default:
+        len = token_length_table.by_type[(size_t)tok.type];
+        break;
+    }
+
+    tok.end = tok.start + len;
+    return tok;
+}
+
 void lexical_analyze(
         src_t& src, 
         const std::string& filename, 
-        std::vector<token_t>& tkns) {
-
-    ::filename = filename;
-    srcptr     = &src;
-    srcbegin   = srcptr->begin();
-    srcend     = srcptr->end();
+        token_buffer_t& tkns) {
 
+    // the example designs average one token per three to six bytes
     tkns.clear();
-    token_t token;
+    tkns.reserve(src.size() / 4ul + 16ul);
 
-    src_iter_t iter = srcbegin;
+    lexer_ctx_t lx = { filename, src, src.begin(), src.end(), tkns };
 
-    lexer_seek(iter);
+    src_iter_t iter = lx.begin;
 
-    const std::string syntax_chars = "><$^*&+-=/:;.,()[]{}|~!";
+    lexer_seek(lx, iter);
 
-    while(iter < srcend) {
+    while(iter < lx.end) {
         const char c = *iter;
 
-        if(is_word_char(c)) { // either keyword or variable name
-            lexer_consume_word(iter, tkns);
-        }
-        else if(is_number_char(c)) { // some kind of number
-            lexer_consume_number(iter, tkns);
-        }
-        else if(c == '"') { // string
-            lexer_consume_string(iter, tkns);
-        }
-        else if(c == '@') { // bit literal
-            lexer_consume_bitliteral(iter, tkns);
-        }
-        else if(is_whitespace(c)) {
-            lexer_seek(iter);
-        }
-        else {
-            auto syntax_begin = syntax_chars.begin();
-            auto syntax_end   = syntax_chars.end();
-            auto find_iter = std::find(syntax_begin, syntax_end, c);
-
-            if(find_iter == syntax_end)
-                throw_lexer_error("unknown character", filename, src, iter - srcbegin);
-
-            lexer_consume_syntax(iter, src, filename, tkns);
+        switch(char_class_table.cls[(uint8_t)c]) {
+        case char_class_word: // either keyword or variable name
+            lexer_consume_word(lx, iter);
+            break;
+        case char_class_number: // some kind of number
+            lexer_consume_number(lx, iter);
+            break;
+        case char_class_string:
+            lexer_consume_string(lx, iter);
+            break;
+        case char_class_bitliteral:
+            lexer_consume_bitliteral(lx, iter);
+            break;
+        case char_class_whitespace:
+            lexer_seek(lx, iter);
+            break;
+        case char_class_syntax:
+            if(c == '/' && iter + 1 < lx.end && *(iter + 1) == '/') { // line comment
+                lexer_skip_line_comment(lx, iter);
+            } else {
+                lexer_consume_syntax(iter, src, filename, tkns);
+            }
+            break;
+        default:
+            throw_lexer_error("unknown character", filename, src, iter - lx.begin);
         }
     }
 }
 
-static void lexer_consume_number(src_iter_t& iter, std::vector<token_t>& tkns) {
+static void lexer_consume_number(lexer_ctx_t& lx, src_iter_t& iter) {
 
     auto second_char_iter = iter + 1;
 
-    if(second_char_iter >= srcend)
-        throw_lexer_error("malformed number", filename, *srcptr, iter - srcbegin);
-
     //
     // 0 - just zero
     // 0bnn - binary number
@@ -99,158 +408,120 @@ static void lexer_consume_number(src_iter_t& iter, std::vector<token_t>& tkns) {
     //
 
     const char c0 = *iter;
-    const char c1 = *second_char_iter;
+    const char c1 = (second_char_iter < lx.end) ? *second_char_iter : '\0';
 
     if(c0 == '0' && !is_number_char(c1) && c1 != 'b' && c1 != 'x') { // just zero
         token_t tok;
         tok.type  = token_type_t::number_dec;
-        tok.start = iter - srcptr->begin();
-        tok.end   = second_char_iter - srcptr->begin();
-        tkns.push_back(tok);
+        tok.start = iter - lx.begin;
+        tok.end   = second_char_iter - lx.begin;
+        lx.tkns.push_back(tok);
         iter++;
         return;
     }
 
     if(c0 == '0') {
         switch(c1) {
-        case 'b': return lexer_consume_binary_number(iter, tkns);
-        case 'x': return lexer_consume_hex_number(iter, tkns);
+        case 'b': return lexer_consume_binary_number(lx, iter);
+        case 'x': return lexer_consume_hex_number(lx, iter);
         default:
-            throw_lexer_error("malformed '0'. note : multiple zeroes is invalid", filename, *srcptr, iter - srcbegin);
+            throw_lexer_error("malformed '0'. note : multiple zeroes is invalid", lx.filename, lx.src, iter - lx.begin);
         }
     }
 
-    lexer_consume_decimal_number(iter, tkns);
+    lexer_consume_decimal_number(lx, iter);
 }
 
-static void lexer_consume_binary_number(src_iter_t& iter, std::vector<token_t>& tkns) {
+static void lexer_consume_binary_number(lexer_ctx_t& lx, src_iter_t& iter) {
     // first two chars are "0b"
 
     token_t tok;
     tok.type = token_type_t::number_bin;
-    tok.start = iter - srcbegin;
+    tok.start = iter - lx.begin;
 
-    iter += 2;
-
-    while(iter < srcend) {
-        const char c = *iter;
+    iter = lexer_scan_binary(iter + 2, lx.end);
 
-        if(c == '0' || c == '1' || c == '_') {
-            iter++;
-        } else {
-            tok.end = iter - srcbegin;
-            tkns.push_back(tok);
-            return;
-        }
-    }
-
-    throw_lexer_error("malformed binary number", filename, *srcptr, tok.start);
+    // may end exactly at end of file
+    tok.end = iter - lx.begin;
+    lx.tkns.push_back(tok);
 }
 
-static void lexer_consume_hex_number(src_iter_t& iter, std::vector<token_t>& tkns) {
+static void lexer_consume_hex_number(lexer_ctx_t& lx, src_iter_t& iter) {
     // first two chars are "0x"
 
     token_t tok;
     tok.type = token_type_t::number_hex;
-    tok.start = iter - srcbegin;
+    tok.start = iter - lx.begin;
     iter += 2;
 
-    while(iter < srcend) {
+    while(iter < lx.end) {
         const char c = *iter;
 
         if(is_hex_digit(c) || c == '_') {
             iter++;
         } else {
-            tok.end = iter - srcbegin;
-            tkns.push_back(tok);
+            tok.end = iter - lx.begin;
+            lx.tkns.push_back(tok);
             return;
         }
     }
 
-    throw_lexer_error("malformed hexadecimal number", filename, *srcptr, tok.start);
+    tok.end = iter - lx.begin;
+    lx.tkns.push_back(tok);
 }
 
-static void lexer_consume_decimal_number(src_iter_t& iter, std::vector<token_t>& tkns) {
+static void lexer_consume_decimal_number(lexer_ctx_t& lx, src_iter_t& iter) {
     token_t tok;
     tok.type = token_type_t::number_dec;
-    tok.start = iter - srcbegin;
+    tok.start = iter - lx.begin;
 
-    while(iter < srcend) {
-        const char c = *iter;
+    iter = lexer_scan_decimal(iter, lx.end);
 
-        if(is_number_char(c) || c == '_') {
-            iter++;
-        } else {
-            tok.end = iter - srcbegin;
-            tkns.push_back(tok);
-            return;
-        }
-    }
-
-    throw_lexer_error("malformed decimal number", filename, *srcptr, tok.start);
+    tok.end = iter - lx.begin;
+    lx.tkns.push_back(tok);
 }
 
-static void lexer_consume_word(src_iter_t& iter, std::vector<token_t>& tkns) {
+static void lexer_consume_word(lexer_ctx_t& lx, src_iter_t& iter) {
     token_t token;
-    token.start = iter - srcptr->begin();
-    iter++;
+    token.start = iter - lx.begin;
+    iter = lexer_scan_word(iter + 1, lx.end);
 
-    while(iter < srcend) {
-        const char c = *iter;
-        if(is_word_char(c) || is_number_char(c)) {
-            iter++;
-        } else {
-            token.end = iter - srcptr->begin();
-            return lexer_word_eval(token, tkns);
-        }
-    }
-    
-    throw_lexer_error("malformed source file", filename, *srcptr, 0);
+    // a word may end exactly at the end of the file
+    token.end = iter - lx.begin;
+    lexer_word_eval(lx, token);
 }
 
-static void lexer_word_eval(token_t& token, std::vector<token_t>& tkns) {
-    auto srcbeg = srcptr->begin();
-    const std::string word(srcbeg + token.start, srcbeg + token.end);
+static void lexer_word_eval(lexer_ctx_t& lx, token_t& token) {
+    const keyword_entry_t* kw = lexer_keyword_lookup(lx.begin + token.start, token.end - token.start);
 
-    auto kw_tup = lexer_token_is_keyword(word);
-    if(std::get<0>(kw_tup)) {
-        token.type = std::get<2>(kw_tup);
+    if(kw == NULL) {
+        token.type = token_type_t::variable_name;
+        token.fn   = function_type_t::UNKNOWN;
+        token.sym  = string_pool_intern(global_string_pool(), lx.begin + token.start, token.end - token.start);
     } else {
-        auto fn_tup = lexer_token_is_function(word);
-        if(std::get<0>(fn_tup)) {
-            token.type = token_type_t::function;
-        } else {
-            token.type = token_type_t::variable_name;
-        }
+        token.type = kw->type;
+        token.fn   = kw->fn;
     }
 
-    tkns.push_back(token);
+    lx.tkns.push_back(token);
 }
 
-static void lexer_consume_bitliteral(src_iter_t& iter, std::vector<token_t>& tkns) {
+static void lexer_consume_bitliteral(lexer_ctx_t& lx, src_iter_t& iter) {
     token_t token;
     src_iter_t bit_start = iter;
-    iter++;
+    iter = lexer_scan_binary(iter + 1, lx.end);
 
-    while(iter < srcend) {
-        const char c = *iter;
-        if(c == '0' || c == '1' || c == '_') {
-            iter++;
-        } else if(lexer_is_var_char(c)) {
-            throw_lexer_error("malformed bit-literal", filename, *srcptr, iter - srcbegin);
-        } else {
-            token.type  = token_type_t::bit_literal;
-            token.start = bit_start - srcbegin;
-            token.end   = iter - srcbegin;
-            tkns.push_back(token);
-            return;
-        }
-    }
+    if(iter < lx.end && lexer_is_var_char(*iter))
+        throw_lexer_error("malformed bit-literal", lx.filename, lx.src, iter - lx.begin);
 
-    throw_lexer_error("malformed bit-literal at end of source", filename, *srcptr, bit_start - srcbegin - 1);
+    token.type  = token_type_t::bit_literal;
+    token.start = bit_start - lx.begin;
+    token.end   = iter - lx.begin;
+    token.sym   = string_pool_intern(global_string_pool(), bit_start, iter - bit_start);
+    lx.tkns.push_back(token);
 }
 
-static void lexer_consume_string(src_iter_t& iter, std::vector<token_t>& tkns) {
+static void lexer_consume_string(lexer_ctx_t& lx, src_iter_t& iter) {
     token_t token;
 
     src_iter_t string_start = iter + 1; // advance past opening "
@@ -258,52 +529,38 @@ static void lexer_consume_string(src_iter_t& iter, std::vector<token_t>& tkns) {
 
     iter++;
 
-    while(iter < srcend) {
-        std::cout << "string char : " << *iter << std::endl;
+    while(iter < lx.end) {
         if(*iter == '\\') {
             iter += 2;
         } else if(*iter == '"') {
             string_end  = iter;
             token.type  = token_type_t::string_literal;
-            token.start = string_start - srcbegin;
-            token.end   = string_end - srcbegin;
+            token.start = string_start - lx.begin;
+            token.end   = string_end - lx.begin;
             iter++; // advance past closing "
 
-            tkns.push_back(token);
+            lx.tkns.push_back(token);
             return;
         } else {
             iter++;
         }
     }
 
-    throw_lexer_error("malformed string", filename, *srcptr, string_start - srcbegin - 1);
+    throw_lexer_error("malformed string", lx.filename, lx.src, string_start - lx.begin - 1);
 }
 
-static const bool lexer_seek(src_iter_t& iter) {
-    while(iter < srcend) {
-        if(is_whitespace(*iter)) {
-            iter++;
-        } else {
-            return true;
-        }
-    }
-    return false;
+static const bool lexer_seek(lexer_ctx_t& lx, src_iter_t& iter) {
+    iter = lexer_scan_whitespace(iter, lx.end);
+    return iter < lx.end;
 }
 
-static const bool is_whitespace(const char c) {
-    switch(c) {
-    case ' ':
-    case '\n':
-    case '\r':
-    case '\t':
-        return true;
-    default:
-        return false;
-    }
-}
-
-static const bool is_word_char(const char c) {
-    return (c == '_') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+//
+// comments are not stripped ahead of time, token offsets always refer to the
+// file as it exists on disk. leaves iter on the terminating newline
+//
+static void lexer_skip_line_comment(lexer_ctx_t& lx, src_iter_t& iter) {
+    const void* newline = memchr(iter, '\n', lx.end - iter);
+    iter = (newline == NULL) ? lx.end : (src_iter_t)newline;
 }
 
 static const bool is_number_char(const char c) {
@@ -457,13 +714,14 @@ size_t lexer_token_to_uinteger(const token_t& tok, parse_info_t& p) {
     return v;
 }
 
-void print_lexer_tokens(std::vector<token_t>& tkns) {
+void print_lexer_tokens(token_buffer_t& tkns, src_t& src) {
 
     const int padding = 20;
 
-    for(auto& t : tkns) {
+    for(size_t i = 0ul; i < tkns.size(); i++) {
+        const token_t t = tkns[i];
         const string_t tok_type  = lexer_token_type(t.type);
-        const string_t tok_value = lexer_token_value(t, *srcptr);
+        const string_t tok_value = lexer_token_value(t, src);
 
         std::cout << tok_type;
         for(int i = 0; i < (padding - tok_type.size()); i++)
@@ -477,71 +735,21 @@ const bool operator==(const token_t& tok, token_type_t tt) {
     return tok.type == tt;
 }
 
-static const std::map<std::string, token_type_t> keywords = {
-    { "integer",  token_type_t::keyword_integer  },
-    { "uinteger", token_type_t::keyword_uinteger },
-    { "string",   token_type_t::keyword_string   },
-    { "bit",      token_type_t::keyword_bit      },
-    { "module",   token_type_t::keyword_module   },
-    { "out",      token_type_t::keyword_out      },
-    { "in",       token_type_t::keyword_in       },
-    { "start",    token_type_t::keyword_start    },
-    { "end",      token_type_t::keyword_end      },
-    { "void",     token_type_t::keyword_void     },
-    { "local",    token_type_t::keyword_local    },
-    { "ref",      token_type_t::keyword_ref      },
-    { "builtin",  token_type_t::keyword_builtin  },
-    { "for",      token_type_t::keyword_for      },
-    { "true",     token_type_t::keyword_true_    },
-    { "false",    token_type_t::keyword_false_   },
-    { "vector",   token_type_t::keyword_vector   },
-};
-
-static const std::map<std::string, function_type_t> functions = {
-    { "push",    function_type_t::push  },
-    { "last",    function_type_t::last  },
-    { "print",   function_type_t::print },
-    { "cast",    function_type_t::cast  },
-
-    { "cmpeq",   function_type_t::cmpeq   },
-    { "match",   function_type_t::match   },
-    { "decoder", function_type_t::decoder },
-    { "signal",  function_type_t::signal  },
-
-    { "wire",      function_type_t::wire      },
-    { "and",       function_type_t::and_      },
-    { "nand",      function_type_t::nand      },
-    { "or",        function_type_t::or_       },
-    { "nor",       function_type_t::nor_      },
-    { "xor",       function_type_t::xor_      },
-    { "xnor",      function_type_t::xnor_     },
-    { "flipflop",  function_type_t::flipflop  },
-    { "set_ff_data",  function_type_t::set_ff_data  },
-    { "set_ff_clock", function_type_t::set_ff_clock },
-
-    { "tristate",            function_type_t::tristate            },
-    { "set_tristate_data",   function_type_t::set_tristate_data   },
-    { "set_tristate_enable", function_type_t::set_tristate_enable },
-
-    { "size",      function_type_t::size      },
-    { "not",       function_type_t::not_ },
-};
-
 std::tuple<bool, string_t, token_type_t> lexer_token_is_keyword(const std::string& s) {
-    auto iter = keywords.find(s);
-    if(iter == keywords.end()) {
+    const keyword_entry_t* kw = lexer_keyword_lookup(s.data(), s.size());
+    if(kw == NULL || kw->type == token_type_t::function) {
         return { false, "", token_type_t::UNKNOWN };
     } else {
-        return { true, iter->first, iter->second };
+        return { true, kw->name, kw->type };
     }
 }
 
 std::tuple<bool, string_t, function_type_t> lexer_token_is_function(const std::string& s) {
-    auto iter = functions.find(s);
-    if(iter == functions.end()) {
+    const keyword_entry_t* kw = lexer_keyword_lookup(s.data(), s.size());
+    if(kw == NULL || kw->type != token_type_t::function) {
         return { false, "", function_type_t::UNKNOWN };
     } else {
-        return { true, iter->first, iter->second };
+        return { true, kw->name, kw->fn };
     }
 }
 
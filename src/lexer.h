@@ -1,14 +1,19 @@
 #pragma once
 
+#include <src/file-reader.h>
+#include <src/string-pool.h>
+
+#include <stdint.h>
+
 #include <vector>
 #include <string>
 #include <utility>
 #include <tuple>
 
-typedef std::vector<char>::const_iterator src_iter_t;
-typedef const std::vector<char>           src_t;
+typedef const char*        src_iter_t;
+typedef const src_buffer_t src_t;
 
-enum class token_type_t {
+enum class token_type_t : uint8_t {
     UNKNOWN,
     keyword_integer,  // type
     keyword_uinteger, // ...
@@ -106,19 +111,78 @@ enum class function_type_t : uint8_t {
 };
 
 struct token_t {
-    token_type_t type;
+    token_type_t    type;
+    function_type_t fn = function_type_t::UNKNOWN; // resolved by the lexer for token_type_t::function
     int start;
     int end;
+    symbol_t sym = symbol_none; // interned text of variable names and bit-literals
+};
+
+//
+// tokens are stored column-wise: a byte of type, the start offset and a 32-bit
+// payload. the end offset is not stored, it is derived from the type and payload:
+//
+//   variable_name, bit_literal : payload is the interned symbol, length comes from the pool
+//   function                   : payload is the function_type_t, length of its name
+//   numbers, string_literal    : payload is the length
+//   keywords, syntax           : payload unused, length is fixed by the type
+//
+// that is 9 bytes per token instead of sizeof(token_t). the parser reads through
+// token_iterator_t, which hands out token_t by value
+//
+struct token_iterator_t;
+
+struct token_buffer_t {
+    std::vector<uint8_t>  types;
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> aux;
+
+    size_t size(void) const { return this->types.size(); }
+    void clear(void);
+    void reserve(size_t n);
+    void push_back(const token_t& tok);
+
+    token_t operator[](size_t idx) const;
+
+    token_iterator_t begin(void) const;
+    token_iterator_t end(void) const;
+};
+
+struct token_iterator_t {
+    const token_buffer_t* buf;
+    long int idx;
+
+    token_t operator*(void) const { return (*this->buf)[this->idx]; }
+    token_t operator[](long int n) const { return (*this->buf)[this->idx + n]; }
+
+    token_iterator_t& operator++(void)   { this->idx++; return *this; }
+    token_iterator_t operator++(int)     { token_iterator_t t = *this; this->idx++; return t; }
+    token_iterator_t& operator--(void)   { this->idx--; return *this; }
+    token_iterator_t operator--(int)     { token_iterator_t t = *this; this->idx--; return t; }
+    token_iterator_t& operator+=(long int n) { this->idx += n; return *this; }
+    token_iterator_t& operator-=(long int n) { this->idx -= n; return *this; }
+
+    token_iterator_t operator+(long int n) const { return { this->buf, this->idx + n }; }
+    token_iterator_t operator-(long int n) const { return { this->buf, this->idx - n }; }
+    long int operator-(const token_iterator_t& rhs) const { return this->idx - rhs.idx; }
+
+    bool operator==(const token_iterator_t& rhs) const { return this->idx == rhs.idx; }
+    bool operator!=(const token_iterator_t& rhs) const { return this->idx != rhs.idx; }
+    bool operator<(const token_iterator_t& rhs) const  { return this->idx <  rhs.idx; }
+    bool operator<=(const token_iterator_t& rhs) const { return this->idx <= rhs.idx; }
+    bool operator>(const token_iterator_t& rhs) const  { return this->idx >  rhs.idx; }
+    bool operator>=(const token_iterator_t& rhs) const { return this->idx >= rhs.idx; }
 };
 
-typedef std::vector<token_t>::iterator token_iterator_t;
+inline token_iterator_t token_buffer_t::begin(void) const { return { this, 0l }; }
+inline token_iterator_t token_buffer_t::end(void) const   { return { this, (long int)this->size() }; }
 
 const bool operator==(const token_t& tok, token_type_t tt);
 
 //
 // no return type because this function throws exceptions on error
 //
-void lexical_analyze(src_t& src, const std::string& filename, std::vector<token_t>& tkns);
+void lexical_analyze(src_t& src, const std::string& filename, token_buffer_t& tkns);
 
 const bool lexer_token_is_typespec(const token_t& tok);
 
@@ -127,7 +191,7 @@ typedef std::string string_t;
 const string_t lexer_token_type(token_type_t);
 const string_t lexer_token_value(const token_t& tok, src_t& src);
 const string_t lexer_token_desc(const token_t& tok, src_t& src);
-void print_lexer_tokens(std::vector<token_t>& tkns);
+void print_lexer_tokens(token_buffer_t& tkns, src_t& src);
 
 size_t lexer_token_to_uinteger(const token_t& tok, struct parse_info_t& p);
 
@@ -0,0 +1,40 @@
+#include <src/memory-stats.h>
+
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <atomic>
+#include <new>
+
+static std::atomic<size_t> memory_allocations(0ul);
+static std::atomic<size_t> memory_allocated_bytes(0ul);
+
+void* operator new(size_t sz) {
+    memory_allocations.fetch_add(1ul, std::memory_order_relaxed);
+    memory_allocated_bytes.fetch_add(sz, std::memory_order_relaxed);
+
+    void* p = malloc(sz > 0ul ? sz : 1ul);
+    if(p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+memory_stats_t memory_stats(void) {
+    memory_stats_t m;
+    m.allocations     = memory_allocations.load(std::memory_order_relaxed);
+    m.allocated_bytes = memory_allocated_bytes.load(std::memory_order_relaxed);
+
+    // ru_maxrss is in kilobytes on linux
+    struct rusage ru;
+    if(getrusage(RUSAGE_SELF, &ru) == 0)
+        m.peak_rss_bytes = (size_t)ru.ru_maxrss * 1024ul;
+    return m;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+
+//
+// global operator new and delete are replaced by versions that count every
+// allocation, so any phase can be measured by taking the counts before and
+// after it. counting costs one relaxed atomic add per allocation
+//
+struct memory_stats_t {
+    size_t allocations     = 0ul; // calls to operator new so far
+    size_t allocated_bytes = 0ul; // bytes requested by those calls
+    size_t peak_rss_bytes  = 0ul; // high water mark of the resident set so far
+};
+
+memory_stats_t memory_stats(void);
@@ -0,0 +1,2195 @@
+#include <src/runtime/elaborate.h>
+#include <src/runtime/module-desc.h>
+#include <src/runtime/runtime-env.h>
+#include <src/runtime/netlist.h>
+#include <src/bytecode-data/opcodes.h>
+#include <src/string-pool.h>
+#include <src/error-util.h>
+#include <src/thread-pool.h>
+#include <src/arena.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+//
+// the dispatch loop jumps straight from one opcode handler to the next through
+// a table of label addresses (a GNU extension). define
+// ELABORATE_NO_THREADED_DISPATCH, or use another compiler, to get a plain
+// switch in a loop instead
+//
+#if defined(__GNUC__) && !defined(ELABORATE_NO_THREADED_DISPATCH)
+#   define ELABORATE_THREADED_DISPATCH 1
+#endif
+
+static const size_t opcode_count = static_cast<size_t>(opcode_t::push_new_local_module) + 1ul;
+
+static const size_t elaborate_max_depth   = 256ul; // module instances inside module instances
+static const size_t elaborate_max_nesting = 64ul;  // vectors inside vectors when flattening
+static const size_t elaborate_max_trace   = 16ul;  // lines of instance trace in error messages
+
+enum class value_kind_t : uint8_t {
+    none,
+    boolean,
+    integer,
+    string,    // i : symbol
+    net,       // i : net_t
+    bus,       // i : offset into bus_nets, n : width
+    vector,    // i : index into vectors
+    instance,  // i : index into instances
+    record,    // i : index into records. result of match, decoder and cmpeq
+    cell,      // i : gate index of a flipflop or tristate, used as its output
+    range,     // i : first, n : last (inclusive)
+    local_ref, // i : constant index of the name, looked up when the value is used
+    port_ref,  // i : port slot in the running module
+
+    // mark the start of variable length argument lists on the stack
+    fn_args,
+    vec_args,
+    arr_args,
+    module_args,
+};
+
+struct value_t {
+    value_kind_t kind = value_kind_t::none;
+    uint32_t n = 0u;
+    int64_t  i = 0;
+};
+
+static inline value_t make_value(value_kind_t kind, int64_t i = 0, uint32_t n = 0u) {
+    value_t v;
+    v.kind = kind;
+    v.n    = n;
+    v.i    = i;
+    return v;
+}
+
+struct port_desc_t {
+    size_t constant; // index of the port name in the module constants
+    bool is_output;
+    bool is_array;
+};
+
+struct fragment_t;
+
+//
+// everything the interpreter needs to know about a module that is not in the
+// bytecode. built for every module before elaboration starts and read only
+// after that, except for the fragment cache
+//
+struct module_info_t {
+    module_desc_t* mod;
+    uint16_t index;                         // in elab_shared_t::infos, scopes record it as their module
+    std::vector<port_desc_t> ports;         // in interface_elements order
+    std::vector<int32_t> port_of_constant;  // constant index -> port slot, -1 if not a port
+    std::vector<module_info_t*> callee;     // constant index -> module, NULL if no module has that name
+
+    std::mutex lock;
+    std::map<std::vector<int64_t>, std::shared_ptr<fragment_t> > fragments; // argument values -> first instance
+};
+
+enum class fragment_state_t : uint8_t {
+    running,
+    done,
+    failed,
+};
+
+//
+// one module instance elaborated into a netlist of its own. an instance only
+// sees its arguments, never the signals of its parent, so it can be built
+// on any thread. the parent gets placeholder nets for the ports as soon as
+// the sizes of the interface arrays are known and splices the fragment in
+// after the rest of its own body has run. instances are spliced in the order
+// they were created, so net and gate ids do not depend on which thread ran
+// what. a fragment is shared by every instance with the same arguments
+//
+struct fragment_t {
+    module_info_t* info = NULL;
+    netlist_t nl;                       // compacted when done, finalized for the top. see elab_finish for the ports
+    std::vector<uint32_t> port_widths;  // 0 for single bit ports
+    elaborate_stats_t stats;            // the subtree below and including this instance
+    std::string error;                  // when failed
+    std::atomic<fragment_state_t> state;
+
+    // fragments this one is waiting for. guarded by elab_shared_t::graph_lock
+    std::vector<const fragment_t*> waits_for;
+
+    fragment_t(void) : state(fragment_state_t::running) { }
+};
+
+//
+// state shared by every instance of one elaboration
+//
+struct elab_shared_t {
+    runtime_env_t* renv;
+    std::ostream*  os;
+    elaborate_options_t opts;
+    symbol_t sym_output;
+
+    std::deque<module_info_t> infos;
+
+    std::mutex print_lock;
+    std::mutex graph_lock;
+    std::atomic<size_t> tasks; // instances still running on the pool
+    std::atomic<bool>   abort; // set when the top instance failed, pending tasks give up
+
+    elab_shared_t(void) : tasks(0ul), abort(false) { }
+};
+
+struct instance_t {
+    module_info_t* info;
+    uint32_t first_port; // index into ports
+};
+
+struct binding_t {
+    uint32_t name; // constant index
+    int32_t  prev; // binding shadowed by this one, -1 if none
+    value_t  value;
+};
+
+//
+// growable array in the arena of one instance. growing copies the elements
+// unless the array is the newest allocation, the old copy is only freed with
+// everything else when the arena is released
+//
+template<typename T>
+struct elab_array_t {
+
+    elab_array_t(arena_t* arena) : arena(arena) { }
+
+    arena_t* arena;
+    T*       first    = NULL;
+    size_t   count    = 0ul;
+    size_t   capacity = 0ul;
+
+    void reserve(size_t n) {
+        if(n <= this->capacity)
+            return;
+        const size_t grown = std::max(std::max(n, this->capacity * 2ul), (size_t)8ul);
+        this->first    = arena_grow_array(this->arena, this->first, this->count, grown);
+        this->capacity = grown;
+    }
+
+    void push_back(const T& v) {
+        if(this->count == this->capacity)
+            this->reserve(this->count + 1ul);
+        this->first[this->count++] = v;
+    }
+
+    // p must not point into this array
+    void append(const T* p, size_t n) {
+        this->reserve(this->count + n);
+        std::copy(p, p + n, this->first + this->count);
+        this->count += n;
+    }
+
+    void assign(size_t n, const T& v) {
+        this->count = 0ul;
+        this->reserve(n);
+        std::fill(this->first, this->first + n, v);
+        this->count = n;
+    }
+
+    size_t size(void) const  { return this->count; }
+    bool empty(void) const   { return this->count == 0ul; }
+    T* data(void) const      { return this->first; }
+    T* begin(void) const     { return this->first; }
+    T* end(void) const       { return this->first + this->count; }
+    T& back(void) const      { return this->first[this->count - 1ul]; }
+    T& operator[](size_t i) const { return this->first[i]; }
+};
+
+typedef elab_array_t<net_t> elab_nets_t;
+
+//
+// a running module. all of its state lives on the elaborator stacks starting
+// at these offsets
+//
+struct frame_t {
+    module_info_t* info;
+    size_t   stack_base;
+    size_t   binding_base;
+    size_t   slot_base;   // slots[slot_base + constant] is the binding of that name
+    size_t   scope_base;
+    size_t   vector_base;
+    uint32_t first_port;
+
+    size_t   pc      = 0ul; // where the body continues after stopping early
+    uint32_t unsized = 0u;  // interface arrays without a size yet
+};
+
+//
+// a child instance that is spliced into the parent netlist once the parent
+// body is done
+//
+struct child_t {
+    std::shared_ptr<fragment_t> frag;
+    uint32_t first_port; // placeholder ports in the parent
+    uint32_t call_pc;    // bytecode offset of the module call in the parent
+    bool     reused;     // frag was made by another instance with the same arguments
+};
+
+//
+// the interpreter state of one module instance
+//
+struct elaborator_t {
+    elab_shared_t* shared;
+    fragment_t*    frag;
+    netlist_t*     nl; // &frag->nl
+    frame_t        frame;
+
+    std::vector<value_t>   stack;
+    std::vector<binding_t> bindings;
+    std::vector<int32_t>   slots;
+    std::vector<size_t>    scopes; // binding count when each scope was entered
+
+    // values that only live while the instance runs: the elements of
+    // vectors and scratch lists of nets. the whole arena is reset when the
+    // instance is done, vectors never leave the instance that created them
+    // because a module instance only hands signals to its parent. what does
+    // leave (gates, nets and port widths) is in the fragment
+    arena_t arena;
+    std::vector<elab_array_t<value_t> > vectors;
+
+    std::vector<value_t>    ports; // own ports first, then placeholders for the children
+    std::vector<instance_t> instances;
+    std::vector<value_t>    records;
+    std::vector<net_t>      bus_nets;
+    std::vector<child_t>    children;
+
+    size_t depth = 0ul; // instances above this one
+
+    // instructions are this instance only until the children are spliced in
+    elaborate_stats_t stats;
+};
+
+[[noreturn]] static void elab_error(const std::string& msg) {
+    throw std::runtime_error(msg);
+}
+
+static const char* value_kind_name(value_kind_t kind) {
+    switch(kind) {
+    case value_kind_t::none:      return "nothing";
+    case value_kind_t::boolean:   return "boolean";
+    case value_kind_t::integer:   return "integer";
+    case value_kind_t::string:    return "string";
+    case value_kind_t::net:       return "signal";
+    case value_kind_t::bus:       return "signal array";
+    case value_kind_t::vector:    return "vector";
+    case value_kind_t::instance:  return "module instance";
+    case value_kind_t::record:    return "builtin result";
+    case value_kind_t::cell:      return "flipflop/tristate";
+    case value_kind_t::range:     return "range";
+    case value_kind_t::local_ref: return "local reference";
+    case value_kind_t::port_ref:  return "interface reference";
+    default:
+        return "argument list marker";
+    }
+}
+
+static const char* builtin_name(function_type_t fn) {
+    switch(fn) {
+    case function_type_t::push:                return "push";
+    case function_type_t::last:                return "last";
+    case function_type_t::print:               return "print";
+    case function_type_t::cast:                return "cast";
+    case function_type_t::cmpeq:               return "cmpeq";
+    case function_type_t::match:               return "match";
+    case function_type_t::decoder:             return "decoder";
+    case function_type_t::not_:                return "not";
+    case function_type_t::signal:              return "signal";
+    case function_type_t::wire:                return "wire";
+    case function_type_t::tristate:            return "tristate";
+    case function_type_t::set_tristate_data:   return "set_tristate_data";
+    case function_type_t::set_tristate_enable: return "set_tristate_enable";
+    case function_type_t::and_:                return "and";
+    case function_type_t::nand:                return "nand";
+    case function_type_t::or_:                 return "or";
+    case function_type_t::nor_:                return "nor";
+    case function_type_t::xor_:                return "xor";
+    case function_type_t::xnor_:               return "xnor";
+    case function_type_t::flipflop:            return "flipflop";
+    case function_type_t::set_ff_data:         return "set_ff_data";
+    case function_type_t::set_ff_clock:        return "set_ff_clock";
+    case function_type_t::size:                return "size";
+    case function_type_t::vector:              return "vector";
+    default:
+        return "unknown function";
+    }
+}
+
+//
+// builds the info of every module up front so the instances running on other
+// threads only ever read it
+//
+static void elab_prepare_modules(elab_shared_t& S) {
+
+    std::map<const module_desc_t*, module_info_t*> info_of;
+
+    for(auto& m : S.renv->modules) {
+        module_desc_t* mod = m.second;
+
+        if(S.infos.size() > 0xFFFFul)
+            elab_error("too many modules to elaborate");
+
+        S.infos.emplace_back();
+        module_info_t* info = &S.infos.back();
+        info->mod   = mod;
+        info->index = (uint16_t)(S.infos.size() - 1ul);
+        info->port_of_constant.assign(mod->constants.size(), -1);
+        info->callee.assign(mod->constants.size(), NULL);
+
+        for(auto& el : mod->interface_elements) {
+            auto pr = module_desc_get_idx_of_string(mod, el.first);
+            if(!pr.first)
+                INTERNAL_ERR();
+
+            port_desc_t pd;
+            pd.constant  = pr.second;
+            pd.is_output = std::get<0>(el.second) == module_desc_t::interface_type_t::out;
+            pd.is_array  = std::get<1>(el.second) == module_desc_t::interface_size_t::array;
+
+            info->port_of_constant[pd.constant] = (int32_t)info->ports.size();
+            info->ports.push_back(pd);
+        }
+
+        info_of[mod] = info;
+    }
+
+    // any constant may name a module, module_call decides which ones do
+    for(module_info_t& info : S.infos) {
+        for(size_t i = 0ul; i < info.mod->constants.size(); i++) {
+            auto iter = S.renv->modules.find(info.mod->constants[i]);
+            if(iter != S.renv->modules.end())
+                info.callee[i] = info_of[iter->second];
+        }
+    }
+}
+
+static module_info_t* elab_callee(module_info_t* info, size_t constant) {
+
+    if(constant >= info->callee.size())
+        INTERNAL_ERR();
+
+    module_info_t* callee = info->callee[constant];
+    if(callee == NULL)
+        elab_error("module '" + info->mod->constants[constant] + "' is not defined");
+    return callee;
+}
+
+static inline const std::string& elab_constant(const frame_t& f, size_t constant) {
+    return f.info->mod->constants.at(constant);
+}
+
+//
+// locals and interface references are left on the stack unresolved because
+// assignment and field access need the name, everything else goes through here
+//
+static inline value_t elab_rvalue(elaborator_t& E, const frame_t& f, const value_t& v) {
+
+    if(v.kind == value_kind_t::local_ref) {
+        const int32_t b = E.slots[f.slot_base + v.i];
+        if(b < 0)
+            elab_error("local variable '" + elab_constant(f, v.i) + "' is not defined");
+        return E.bindings[b].value;
+    }
+
+    if(v.kind == value_kind_t::port_ref) {
+        const value_t& p = E.ports[f.first_port + v.i];
+        if(p.kind == value_kind_t::none)
+            elab_error("interface element '" + elab_constant(f, f.info->ports[v.i].constant) + "' is used before its size is set");
+        return p;
+    }
+
+    return v;
+}
+
+static void elab_declare(elaborator_t& E, const frame_t& f, size_t name, const value_t& v) {
+
+    int32_t& slot = E.slots[f.slot_base + name];
+
+    // declaring a name twice in one scope (a loop body runs more than once) reuses the binding
+    if(slot >= 0 && (size_t)slot >= E.scopes.back()) {
+        E.bindings[slot].value = v;
+        return;
+    }
+
+    binding_t b;
+    b.name  = (uint32_t)name;
+    b.prev  = slot;
+    b.value = v;
+
+    slot = (int32_t)E.bindings.size();
+    E.bindings.push_back(b);
+}
+
+static void elab_pop_scope(elaborator_t& E, const frame_t& f) {
+
+    if(E.scopes.size() <= f.scope_base)
+        elab_error("scope closed more often than it was opened");
+
+    const size_t mark = E.scopes.back();
+    E.scopes.pop_back();
+
+    while(E.bindings.size() > mark) {
+        const binding_t& b = E.bindings.back();
+        E.slots[f.slot_base + b.name] = b.prev;
+        E.bindings.pop_back();
+    }
+}
+
+static value_t elab_new_vector(elaborator_t& E) {
+    E.vectors.emplace_back(&E.arena);
+    return make_value(value_kind_t::vector, E.vectors.size() - 1ul);
+}
+
+//
+// signals
+//
+
+static inline bool elab_single_net(const elaborator_t& E, const value_t& v, net_t& n) {
+    switch(v.kind) {
+    case value_kind_t::net:     n = (net_t)v.i; return true;
+    case value_kind_t::boolean: n = v.i ? net_const1 : net_const0; return true;
+    case value_kind_t::cell:    n = E.nl->gate_outputs[v.i]; return true;
+    case value_kind_t::bus:
+        if(v.n != 1u)
+            return false;
+        n = E.bus_nets[v.i];
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void elab_to_nets(const elaborator_t& E, const value_t& v, elab_nets_t& nets, size_t nesting = 0ul) {
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(v.kind) {
+    case value_kind_t::bus:
+        nets.append(E.bus_nets.data() + v.i, v.n);
+        break;
+
+    case value_kind_t::record:
+        elab_to_nets(E, E.records[v.i], nets, nesting);
+        break;
+
+    case value_kind_t::vector:
+        if(nesting >= elaborate_max_nesting)
+            elab_error("vector nested too deeply (or contains itself) to be used as a signal");
+        for(const value_t& el : E.vectors[v.i])
+            elab_to_nets(E, el, nets, nesting + 1ul);
+        break;
+
+    default: {
+        net_t n;
+        if(!elab_single_net(E, v, n))
+            elab_error(std::string(value_kind_name(v.kind)) + " cannot be used as a signal");
+        nets.push_back(n);
+        break;
+    }
+    }
+    #pragma GCC diagnostic pop
+}
+
+//
+// nets must not point into bus_nets
+//
+static value_t elab_make_signal(elaborator_t& E, const net_t* nets, size_t n) {
+    if(n == 1ul)
+        return make_value(value_kind_t::net, nets[0]);
+
+    const size_t offset = E.bus_nets.size();
+    E.bus_nets.insert(E.bus_nets.end(), nets, nets + n);
+    return make_value(value_kind_t::bus, offset, (uint32_t)n);
+}
+
+static value_t elab_new_record(elaborator_t& E, const value_t& output) {
+    E.records.push_back(output);
+    return make_value(value_kind_t::record, E.records.size() - 1ul);
+}
+
+static inline net_t elab_add_gate(elaborator_t& E, gate_type_t type, const net_t* in, size_t n) {
+    if(!E.shared->opts.strash)
+        return netlist_add_gate(E.nl, type, in, n);
+
+    const size_t before = netlist_gate_count(*E.nl);
+    const net_t out = netlist_add_hashed_gate(E.nl, type, in, n);
+    if(netlist_gate_count(*E.nl) == before)
+        E.stats.strash_merged++;
+    return out;
+}
+
+static inline net_t elab_gate2(elaborator_t& E, gate_type_t type, net_t a, net_t b) {
+    const net_t in[2] = { a, b };
+    return elab_add_gate(E, type, in, 2ul);
+}
+
+static inline net_t elab_not(elaborator_t& E, net_t a) {
+    return elab_add_gate(E, gate_type_t::not_, &a, 1ul);
+}
+
+//
+// -1 if n is not tied to a constant (yet)
+//
+static inline int elab_const_value(elaborator_t& E, net_t n) {
+    n = netlist_find(E.nl, n);
+    return n == net_const0 ? 0 : (n == net_const1 ? 1 : -1);
+}
+
+static void elab_connect(elaborator_t& E, const value_t& dst, const value_t& src) {
+
+    net_t a, b;
+    if(elab_single_net(E, dst, a) && elab_single_net(E, src, b)) {
+        netlist_connect(E.nl, a, b);
+        return;
+    }
+
+    arena_scope_t scratch(&E.arena);
+    elab_nets_t d(&E.arena), s(&E.arena);
+    elab_to_nets(E, dst, d);
+    elab_to_nets(E, src, s);
+
+    if(s.size() == d.size()) {
+        for(size_t i = 0ul; i < d.size(); i++)
+            netlist_connect(E.nl, d[i], s[i]);
+    } else if(s.size() == 1ul) {
+        // one-to-many
+        for(size_t i = 0ul; i < d.size(); i++)
+            netlist_connect(E.nl, d[i], s[0]);
+    } else {
+        elab_error("width mismatch, cannot assign " + STR(s.size()) + " bits to " + STR(d.size()) + " bits");
+    }
+}
+
+//
+// & | ^ on signals, bit by bit. a single bit is applied to every bit of the other side
+//
+static value_t elab_bitwise(elaborator_t& E, gate_type_t type, const value_t& a, const value_t& b) {
+
+    if(a.kind == b.kind && (a.kind == value_kind_t::boolean || a.kind == value_kind_t::integer)) {
+        int64_t r = 0;
+        switch(type) {
+        case gate_type_t::and_: r = a.i & b.i; break;
+        case gate_type_t::or_:  r = a.i | b.i; break;
+        case gate_type_t::xor_: r = a.i ^ b.i; break;
+        default:
+            INTERNAL_ERR();
+        }
+        return make_value(a.kind, r);
+    }
+
+    net_t x, y;
+    if(elab_single_net(E, a, x) && elab_single_net(E, b, y))
+        return make_value(value_kind_t::net, elab_gate2(E, type, x, y));
+
+    arena_scope_t scratch(&E.arena);
+    elab_nets_t l(&E.arena), r(&E.arena), out(&E.arena);
+    elab_to_nets(E, a, l);
+    elab_to_nets(E, b, r);
+
+    if(l.size() != r.size() && l.size() != 1ul && r.size() != 1ul)
+        elab_error("width mismatch, " + STR(l.size()) + " bits and " + STR(r.size()) + " bits");
+
+    const size_t width = std::max(l.size(), r.size());
+    for(size_t i = 0ul; i < width; i++)
+        out.push_back(elab_gate2(E, type, l[l.size() == 1ul ? 0ul : i], r[r.size() == 1ul ? 0ul : i]));
+
+    return elab_make_signal(E, out.data(), out.size());
+}
+
+static value_t elab_invert(elaborator_t& E, const value_t& a) {
+
+    if(a.kind == value_kind_t::boolean)
+        return make_value(value_kind_t::boolean, !a.i);
+    if(a.kind == value_kind_t::integer)
+        return make_value(value_kind_t::integer, ~a.i);
+
+    net_t x;
+    if(elab_single_net(E, a, x))
+        return make_value(value_kind_t::net, elab_not(E, x));
+
+    arena_scope_t scratch(&E.arena);
+    elab_nets_t in(&E.arena), out(&E.arena);
+    elab_to_nets(E, a, in);
+    for(net_t n : in)
+        out.push_back(elab_not(E, n));
+
+    return elab_make_signal(E, out.data(), out.size());
+}
+
+//
+// and(...), or(...) etc. every argument is flattened into one list of inputs
+//
+static value_t elab_reduce(elaborator_t& E, gate_type_t type, const value_t* args, size_t n_args) {
+
+    arena_scope_t scratch(&E.arena);
+    elab_nets_t in(&E.arena);
+    for(size_t i = 0ul; i < n_args; i++)
+        elab_to_nets(E, args[i], in);
+
+    const bool inverted = type == gate_type_t::nand || type == gate_type_t::nor_ || type == gate_type_t::xnor_;
+
+    if(in.size() == 0ul) {
+        // value of the gate with no inputs is its identity
+        const bool identity = type == gate_type_t::and_ || type == gate_type_t::nand;
+        return make_value(value_kind_t::net, (identity != inverted) ? net_const1 : net_const0);
+    }
+
+    if(in.size() == 1ul)
+        return make_value(value_kind_t::net, inverted ? elab_not(E, in[0]) : in[0]);
+
+    return make_value(value_kind_t::net, elab_add_gate(E, type, in.data(), in.size()));
+}
+
+static value_t elab_and_of(elaborator_t& E, const elab_nets_t& terms) {
+    if(terms.empty())
+        return make_value(value_kind_t::net, net_const1);
+    if(terms.size() == 1ul)
+        return make_value(value_kind_t::net, terms[0]);
+    return make_value(value_kind_t::net, elab_add_gate(E, gate_type_t::and_, terms.data(), terms.size()));
+}
+
+//
+// single net that is high when in equals the constant bits. inverted[b] caches
+// the inverse of in[b] across several patterns, ~0u when not built yet
+//
+static net_t elab_match_bits(
+        elaborator_t& E,
+        const elab_nets_t& in,
+        const elab_array_t<uint8_t>& bits,
+        elab_nets_t& inverted) {
+
+    arena_scope_t scratch(&E.arena);
+    elab_nets_t terms(&E.arena);
+    for(size_t b = 0ul; b < in.size(); b++) {
+        if(bits[b]) {
+            terms.push_back(in[b]);
+        } else {
+            if(inverted[b] == ~0u)
+                inverted[b] = elab_not(E, in[b]);
+            terms.push_back(inverted[b]);
+        }
+    }
+
+    net_t n;
+    const value_t v = elab_and_of(E, terms);
+    if(!elab_single_net(E, v, n))
+        INTERNAL_ERR();
+    return n;
+}
+
+static void elab_const_bits(elaborator_t& E, const value_t& v, const char* what, elab_array_t<uint8_t>& bits) {
+    elab_nets_t nets(&E.arena);
+    elab_to_nets(E, v, nets);
+
+    for(net_t n : nets) {
+        const int c = elab_const_value(E, n);
+        if(c < 0)
+            elab_error(std::string(what) + " must be a constant");
+        bits.push_back((uint8_t)c);
+    }
+}
+
+static value_t elab_bit_literal(elaborator_t& E, const std::string& text) {
+
+    // written msb first, bit 0 is the rightmost digit
+    arena_scope_t scratch(&E.arena);
+    elab_nets_t bits(&E.arena);
+    for(auto c = text.rbegin(); c != text.rend(); c++) {
+        if(*c == '0')
+            bits.push_back(net_const0);
+        else if(*c == '1')
+            bits.push_back(net_const1);
+    }
+
+    if(bits.empty())
+        elab_error("empty bit literal '" + text + "'");
+
+    return elab_make_signal(E, bits.data(), bits.size());
+}
+
+//
+// builtin functions. args have already been resolved
+//
+
+static void elab_expect_args(function_type_t fn, size_t n_args, size_t expected) {
+    if(n_args != expected)
+        elab_error(std::string(builtin_name(fn)) + "() expects " + STR(expected) + " argument(s), got " + STR(n_args));
+}
+
+static int64_t elab_expect_integer(const value_t& v, const char* what) {
+    if(v.kind != value_kind_t::integer)
+        elab_error(std::string(what) + " must be an integer, found " + value_kind_name(v.kind));
+    return v.i;
+}
+
+//
+// returns the gate id
+//
+static uint32_t elab_expect_cell(elaborator_t& E, function_type_t fn, const value_t& v, gate_type_t type) {
+    if(v.kind != value_kind_t::cell || netlist_gate_type(*E.nl, (uint32_t)v.i) != type)
+        elab_error(std::string(builtin_name(fn)) + "() expects a " + gate_type_name(type) + " as first argument, found " + value_kind_name(v.kind));
+    return (uint32_t)v.i;
+}
+
+static value_t elab_new_cell(elaborator_t& E, gate_type_t type) {
+    // both inputs start out as fresh nets and get connected later
+    const net_t first = netlist_new_nets(E.nl, 2ul);
+    const net_t in[2] = { first, first + 1u };
+    netlist_add_gate(E.nl, type, in, 2ul);
+    return make_value(value_kind_t::cell, netlist_gate_count(*E.nl) - 1ul);
+}
+
+static void elab_print(elaborator_t& E, const value_t* args, size_t n_args) {
+    // whole lines at a time, other instances may be printing too
+    std::ostringstream os;
+
+    for(size_t i = 0ul; i < n_args; i++) {
+        const value_t& v = args[i];
+        os << (i ? " " : "");
+
+        #pragma GCC diagnostic push
+        #pragma GCC diagnostic ignored "-Wswitch-enum"
+        switch(v.kind) {
+        case value_kind_t::boolean:  os << (v.i ? "true" : "false"); break;
+        case value_kind_t::integer:  os << v.i; break;
+        case value_kind_t::string:   os << string_pool_string(global_string_pool(), (symbol_t)v.i); break;
+        case value_kind_t::net:      os << "net(" << v.i << ")"; break;
+        case value_kind_t::bus:      os << "bus[" << v.n << "]"; break;
+        case value_kind_t::vector:   os << "vector[" << E.vectors[v.i].size() << "]"; break;
+        case value_kind_t::instance: os << "module." << E.instances[v.i].info->mod->name; break;
+        case value_kind_t::range:    os << v.i << ":" << v.n; break;
+        default:
+            os << value_kind_name(v.kind);
+            break;
+        }
+        #pragma GCC diagnostic pop
+    }
+    os << "\n";
+
+    std::lock_guard<std::mutex> guard(E.shared->print_lock);
+    *E.shared->os << os.str();
+}
+
+static value_t elab_builtin(elaborator_t& E, function_type_t fn, value_t* args, size_t n_args) {
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(fn) {
+    case function_type_t::vector: {
+        const value_t v = elab_new_vector(E);
+        E.vectors[v.i].append(args, n_args);
+        return v;
+    }
+
+    case function_type_t::push: {
+        if(n_args < 1ul || args[0].kind != value_kind_t::vector)
+            elab_error("push() expects a vector as first argument");
+        E.vectors[args[0].i].append(args + 1, n_args - 1ul);
+        return value_t();
+    }
+
+    case function_type_t::last: {
+        elab_expect_args(fn, n_args, 1ul);
+        if(args[0].kind == value_kind_t::vector) {
+            const elab_array_t<value_t>& vec = E.vectors[args[0].i];
+            if(vec.empty())
+                elab_error("last() of an empty vector");
+            return vec.back();
+        }
+
+        arena_scope_t scratch(&E.arena);
+        elab_nets_t nets(&E.arena);
+        elab_to_nets(E, args[0], nets);
+        return make_value(value_kind_t::net, nets.back());
+    }
+
+    case function_type_t::size: {
+        elab_expect_args(fn, n_args, 1ul);
+        if(args[0].kind == value_kind_t::vector)
+            return make_value(value_kind_t::integer, E.vectors[args[0].i].size());
+
+        arena_scope_t scratch(&E.arena);
+        elab_nets_t nets(&E.arena);
+        elab_to_nets(E, args[0], nets);
+        return make_value(value_kind_t::integer, nets.size());
+    }
+
+    case function_type_t::print:
+        elab_print(E, args, n_args);
+        return value_t();
+
+    case function_type_t::signal:
+        elab_expect_args(fn, n_args, 0ul);
+        return make_value(value_kind_t::net, netlist_new_net(E.nl));
+
+    case function_type_t::wire: {
+        if(n_args == 0ul)
+            return make_value(value_kind_t::net, netlist_new_net(E.nl));
+
+        elab_expect_args(fn, n_args, 1ul);
+        const int64_t width = elab_expect_integer(args[0], "width of wire()");
+        if(width <= 0)
+            elab_error("wire() width must be positive");
+
+        arena_scope_t scratch(&E.arena);
+        elab_nets_t nets(&E.arena);
+        const net_t first = netlist_new_nets(E.nl, width);
+        for(int64_t i = 0; i < width; i++)
+            nets.push_back(first + i);
+        return elab_make_signal(E, nets.data(), nets.size());
+    }
+
+    case function_type_t::not_:
+        elab_expect_args(fn, n_args, 1ul);
+        return elab_invert(E, args[0]);
+
+    case function_type_t::and_:  return elab_reduce(E, gate_type_t::and_, args, n_args);
+    case function_type_t::nand:  return elab_reduce(E, gate_type_t::nand, args, n_args);
+    case function_type_t::or_:   return elab_reduce(E, gate_type_t::or_,  args, n_args);
+    case function_type_t::nor_:  return elab_reduce(E, gate_type_t::nor_, args, n_args);
+    case function_type_t::xor_:  return elab_reduce(E, gate_type_t::xor_, args, n_args);
+    case function_type_t::xnor_: return elab_reduce(E, gate_type_t::xnor_, args, n_args);
+
+    case function_type_t::flipflop:
+        elab_expect_args(fn, n_args, 0ul);
+        return elab_new_cell(E, gate_type_t::flipflop);
+
+    case function_type_t::tristate:
+        elab_expect_args(fn, n_args, 0ul);
+        return elab_new_cell(E, gate_type_t::tristate);
+
+    case function_type_t::set_ff_data:
+    case function_type_t::set_ff_clock:
+    case function_type_t::set_tristate_data:
+    case function_type_t::set_tristate_enable: {
+        elab_expect_args(fn, n_args, 2ul);
+        const bool ff = fn == function_type_t::set_ff_data || fn == function_type_t::set_ff_clock;
+        const uint32_t g = elab_expect_cell(E, fn, args[0], ff ? gate_type_t::flipflop : gate_type_t::tristate);
+        const size_t input = (fn == function_type_t::set_ff_data || fn == function_type_t::set_tristate_data) ? 0ul : 1ul;
+
+        net_t n;
+        if(!elab_single_net(E, args[1], n))
+            elab_error(std::string(builtin_name(fn)) + "() expects a single bit, found " + value_kind_name(args[1].kind));
+
+        netlist_connect(E.nl, netlist_gate_fanin(*E.nl, g)[input], n);
+        return value_t();
+    }
+
+    case function_type_t::cmpeq: {
+        elab_expect_args(fn, n_args, 2ul);
+        arena_scope_t scratch(&E.arena);
+        elab_nets_t a(&E.arena), b(&E.arena), terms(&E.arena);
+        elab_to_nets(E, args[0], a);
+        elab_to_nets(E, args[1], b);
+        if(a.size() != b.size())
+            elab_error("cmpeq() width mismatch, " + STR(a.size()) + " bits and " + STR(b.size()) + " bits");
+
+        for(size_t i = 0ul; i < a.size(); i++) {
+            const int ca = elab_const_value(E, a[i]);
+            const int cb = elab_const_value(E, b[i]);
+
+            if(ca >= 0 && cb >= 0) {
+                if(ca != cb)
+                    return elab_new_record(E, make_value(value_kind_t::net, net_const0));
+            } else if(ca >= 0 || cb >= 0) {
+                const net_t other = ca >= 0 ? b[i] : a[i];
+                terms.push_back((ca >= 0 ? ca : cb) ? other : elab_not(E, other));
+            } else {
+                terms.push_back(elab_gate2(E, gate_type_t::xnor_, a[i], b[i]));
+            }
+        }
+
+        return elab_new_record(E, elab_and_of(E, terms));
+    }
+
+    case function_type_t::match: {
+        // match(pattern, ..., input), output[i] is high when input equals pattern i
+        if(n_args < 2ul)
+            elab_error("match() expects at least one pattern and an input");
+
+        arena_scope_t scratch(&E.arena);
+        elab_nets_t in(&E.arena), out(&E.arena), inverted(&E.arena);
+        elab_to_nets(E, args[n_args - 1ul], in);
+        inverted.assign(in.size(), ~0u);
+
+        // out must not grow while a pattern holds its scratch space
+        out.reserve(n_args - 1ul);
+
+        for(size_t i = 0ul; i + 1ul < n_args; i++) {
+            arena_scope_t pattern(&E.arena);
+            elab_array_t<uint8_t> bits(&E.arena);
+            elab_const_bits(E, args[i], "match() pattern", bits);
+            if(bits.size() != in.size())
+                elab_error("match() pattern " + STR(i) + " is " + STR(bits.size()) + " bits, input is " + STR(in.size()) + " bits");
+            out.push_back(elab_match_bits(E, in, bits, inverted));
+        }
+
+        return elab_new_record(E, elab_make_signal(E, out.data(), out.size()));
+    }
+
+    case function_type_t::decoder: {
+        // decoder(outputs, first value, input), output[i] is high when input equals first value + i
+        elab_expect_args(fn, n_args, 3ul);
+        const int64_t outputs = elab_expect_integer(args[0], "decoder() output count");
+        const int64_t first   = elab_expect_integer(args[1], "decoder() first value");
+
+        if(outputs <= 0 || first < 0)
+            elab_error("decoder() output count must be positive and first value not negative");
+
+        arena_scope_t scratch(&E.arena);
+        elab_nets_t in(&E.arena), out(&E.arena), inverted(&E.arena);
+        elab_array_t<uint8_t> bits(&E.arena);
+        elab_to_nets(E, args[2], in);
+        inverted.assign(in.size(), ~0u);
+
+        for(int64_t i = 0; i < outputs; i++) {
+            const uint64_t value = (uint64_t)(first + i);
+            if(in.size() < 64ul && (value >> in.size()) != 0ul)
+                elab_error("decoder() value " + STR(value) + " does not fit in " + STR(in.size()) + " input bits");
+
+            bits.assign(in.size(), 0u);
+            for(size_t b = 0ul; b < in.size(); b++)
+                bits[b] = b < 64ul ? (value >> b) & 1ul : 0u;
+
+            out.push_back(elab_match_bits(E, in, bits, inverted));
+        }
+
+        return elab_new_record(E, elab_make_signal(E, out.data(), out.size()));
+    }
+
+    case function_type_t::cast:
+    default:
+        elab_error(std::string(builtin_name(fn)) + "() is not supported during elaboration");
+    }
+    #pragma GCC diagnostic pop
+}
+
+//
+// operators on values that only exist while elaborating
+//
+
+static value_t elab_arith(elaborator_t& E, opcode_t op, const value_t& a, const value_t& b) {
+
+    if(op == opcode_t::operator_add && a.kind == value_kind_t::vector && b.kind == value_kind_t::vector) {
+        // concatenation. elements in the arena stay put while dst grows
+        const value_t v = elab_new_vector(E);
+        elab_array_t<value_t>& dst = E.vectors[v.i];
+        const elab_array_t<value_t>& va = E.vectors[a.i];
+        const elab_array_t<value_t>& vb = E.vectors[b.i];
+        dst.reserve(va.size() + vb.size());
+        dst.append(va.data(), va.size());
+        dst.append(vb.data(), vb.size());
+        return v;
+    }
+
+    if(a.kind != value_kind_t::integer || b.kind != value_kind_t::integer)
+        elab_error(std::string("arithmetic and comparison need integers, found ") + value_kind_name(a.kind) + " and " + value_kind_name(b.kind));
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(op) {
+    case opcode_t::operator_add:      return make_value(value_kind_t::integer, a.i + b.i);
+    case opcode_t::operator_subtract: return make_value(value_kind_t::integer, a.i - b.i);
+    case opcode_t::operator_multiply: return make_value(value_kind_t::integer, a.i * b.i);
+    case opcode_t::operator_divide:
+        if(b.i == 0)
+            elab_error("division by zero");
+        return make_value(value_kind_t::integer, a.i / b.i);
+
+    case opcode_t::operator_cmp_lt: return make_value(value_kind_t::boolean, a.i <  b.i);
+    case opcode_t::operator_cmp_le: return make_value(value_kind_t::boolean, a.i <= b.i);
+    case opcode_t::operator_cmp_gt: return make_value(value_kind_t::boolean, a.i >  b.i);
+    case opcode_t::operator_cmp_ge: return make_value(value_kind_t::boolean, a.i >= b.i);
+    default:
+        INTERNAL_ERR();
+    }
+    #pragma GCC diagnostic pop
+}
+
+static value_t elab_range(const value_t& a, const value_t& b) {
+    const int64_t first = elab_expect_integer(a, "start of range");
+    const int64_t last  = elab_expect_integer(b, "end of range");
+    if(first < 0 || last < 0 || last > 0xFFFFFFFFl)
+        elab_error("range " + STR(first) + ":" + STR(last) + " is out of bounds");
+    return make_value(value_kind_t::range, first, (uint32_t)last);
+}
+
+//
+// base[index]. ranges are inclusive and may run backwards
+//
+static value_t elab_index(elaborator_t& E, const value_t& base, const value_t& index) {
+
+    if(base.kind == value_kind_t::vector) {
+        const elab_array_t<value_t>& vec = E.vectors[base.i];
+        const int64_t i = elab_expect_integer(index, "vector index");
+        if(i < 0 || (size_t)i >= vec.size())
+            elab_error("index " + STR(i) + " out of bounds for vector of size " + STR(vec.size()));
+        return vec[i];
+    }
+
+    // fast path for a single bit of a bus
+    if(base.kind == value_kind_t::bus && index.kind == value_kind_t::integer) {
+        if(index.i < 0 || index.i >= base.n)
+            elab_error("index " + STR(index.i) + " out of bounds for signal array of size " + STR(base.n));
+        return make_value(value_kind_t::net, E.bus_nets[base.i + index.i]);
+    }
+
+    arena_scope_t scratch(&E.arena);
+    elab_nets_t nets(&E.arena), out(&E.arena);
+    elab_to_nets(E, base, nets);
+
+    if(index.kind == value_kind_t::integer) {
+        if(index.i < 0 || (size_t)index.i >= nets.size())
+            elab_error("index " + STR(index.i) + " out of bounds for signal of size " + STR(nets.size()));
+        return make_value(value_kind_t::net, nets[index.i]);
+    }
+
+    if(index.kind != value_kind_t::range)
+        elab_error(std::string("index must be an integer or a range, found ") + value_kind_name(index.kind));
+
+    const size_t first = index.i;
+    const size_t last  = index.n;
+    if(first >= nets.size() || last >= nets.size())
+        elab_error("range " + STR(first) + ":" + STR(last) + " out of bounds for signal of size " + STR(nets.size()));
+
+    for(size_t i = first; ; i += (first <= last) ? 1ul : -1ul) {
+        out.push_back(nets[i]);
+        if(i == last)
+            break;
+    }
+
+    return elab_make_signal(E, out.data(), out.size());
+}
+
+static value_t elab_get_field(elaborator_t& E, const frame_t& f, const value_t& obj, const value_t& field) {
+
+    if(field.kind != value_kind_t::local_ref)
+        INTERNAL_ERR();
+
+    const symbol_t sym = f.info->mod->constant_syms.at(field.i);
+
+    if(obj.kind == value_kind_t::instance) {
+        const instance_t& inst = E.instances[obj.i];
+        auto iter = inst.info->mod->constant_index.find(sym);
+        const int32_t slot = (iter == inst.info->mod->constant_index.end()) ? -1 : inst.info->port_of_constant[iter->second];
+
+        if(slot < 0)
+            elab_error("module '" + inst.info->mod->name + "' has no interface element named '" + elab_constant(f, field.i) + "'");
+        return E.ports[inst.first_port + slot];
+    }
+
+    if(obj.kind == value_kind_t::record) {
+        if(sym != E.shared->sym_output)
+            elab_error("builtin result has no field '" + elab_constant(f, field.i) + "', only 'output'");
+        return E.records[obj.i];
+    }
+
+    elab_error("cannot take field '" + elab_constant(f, field.i) + "' of " + value_kind_name(obj.kind));
+}
+
+//
+// assigning to a local (re)binds the name, assigning to anything else
+// connects signals
+//
+static void elab_assign(elaborator_t& E, const frame_t& f, const value_t& lhs, const value_t& rhs) {
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(lhs.kind) {
+    case value_kind_t::local_ref: {
+        const int32_t b = E.slots[f.slot_base + lhs.i];
+        if(b < 0)
+            elab_error("local variable '" + elab_constant(f, lhs.i) + "' is not defined");
+        E.bindings[b].value = rhs;
+        break;
+    }
+
+    case value_kind_t::port_ref:
+        elab_connect(E, elab_rvalue(E, f, lhs), rhs);
+        break;
+
+    case value_kind_t::net:
+    case value_kind_t::bus:
+    case value_kind_t::cell:
+        elab_connect(E, lhs, rhs);
+        break;
+
+    default:
+        elab_error(std::string("cannot assign to ") + value_kind_name(lhs.kind));
+    }
+    #pragma GCC diagnostic pop
+}
+
+static int32_t elab_port_slot(const frame_t& f, size_t constant, bool is_output) {
+    const int32_t slot = constant < f.info->port_of_constant.size() ? f.info->port_of_constant[constant] : -1;
+    if(slot < 0 || f.info->ports[slot].is_output != is_output)
+        elab_error("module '" + f.info->mod->name + "' has no " + (is_output ? "output" : "input") + " named '" + elab_constant(f, constant) + "'");
+    return slot;
+}
+
+static void elab_set_interface_size(elaborator_t& E, const frame_t& f, const value_t& port, const value_t& size) {
+
+    if(port.kind != value_kind_t::port_ref)
+        INTERNAL_ERR();
+
+    const port_desc_t& pd = f.info->ports[port.i];
+    value_t& p = E.ports[f.first_port + port.i];
+
+    if(!pd.is_array || p.kind != value_kind_t::none)
+        elab_error("size of interface element '" + elab_constant(f, pd.constant) + "' is already set");
+
+    const int64_t width = elab_expect_integer(size, "interface size");
+    if(width <= 0 || width > 0xFFFFFFFFl)
+        elab_error("interface element '" + elab_constant(f, pd.constant) + "' cannot have size " + STR(width));
+
+    const net_t first = netlist_new_nets(E.nl, width);
+    const size_t offset = E.bus_nets.size();
+    for(int64_t i = 0; i < width; i++)
+        E.bus_nets.push_back(first + i);
+
+    p = make_value(value_kind_t::bus, offset, (uint32_t)width);
+}
+
+static bool elab_condition(elaborator_t& E, const frame_t& f) {
+    if(E.stack.size() <= f.stack_base)
+        elab_error("branch without a condition");
+
+    const value_t v = elab_rvalue(E, f, E.stack.back());
+    if(v.kind == value_kind_t::boolean || v.kind == value_kind_t::integer)
+        return v.i != 0;
+
+    elab_error(std::string("condition must be known during elaboration, found ") + value_kind_name(v.kind));
+}
+
+//
+// index of the nearest argument list marker, which has to be of the given kind
+//
+static size_t elab_find_marker(elaborator_t& E, const frame_t& f, value_kind_t kind) {
+    for(size_t i = E.stack.size(); i > f.stack_base; i--) {
+        const value_kind_t k = E.stack[i - 1ul].kind;
+        if(k >= value_kind_t::fn_args) {
+            if(k != kind)
+                break;
+            return i - 1ul;
+        }
+    }
+    INTERNAL_ERR();
+}
+
+static void elab_pop2(elaborator_t& E, const frame_t& f, value_t& a, value_t& b) {
+    if(E.stack.size() < f.stack_base + 2ul)
+        INTERNAL_ERR();
+
+    b = E.stack.back(); E.stack.pop_back();
+    a = E.stack.back(); E.stack.pop_back();
+}
+
+static inline size_t elab_read_varint(const uint8_t* code, size_t& pc) {
+    size_t v = 0ul;
+    uint8_t u8;
+    do {
+        u8 = code[pc++];
+        v = (v << 7) | (u8 & 0x7F);
+    } while(u8 & 0x80);
+    return v;
+}
+
+static value_t elab_instantiate(elaborator_t& E, module_info_t* info, const value_t* args, size_t n_args, size_t call_pc);
+
+//
+// adds one line of instance trace to an error message. every instance adds
+// itself on the way out, deep recursion would make the trace unreadable
+//
+static std::string elab_trace(const std::string& msg, const module_info_t* info, size_t pc) {
+
+    static const std::string line = "\n    in module '";
+    static const std::string more = "\n    ...";
+
+    if(msg.size() >= more.size() && msg.compare(msg.size() - more.size(), more.size(), more) == 0)
+        return msg;
+
+    size_t lines = 1ul;
+    for(size_t at = msg.find(line); at != std::string::npos; at = msg.find(line, at + 1ul))
+        lines++;
+
+    if(lines == elaborate_max_trace)
+        return msg + more;
+    return msg + line + info->mod->name + "', bytecode offset " + STR(pc);
+}
+
+//
+// executes the bytecode of the module in f from f.pc until it returns (true)
+// or, if f.unsized is not 0, until the last interface array gets its size
+// (false)
+//
+static bool elab_run(elaborator_t& E, frame_t& f) {
+
+    const uint8_t* const code = f.info->mod->bytecode.data();
+    size_t pc        = f.pc;
+    size_t op_pc     = 0ul; // start of the instruction being executed
+    size_t executed  = 0ul;
+
+    if(f.info->mod->bytecode.empty())
+        INTERNAL_ERR();
+
+    try {
+
+#ifdef ELABORATE_THREADED_DISPATCH
+
+    // in opcode_t order
+    static void* const dispatch[] = {
+        &&op_clear_stack,
+        &&op_jump_exe,
+        &&op_jump_true,
+        &&op_jump_false,
+        &&op_pop_scope,
+        &&op_push_scope_for,
+        &&op_push_scope_if,
+        &&op_return_,
+        &&op_push_true,
+        &&op_push_false,
+        &&op_push_in_ref,
+        &&op_push_out_ref,
+        &&op_push_new_local_ref,
+        &&op_push_local_ref,
+        &&op_push_uinteger,
+        &&op_push_bit_literal,
+        &&op_assign_in_ref,
+        &&op_assign_out_ref,
+        &&op_push_fn_args_sentinal,
+        &&op_push_vec_args_sentinal,
+        &&op_push_arr_sentinal,
+        &&op_push_module_args_sentinal,
+        &&op_function_call,
+        &&op_module_call,
+        &&op_index_call,
+        &&op_set_interface_size,
+        &&op_operator_add,
+        &&op_operator_subtract,
+        &&op_operator_multiply,
+        &&op_operator_divide,
+        &&op_operator_assign,
+        &&op_operator_get_field,
+        &&op_operator_cmp_lt,
+        &&op_operator_cmp_le,
+        &&op_operator_cmp_gt,
+        &&op_operator_cmp_ge,
+        &&op_operator_unary_negate,
+        &&op_operator_binary_not,
+        &&op_operator_binary_xor,
+        &&op_operator_binary_and,
+        &&op_operator_binary_or,
+        &&op_operator_range_desc,
+        &&op_push_new_local_any,
+        &&op_push_new_local_integer,
+        &&op_push_new_local_uinteger,
+        &&op_push_new_local_string,
+        &&op_push_new_local_vector,
+        &&op_push_new_local_module,
+    };
+    static_assert(sizeof(dispatch) / sizeof(dispatch[0]) == opcode_count, "dispatch table out of sync with opcode_t");
+
+#   define ELAB_OP(name) op_##name:
+#   define ELAB_NEXT() do {                         \
+        op_pc = pc;                                 \
+        executed++;                                 \
+        const uint8_t opc_ = code[pc++];            \
+        if(opc_ >= opcode_count) goto op_invalid;   \
+        goto *dispatch[opc_];                       \
+    } while(0)
+
+    ELAB_NEXT();
+
+#else
+
+#   define ELAB_OP(name) case opcode_t::name:
+#   define ELAB_NEXT() continue
+
+    for(;;) {
+    op_pc = pc;
+    executed++;
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(static_cast<opcode_t>(code[pc++])) {
+
+#endif
+
+    ELAB_OP(clear_stack) {
+        E.stack.resize(f.stack_base);
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(jump_exe) {
+        pc = op_pc + (int32_t)opc_read_jump_operand(code + pc);
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(jump_true) {
+        if(elab_condition(E, f))
+            pc = op_pc + (int32_t)opc_read_jump_operand(code + pc);
+        else
+            pc += opc_jump_operand_size;
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(jump_false) {
+        if(!elab_condition(E, f))
+            pc = op_pc + (int32_t)opc_read_jump_operand(code + pc);
+        else
+            pc += opc_jump_operand_size;
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(pop_scope) {
+        elab_pop_scope(E, f);
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_scope_for)
+    ELAB_OP(push_scope_if) {
+        E.scopes.push_back(E.bindings.size());
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(return_) {
+        E.stats.instructions += executed;
+        return true;
+    }
+
+    ELAB_OP(push_true) {
+        E.stack.push_back(make_value(value_kind_t::boolean, 1));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_false) {
+        E.stack.push_back(make_value(value_kind_t::boolean, 0));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_in_ref) {
+        const size_t constant = elab_read_varint(code, pc);
+        E.stack.push_back(make_value(value_kind_t::port_ref, elab_port_slot(f, constant, false)));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_out_ref) {
+        const size_t constant = elab_read_varint(code, pc);
+        E.stack.push_back(make_value(value_kind_t::port_ref, elab_port_slot(f, constant, true)));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_new_local_ref)
+    ELAB_OP(push_new_local_any)
+    ELAB_OP(push_new_local_module) {
+        const size_t constant = elab_read_varint(code, pc);
+        elab_declare(E, f, constant, value_t());
+        E.stack.push_back(make_value(value_kind_t::local_ref, constant));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_new_local_integer)
+    ELAB_OP(push_new_local_uinteger) {
+        const size_t constant = elab_read_varint(code, pc);
+        elab_declare(E, f, constant, make_value(value_kind_t::integer, 0));
+        E.stack.push_back(make_value(value_kind_t::local_ref, constant));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_new_local_string) {
+        const size_t constant = elab_read_varint(code, pc);
+        elab_declare(E, f, constant, make_value(value_kind_t::string, string_pool_intern(global_string_pool(), "", 0ul)));
+        E.stack.push_back(make_value(value_kind_t::local_ref, constant));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_new_local_vector) {
+        const size_t constant = elab_read_varint(code, pc);
+        elab_declare(E, f, constant, elab_new_vector(E));
+        E.stack.push_back(make_value(value_kind_t::local_ref, constant));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_local_ref) {
+        const size_t constant = elab_read_varint(code, pc);
+        E.stack.push_back(make_value(value_kind_t::local_ref, constant));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_uinteger) {
+        const size_t u = elab_read_varint(code, pc);
+        E.stack.push_back(make_value(value_kind_t::integer, (int64_t)u));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_bit_literal) {
+        const size_t constant = elab_read_varint(code, pc);
+        E.stack.push_back(elab_bit_literal(E, elab_constant(f, constant)));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_fn_args_sentinal) {
+        E.stack.push_back(make_value(value_kind_t::fn_args));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_vec_args_sentinal) {
+        E.stack.push_back(make_value(value_kind_t::vec_args));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_arr_sentinal) {
+        E.stack.push_back(make_value(value_kind_t::arr_args));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(push_module_args_sentinal) {
+        E.stack.push_back(make_value(value_kind_t::module_args));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(function_call) {
+        const function_type_t fn = static_cast<function_type_t>(code[pc++]);
+        const size_t m = elab_find_marker(E, f, fn == function_type_t::vector ? value_kind_t::vec_args : value_kind_t::fn_args);
+
+        for(size_t i = m + 1ul; i < E.stack.size(); i++)
+            E.stack[i] = elab_rvalue(E, f, E.stack[i]);
+
+        const value_t r = elab_builtin(E, fn, E.stack.data() + m + 1ul, E.stack.size() - m - 1ul);
+        E.stack.resize(m);
+        E.stack.push_back(r);
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(module_call) {
+        module_info_t* callee = elab_callee(f.info, elab_read_varint(code, pc));
+        const size_t m = elab_find_marker(E, f, value_kind_t::module_args);
+
+        for(size_t i = m + 1ul; i < E.stack.size(); i++)
+            E.stack[i] = elab_rvalue(E, f, E.stack[i]);
+
+        const value_t r = elab_instantiate(E, callee, E.stack.data() + m + 1ul, E.stack.size() - m - 1ul, op_pc);
+        E.stack.resize(m);
+        E.stack.push_back(r);
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(index_call) {
+        const size_t m = elab_find_marker(E, f, value_kind_t::arr_args);
+        if(m == f.stack_base || E.stack.size() != m + 2ul)
+            INTERNAL_ERR();
+
+        const value_t r = elab_index(E, elab_rvalue(E, f, E.stack[m - 1ul]), elab_rvalue(E, f, E.stack[m + 1ul]));
+        E.stack.resize(m - 1ul);
+        E.stack.push_back(r);
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(set_interface_size) {
+        value_t port, size;
+        elab_pop2(E, f, port, size);
+        elab_set_interface_size(E, f, port, elab_rvalue(E, f, size));
+
+        // the parent can go on once it knows the sizes of all ports
+        if(f.unsized > 0u && --f.unsized == 0u) {
+            f.pc = pc;
+            E.stats.instructions += executed;
+            return false;
+        }
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(operator_add)
+    ELAB_OP(operator_subtract)
+    ELAB_OP(operator_multiply)
+    ELAB_OP(operator_divide)
+    ELAB_OP(operator_cmp_lt)
+    ELAB_OP(operator_cmp_le)
+    ELAB_OP(operator_cmp_gt)
+    ELAB_OP(operator_cmp_ge) {
+        value_t a, b;
+        elab_pop2(E, f, a, b);
+        E.stack.push_back(elab_arith(E, static_cast<opcode_t>(code[op_pc]), elab_rvalue(E, f, a), elab_rvalue(E, f, b)));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(assign_in_ref)  // never emitted, behave like assignment
+    ELAB_OP(assign_out_ref)
+    ELAB_OP(operator_assign) {
+        value_t lhs, rhs;
+        elab_pop2(E, f, lhs, rhs);
+        rhs = elab_rvalue(E, f, rhs);
+        elab_assign(E, f, lhs, rhs);
+        E.stack.push_back(rhs);
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(operator_get_field) {
+        value_t obj, field;
+        elab_pop2(E, f, obj, field);
+        E.stack.push_back(elab_get_field(E, f, elab_rvalue(E, f, obj), field));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(operator_unary_negate) {
+        if(E.stack.size() <= f.stack_base)
+            INTERNAL_ERR();
+        const value_t a = elab_rvalue(E, f, E.stack.back());
+        E.stack.back() = make_value(value_kind_t::integer, -elab_expect_integer(a, "operand of unary -"));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(operator_binary_not) {
+        if(E.stack.size() <= f.stack_base)
+            INTERNAL_ERR();
+        const value_t a = elab_rvalue(E, f, E.stack.back());
+        E.stack.back() = elab_invert(E, a);
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(operator_binary_xor)
+    ELAB_OP(operator_binary_and)
+    ELAB_OP(operator_binary_or) {
+        const opcode_t op = static_cast<opcode_t>(code[op_pc]);
+        const gate_type_t type =
+                op == opcode_t::operator_binary_xor ? gate_type_t::xor_ :
+                op == opcode_t::operator_binary_and ? gate_type_t::and_ : gate_type_t::or_;
+
+        value_t a, b;
+        elab_pop2(E, f, a, b);
+        E.stack.push_back(elab_bitwise(E, type, elab_rvalue(E, f, a), elab_rvalue(E, f, b)));
+        ELAB_NEXT();
+    }
+
+    ELAB_OP(operator_range_desc) {
+        value_t a, b;
+        elab_pop2(E, f, a, b);
+        E.stack.push_back(elab_range(elab_rvalue(E, f, a), elab_rvalue(E, f, b)));
+        ELAB_NEXT();
+    }
+
+#ifdef ELABORATE_THREADED_DISPATCH
+    op_invalid:
+#else
+    default:
+#endif
+        elab_error("invalid opcode " + STR(code[op_pc]));
+
+#ifndef ELABORATE_THREADED_DISPATCH
+    } // switch
+    #pragma GCC diagnostic pop
+    } // for
+#endif
+
+#undef ELAB_OP
+#undef ELAB_NEXT
+
+    }
+    catch(std::runtime_error& err) {
+        E.stats.instructions += executed;
+        throw std::runtime_error(elab_trace(err.what(), f.info, op_pc));
+    }
+}
+
+//
+// copies a finished fragment into the netlist of E and ties its ports to the
+// placeholders starting at first_port. the scopes of the fragment go below
+// scope 0 of E, the instance itself becomes scope name
+//
+static void elab_splice(elaborator_t& E, const fragment_t& frag, uint32_t first_port, const std::string& name) {
+
+    const netlist_t& src = frag.nl;
+    netlist_t* nl = E.nl;
+
+    const net_t base = netlist_new_nets(nl, src.net_count - 2ul);
+    auto map = [&](net_t n) { return n <= net_const1 ? n : n - 2u + base; };
+
+    const uint32_t scope_base = (uint32_t)nl->scopes.size();
+    const uint32_t port_base  = (uint32_t)nl->scope_ports.size();
+    const uint32_t nets_base  = (uint32_t)nl->scope_nets.size();
+    const uint32_t gate_base  = (uint32_t)netlist_gate_count(*nl);
+
+    for(netlist_scope_t scope : src.scopes) {
+        scope.parent     += scope_base;
+        scope.first_port += port_base;
+        scope.last_port  += port_base;
+        scope.first_gate += gate_base;
+        scope.last_gate  += gate_base;
+        nl->scopes.push_back(scope);
+    }
+    for(netlist_port_t port : src.scope_ports) {
+        port.first += nets_base;
+        nl->scope_ports.push_back(port);
+    }
+    for(net_t n : src.scope_nets)
+        nl->scope_nets.push_back(map(n));
+
+    netlist_scope_t& inst = nl->scopes[scope_base];
+    inst.name       = name;
+    inst.parent     = 0u;
+    inst.first_port = (uint32_t)nl->scope_ports.size();
+
+    const uint32_t fanin_base = (uint32_t)nl->fanin.size();
+    for(net_t n : src.fanin)
+        nl->fanin.push_back(map(n));
+    for(size_t g = 1ul; g < src.fanin_offsets.size(); g++)
+        nl->fanin_offsets.push_back(src.fanin_offsets[g] + fanin_base);
+    for(net_t n : src.gate_outputs)
+        nl->gate_outputs.push_back(map(n));
+    nl->gate_types.insert(nl->gate_types.end(), src.gate_types.begin(), src.gate_types.end());
+
+    // port_nets of a child fragment hold every port bit in order
+    const net_t* nets = src.port_nets.data();
+    const module_desc_t* mod = frag.info->mod;
+
+    for(size_t i = 0ul; i < frag.port_widths.size(); i++) {
+        const value_t& p = E.ports[first_port + i];
+
+        netlist_port_t port;
+        port.name      = mod->constants[frag.info->ports[i].constant];
+        port.is_output = frag.info->ports[i].is_output;
+        port.first     = (uint32_t)nl->scope_nets.size();
+        port.width     = std::max(frag.port_widths[i], 1u);
+        nl->scope_ports.push_back(port);
+        for(uint32_t b = 0u; b < port.width; b++)
+            nl->scope_nets.push_back(map(nets[b]));
+
+        if(p.kind == value_kind_t::net) {
+            netlist_connect(nl, (net_t)p.i, map(*nets++));
+        } else {
+            for(uint32_t b = 0u; b < p.n; b++)
+                netlist_connect(nl, E.bus_nets[p.i + b], map(*nets++));
+        }
+    }
+
+    nl->scopes[scope_base].last_port = (uint32_t)nl->scope_ports.size();
+}
+
+static inline bool elab_settled(const fragment_t& frag) {
+    return frag.state.load(std::memory_order_acquire) != fragment_state_t::running;
+}
+
+//
+// runs other tasks until frag is done or failed
+//
+static void elab_wait(elab_shared_t& S, const fragment_t& frag) {
+
+    if(elab_settled(frag))
+        return;
+
+    // without other threads every instance is finished before its parent goes on
+    if(S.opts.pool == NULL || thread_pool_size(S.opts.pool) == 1ul)
+        INTERNAL_ERR();
+
+    thread_pool_wait_until(S.opts.pool, [&] { return elab_settled(frag); });
+}
+
+//
+// true if from waits for to, directly or through other fragments. called with
+// graph_lock held
+//
+static bool elab_waits_for(const fragment_t* from, const fragment_t* to) {
+
+    std::vector<const fragment_t*> todo = { from };
+    std::vector<const fragment_t*> seen;
+
+    while(!todo.empty()) {
+        const fragment_t* frag = todo.back();
+        todo.pop_back();
+
+        if(frag == to)
+            return true;
+        if(elab_settled(*frag) || std::find(seen.begin(), seen.end(), frag) != seen.end())
+            continue;
+
+        seen.push_back(frag);
+        todo.insert(todo.end(), frag->waits_for.begin(), frag->waits_for.end());
+    }
+    return false;
+}
+
+//
+// marks frag done, or failed with error. the fragments it waited for may go
+// away after this
+//
+static void elab_settle(elab_shared_t& S, fragment_t& frag, const std::string* error) {
+
+    if(S.opts.memoize) {
+        std::lock_guard<std::mutex> guard(S.graph_lock);
+        frag.waits_for.clear();
+    }
+
+    if(error != NULL)
+        frag.error = *error;
+    frag.state.store(error != NULL ? fragment_state_t::failed : fragment_state_t::done, std::memory_order_release);
+}
+
+//
+// the body has run to the end. splices in the children in the order they were
+// created and finalizes the netlist of the instance
+//
+static void elab_finish(elaborator_t& E) {
+
+    const frame_t& f = E.frame;
+    module_desc_t* mod = f.info->mod;
+
+    for(size_t i = 0ul; i < f.info->ports.size(); i++)
+        if(E.ports[f.first_port + i].kind == value_kind_t::none)
+            elab_error("module '" + mod->name + "' never sets the size of interface element '" + mod->constants[f.info->ports[i].constant] + "'");
+
+    // the gates of the body come before those of the children
+    E.nl->scopes[0].last_gate = (uint32_t)netlist_gate_count(*E.nl);
+
+    size_t child_depth = 0ul;
+    std::vector<uint32_t> numbered(E.shared->infos.size(), 0u); // instances of each module so far
+
+    for(const child_t& c : E.children) {
+        const fragment_t& frag = *c.frag;
+
+        elab_wait(*E.shared, frag);
+        if(frag.state.load(std::memory_order_acquire) == fragment_state_t::failed)
+            elab_error(elab_trace(frag.error, f.info, c.call_pc));
+
+        const module_info_t* info = frag.info;
+        elab_splice(E, frag, c.first_port, info->mod->name + "_" + STR(numbered[info->index]++));
+
+        // a shared fragment is counted once, by the instance that made it
+        if(c.reused) {
+            E.stats.cache_hits++;
+            E.stats.strash_merged += frag.stats.strash_merged;
+        } else {
+            E.stats.instructions += frag.stats.instructions;
+            E.stats.cache_hits   += frag.stats.cache_hits;
+            E.stats.cache_misses += frag.stats.cache_misses;
+        }
+        E.stats.instances += frag.stats.instances;
+        child_depth = std::max(child_depth, frag.stats.max_depth);
+    }
+
+    // port nets outlive the instance, they are copied out of the arena into
+    // the fragment. only the top names its ports, a child only needs the bits
+    // in order
+    for(size_t i = 0ul; i < f.info->ports.size(); i++) {
+        const size_t first = E.nl->port_nets.size();
+
+        arena_scope_t scratch(&E.arena);
+        elab_nets_t nets(&E.arena);
+        elab_to_nets(E, E.ports[f.first_port + i], nets);
+        E.nl->port_nets.insert(E.nl->port_nets.end(), nets.begin(), nets.end());
+
+        if(E.depth == 0ul) {
+            netlist_port_t port;
+            port.name      = mod->constants[f.info->ports[i].constant];
+            port.is_output = f.info->ports[i].is_output;
+            port.first     = (uint32_t)first;
+            port.width     = (uint32_t)(E.nl->port_nets.size() - first);
+            E.nl->ports.push_back(port);
+        }
+    }
+
+    E.stats.instances++;
+    E.stats.cache_misses++;
+    E.stats.max_depth = child_depth + 1ul;
+
+    // children are copied into their parent, which still has to resolve shared tristates
+    E.nl->instances = E.stats.instances;
+    if(E.depth == 0ul)
+        netlist_finalize(E.nl);
+    else
+        netlist_compact(E.nl);
+
+    E.frag->stats = E.stats;
+}
+
+//
+// the rest of an instance body, on whatever thread the pool picks
+//
+static void elab_task(std::shared_ptr<elaborator_t> E, std::shared_ptr<fragment_t> frag) {
+
+    elab_shared_t& S = *E->shared;
+
+    try {
+        if(S.abort.load())
+            elab_error("elaboration stopped");
+
+        if(!elab_run(*E, E->frame))
+            INTERNAL_ERR();
+        elab_finish(*E);
+        elab_settle(S, *frag, NULL);
+    }
+    catch(std::exception& err) {
+        const std::string msg = err.what();
+        elab_settle(S, *frag, &msg);
+    }
+
+    E.reset();
+    S.tasks--; // S may be gone after this
+}
+
+//
+// elaborators are recycled per thread, so the stacks of an instance start
+// out with the capacity earlier instances grew them to
+//
+static const size_t elab_max_free   = 64ul;
+static const size_t elab_keep_arena = 4ul * arena_block_size; // per free elaborator
+static thread_local std::vector<std::unique_ptr<elaborator_t> > tls_free_elaborators;
+
+static void elab_recycle(elaborator_t* E) {
+
+    if(tls_free_elaborators.size() >= elab_max_free) {
+        delete E;
+        return;
+    }
+
+    E->stack.clear();
+    E->bindings.clear();
+    E->slots.clear();
+    E->scopes.clear();
+    E->vectors.clear();
+    arena_reset(&E->arena, elab_keep_arena);
+    E->ports.clear();
+    E->instances.clear();
+    E->records.clear();
+    E->bus_nets.clear();
+    E->children.clear();
+    E->frame = frame_t();
+    E->depth = 0ul;
+    E->stats = elaborate_stats_t();
+
+    tls_free_elaborators.emplace_back(E);
+}
+
+static std::shared_ptr<elaborator_t> elab_new_elaborator(void) {
+
+    elaborator_t* E = NULL;
+    if(tls_free_elaborators.empty()) {
+        E = new elaborator_t;
+    } else {
+        E = tls_free_elaborators.back().release();
+        tls_free_elaborators.pop_back();
+    }
+    return std::shared_ptr<elaborator_t>(E, elab_recycle);
+}
+
+//
+// a new instance of info. runs the body until the sizes of all interface
+// arrays are known, which is all the parent needs, and leaves the rest to a
+// task. without other threads the rest runs right away
+//
+static std::shared_ptr<fragment_t> elab_begin(
+        elab_shared_t& S,
+        module_info_t* info,
+        const value_t* args,
+        size_t n_args,
+        size_t depth) {
+
+    module_desc_t* mod = info->mod;
+
+    std::shared_ptr<fragment_t>   frag = std::make_shared<fragment_t>();
+    std::shared_ptr<elaborator_t> E    = elab_new_elaborator();
+
+    frag->info = info;
+    E->shared  = &S;
+    E->frag    = frag.get();
+    E->nl      = &frag->nl;
+    E->depth   = depth;
+
+    // the parent renames scope 0 when it splices the fragment in
+    netlist_scope_t scope;
+    scope.name   = mod->name;
+    scope.module = info->index;
+    frag->nl.scopes.push_back(scope);
+
+    frame_t& f = E->frame;
+    f.info         = info;
+    f.stack_base   = 0ul;
+    f.binding_base = 0ul;
+    f.slot_base    = 0ul;
+    f.scope_base   = 0ul;
+    f.vector_base  = 0ul;
+    f.first_port   = 0u;
+
+    E->slots.assign(mod->constants.size(), -1);
+    E->scopes.push_back(0ul);
+
+    // args point into the stack of the parent, bind them before anything runs
+    for(size_t i = 0ul; i < n_args; i++)
+        elab_declare(*E, f, mod->argument_list[i].first, args[i]);
+
+    // single bit ports exist right away, arrays once the body sets their size
+    for(const port_desc_t& pd : info->ports) {
+        E->ports.push_back(pd.is_array ? value_t() : make_value(value_kind_t::net, netlist_new_net(E->nl)));
+        f.unsized += pd.is_array ? 1u : 0u;
+    }
+
+    const bool finished = f.unsized > 0u && elab_run(*E, f);
+    if(finished)
+        elab_finish(*E);
+
+    for(size_t i = 0ul; i < info->ports.size(); i++) {
+        const value_t& p = E->ports[f.first_port + i];
+        frag->port_widths.push_back(p.kind == value_kind_t::bus ? p.n : 0u);
+    }
+
+    if(finished) {
+        elab_settle(S, *frag, NULL);
+        return frag;
+    }
+
+    // with nobody to hand the task to it may as well run while E is warm
+    S.tasks++;
+    if(S.opts.pool == NULL || thread_pool_size(S.opts.pool) == 1ul)
+        elab_task(E, frag);
+    else
+        thread_pool_spawn(S.opts.pool, [E, frag] { elab_task(E, frag); });
+
+    return frag;
+}
+
+static void elab_check_args(const module_info_t* info, const value_t* args, size_t n_args) {
+
+    const module_desc_t* mod = info->mod;
+
+    if(n_args != mod->argument_list.size())
+        elab_error("module '" + mod->name + "' expects " + STR(mod->argument_list.size()) + " argument(s), got " + STR(n_args));
+
+    for(size_t i = 0ul; i < n_args; i++) {
+        const auto& arg = mod->argument_list[i];
+        const bool want_string = arg.second == token_type_t::keyword_string;
+
+        if(want_string ? args[i].kind != value_kind_t::string : args[i].kind != value_kind_t::integer)
+            elab_error("argument '" + mod->constants[arg.first] + "' of module '" + mod->name + "' must be " +
+                    (want_string ? "a string" : "an integer") + ", found " + value_kind_name(args[i].kind));
+
+        if(arg.second == token_type_t::keyword_uinteger && args[i].i < 0)
+            elab_error("argument '" + mod->constants[arg.first] + "' of module '" + mod->name + "' must not be negative");
+    }
+}
+
+static value_t elab_instantiate(elaborator_t& E, module_info_t* info, const value_t* args, size_t n_args, size_t call_pc) {
+
+    elab_shared_t& S = *E.shared;
+    module_desc_t* mod = info->mod;
+
+    elab_check_args(info, args, n_args);
+
+    if(E.depth + 1ul >= elaborate_max_depth)
+        elab_error("module instances nested more than " + STR(elaborate_max_depth) + " deep, is '" + mod->name + "' recursive?");
+
+    std::shared_ptr<fragment_t> frag;
+    bool reused = false;
+
+    // argument types are fixed per module, the values alone identify an instance
+    std::vector<int64_t> key;
+    if(S.opts.memoize) {
+        key.resize(n_args);
+        for(size_t i = 0ul; i < n_args; i++)
+            key[i] = args[i].i;
+
+        std::lock_guard<std::mutex> guard(info->lock);
+        auto iter = info->fragments.find(key);
+        if(iter != info->fragments.end()) {
+            frag   = iter->second;
+            reused = true;
+        }
+    }
+
+    if(reused) {
+        if(!elab_settled(*frag)) {
+            std::lock_guard<std::mutex> guard(S.graph_lock);
+            if(elab_waits_for(frag.get(), E.frag))
+                elab_error("module '" + mod->name + "' ends up instantiating itself with the same arguments, is it recursive?");
+            E.frag->waits_for.push_back(frag.get());
+        }
+    } else {
+        frag = elab_begin(S, info, args, n_args, E.depth + 1ul);
+
+        if(S.opts.memoize) {
+            // if another instance got there first this fragment stays private
+            {
+                std::lock_guard<std::mutex> guard(info->lock);
+                info->fragments.emplace(key, frag);
+            }
+            std::lock_guard<std::mutex> guard(S.graph_lock);
+            E.frag->waits_for.push_back(frag.get());
+        }
+    }
+
+    // placeholders for the ports, tied to the fragment when it is spliced in
+    const uint32_t first_port = (uint32_t)E.ports.size();
+
+    for(uint32_t width : frag->port_widths) {
+        if(width == 0u) {
+            E.ports.push_back(make_value(value_kind_t::net, netlist_new_net(E.nl)));
+        } else {
+            const net_t first   = netlist_new_nets(E.nl, width);
+            const size_t offset = E.bus_nets.size();
+            for(uint32_t i = 0u; i < width; i++)
+                E.bus_nets.push_back(first + i);
+            E.ports.push_back(make_value(value_kind_t::bus, offset, width));
+        }
+    }
+
+    E.instances.push_back({ info, first_port });
+    E.children.push_back({ frag, first_port, (uint32_t)call_pc, reused });
+
+    return make_value(value_kind_t::instance, E.instances.size() - 1ul);
+}
+
+//
+// "name(arg, ...)" -> name and argument values
+//
+static std::string elab_parse_top(const std::string& top, std::vector<value_t>& args) {
+
+    auto trim = [](const std::string& s) {
+        const size_t b = s.find_first_not_of(" \t");
+        const size_t e = s.find_last_not_of(" \t");
+        return b == std::string::npos ? std::string() : s.substr(b, e - b + 1ul);
+    };
+
+    const size_t lparen = top.find('(');
+    const std::string name = trim(top.substr(0ul, lparen));
+
+    if(name.empty())
+        elab_error("no top module given in '" + top + "'");
+
+    if(lparen == std::string::npos)
+        return name;
+
+    const std::string rest = trim(top.substr(lparen + 1ul));
+    if(rest.empty() || rest.back() != ')')
+        elab_error("expecting ')' at the end of '" + top + "'");
+
+    const std::string list = trim(rest.substr(0ul, rest.size() - 1ul));
+    if(list.empty() || list == "void")
+        return name;
+
+    size_t start = 0ul;
+    while(start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if(comma == std::string::npos)
+            comma = list.size();
+
+        const std::string arg = trim(list.substr(start, comma - start));
+        if(arg.empty())
+            elab_error("empty argument in '" + top + "'");
+
+        if(arg.size() >= 2ul && arg.front() == '"' && arg.back() == '"') {
+            args.push_back(make_value(value_kind_t::string, string_pool_intern(global_string_pool(), arg.substr(1ul, arg.size() - 2ul))));
+        } else {
+            const bool bin = arg.size() > 2ul && arg[0] == '0' && (arg[1] == 'b' || arg[1] == 'B');
+            char* end = NULL;
+            const long long v = strtoll(arg.c_str() + (bin ? 2 : 0), &end, bin ? 2 : (arg.compare(0, 2, "0x") == 0 ? 16 : 10));
+
+            if(*end == '\0')
+                args.push_back(make_value(value_kind_t::integer, v));
+            else
+                args.push_back(make_value(value_kind_t::string, string_pool_intern(global_string_pool(), arg)));
+        }
+
+        start = comma + 1ul;
+    }
+
+    return name;
+}
+
+//
+// tells tasks that have not started yet to give up and waits for the rest
+//
+static void elab_stop(elab_shared_t& S) {
+    S.abort = true;
+    if(S.opts.pool != NULL)
+        thread_pool_wait_until(S.opts.pool, [&] { return S.tasks.load() == 0ul; });
+}
+
+elaborate_stats_t elaborate_top(
+        runtime_env_t* renv,
+        const std::string& top,
+        netlist_t& nl,
+        std::ostream& os,
+        const elaborate_options_t& opts) {
+
+    elab_shared_t S;
+    S.renv = renv;
+    S.os   = &os;
+    S.opts = opts;
+    S.sym_output = string_pool_intern(global_string_pool(), "output");
+
+    elab_prepare_modules(S);
+
+    std::vector<value_t> args;
+    const std::string name = elab_parse_top(top, args);
+
+    auto iter = renv->modules.find(name);
+    if(iter == renv->modules.end())
+        elab_error("top module '" + name + "' is not defined");
+
+    module_info_t* info = NULL;
+    for(module_info_t& i : S.infos)
+        if(i.mod == iter->second)
+            info = &i;
+
+    // the top instance is elaborated like any other, its fragment is the result
+    std::shared_ptr<fragment_t> frag;
+    try {
+        elab_check_args(info, args.data(), args.size());
+        frag = elab_begin(S, info, args.data(), args.size(), 0ul);
+        elab_wait(S, *frag);
+    }
+    catch(...) {
+        elab_stop(S);
+        throw;
+    }
+    elab_stop(S);
+
+    if(frag->state.load() == fragment_state_t::failed)
+        elab_error(frag->error);
+
+    elaborate_stats_t stats = frag->stats;
+
+    nl = std::move(frag->nl);
+    for(const module_info_t& i : S.infos)
+        nl.modules.push_back(i.mod->name);
+
+    // constants that reach a gate can make it a duplicate of another one
+    if(opts.sweep)
+        stats.sweep = netlist_sweep(&nl, opts.four_state);
+    if(opts.strash)
+        stats.strash_merged += netlist_strash(&nl);
+    netlist_build_fanout(&nl);
+
+    stats.gates = netlist_gate_count(nl);
+    return stats;
+}
+
+std::ostream& operator<<(std::ostream& os, const elaborate_stats_t& stats) {
+    os << "elaborate : " << stats.instances << " instances, " << stats.instructions
+       << " instructions executed, nesting depth " << stats.max_depth << "\n"
+       << "    template cache : " << stats.cache_hits << " hits, " << stats.cache_misses << " misses\n"
+       << "    structural hashing : " << stats.strash_merged << " gates merged\n";
+
+    const netlist_sweep_stats_t& sw = stats.sweep;
+    if(sw.passes > 0ul) {
+        os << "    sweep : " << sw.constant << " constant, " << sw.dead << " dead, "
+           << sw.simplified << " simplified, " << sw.passes << " passes\n";
+        for(auto& m : sw.removed_by_module)
+            os << "        " << m.first << " : " << m.second << " removed\n";
+    }
+
+    os << "    gates : " << stats.gates + stats.strash_merged + sw.constant + sw.dead
+       << " before optimizing, " << stats.gates << " after\n";
+    return os;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <src/runtime/runtime-env.h>
+#include <src/runtime/netlist.h>
+#include <src/runtime/netlist-optimize.h>
+
+#include <stddef.h>
+
+#include <string>
+#include <iostream>
+
+//
+// elaboration runs the bytecode of a module with concrete arguments. loops and
+// conditions are evaluated, module instances are expanded in place and every
+// gate builtin or operator applied to signals becomes a gate in a flat netlist.
+// integers, strings and vectors only exist while elaborating
+//
+
+struct thread_pool_t;
+
+struct elaborate_options_t {
+    // the first instance of a module with a particular set of arguments is
+    // kept as a template. later instances with the same arguments copy its
+    // gates instead of running the body again, so print() output of a module
+    // only appears once per distinct set of arguments
+    bool memoize = true;
+
+    // gates with the same type and the same inputs are built once, while
+    // elaborating and again over the whole netlist afterwards. see
+    // netlist_add_hashed_gate and netlist_strash
+    bool strash = true;
+
+    // constant propagation and dead logic removal on the finished netlist,
+    // see netlist_sweep. four_state keeps the flipflops that two state logic
+    // would fold, for a netlist simulated with X and Z
+    bool sweep = true;
+    bool four_state = false;
+
+    // module instances run as tasks on the pool, NULL runs them one after
+    // another. the netlist comes out the same either way, lines of print()
+    // output from different instances may come out in any order
+    thread_pool_t* pool = NULL;
+};
+
+struct elaborate_stats_t {
+    size_t instructions  = 0ul; // bytecode instructions executed
+    size_t instances     = 0ul; // including the top module
+    size_t max_depth     = 0ul; // deepest module nesting
+    size_t cache_hits    = 0ul; // instances copied from a template
+    size_t cache_misses  = 0ul; // instances elaborated by running their body
+    size_t strash_merged = 0ul; // gates left out because an identical one existed
+    size_t gates         = 0ul; // in the final netlist
+
+    netlist_sweep_stats_t sweep;
+};
+
+//
+// top is written the way a module is instantiated, without the leading
+// `module.', e.g. "adder(32)" or "full_adder". arguments are integers (decimal,
+// 0x hex or 0b binary) or strings. output of print() goes to os. any error is
+// thrown as std::runtime_error, with the chain of module instances that led
+// to it. nl must be empty, it is finalized and has its fanout built on success
+//
+elaborate_stats_t elaborate_top(
+        runtime_env_t* renv,
+        const std::string& top,
+        netlist_t& nl,
+        std::ostream& os,
+        const elaborate_options_t& opts = elaborate_options_t());
+
+std::ostream& operator<<(std::ostream& os, const elaborate_stats_t& stats);
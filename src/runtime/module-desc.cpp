@@ -62,18 +62,23 @@ size_t module_desc_add_string_constant(
         module_desc_t* modptr,
         const std::string& string_constant) {
 
-    // TODO : use a map<> for the lookup
-    size_t idx = 0ul;
-    for(auto& s : modptr->constants) {
-        if(s == string_constant) {
-            return idx;
-        }
-        idx++;
-    }
+    return module_desc_add_symbol_constant(
+            modptr, string_pool_intern(global_string_pool(), string_constant));
+}
+
+size_t module_desc_add_symbol_constant(
+        module_desc_t* modptr,
+        symbol_t sym) {
+
+    auto iter = modptr->constant_index.find(sym);
+    if(iter != modptr->constant_index.end())
+        return iter->second;
 
     // the constant does not exist in constant array
-    idx = modptr->constants.size();
-    modptr->constants.push_back(string_constant);
+    const size_t idx = modptr->constants.size();
+    modptr->constants.push_back(string_pool_string(global_string_pool(), sym));
+    modptr->constant_syms.push_back(sym);
+    modptr->constant_index.insert({ sym, idx });
     return idx;
 }
 
@@ -81,15 +86,22 @@ std::pair<bool, size_t> module_desc_get_idx_of_string(
         module_desc_t* modptr,
         const std::string& string_constant) {
 
-    size_t idx = 0ul;
-    for(auto& s : modptr->constants) {
-        if(s == string_constant) {
-            return { true, idx };
-        }
-        idx++;
-    }
+    const symbol_t sym = string_pool_find(global_string_pool(), string_constant.data(), string_constant.size());
+    if(sym == symbol_none)
+        return { false, 0ul };
 
-    return { false, 0ul }; // doesnt matter what second entry is
+    return module_desc_get_idx_of_symbol(modptr, sym);
+}
+
+std::pair<bool, size_t> module_desc_get_idx_of_symbol(
+        module_desc_t* modptr,
+        symbol_t sym) {
+
+    auto iter = modptr->constant_index.find(sym);
+    if(iter == modptr->constant_index.end())
+        return { false, 0ul }; // doesnt matter what second entry is
+
+    return { true, iter->second };
 }
 
 void module_desc_add_argument_desc(
@@ -98,17 +110,14 @@ void module_desc_add_argument_desc(
         token_t& arg_name,
         token_t& arg_type) {
 
-    const string_t arg_name_s = lexer_token_value(arg_name, p.src);
-
     for(auto& q : modptr->argument_list) {
-        const string_t args = modptr->constants.at(q.first);
-        if(args == arg_name_s)
+        if(modptr->constant_syms.at(q.first) == arg_name.sym)
             throw_parse_error(
-                    "In module '" + modptr->name + "', argument with name '" + arg_name_s + "' already exists",\
+                    "In module '" + modptr->name + "', argument with name '" + lexer_token_value(arg_name, p.src) + "' already exists",\
                     p.filename, p.src, arg_name);
     }
 
-    size_t arg_idx = module_desc_add_string_constant(modptr, arg_name_s);
+    size_t arg_idx = module_desc_add_symbol_constant(modptr, arg_name.sym);
     modptr->argument_list.push_back({ arg_idx, arg_type.type });
 }
 
@@ -118,7 +127,7 @@ size_t module_desc_alloc_jump_label(
     size_t next_avail = modptr->jump_targets.size();
 
     const size_t unused = ~0ul;
-    modptr->jump_targets.insert({ next_avail, unused });
+    modptr->jump_targets.push_back(unused);
 
     return next_avail;
 }
@@ -128,13 +137,12 @@ void module_desc_define_jump_label(
         const size_t jump_label,
         const size_t jump_target) {
 
-    auto iter = modptr->jump_targets.find(jump_label);
-    if(iter == modptr->jump_targets.end())
+    if(jump_label >= modptr->jump_targets.size())
         INTERNAL_ERR();
 
     const size_t unused = ~0ul;
-    if(iter->second != unused)
+    if(modptr->jump_targets[jump_label] != unused)
         INTERNAL_ERR();
 
-    iter->second = jump_target;
+    modptr->jump_targets[jump_label] = jump_target;
 }
@@ -1,12 +1,14 @@
 #pragma once
 
 #include <src/lexer.h>
+#include <src/string-pool.h>
 #include <src/semantic-analysis/parser.h>
 
 #include <stddef.h>
 
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <tuple>
 #include <vector>
 #include <utility>
@@ -15,9 +17,17 @@
 struct module_desc_t {
     std::string name;
 
+    // where the module was defined, used when reporting errors across files
+    std::string filename;
+    token_t     name_token;
+
     // used in the bytecode stream for various purposes. string references in bytecode
     // are referenced as indices into this table
     std::vector<std::string> constants;
+    std::vector<symbol_t>    constant_syms; // interned copy of each entry in constants
+
+    // symbol -> index into constants
+    std::unordered_map<symbol_t, size_t> constant_index;
 
     enum class interface_type_t {
         in, out
@@ -36,7 +46,10 @@ struct module_desc_t {
 
     std::vector<uint8_t> bytecode;
 
-    std::map<size_t, size_t> jump_targets;
+    // jump label -> bytecode offset, only used while the module is being
+    // generated. link_bytecode resolves every jump and empties both of these
+    std::vector<size_t> jump_targets;
+    std::vector<size_t> jump_fixups; // offsets of jump operands still holding a label
 
     long int scope_levels = 1;
 };
@@ -56,18 +69,24 @@ size_t module_desc_add_string_constant(
         module_desc_t* modptr,
         const std::string& string_constant);
 
+size_t module_desc_add_symbol_constant(
+        module_desc_t* modptr,
+        symbol_t sym);
+
 std::pair<bool, size_t> module_desc_get_idx_of_string(
         module_desc_t* modptr,
         const std::string& string_constant);
 
+std::pair<bool, size_t> module_desc_get_idx_of_symbol(
+        module_desc_t* modptr,
+        symbol_t sym);
+
 void module_desc_add_argument_desc(
         module_desc_t* modptr,
         struct parse_info_t& p,
         token_t& arg_name,
         token_t& arg_type);
 
-size_t module_desc_alloc_jump_target(module_desc_t* modptr);
-
 size_t module_desc_alloc_jump_label(
         module_desc_t* modptr);
 
@@ -0,0 +1,297 @@
+#include <src/runtime/netlist-optimize.h>
+#include <src/runtime/netlist.h>
+#include <src/error-util.h>
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct sweep_t {
+    netlist_t* nl;
+    net_t first;
+    bool four_state;
+
+    // net the output of each gate reads as, its own output while the gate stays
+    std::vector<net_t> alias;
+
+    // inputs still in use, at the start of the fanin range of each gate
+    std::vector<uint32_t> width;
+};
+
+static inline int sweep_constant(net_t n) {
+    return n == net_const0 ? 0 : (n == net_const1 ? 1 : -1);
+}
+
+static inline net_t sweep_net(int value) {
+    return value ? net_const1 : net_const0;
+}
+
+static inline bool sweep_alive(const sweep_t& S, uint32_t g) {
+    return S.alias[g] == S.first + g;
+}
+
+//
+// inputs, undriven nets and tristate or bus outputs. with four states gates
+// read Z as X, so a gate left with one of those as its only input stays
+//
+static bool sweep_may_float(const sweep_t& S, net_t n) {
+    if(n < S.first)
+        return n != net_const0 && n != net_const1;
+    const gate_type_t type = netlist_gate_type(*S.nl, n - S.first);
+    return type == gate_type_t::tristate || type == gate_type_t::bus;
+}
+
+static net_t sweep_resolve(sweep_t& S, net_t n) {
+
+    net_t r = n;
+    while(r >= S.first && S.alias[r - S.first] != r)
+        r = S.alias[r - S.first];
+
+    // shorten the chain for the next lookup
+    while(n >= S.first && S.alias[n - S.first] != r) {
+        const net_t next = S.alias[n - S.first];
+        S.alias[n - S.first] = r;
+        n = next;
+    }
+    return r;
+}
+
+//
+// one gate, its inputs already resolved. returns true when the gate was
+// removed or rewritten
+//
+static bool sweep_gate(sweep_t& S, netlist_sweep_stats_t& stats, uint32_t g) {
+
+    netlist_t* nl = S.nl;
+    net_t* in = nl->fanin.data() + nl->fanin_offsets[g];
+    const size_t n = S.width[g];
+    const gate_type_t type = netlist_gate_type(*nl, g);
+
+    auto replace = [&](net_t with) {
+        // a gate on a loop that only passes itself on stays as it is
+        if(with == S.first + g)
+            return false;
+        S.alias[g] = with;
+        stats.constant++;
+        return true;
+    };
+
+    auto rewrite = [&](gate_type_t t, size_t m) {
+        const bool changed = t != type || m != n;
+        nl->gate_types[g] = static_cast<uint8_t>(t);
+        S.width[g] = (uint32_t)m;
+        return changed;
+    };
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(type) {
+    case gate_type_t::not_: {
+        const int c = sweep_constant(in[0]);
+        return c >= 0 ? replace(sweep_net(!c)) : false;
+    }
+
+    case gate_type_t::and_:
+    case gate_type_t::nand:
+    case gate_type_t::or_:
+    case gate_type_t::nor_: {
+        const int  control  = (type == gate_type_t::and_ || type == gate_type_t::nand) ? 0 : 1;
+        const bool inverted = type == gate_type_t::nand || type == gate_type_t::nor_;
+
+        size_t m = 0ul;
+        for(size_t i = 0ul; i < n; i++) {
+            const int c = sweep_constant(in[i]);
+            if(c == control)
+                return replace(sweep_net(control ^ inverted));
+            if(c < 0)
+                in[m++] = in[i];
+        }
+
+        if(m == 0ul)
+            return replace(sweep_net(!control ^ inverted));
+        if(m == 1ul && (inverted || !S.four_state || !sweep_may_float(S, in[0])))
+            return inverted ? rewrite(gate_type_t::not_, 1ul) : replace(in[0]);
+        return rewrite(type, m);
+    }
+
+    case gate_type_t::xor_:
+    case gate_type_t::xnor_: {
+        int parity = type == gate_type_t::xnor_ ? 1 : 0;
+
+        size_t m = 0ul;
+        for(size_t i = 0ul; i < n; i++) {
+            const int c = sweep_constant(in[i]);
+            if(c < 0)
+                in[m++] = in[i];
+            else
+                parity ^= c;
+        }
+
+        if(m == 0ul)
+            return replace(sweep_net(parity));
+        if(m == 1ul && (parity || !S.four_state || !sweep_may_float(S, in[0])))
+            return parity ? rewrite(gate_type_t::not_, 1ul) : replace(in[0]);
+        return rewrite(parity ? gate_type_t::xnor_ : gate_type_t::xor_, m);
+    }
+
+    case gate_type_t::flipflop: {
+        // never clocked, or clocked but only ever loads the 0 it starts with.
+        // a clock tied to 1 rises once, in the evaluation simulator_init runs,
+        // so it loads d then and never again. with four states it starts out
+        // as X and only that load makes it known
+        const net_t d = in[0];
+        const int clk = sweep_constant(in[1]);
+        if(!S.four_state && (clk == 0 || d == net_const0 || d == S.first + g))
+            return replace(net_const0);
+        if(clk == 1 && sweep_constant(d) >= 0)
+            return replace(d);
+        return false;
+    }
+
+    case gate_type_t::tristate:
+        return sweep_constant(in[1]) == 1 ? replace(in[0]) : false;
+
+    case gate_type_t::bus: {
+        size_t m = 0ul;
+        for(size_t i = 0ul; i < n; i++) {
+            const int64_t d = in[i] >= S.first ? (int64_t)(in[i] - S.first) : -1;
+            const bool disabled =
+                    d >= 0 && netlist_gate_type(*nl, (uint32_t)d) == gate_type_t::tristate &&
+                    sweep_resolve(S, nl->fanin[nl->fanin_offsets[d] + 1ul]) == net_const0;
+            if(!disabled)
+                in[m++] = in[i];
+        }
+
+        if(m == 1ul)
+            return replace(in[0]);
+        return rewrite(type, m);
+    }
+
+    default:
+        INTERNAL_ERR();
+    }
+    #pragma GCC diagnostic pop
+}
+
+netlist_sweep_stats_t netlist_sweep(netlist_t* nl, bool four_state) {
+
+    netlist_sweep_stats_t stats;
+
+    const size_t n_gates = netlist_gate_count(*nl);
+
+    sweep_t S;
+    S.nl    = nl;
+    S.first = nl->first_gate_net;
+    S.four_state = four_state;
+    S.alias.resize(n_gates);
+    S.width.resize(n_gates);
+    for(size_t g = 0ul; g < n_gates; g++) {
+        S.alias[g] = S.first + (net_t)g;
+        S.width[g] = nl->fanin_offsets[g + 1ul] - nl->fanin_offsets[g];
+    }
+
+    // the combinational gates in order, then the flipflops and the gates on
+    // loops. only a change to one of those last ones can affect a gate that
+    // has already been looked at, so only then another pass is needed
+    std::vector<uint32_t> order, last;
+    const size_t ordered = netlist_order_gates(*nl, order);
+
+    std::vector<uint32_t> comb;
+    comb.reserve(ordered);
+    for(size_t i = 0ul; i < order.size(); i++) {
+        const bool ff = netlist_gate_type(*nl, order[i]) == gate_type_t::flipflop;
+        (ff || i >= ordered ? last : comb).push_back(order[i]);
+    }
+
+    auto visit = [&](uint32_t g) {
+        if(!sweep_alive(S, g))
+            return false;
+
+        net_t* in = nl->fanin.data() + nl->fanin_offsets[g];
+        for(size_t i = 0ul; i < S.width[g]; i++)
+            in[i] = sweep_resolve(S, in[i]);
+        return sweep_gate(S, stats, g);
+    };
+
+    for(bool changed = true; changed; ) {
+        changed = false;
+        stats.passes++;
+
+        for(uint32_t g : comb)
+            visit(g);
+        for(uint32_t g : last)
+            changed = visit(g) || changed;
+    }
+
+    // everything an output or a flipflop depends on stays
+    std::vector<uint8_t>  live(n_gates, 0u);
+    std::vector<uint32_t> todo;
+
+    auto mark = [&](net_t n) {
+        n = sweep_resolve(S, n);
+        if(n >= S.first && !live[n - S.first]) {
+            live[n - S.first] = 1u;
+            todo.push_back(n - S.first);
+        }
+    };
+
+    for(const netlist_port_t& port : nl->ports)
+        if(port.is_output)
+            for(net_t n : netlist_port_nets(*nl, port))
+                mark(n);
+
+    for(uint32_t g = 0u; g < n_gates; g++)
+        if(sweep_alive(S, g) && netlist_gate_type(*nl, g) == gate_type_t::flipflop)
+            mark(S.first + g);
+
+    while(!todo.empty()) {
+        const uint32_t g = todo.back();
+        todo.pop_back();
+
+        const net_t* in = nl->fanin.data() + nl->fanin_offsets[g];
+        for(size_t i = 0ul; i < S.width[g]; i++)
+            mark(in[i]);
+    }
+
+    // nothing live reads a dead gate, so what it is replaced with does not matter
+    std::vector<net_t> replaced(n_gates);
+    std::vector<uint32_t> gate_scopes; // for the report, once a gate goes
+    for(uint32_t g = 0u; g < n_gates; g++) {
+        const bool alive = sweep_alive(S, g);
+
+        if(alive && !live[g])
+            stats.dead++;
+        else if(alive && S.width[g] != nl->fanin_offsets[g + 1ul] - nl->fanin_offsets[g])
+            stats.simplified++;
+
+        if(!alive || !live[g]) {
+            if(gate_scopes.empty())
+                netlist_gate_scopes(*nl, gate_scopes);
+            const uint16_t module = nl->scopes.empty() ? 0u : nl->scopes[gate_scopes[g]].module;
+            const std::string& name = module < nl->modules.size() ? nl->modules[module] : std::string("?");
+            stats.removed_by_module[name]++;
+        }
+
+        const net_t r = alive ? (live[g] ? S.first + g : net_const0) : sweep_resolve(S, S.first + g);
+        replaced[g] = (r >= S.first && !live[r - S.first]) ? net_const0 : r;
+    }
+
+    // the inputs dropped along the way go before the gates are renumbered
+    std::vector<uint32_t> offsets = { 0u };
+    offsets.reserve(n_gates + 1ul);
+    size_t used = 0ul;
+    for(uint32_t g = 0u; g < n_gates; g++) {
+        const uint32_t from = nl->fanin_offsets[g];
+        for(size_t i = 0ul; i < S.width[g]; i++)
+            nl->fanin[used++] = sweep_resolve(S, nl->fanin[from + i]);
+        offsets.push_back((uint32_t)used);
+    }
+    nl->fanin.resize(used);
+    nl->fanin.shrink_to_fit();
+    nl->fanin_offsets.swap(offsets);
+
+    netlist_remove_gates(nl, replaced);
+    return stats;
+}
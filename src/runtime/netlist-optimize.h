@@ -0,0 +1,49 @@
+#pragma once
+
+#include <src/runtime/netlist.h>
+
+#include <stddef.h>
+
+#include <map>
+#include <string>
+
+//
+// passes over a finalized netlist that run after elaboration. structural
+// hashing (netlist_strash) lives with the netlist because the elaborator
+// uses the same table while building
+//
+
+struct netlist_sweep_stats_t {
+    size_t passes     = 0ul; // constant propagation passes, more than one only for flipflops and loops
+    size_t constant   = 0ul; // gates replaced by a constant or by one of their inputs
+    size_t simplified = 0ul; // gates left with fewer inputs or turned into a not
+    size_t dead       = 0ul; // gates that reach neither an output nor a flipflop
+
+    // constant + dead by the module whose body built the gate
+    std::map<std::string, size_t> removed_by_module;
+};
+
+//
+// propagates constants through every gate type until nothing changes, then
+// drops the gates that no top level output and no flipflop depends on
+//
+//     and, or, xor, ...  a controlling input decides the output, the other
+//                        constants are dropped. one input left becomes a
+//                        wire or a not. with four_state not a wire to a net
+//                        that may be Z, the gate turns that into X
+//     flipflop           a clock tied to 0 or a constant 0 (or its own
+//                        output) on d keeps it at 0 for good. a clock tied
+//                        to 1 rises once while the simulator starts, a
+//                        constant on d is what it holds from then on.
+//                        with four_state only the last one, the others
+//                        would hide the X a flipflop starts out as
+//     tristate           enable 1 makes it a wire to data
+//     bus                disabled tristates are dropped, one left becomes a
+//                        wire
+//
+// a tristate that is always disabled and drives a net on its own stays, it
+// leaves the net floating. ports and undriven nets are never removed. drops
+// the fanout. four_state sweeps for simulate_logic_t::four_state, where
+// flipflops start out as X
+//
+netlist_sweep_stats_t netlist_sweep(netlist_t* nl, bool four_state = false);
@@ -0,0 +1,634 @@
+#include <src/runtime/netlist.h>
+#include <src/error-util.h>
+
+#include <string>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <stdexcept>
+
+const char* gate_type_name(gate_type_t type) {
+    switch(type) {
+    case gate_type_t::not_:     return "not";
+    case gate_type_t::and_:     return "and";
+    case gate_type_t::nand:     return "nand";
+    case gate_type_t::or_:      return "or";
+    case gate_type_t::nor_:     return "nor";
+    case gate_type_t::xor_:     return "xor";
+    case gate_type_t::xnor_:    return "xnor";
+    case gate_type_t::flipflop: return "flipflop";
+    case gate_type_t::tristate: return "tristate";
+    case gate_type_t::bus:      return "bus";
+    default:
+        INTERNAL_ERR();
+    }
+}
+
+net_t netlist_new_net(netlist_t* nl) {
+    return netlist_new_nets(nl, 1ul);
+}
+
+net_t netlist_new_nets(netlist_t* nl, size_t n) {
+    if(nl->net_count + n > 0xFFFFFFFFul)
+        throw std::runtime_error("netlist : too many nets");
+
+    const net_t first = (net_t)nl->net_count;
+    for(size_t i = 0ul; i < n; i++)
+        nl->parent.push_back(first + i);
+
+    nl->net_count += n;
+    return first;
+}
+
+net_t netlist_find(netlist_t* nl, net_t n) {
+    std::vector<net_t>& parent = nl->parent;
+
+    while(parent[n] != n) {
+        parent[n] = parent[parent[n]]; // path halving
+        n = parent[n];
+    }
+    return n;
+}
+
+void netlist_connect(netlist_t* nl, net_t a, net_t b) {
+    a = netlist_find(nl, a);
+    b = netlist_find(nl, b);
+
+    if(a == b)
+        return;
+
+    // the lower id always wins so the constants stay their own representatives
+    if(a > b)
+        std::swap(a, b);
+
+    if(a == net_const0 && b == net_const1)
+        throw std::runtime_error("netlist : constant false connected to constant true");
+
+    nl->parent[b] = a;
+}
+
+net_t netlist_add_gate(netlist_t* nl, gate_type_t type, const net_t* inputs, size_t n_inputs) {
+
+    if(nl->fanin.size() + n_inputs > 0xFFFFFFFFul)
+        throw std::runtime_error("netlist : too many gate inputs");
+
+    const net_t output = netlist_new_net(nl);
+
+    nl->gate_types.push_back(static_cast<uint8_t>(type));
+    nl->fanin.insert(nl->fanin.end(), inputs, inputs + n_inputs);
+    nl->fanin_offsets.push_back((uint32_t)nl->fanin.size());
+    nl->gate_outputs.push_back(output);
+    return output;
+}
+
+//
+// structural hashing
+//
+
+static inline bool netlist_hashable(uint8_t type) {
+    return type <= static_cast<uint8_t>(gate_type_t::xnor_);
+}
+
+static inline uint32_t netlist_gate_hash(uint8_t type, const net_t* in, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ type;
+    for(size_t i = 0ul; i < n; i++) {
+        h = (h ^ in[i]) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    return (uint32_t)h;
+}
+
+static inline bool netlist_same_gate(const netlist_t& nl, uint32_t g, uint8_t type, const net_t* in, size_t n) {
+    if(nl.gate_types[g] != type)
+        return false;
+    const netlist_span_t other = netlist_gate_fanin(nl, g);
+    return other.size() == n && std::equal(in, in + n, other.begin());
+}
+
+static inline uint64_t netlist_table_entry(uint32_t hash, uint32_t g) {
+    return ((uint64_t)hash << 32) | (g + 1u);
+}
+
+//
+// slot of the gate equal to (type, in) or of the empty slot where it goes.
+// the hashes are compared first so most probes never touch the fanin
+//
+static inline size_t netlist_table_find(
+        const netlist_t& nl, const std::vector<uint64_t>& table,
+        uint32_t hash, uint8_t type, const net_t* in, size_t n) {
+
+    const size_t mask = table.size() - 1ul;
+    size_t h = hash & mask;
+    for(; table[h] != 0ul; h = (h + 1ul) & mask) {
+        const uint64_t e = table[h];
+        if((uint32_t)(e >> 32) == hash && netlist_same_gate(nl, (uint32_t)e - 1u, type, in, n))
+            break;
+    }
+    return h;
+}
+
+static void netlist_grow_gate_table(netlist_t* nl) {
+
+    const size_t size = nl->gate_table.empty() ? 64ul : nl->gate_table.size() * 2ul;
+    std::vector<uint64_t> table(size, 0ul);
+
+    for(uint64_t e : nl->gate_table) {
+        if(e == 0ul)
+            continue;
+        size_t h = (e >> 32) & (size - 1ul);
+        while(table[h] != 0ul)
+            h = (h + 1ul) & (size - 1ul);
+        table[h] = e;
+    }
+
+    nl->gate_table.swap(table);
+}
+
+net_t netlist_add_hashed_gate(netlist_t* nl, gate_type_t type, const net_t* inputs, size_t n_inputs) {
+
+    const uint8_t t = static_cast<uint8_t>(type);
+    if(!netlist_hashable(t))
+        return netlist_add_gate(nl, type, inputs, n_inputs);
+
+    if(nl->fanin.size() + n_inputs > 0xFFFFFFFFul)
+        throw std::runtime_error("netlist : too many gate inputs");
+
+    if((nl->gate_table_used + 1ul) * 2ul > nl->gate_table.size())
+        netlist_grow_gate_table(nl);
+
+    // the inputs go where the new gate would keep them, so they can be sorted in place
+    const size_t start = nl->fanin.size();
+    for(size_t i = 0ul; i < n_inputs; i++)
+        nl->fanin.push_back(netlist_find(nl, inputs[i]));
+    if(!std::is_sorted(nl->fanin.begin() + start, nl->fanin.end()))
+        std::sort(nl->fanin.begin() + start, nl->fanin.end());
+
+    const net_t* key = nl->fanin.data() + start;
+    const uint32_t hash = netlist_gate_hash(t, key, n_inputs);
+    const size_t h = netlist_table_find(*nl, nl->gate_table, hash, t, key, n_inputs);
+
+    if(nl->gate_table[h] != 0ul) {
+        nl->fanin.resize(start);
+        return nl->gate_outputs[(uint32_t)nl->gate_table[h] - 1u];
+    }
+
+    const net_t output = netlist_new_net(nl);
+
+    nl->gate_types.push_back(t);
+    nl->fanin_offsets.push_back((uint32_t)nl->fanin.size());
+    nl->gate_outputs.push_back(output);
+
+    nl->gate_table[h] = netlist_table_entry(hash, (uint32_t)netlist_gate_count(*nl) - 1u);
+    nl->gate_table_used++;
+    return output;
+}
+
+void netlist_compact(netlist_t* nl) {
+
+    const net_t unnumbered = ~0u;
+    std::vector<net_t> number(nl->net_count, unnumbered);
+
+    // representatives are numbered in id order, so 0 and 1 keep their ids
+    size_t count = 0ul;
+    for(size_t i = 0ul; i < nl->net_count; i++) {
+        const net_t rep = netlist_find(nl, (net_t)i);
+        if(number[rep] == unnumbered)
+            number[rep] = (net_t)count++;
+    }
+
+    auto renumber = [&](net_t n) { return number[netlist_find(nl, n)]; };
+
+    enum : uint8_t { undriven, driven_by_gate, driven_by_tristate };
+    std::vector<uint8_t> driver(count, undriven);
+    driver[net_const0] = driven_by_gate;
+    driver[net_const1] = driven_by_gate;
+
+    for(size_t g = 0ul; g < nl->gate_outputs.size(); g++) {
+        const net_t out = renumber(nl->gate_outputs[g]);
+        const bool tristate = nl->gate_types[g] == static_cast<uint8_t>(gate_type_t::tristate);
+
+        uint8_t& d = driver[out];
+        if(tristate ? d == driven_by_gate : d != undriven)
+            throw std::runtime_error(
+                    "netlist : net " + STR(out) + " has more than one driver (" +
+                    gate_type_name(static_cast<gate_type_t>(nl->gate_types[g])) + " gate output shorted to another driver)");
+
+        d = tristate ? driven_by_tristate : driven_by_gate;
+        nl->gate_outputs[g] = out;
+    }
+
+    for(net_t& n : nl->fanin)
+        n = renumber(n);
+
+    for(net_t& n : nl->port_nets)
+        n = renumber(n);
+    for(net_t& n : nl->scope_nets)
+        n = renumber(n);
+
+    nl->net_count = count;
+    nl->parent.clear();
+    nl->parent.shrink_to_fit();
+
+    // gate ids stay, but the inputs the table was built from do not
+    nl->gate_table.clear();
+    nl->gate_table.shrink_to_fit();
+    nl->gate_table_used = 0ul;
+}
+
+void netlist_finalize(netlist_t* nl) {
+
+    netlist_compact(nl);
+
+    const size_t n_nets  = nl->net_count;
+    const size_t n_gates = netlist_gate_count(*nl);
+    const uint32_t none  = ~0u;
+
+    auto is_tristate = [&](size_t g) { return nl->gate_types[g] == static_cast<uint8_t>(gate_type_t::tristate); };
+
+    // nets shared by several tristates get a bus gate each, in net order
+    std::vector<uint32_t> tristates_on(n_nets, 0u);
+    for(size_t g = 0ul; g < n_gates; g++)
+        if(is_tristate(g))
+            tristates_on[nl->gate_outputs[g]]++;
+
+    std::vector<uint32_t> bus_of(n_nets, none);
+    std::vector<uint32_t> bus_nets;
+    for(size_t n = 0ul; n < n_nets; n++) {
+        if(tristates_on[n] >= 2u) {
+            bus_of[n] = (uint32_t)(n_gates + bus_nets.size());
+            bus_nets.push_back((net_t)n);
+        }
+    }
+
+    // after this every net has at most one driver and every gate its own output
+    std::vector<uint32_t> driver(n_nets, none);
+    for(size_t g = 0ul; g < n_gates; g++) {
+        const net_t out = nl->gate_outputs[g];
+        if(!(is_tristate(g) && bus_of[out] != none))
+            driver[out] = (uint32_t)g;
+    }
+    for(net_t n : bus_nets)
+        driver[n] = bus_of[n];
+
+    size_t undriven = 2ul;
+    for(size_t n = 2ul; n < n_nets; n++)
+        if(driver[n] == none)
+            undriven++;
+
+    if(undriven + n_gates + bus_nets.size() > 0xFFFFFFFFul)
+        throw std::runtime_error("netlist : too many nets");
+
+    nl->first_gate_net = (net_t)undriven;
+
+    std::vector<net_t> number(n_nets);
+    net_t next = 2u;
+    for(size_t n = 0ul; n < n_nets; n++) {
+        if(n < 2ul)
+            number[n] = (net_t)n;
+        else if(driver[n] == none)
+            number[n] = next++;
+        else
+            number[n] = nl->first_gate_net + driver[n];
+    }
+
+    for(net_t& n : nl->fanin)
+        n = number[n];
+
+    for(net_t& n : nl->port_nets)
+        n = number[n];
+
+    for(net_t& n : nl->scope_nets)
+        n = number[n];
+
+    // bus inputs are the tristates in gate order
+    std::vector<std::vector<net_t> > bus_inputs(bus_nets.size());
+    for(size_t g = 0ul; g < n_gates; g++) {
+        const net_t out = nl->gate_outputs[g];
+        if(is_tristate(g) && bus_of[out] != none)
+            bus_inputs[bus_of[out] - n_gates].push_back(nl->first_gate_net + (net_t)g);
+    }
+
+    for(const std::vector<net_t>& inputs : bus_inputs) {
+        nl->gate_types.push_back(static_cast<uint8_t>(gate_type_t::bus));
+        nl->fanin.insert(nl->fanin.end(), inputs.begin(), inputs.end());
+        nl->fanin_offsets.push_back((uint32_t)nl->fanin.size());
+    }
+
+    nl->net_count = nl->first_gate_net + netlist_gate_count(*nl);
+    nl->gate_outputs.clear();
+    nl->gate_outputs.shrink_to_fit();
+
+    nl->gate_types.shrink_to_fit();
+    nl->fanin_offsets.shrink_to_fit();
+    nl->fanin.shrink_to_fit();
+}
+
+size_t netlist_order_gates(const netlist_t& nl, std::vector<uint32_t>& order) {
+
+    const size_t n_gates = netlist_gate_count(nl);
+
+    auto is_flipflop = [&](size_t g) { return nl.gate_types[g] == static_cast<uint8_t>(gate_type_t::flipflop); };
+    auto comb_driver = [&](net_t n) {
+        const int64_t d = netlist_net_driver(nl, n);
+        return d >= 0 && !is_flipflop((size_t)d) ? d : (int64_t)-1;
+    };
+
+    // gates that read the output of each gate in csr form, flipflops excepted
+    // on both ends
+    std::vector<uint32_t> pending(n_gates, 0u);
+    std::vector<uint32_t> user_offsets(n_gates + 1ul, 0u);
+
+    for(uint32_t g = 0u; g < n_gates; g++) {
+        if(is_flipflop(g))
+            continue;
+        for(net_t n : netlist_gate_fanin(nl, g)) {
+            const int64_t d = comb_driver(n);
+            if(d >= 0) {
+                user_offsets[d + 1]++;
+                pending[g]++;
+            }
+        }
+    }
+
+    for(size_t g = 0ul; g < n_gates; g++)
+        user_offsets[g + 1ul] += user_offsets[g];
+
+    std::vector<uint32_t> users(user_offsets.back());
+    {
+        std::vector<uint32_t> cursor(user_offsets.begin(), user_offsets.end() - 1);
+        for(uint32_t g = 0u; g < n_gates; g++) {
+            if(is_flipflop(g))
+                continue;
+            for(net_t n : netlist_gate_fanin(nl, g)) {
+                const int64_t d = comb_driver(n);
+                if(d >= 0)
+                    users[cursor[d]++] = g;
+            }
+        }
+    }
+
+    order.clear();
+    order.reserve(n_gates);
+    for(uint32_t g = 0u; g < n_gates; g++)
+        if(pending[g] == 0u)
+            order.push_back(g);
+
+    for(size_t i = 0ul; i < order.size(); i++) {
+        const uint32_t g = order[i];
+        for(uint32_t k = user_offsets[g]; k < user_offsets[g + 1ul]; k++)
+            if(--pending[users[k]] == 0u)
+                order.push_back(users[k]);
+    }
+
+    const size_t ordered = order.size();
+    for(uint32_t g = 0u; g < n_gates; g++)
+        if(pending[g] != 0u)
+            order.push_back(g);
+
+    return ordered;
+}
+
+void netlist_remove_gates(netlist_t* nl, const std::vector<net_t>& replaced) {
+
+    const size_t n_gates = netlist_gate_count(*nl);
+    const net_t first    = nl->first_gate_net;
+
+    auto target = [&](net_t n) { return n >= first ? replaced[n - first] : n; };
+
+    // survivors keep their order, their outputs move down. a dropped gate
+    // gets the number of the survivor after it, for the scope ranges
+    std::vector<net_t> number(n_gates, 0u);
+    uint32_t kept = 0u;
+    for(size_t g = 0ul; g < n_gates; g++) {
+        number[g] = first + kept;
+        if(replaced[g] == first + g)
+            kept++;
+    }
+
+    auto renumber = [&](net_t n) {
+        n = target(n);
+        return n >= first ? number[n - first] : n;
+    };
+
+    nl->fanout_offsets.clear();
+    nl->fanout.clear();
+
+    for(net_t& n : nl->port_nets)
+        n = renumber(n);
+    for(net_t& n : nl->scope_nets)
+        n = renumber(n);
+
+    if(kept == n_gates) {
+        for(net_t& n : nl->fanin)
+            n = renumber(n);
+        return;
+    }
+
+    auto range_end = [&](uint32_t g) { return g < n_gates ? number[g] - first : kept; };
+    for(netlist_scope_t& scope : nl->scopes) {
+        scope.first_gate = range_end(scope.first_gate);
+        scope.last_gate  = range_end(scope.last_gate);
+    }
+
+    std::vector<uint8_t>  types;
+    std::vector<uint32_t> offsets = { 0u };
+    std::vector<net_t>    fanin;
+    types.reserve(kept);
+    offsets.reserve(kept + 1ul);
+    fanin.reserve(nl->fanin.size());
+
+    for(uint32_t g = 0u; g < n_gates; g++) {
+        if(replaced[g] != first + g)
+            continue;
+        types.push_back(nl->gate_types[g]);
+        for(net_t n : netlist_gate_fanin(*nl, g))
+            fanin.push_back(renumber(n));
+        offsets.push_back((uint32_t)fanin.size());
+    }
+
+    fanin.shrink_to_fit();
+    nl->gate_types.swap(types);
+    nl->fanin_offsets.swap(offsets);
+    nl->fanin.swap(fanin);
+    nl->net_count = first + kept;
+}
+
+size_t netlist_strash(netlist_t* nl) {
+
+    const size_t n_gates = netlist_gate_count(*nl);
+    const net_t first    = nl->first_gate_net;
+
+    // a gate is looked at once every gate driving it has been, so the gates
+    // feeding it are already merged
+    std::vector<uint32_t> order;
+    const size_t ordered = netlist_order_gates(*nl, order);
+
+    // output net each gate is replaced with, its own when it stays
+    std::vector<net_t> replaced(n_gates);
+    for(size_t g = 0ul; g < n_gates; g++)
+        replaced[g] = first + (net_t)g;
+
+    auto canonical = [&](net_t n) { return n >= first ? replaced[n - first] : n; };
+
+    size_t table_size = 64ul;
+    while(table_size < n_gates * 2ul)
+        table_size *= 2ul;
+    std::vector<uint64_t> table(table_size, 0ul);
+
+    size_t removed = 0ul;
+
+    for(size_t i = 0ul; i < ordered; i++) {
+        const uint32_t g = order[i];
+        const uint8_t t  = nl->gate_types[g];
+
+        // flipflops, tristates and buses are only renumbered
+        if(!netlist_hashable(t))
+            continue;
+
+        net_t* in = nl->fanin.data() + nl->fanin_offsets[g];
+        const size_t n = nl->fanin_offsets[g + 1ul] - nl->fanin_offsets[g];
+        for(size_t j = 0ul; j < n; j++)
+            in[j] = canonical(in[j]);
+        if(!std::is_sorted(in, in + n))
+            std::sort(in, in + n);
+
+        const uint32_t hash = netlist_gate_hash(t, in, n);
+        const size_t h = netlist_table_find(*nl, table, hash, t, in, n);
+
+        if(table[h] != 0ul) {
+            replaced[g] = first + ((uint32_t)table[h] - 1u);
+            removed++;
+        } else {
+            table[h] = netlist_table_entry(hash, g);
+        }
+    }
+
+    netlist_remove_gates(nl, replaced);
+    return removed;
+}
+
+void netlist_build_fanout(netlist_t* nl) {
+
+    const size_t n_gates = netlist_gate_count(*nl);
+    const uint32_t none  = ~0u;
+
+    // a gate reading a net twice is listed once
+    std::vector<uint32_t> last(nl->net_count, none);
+
+    nl->fanout_offsets.assign(nl->net_count + 1ul, 0u);
+    for(uint32_t g = 0u; g < n_gates; g++) {
+        for(net_t n : netlist_gate_fanin(*nl, g)) {
+            if(last[n] != g) {
+                last[n] = g;
+                nl->fanout_offsets[n + 1ul]++;
+            }
+        }
+    }
+
+    for(size_t n = 0ul; n < nl->net_count; n++)
+        nl->fanout_offsets[n + 1ul] += nl->fanout_offsets[n];
+
+    std::vector<uint32_t> cursor(nl->fanout_offsets.begin(), nl->fanout_offsets.end() - 1);
+    std::fill(last.begin(), last.end(), none);
+
+    nl->fanout.resize(nl->fanout_offsets.back());
+    for(uint32_t g = 0u; g < n_gates; g++) {
+        for(net_t n : netlist_gate_fanin(*nl, g)) {
+            if(last[n] != g) {
+                last[n] = g;
+                nl->fanout[cursor[n]++] = g;
+            }
+        }
+    }
+}
+
+void netlist_gate_scopes(const netlist_t& nl, std::vector<uint32_t>& gate_scopes) {
+
+    const size_t n_gates = netlist_gate_count(nl);
+    const uint32_t none  = ~0u;
+
+    gate_scopes.assign(n_gates, none);
+    for(uint32_t s = 0u; s < nl.scopes.size(); s++)
+        for(uint32_t g = nl.scopes[s].first_gate; g < nl.scopes[s].last_gate; g++)
+            gate_scopes[g] = s;
+
+    // buses come after the tristates they join
+    for(uint32_t g = 0u; g < n_gates; g++) {
+        if(gate_scopes[g] != none)
+            continue;
+        const netlist_span_t in = netlist_gate_fanin(nl, g);
+        const int64_t d = netlist_gate_type(nl, g) == gate_type_t::bus && in.size() > 0ul ? netlist_net_driver(nl, in[0]) : -1;
+        gate_scopes[g] = d >= 0 ? gate_scopes[d] : 0u;
+    }
+}
+
+template<typename T>
+static size_t netlist_bytes(const std::vector<T>& v) {
+    return v.capacity() * sizeof(T);
+}
+
+netlist_memory_t netlist_memory(const netlist_t& nl) {
+    netlist_memory_t m;
+    m.gate_bytes   = netlist_bytes(nl.gate_types) + netlist_bytes(nl.fanin_offsets) + netlist_bytes(nl.fanin);
+    m.fanout_bytes = netlist_bytes(nl.fanout_offsets) + netlist_bytes(nl.fanout);
+    m.port_bytes   = netlist_bytes(nl.ports) + netlist_bytes(nl.port_nets) + netlist_bytes(nl.scopes) +
+                     netlist_bytes(nl.scope_ports) + netlist_bytes(nl.scope_nets);
+    m.total_bytes  = m.gate_bytes + m.fanout_bytes + m.port_bytes +
+                     netlist_bytes(nl.gate_outputs) + netlist_bytes(nl.parent);
+    return m;
+}
+
+void netlist_print(std::ostream& os, const netlist_t& nl) {
+
+    for(const netlist_port_t& port : nl.ports) {
+        os << (port.is_output ? "out " : "in  ") << port.name << " :";
+        for(net_t n : netlist_port_nets(nl, port))
+            os << " " << n;
+        os << "\n";
+    }
+
+    const bool finalized = nl.gate_outputs.empty();
+
+    for(uint32_t g = 0u; g < netlist_gate_count(nl); g++) {
+        os << "[" << g << "] " << (finalized ? netlist_gate_output(nl, g) : nl.gate_outputs[g])
+           << " = " << gate_type_name(netlist_gate_type(nl, g)) << "(";
+
+        const netlist_span_t in = netlist_gate_fanin(nl, g);
+        for(size_t j = 0ul; j < in.size(); j++)
+            os << (j ? ", " : "") << in[j];
+        os << ")\n";
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const netlist_t& nl) {
+
+    const size_t n_gates = netlist_gate_count(nl);
+
+    size_t by_type[gate_type_count] = {};
+    for(uint8_t t : nl.gate_types)
+        by_type[t]++;
+
+    size_t inputs = 0ul, outputs = 0ul;
+    for(const netlist_port_t& port : nl.ports)
+        (port.is_output ? outputs : inputs) += port.width;
+
+    os << "netlist : " << nl.instances << " instances, " << n_gates << " gates, "
+       << nl.net_count << " nets, " << inputs << " input bits, " << outputs << " output bits\n";
+
+    if(n_gates > 0ul) {
+        os << "   ";
+        for(size_t i = 0ul; i < gate_type_count; i++)
+            if(by_type[i] > 0ul)
+                os << " " << gate_type_name((gate_type_t)i) << "=" << by_type[i];
+        os << "\n";
+
+        const netlist_memory_t m = netlist_memory(nl);
+        os << "    memory : " << m.total_bytes << " bytes, "
+           << std::fixed << std::setprecision(2)
+           << (double)m.gate_bytes / n_gates << " bytes per gate, "
+           << (double)m.total_bytes / n_gates << " with fanout and ports\n"
+           << std::defaultfloat;
+    }
+
+    return os;
+}
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//
+// flat gate level view of an elaborated design. every signal is a net, every
+// net is identified by a small integer. nets 0 and 1 are the constants false
+// and true
+//
+// gates are stored as parallel arrays indexed by gate id, so a pass that only
+// looks at gate types or only at fanin touches nothing else. once finalized
+// every net has at most one driver and the nets are numbered
+//
+//     constants | nets no gate drives (inputs, undriven) | gate outputs in gate order
+//
+// so the output of gate g is net first_gate_net + g and needs no storage
+//
+
+typedef uint32_t net_t;
+
+const net_t net_const0 = 0u;
+const net_t net_const1 = 1u;
+
+enum class gate_type_t : uint8_t {
+    not_,
+    and_,
+    nand,
+    or_,
+    nor_,
+    xor_,
+    xnor_,
+    flipflop, // inputs : d, clk. starts out at 0 (X with four state logic), takes d when clk goes from 0 to 1
+    tristate, // inputs : data, enable. drives nothing while enable is 0
+    bus,      // inputs : tristate outputs. added by netlist_finalize where several tristates drive one net
+};
+
+const size_t gate_type_count = 10ul;
+
+//
+// interface element of the top level module, nets are
+// port_nets[first, first + width), bit 0 first
+//
+struct netlist_port_t {
+    std::string name;
+    bool     is_output = false;
+    uint32_t first     = 0u;
+    uint32_t width     = 0u;
+};
+
+//
+// a module instance. scope 0 is the top level module, every other scope an
+// instance made by the body of scope parent. the name is the module name and
+// the number of the instance among those of the same module in the parent,
+// counted in the order they were created, like adder_3. the ports of an
+// instance are scope_ports[first_port, last_port) and their first and width
+// index scope_nets
+//
+// the body of a scope builds its gates before the instances it makes are
+// copied in, so they are the range [first_gate, last_gate). kept as ranges
+// and not per gate, only waveforms and reports ask, see netlist_gate_scopes
+//
+struct netlist_scope_t {
+    std::string name;
+    uint32_t parent     = 0u;
+    uint16_t module     = 0u; // index into modules
+    uint32_t first_port = 0u;
+    uint32_t last_port  = 0u;
+    uint32_t first_gate = 0u;
+    uint32_t last_gate  = 0u;
+};
+
+struct netlist_t {
+
+    size_t net_count = 2ul; // the two constants
+
+    // gate g has type gate_types[g] and reads fanin[fanin_offsets[g] .. fanin_offsets[g + 1])
+    std::vector<uint8_t>  gate_types;
+    std::vector<uint32_t> fanin_offsets = { 0u };
+    std::vector<net_t>    fanin;
+
+    // names of the modules, netlist_scope_t::module indexes them
+    std::vector<std::string> modules;
+
+    net_t first_gate_net = 2u; // valid once finalized
+
+    // gates reading net n are fanout[fanout_offsets[n] .. fanout_offsets[n + 1]).
+    // empty until netlist_build_fanout
+    std::vector<uint32_t> fanout_offsets;
+    std::vector<uint32_t> fanout;
+
+    // interface of the top level module
+    std::vector<netlist_port_t> ports;
+    std::vector<net_t> port_nets;
+
+    // instance tree. the ports of scope 0 are the ones above, it has no
+    // scope_ports
+    std::vector<netlist_scope_t> scopes;
+    std::vector<netlist_port_t>  scope_ports;
+    std::vector<net_t>           scope_nets;
+
+    size_t instances = 0ul; // module instances flattened into this netlist
+
+    // only while elaborating. gate_outputs holds the output of every gate,
+    // assigning one net to another merges them and parent is a union-find
+    // forest over net ids. netlist_finalize drops both
+    std::vector<net_t> gate_outputs;
+    std::vector<net_t> parent = { net_const0, net_const1 };
+
+    // only while elaborating, open addressing table for netlist_add_hashed_gate.
+    // an entry is the gate hash in the high half and gate id + 1 in the low
+    // half, 0 is empty. netlist_compact drops it
+    std::vector<uint64_t> gate_table;
+    size_t gate_table_used = 0ul;
+};
+
+//
+// one gate or net range of a finalized netlist, for range-for loops
+//
+struct netlist_span_t {
+    const uint32_t* first;
+    const uint32_t* last;
+
+    const uint32_t* begin(void) const { return this->first; }
+    const uint32_t* end(void) const   { return this->last; }
+    size_t size(void) const           { return (size_t)(this->last - this->first); }
+    uint32_t operator[](size_t i) const { return this->first[i]; }
+};
+
+const char* gate_type_name(gate_type_t type);
+
+//
+// iteration. gate ids are [0, netlist_gate_count)
+//
+
+inline size_t netlist_gate_count(const netlist_t& nl) {
+    return nl.gate_types.size();
+}
+
+inline gate_type_t netlist_gate_type(const netlist_t& nl, uint32_t g) {
+    return static_cast<gate_type_t>(nl.gate_types[g]);
+}
+
+inline netlist_span_t netlist_gate_fanin(const netlist_t& nl, uint32_t g) {
+    const net_t* base = nl.fanin.data();
+    return { base + nl.fanin_offsets[g], base + nl.fanin_offsets[g + 1ul] };
+}
+
+//
+// finalized netlists only
+//
+inline net_t netlist_gate_output(const netlist_t& nl, uint32_t g) {
+    return nl.first_gate_net + g;
+}
+
+//
+// gate driving n, -1 for constants, inputs and undriven nets. finalized netlists only
+//
+inline int64_t netlist_net_driver(const netlist_t& nl, net_t n) {
+    return n >= nl.first_gate_net ? (int64_t)(n - nl.first_gate_net) : -1;
+}
+
+//
+// gates reading n. needs netlist_build_fanout
+//
+inline netlist_span_t netlist_net_fanout(const netlist_t& nl, net_t n) {
+    const uint32_t* base = nl.fanout.data();
+    return { base + nl.fanout_offsets[n], base + nl.fanout_offsets[n + 1ul] };
+}
+
+inline netlist_span_t netlist_port_nets(const netlist_t& nl, const netlist_port_t& port) {
+    const net_t* base = nl.port_nets.data();
+    return { base + port.first, base + port.first + port.width };
+}
+
+//
+// nets of a port in scope_ports
+//
+inline netlist_span_t netlist_scope_port_nets(const netlist_t& nl, const netlist_port_t& port) {
+    const net_t* base = nl.scope_nets.data();
+    return { base + port.first, base + port.first + port.width };
+}
+
+//
+// building, while elaborating
+//
+
+net_t netlist_new_net(netlist_t* nl);
+
+//
+// n consecutive new nets, returns the first
+//
+net_t netlist_new_nets(netlist_t* nl, size_t n);
+
+//
+// the net that currently stands for n
+//
+net_t netlist_find(netlist_t* nl, net_t n);
+
+//
+// a and b become the same net. throws if that would tie false to true
+//
+void netlist_connect(netlist_t* nl, net_t a, net_t b);
+
+//
+// returns the gate output, a new net
+//
+net_t netlist_add_gate(netlist_t* nl, gate_type_t type, const net_t* inputs, size_t n_inputs);
+
+//
+// structural hashing. for the plain logic gates (not, and, nand, or, nor,
+// xor, xnor) this returns the output of an earlier gate with the same type
+// and the same inputs in any order if there is one, and adds the gate with
+// its inputs sorted otherwise. flipflops and tristates are always added.
+// nets merged after a gate was added can hide a match, netlist_strash finds
+// those
+//
+net_t netlist_add_hashed_gate(netlist_t* nl, gate_type_t type, const net_t* inputs, size_t n_inputs);
+
+//
+// replaces every merged net with its representative and numbers the survivors
+// densely in id order (constants stay 0 and 1). gate outputs stay explicit in
+// gate_outputs and several tristates may still share a net, so this is for a
+// piece of a design that gets copied into a bigger netlist later. throws if a
+// net ends up with more than one driver, tristates excepted. no more nets may
+// be connected afterwards
+//
+void netlist_compact(netlist_t* nl);
+
+//
+// like netlist_compact, then gives each tristate sharing a net its own output
+// and adds a bus gate driving the shared net. the nets are renumbered as
+// described at the top, gate_outputs and parent are dropped
+//
+void netlist_finalize(netlist_t* nl);
+
+//
+// the rest is for finalized netlists only
+//
+
+//
+// gates ordered so that each comes after the gates driving its inputs, the
+// outputs of flipflops count as inputs of the design. gates on or behind a
+// combinational loop come last, in id order. returns how many gates are
+// ordered properly
+//
+size_t netlist_order_gates(const netlist_t& nl, std::vector<uint32_t>& order);
+
+//
+// drops every gate g for which replaced[g] is not its own output, readers of
+// that output read replaced[g] instead, which must not be a dropped gate. the
+// surviving gates keep their order and are renumbered. drops the fanout
+//
+void netlist_remove_gates(netlist_t* nl, const std::vector<net_t>& replaced);
+
+//
+// merges the plain logic gates of a finalized netlist that have the same
+// type and the same inputs in any order, after the gates feeding them have
+// been merged. gates on a combinational loop are left alone. the surviving
+// gates keep their order, their inputs are sorted. returns the number of
+// gates removed. drops the fanout
+//
+size_t netlist_strash(netlist_t* nl);
+
+//
+// fanout in compressed sparse row form, finalized netlists only
+//
+void netlist_build_fanout(netlist_t* nl);
+
+//
+// scope whose body built each gate, from the gate ranges of the scopes. a bus
+// belongs to the scope of its first tristate, any other gate outside every
+// range to scope 0. finalized netlists only
+//
+void netlist_gate_scopes(const netlist_t& nl, std::vector<uint32_t>& gate_scopes);
+
+struct netlist_memory_t {
+    size_t gate_bytes   = 0ul; // gate_types, fanin_offsets, fanin
+    size_t fanout_bytes = 0ul;
+    size_t port_bytes   = 0ul; // top level and instance ports, scopes
+    size_t total_bytes  = 0ul;
+};
+
+//
+// bytes used by the arrays, capacity included
+//
+netlist_memory_t netlist_memory(const netlist_t& nl);
+
+//
+// one line per gate, for small designs
+//
+void netlist_print(std::ostream& os, const netlist_t& nl);
+
+//
+// counts only
+//
+std::ostream& operator<<(std::ostream& os, const netlist_t& nl);
@@ -22,7 +22,27 @@ module_desc_t* runtime_env_create_new_module(
 
     module_desc_t* modptr = new module_desc_t;
     modptr->name         = new_module_name;
+    modptr->filename     = p.filename;
+    modptr->name_token   = tok;
     modptr->scope_levels = 1;
     renv->modules.insert({ new_module_name, modptr }); // save pointer in runtime environment
     return modptr;
 }
+
+std::vector<module_desc_t*> runtime_env_merge(runtime_env_t* dst, runtime_env_t* src) {
+
+    std::vector<module_desc_t*> duplicates;
+
+    auto iter = src->modules.begin();
+    while(iter != src->modules.end()) {
+        if(dst->modules.find(iter->first) != dst->modules.end()) {
+            duplicates.push_back(iter->second);
+            iter++;
+        } else {
+            dst->modules.insert(*iter);
+            iter = src->modules.erase(iter);
+        }
+    }
+
+    return duplicates;
+}
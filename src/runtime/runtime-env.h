@@ -7,6 +7,7 @@
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 struct runtime_env_t {
 
@@ -24,4 +25,11 @@ module_desc_t* runtime_env_create_new_module(
         struct parse_info_t& p,
         token_t& tok);
 
+//
+// moves every module of src into dst. modules whose name is already taken in
+// dst stay behind in src (and are still owned by it) and are returned so the
+// caller can report them
+//
+std::vector<module_desc_t*> runtime_env_merge(runtime_env_t* dst, runtime_env_t* src);
+
 void runtime_env_print_module(std::ostream& os, runtime_env_t* rtenv, module_desc_t* modptr);
@@ -0,0 +1,577 @@
+#include <src/runtime/simulate-bench.h>
+#include <src/runtime/netlist-optimize.h>
+#include <src/runtime/simulate.h>
+#include <src/runtime/simulate-simd.h>
+#include <src/runtime/simulate-codegen.h>
+#include <src/runtime/simulate-vcd.h>
+#include <src/runtime/waveform.h>
+#include <src/thread-pool.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+
+//
+// milliseconds the way the driver prints every phase
+//
+static std::string bench_ms(double ms) {
+    std::string s = std::to_string(ms);
+    while(s.size() < 14ul)
+        s.push_back(' ');
+    return s;
+}
+
+//
+// gate delays for the event engine from --sim-delay, a name is a gate type
+// or a module
+//
+static std::vector<uint32_t> simulation_delays(const netlist_t& nl, const std::vector<std::string>& specs) {
+
+    std::vector<uint32_t> delays(netlist_gate_count(nl), 1u);
+    std::vector<uint32_t> gate_scopes;
+    netlist_gate_scopes(nl, gate_scopes);
+
+    for(const std::string& spec : specs) {
+        const size_t eq = spec.find('=');
+        const std::string name = spec.substr(0ul, eq);
+        const uint32_t delay = (uint32_t)strtol(spec.c_str() + eq + 1ul, NULL, 10);
+
+        bool found = false;
+        for(uint32_t g = 0u; g < delays.size(); g++) {
+            if(name == gate_type_name(netlist_gate_type(nl, g)) || name == nl.modules[nl.scopes[gate_scopes[g]].module]) {
+                delays[g] = delay;
+                found = true;
+            }
+        }
+        if(!found)
+            throw std::runtime_error("no gate of type or from module '" + name + "' to give a delay");
+    }
+
+    return delays;
+}
+
+//
+// every step sets each input bit at random and evaluates. the signature folds
+// in every output bit of every step, two runs of the same design and step
+// count that disagree anywhere end up with different signatures. with 64
+// patterns each input bit gets a random word and the signature folds in
+// output words. with --sim-flips only that many input bits chosen at random
+// change in a step, in a random set of the patterns
+//
+// with four states the unknown plane of an output is folded in after its
+// values whenever it is not 0, so a run without any X or Z on the outputs
+// has the signature of the two state run. unknown counts the output bits
+// that were X or Z, summed over the steps and patterns
+//
+static uint64_t simulate_steps(
+        simulator_t* sim,
+        const netlist_t& nl,
+        const simulate_bench_options_t& opts,
+        size_t* unknown          = NULL,
+        simulate_vcd_t* vcd      = NULL,
+        waveform_writer_t* wave  = NULL) {
+
+    const bool parallel = sim->width == simulate_width_t::parallel64;
+
+    uint64_t rng = 0x9e3779b97f4a7c15ul;
+    auto random_word = [&rng](void) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    };
+
+    uint64_t signature = 0xcbf29ce484222325ul;
+
+    std::vector<std::pair<const netlist_port_t*, size_t> > input_bits;
+    for(const netlist_port_t& port : nl.ports)
+        for(size_t i = 0ul; i < port.width && !port.is_output; i++)
+            input_bits.push_back({ &port, i });
+
+    for(size_t s = 0ul; s < opts.steps; s++) {
+        for(size_t f = 0ul; f < opts.flips && !input_bits.empty(); f++) {
+            const auto& bit = input_bits[random_word() % input_bits.size()];
+            const uint64_t lanes = parallel ? random_word() : 1ul;
+            simulator_poke_lanes(sim, *bit.first, bit.second, simulator_peek_lanes(sim, *bit.first, bit.second) ^ lanes);
+        }
+
+        for(const netlist_port_t& port : nl.ports) {
+            if(port.is_output || opts.flips > 0ul)
+                continue;
+            if(parallel) {
+                for(size_t i = 0ul; i < port.width; i++)
+                    simulator_poke_lanes(sim, port, i, random_word());
+                continue;
+            }
+            for(size_t b = 0ul; b < port.width; b += 64ul) {
+                const uint64_t r = random_word();
+                for(size_t i = b; i < port.width && i < b + 64ul; i++)
+                    simulator_poke_bit(sim, port, i, (r >> (i - b)) & 1ul);
+            }
+        }
+
+        simulator_eval(sim);
+        if(vcd != NULL)
+            simulate_vcd_sample(vcd, s);
+        if(wave != NULL)
+            waveform_sample(wave, s);
+
+        for(const netlist_port_t& port : nl.ports) {
+            if(!port.is_output)
+                continue;
+            for(size_t i = 0ul; i < port.width; i++) {
+                uint64_t value, unknown_lanes;
+                simulator_peek_state(sim, port, i, &value, &unknown_lanes);
+                signature = (signature ^ value) * 0x100000001b3ul;
+                if(unknown_lanes == 0ul)
+                    continue;
+                signature = (signature ^ unknown_lanes ^ 0x5555555555555555ul) * 0x100000001b3ul;
+                if(unknown != NULL)
+                    *unknown += (size_t)__builtin_popcountll(unknown_lanes);
+            }
+        }
+    }
+
+    return signature;
+}
+
+static void simulate_init(simulator_t* sim, const netlist_t& nl, const simulate_bench_options_t& opts, thread_pool_t* pool) {
+    simulator_init(sim, nl, opts.width, opts.engine, pool, opts.logic);
+    if(!opts.delays.empty())
+        simulator_set_delays(sim, simulation_delays(nl, opts.delays));
+}
+
+//
+// with --sim-scaling the same steps run again for each thread count, every
+// run has to end with the signature of the one with a single thread
+//
+static void simulate_scaling(std::ostream& os, const netlist_t& nl, const simulate_bench_options_t& opts) {
+
+    const size_t max_threads = opts.threads > 1ul ? opts.threads : thread_pool_hardware_threads();
+
+    os << "    scaling :\n";
+
+    uint64_t expected = 0ul;
+    double base_ms = 0.0;
+
+    for(size_t threads = 1ul; ; threads = std::min(threads * 2ul, max_threads)) {
+        thread_pool_t pool(threads);
+        simulator_t sim;
+        simulate_init(&sim, nl, opts, &pool);
+
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t signature = simulate_steps(&sim, nl, opts);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if(threads == 1ul) {
+            expected = signature;
+            base_ms = ms;
+        }
+
+        os << "        " << threads << " threads : " << bench_ms(ms) << " ms, "
+           << std::fixed << std::setprecision(2) << (ms > 0.0 ? base_ms / ms : 0.0) << "x, " << std::defaultfloat
+           << sim.threads << " partitions, " << sim.phases << " phases\n";
+
+        if(signature != expected)
+            throw std::runtime_error("simulating with " + std::to_string(threads) + " threads disagrees with one thread");
+        if(threads == max_threads)
+            break;
+    }
+}
+
+//
+// with --sim-vcd the steps run again with a dump after every one. the time
+// the samples and the writer add is what the throughput is measured against
+//
+static void simulate_vcd(std::ostream& os, const netlist_t& nl, const simulate_bench_options_t& opts, thread_pool_t* pool, uint64_t expected, double plain_ms) {
+
+    simulator_t sim;
+    simulate_init(&sim, nl, opts, pool);
+
+    simulate_vcd_t vcd;
+    simulate_vcd_open(&vcd, &sim, opts.vcd, opts.vcd_opts);
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t signature = simulate_steps(&sim, nl, opts, NULL, &vcd);
+    simulate_vcd_close(&vcd);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    os << vcd.stats
+       << "    vcd run : " << bench_ms(ms) << " ms, " << std::fixed << std::setprecision(2)
+       << (plain_ms > 0.0 ? ms / plain_ms : 0.0) << "x the time without the dump" << std::defaultfloat << "\n";
+    if(signature != expected)
+        throw std::runtime_error("simulating with a value change dump disagrees with simulating without");
+}
+
+//
+// with --sim-wave the steps run again recording a waveform. reading it back
+// at the middle step and one signal over all of them has to touch a small
+// part of the file. with --sim-vcd too it is converted and compared
+//
+static void simulate_wave(std::ostream& os, const netlist_t& nl, const simulate_bench_options_t& opts, thread_pool_t* pool, uint64_t expected, double plain_ms) {
+
+    simulator_t sim;
+    simulate_init(&sim, nl, opts, pool);
+
+    waveform_writer_t wave;
+    waveform_open_simulator(&wave, &sim, opts.wave, opts.vcd_opts);
+
+    auto start = std::chrono::steady_clock::now();
+    const uint64_t signature = simulate_steps(&sim, nl, opts, NULL, NULL, &wave);
+    waveform_close(&wave);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    os << wave.stats
+       << "    wave run : " << bench_ms(ms) << " ms, " << std::fixed << std::setprecision(2)
+       << (plain_ms > 0.0 ? ms / plain_ms : 0.0) << "x the time without the waveform" << std::defaultfloat << "\n";
+    if(signature != expected)
+        throw std::runtime_error("simulating with a waveform disagrees with simulating without");
+
+    waveform_reader_t reader;
+    waveform_read_open(&reader, opts.wave);
+
+    start = std::chrono::steady_clock::now();
+    for(uint32_t s = 0u; s < reader.signals.size(); s++)
+        waveform_value_at(&reader, s, opts.steps / 2ul);
+    double read_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    os << "    wave seek : every signal at step " << opts.steps / 2ul << " in " << std::fixed << std::setprecision(2)
+       << read_ms << " ms, " << reader.bytes_read / 1024ul << " KB of " << wave.stats.bytes / 1024ul << " KB read\n" << std::defaultfloat;
+
+    // the signal with the most blocks, the worst case for extracting one
+    uint32_t busiest = 0u;
+    for(uint32_t s = 0u; s < reader.signals.size(); s++)
+        if(reader.signals[s].blocks > reader.signals[busiest].blocks)
+            busiest = s;
+
+    if(!reader.signals.empty()) {
+        const waveform_signal_t& sig = reader.signals[busiest];
+        std::vector<waveform_change_t> changes;
+        reader.bytes_read = 0ul;
+
+        start = std::chrono::steady_clock::now();
+        waveform_changes(&reader, busiest, 0ul, reader.end_time, changes);
+        read_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        os << "    wave extract : " << sig.scope << "." << sig.name << ", " << changes.size() << " values in " << std::fixed
+           << std::setprecision(2) << read_ms << " ms, " << reader.bytes_read / 1024ul << " KB read\n" << std::defaultfloat;
+    }
+
+    if(opts.vcd.empty())
+        return;
+
+    std::ostringstream converted;
+    waveform_to_vcd(&reader, converted);
+    std::ifstream dump(opts.vcd, std::ios::binary);
+    std::ostringstream written;
+    written << dump.rdbuf();
+    if(converted.str() != written.str())
+        throw std::runtime_error("the waveform converted to a value change dump differs from '" + opts.vcd + "'");
+    os << "    wave to vcd : same as " << opts.vcd << "\n";
+}
+
+//
+// the wave check runs the steps once more, writing a dump and a waveform of
+// the same signals to temporary files, and holds the waveform against the
+// dump
+//
+struct bench_temp_file_t {
+    std::string path;
+
+    ~bench_temp_file_t() {
+        if(!this->path.empty())
+            unlink(this->path.c_str());
+    }
+};
+
+static void bench_temp_file(bench_temp_file_t& file, const char* suffix) {
+    const char* dir = getenv("TMPDIR");
+    std::string path = std::string(dir != NULL && *dir != '\0' ? dir : "/tmp") + "/chdl-check-XXXXXX" + suffix;
+
+    const int fd = mkstemps(&path[0], (int)strlen(suffix));
+    if(fd < 0)
+        throw std::runtime_error("can not create a temporary file : " + std::string(strerror(errno)));
+    close(fd);
+    file.path = path;
+}
+
+static void simulate_wave_check(std::ostream& os, const netlist_t& nl, const simulate_bench_options_t& opts, thread_pool_t* pool, uint64_t expected) {
+
+    bench_temp_file_t vcd_file, wave_file;
+    bench_temp_file(vcd_file, ".vcd");
+    bench_temp_file(wave_file, ".wave");
+
+    simulator_t sim;
+    simulate_init(&sim, nl, opts, pool);
+
+    simulate_vcd_t vcd;
+    simulate_vcd_open(&vcd, &sim, vcd_file.path, opts.vcd_opts);
+    waveform_writer_t wave;
+    waveform_open_simulator(&wave, &sim, wave_file.path, opts.vcd_opts);
+
+    const uint64_t signature = simulate_steps(&sim, nl, opts, NULL, &vcd, &wave);
+    simulate_vcd_close(&vcd);
+    waveform_close(&wave);
+    if(signature != expected)
+        throw std::runtime_error("simulating with a dump and a waveform disagrees with simulating without");
+
+    std::ifstream dump(vcd_file.path, std::ios::binary);
+    std::ostringstream text;
+    text << dump.rdbuf();
+
+    waveform_reader_t reader;
+    waveform_read_open(&reader, wave_file.path);
+    if(!waveform_check(os, &reader, text.str()))
+        throw std::runtime_error("the waveform disagrees with the value change dump of the same run");
+}
+
+//
+// the sweep check builds small netlists straight from gates: a flipflop for
+// every clock and d the sweep tells apart, then random logic where any gate
+// may read a constant, an input or an earlier gate and a flipflop anything.
+// each one is simulated as built and after netlist_sweep, with both logics
+//
+static net_t sweep_check_flipflop(netlist_t* nl, net_t d, net_t clk, bool own_d) {
+    const net_t in[2] = { netlist_new_net(nl), netlist_new_net(nl) };
+    const net_t q = netlist_add_gate(nl, gate_type_t::flipflop, in, 2ul);
+    netlist_connect(nl, in[0], own_d ? q : d);
+    netlist_connect(nl, in[1], clk);
+    return q;
+}
+
+static void sweep_check_netlist(netlist_t* nl, uint64_t& rng, bool cases) {
+
+    auto random_word = [&rng](void) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    };
+
+    const size_t n_inputs = 6ul;
+    const net_t inputs = netlist_new_nets(nl, n_inputs);
+
+    std::vector<net_t> pool = { net_const0, net_const1 };
+    for(size_t i = 0ul; i < n_inputs; i++)
+        pool.push_back(inputs + (net_t)i);
+
+    std::vector<net_t> outputs;
+
+    if(cases) {
+        const net_t clocks[3] = { net_const0, net_const1, inputs };
+        for(net_t clk : clocks) {
+            outputs.push_back(sweep_check_flipflop(nl, net_const0, clk, false));
+            outputs.push_back(sweep_check_flipflop(nl, net_const1, clk, false));
+            outputs.push_back(sweep_check_flipflop(nl, inputs + 1u, clk, false));
+            outputs.push_back(sweep_check_flipflop(nl, 0u, clk, true));
+
+            // d is the inverted output, it toggles on every edge
+            const net_t in[2] = { netlist_new_net(nl), netlist_new_net(nl) };
+            const net_t q = netlist_add_gate(nl, gate_type_t::flipflop, in, 2ul);
+            netlist_connect(nl, in[0], netlist_add_gate(nl, gate_type_t::not_, &q, 1ul));
+            netlist_connect(nl, in[1], clk);
+            outputs.push_back(q);
+        }
+    }
+
+    // flipflop inputs are connected last, they may read gates made after them
+    std::vector<net_t> later;
+
+    const size_t n_gates = 8ul + random_word() % 48ul;
+    for(size_t g = 0ul; g < n_gates; g++) {
+        const uint64_t kind = random_word() % 10ul;
+
+        if(kind < 7ul) {
+            const gate_type_t type = static_cast<gate_type_t>(random_word() % 7ul);
+            const size_t n_in = type == gate_type_t::not_ ? 1ul : 2ul + random_word() % 3ul;
+            net_t in[4];
+            for(size_t i = 0ul; i < n_in; i++)
+                in[i] = pool[random_word() % pool.size()];
+            pool.push_back(netlist_add_gate(nl, type, in, n_in));
+        } else if(kind < 9ul) {
+            const net_t in[2] = { netlist_new_net(nl), netlist_new_net(nl) };
+            pool.push_back(netlist_add_gate(nl, gate_type_t::flipflop, in, 2ul));
+            later.insert(later.end(), in, in + 2);
+        } else {
+            // one to three tristates on a net, more than one make a bus
+            const size_t n_drivers = 1ul + random_word() % 3ul;
+            net_t out = 0u;
+            for(size_t i = 0ul; i < n_drivers; i++) {
+                const net_t in[2] = { pool[random_word() % pool.size()], pool[random_word() % pool.size()] };
+                const net_t t = netlist_add_gate(nl, gate_type_t::tristate, in, 2ul);
+                if(i == 0ul)
+                    out = t;
+                else
+                    netlist_connect(nl, out, t);
+            }
+            pool.push_back(out);
+        }
+    }
+
+    for(net_t n : later)
+        netlist_connect(nl, n, pool[random_word() % pool.size()]);
+
+    const size_t n_outputs = 1ul + random_word() % 8ul;
+    for(size_t i = 0ul; i < n_outputs; i++)
+        outputs.push_back(pool[n_inputs + 2ul + random_word() % (pool.size() - n_inputs - 2ul)]);
+
+    netlist_port_t in_port;
+    in_port.name  = "in";
+    in_port.width = (uint32_t)n_inputs;
+    for(size_t i = 0ul; i < n_inputs; i++)
+        nl->port_nets.push_back(inputs + (net_t)i);
+
+    netlist_port_t out_port;
+    out_port.name      = "out";
+    out_port.is_output = true;
+    out_port.first     = (uint32_t)n_inputs;
+    out_port.width     = (uint32_t)outputs.size();
+    nl->port_nets.insert(nl->port_nets.end(), outputs.begin(), outputs.end());
+
+    nl->ports = { in_port, out_port };
+    nl->modules = { "sweep_check" };
+
+    netlist_scope_t scope;
+    scope.name      = "sweep_check";
+    scope.last_port = 0u;
+    scope.last_gate = (uint32_t)nl->gate_types.size();
+    nl->scopes.push_back(scope);
+    nl->instances = 1ul;
+
+    netlist_finalize(nl);
+}
+
+bool simulate_sweep_check(std::ostream& os) {
+
+    const size_t n_netlists = 512ul;
+    const simulate_width_t widths[2] = { simulate_width_t::scalar, simulate_width_t::parallel64 };
+    const simulate_logic_t logics[2] = { simulate_logic_t::two_state, simulate_logic_t::four_state };
+
+    simulate_bench_options_t opts;
+    opts.steps = 48ul;
+
+    uint64_t rng = 0x2545f4914f6cdd1dul;
+    size_t before = 0ul, after[2] = { 0ul, 0ul }, failed = 0ul;
+
+    for(size_t i = 0ul; i < n_netlists; i++) {
+        netlist_t nl;
+        sweep_check_netlist(&nl, rng, i == 0ul);
+
+        netlist_t swept[2] = { nl, nl };
+        netlist_sweep(&swept[0], false);
+        netlist_sweep(&swept[1], true);
+        netlist_build_fanout(&nl);
+        before += netlist_gate_count(nl);
+
+        for(size_t k = 0ul; k < 4ul; k++) {
+            const size_t l = k / 2ul;
+            opts.logic = logics[l];
+            opts.width = widths[k % 2ul];
+            if(k % 2ul == 0ul) {
+                netlist_build_fanout(&swept[l]);
+                after[l] += netlist_gate_count(swept[l]);
+            }
+
+            simulator_t sim, swept_sim;
+            simulate_init(&sim, nl, opts, NULL);
+            simulate_init(&swept_sim, swept[l], opts, NULL);
+
+            size_t unknown = 0ul, swept_unknown = 0ul;
+            const uint64_t expected  = simulate_steps(&sim, nl, opts, &unknown);
+            const uint64_t signature = simulate_steps(&swept_sim, swept[l], opts, &swept_unknown);
+            if(signature == expected && swept_unknown == unknown)
+                continue;
+
+            if(failed++ == 0ul) {
+                os << "sweep check : netlist " << i << " simulates differently once swept for "
+                   << (l == 0ul ? "two" : "four") << " states, as built :\n";
+                netlist_print(os, nl);
+                os << "swept :\n";
+                netlist_print(os, swept[l]);
+            }
+            break;
+        }
+    }
+
+    os << "sweep check : " << n_netlists << " netlists, " << before << " gates swept to " << after[0]
+       << " for two states and " << after[1] << " for four, ";
+    if(failed > 0ul)
+        os << failed << " simulate differently\n";
+    else
+        os << "every one simulates the same\n";
+    return failed == 0ul;
+}
+
+//
+// with --sim-compile the compiled model runs the steps, then the interpreter
+// runs them again. both have to end with the same signature
+//
+void simulate_bench(std::ostream& os, const netlist_t& nl, const simulate_bench_options_t& opts) {
+
+    thread_pool_t pool(opts.threads);
+    simulator_t sim;
+    simulate_init(&sim, nl, opts, &pool);
+
+    simulate_compile_stats_t compile_stats;
+    if(!opts.compile.empty()) {
+        const char* cxx = getenv("CXX");
+        compile_stats = simulate_compile(&sim, opts.compile, cxx != NULL && *cxx != '\0' ? cxx : "c++");
+    }
+
+    const size_t patterns = simulator_patterns(&sim);
+
+    size_t unknown = 0ul;
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t signature = simulate_steps(&sim, nl, opts, &unknown);
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    os << "\n" << sim;
+    if(sim.logic == simulate_logic_t::four_state)
+        os << "    four state : " << unknown << " output bits were X or Z\n";
+    if(sim.width == simulate_width_t::parallel64 && sim.compiled == NULL)
+        os << "    kernels : " << simulate_simd_level_name(simulate_simd_level()) << "\n";
+    if(sim.compiled != NULL)
+        os << "    compiled : " << opts.compile << ".so from " << compile_stats.source_bytes / 1024ul << " KB of C++, generated in "
+           << std::fixed << std::setprecision(1) << compile_stats.generate_ms << " ms, built in " << compile_stats.build_ms << " ms\n"
+           << std::defaultfloat;
+    os << "    time : " << bench_ms(ms) << " ms, " << std::fixed << std::setprecision(1)
+       << (ms > 0.0 ? sim.stats.gate_evals * patterns / (ms * 1000.0) : 0.0) << " M gate evaluations/s, "
+       << (ms > 0.0 ? opts.steps * patterns / ms : 0.0) << " K patterns/s\n" << std::defaultfloat
+       << "    output signature : " << std::hex << signature << std::dec << "\n";
+
+    if(sim.compiled != NULL) {
+        simulate_unload(&sim);
+
+        simulator_t interpreted;
+        simulate_init(&interpreted, nl, opts, &pool);
+
+        const auto istart = std::chrono::steady_clock::now();
+        const uint64_t expected = simulate_steps(&interpreted, nl, opts);
+        const double ims = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - istart).count();
+
+        os << "    interpreted : " << bench_ms(ims) << " ms, compiled " << std::fixed << std::setprecision(2)
+           << (ms > 0.0 ? ims / ms : 0.0) << "x as fast" << std::defaultfloat << "\n";
+        if(expected != signature)
+            throw std::runtime_error("the compiled simulation disagrees with the interpreter");
+    }
+
+    if(!opts.vcd.empty())
+        simulate_vcd(os, nl, opts, &pool, signature, ms);
+    if(!opts.wave.empty())
+        simulate_wave(os, nl, opts, &pool, signature, ms);
+    if(opts.wave_check)
+        simulate_wave_check(os, nl, opts, &pool, signature);
+
+    if(opts.scaling)
+        simulate_scaling(os, nl, opts);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <src/runtime/netlist.h>
+#include <src/runtime/simulate.h>
+#include <src/runtime/simulate-vcd.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//
+// the simulation runs behind --sim. every step sets the inputs at random and
+// evaluates, and the output bits of every step fold into a signature. the
+// runs asked for on top of the first one (other thread counts, a compiled
+// model, a dump, a waveform) repeat the same steps and have to end with the
+// same signature. each reports how long it took next to the first run
+//
+
+struct simulate_bench_options_t {
+    size_t steps = 0ul; // random input patterns to simulate the netlist with
+    simulate_width_t width   = simulate_width_t::scalar;
+    simulate_engine_t engine = simulate_engine_t::levelized;
+    simulate_logic_t logic   = simulate_logic_t::two_state;
+    std::vector<std::string> delays; // <gate type or module>=<delay>, later ones win
+    size_t flips   = 0ul;   // input bits flipped per step, 0 sets all of them at random
+    size_t threads = 1ul;   // threads of the levelized engine
+    bool scaling   = false; // simulate again with 1, 2, 4, ... threads and compare
+    std::string compile;    // path of the compiled model without extension, empty to interpret
+    std::string vcd;        // value change dump written by a second run, empty for none
+    simulate_vcd_options_t vcd_opts;
+    std::string wave;       // compressed waveform written by another run, empty for none
+    bool wave_check = false; // dump and waveform of another run to temporary files, see waveform_check
+};
+
+//
+// simulates nl as opts asks and reports to os. throws std::runtime_error if
+// a run disagrees with the first one or a check fails
+//
+void simulate_bench(std::ostream& os, const netlist_t& nl, const simulate_bench_options_t& opts);
+
+//
+// builds random netlists and a set of flipflops with constant clocks and d,
+// sweeps each one and simulates it before and after. prints the first one
+// that disagrees and returns false if any do. needs no input files
+//
+bool simulate_sweep_check(std::ostream& os);
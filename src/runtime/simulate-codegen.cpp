@@ -0,0 +1,294 @@
+#include <src/runtime/simulate-codegen.h>
+#include <src/runtime/simulate.h>
+#include <src/runtime/netlist.h>
+#include <src/error-util.h>
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <sys/wait.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+static void cg_hash(uint64_t& h, uint64_t x) {
+    for(size_t i = 0ul; i < 8ul; i++, x >>= 8)
+        h = (h ^ (x & 0xfful)) * 0x100000001b3ul;
+}
+
+template<typename T>
+static void cg_hash(uint64_t& h, const std::vector<T>& xs) {
+    cg_hash(h, (uint64_t)xs.size());
+    for(const T& x : xs)
+        cg_hash(h, (uint64_t)x);
+}
+
+uint64_t simulate_codegen_shape(const simulator_t* sim) {
+    uint64_t h = 0xcbf29ce484222325ul;
+    cg_hash(h, (uint64_t)sim->width);
+    cg_hash(h, (uint64_t)sim->nl->net_count);
+    cg_hash(h, (uint64_t)sim->gate_slot);
+    cg_hash(h, (uint64_t)sim->loop_first);
+    cg_hash(h, sim->types);
+    cg_hash(h, sim->fanin_offsets);
+    cg_hash(h, sim->fanin);
+    cg_hash(h, sim->ff_d);
+    cg_hash(h, sim->ff_clk);
+    cg_hash(h, sim->ff_q);
+    return h;
+}
+
+//
+// value of net n for gate i. outputs of the gates [first, i) are locals of
+// the function being written, everything else comes from the net array
+//
+static void cg_operand(std::ostream& os, const simulator_t* sim, net_t n, uint32_t first, uint32_t i) {
+    if(n == net_const0)
+        os << "zeros";
+    else if(n == net_const1)
+        os << "ones";
+    else if(n >= sim->gate_slot + first && n < sim->gate_slot + i)
+        os << "n" << n;
+    else
+        os << "v[" << n << "]";
+}
+
+static void cg_gate(std::ostream& os, const simulator_t* sim, uint32_t i, uint32_t first) {
+
+    const gate_type_t type = static_cast<gate_type_t>(sim->types[i]);
+    const net_t* in  = sim->fanin.data() + sim->fanin_offsets[i];
+    const net_t* end = sim->fanin.data() + sim->fanin_offsets[i + 1u];
+
+    const char* op;
+    const char* identity;
+    bool invert = false;
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(type) {
+    case gate_type_t::not_:
+        os << "(word_t)~";
+        cg_operand(os, sim, in[0], first, i);
+        return;
+    case gate_type_t::nand:     invert = true; // fall through
+    case gate_type_t::and_:
+    case gate_type_t::tristate: op = " & "; identity = "ones"; break;
+    case gate_type_t::nor_:     invert = true; // fall through
+    case gate_type_t::or_:
+    case gate_type_t::bus:      op = " | "; identity = "zeros"; break;
+    case gate_type_t::xnor_:    invert = true; // fall through
+    case gate_type_t::xor_:     op = " ^ "; identity = "zeros"; break;
+    default:
+        INTERNAL_ERR();
+    }
+    #pragma GCC diagnostic pop
+
+    os << (invert ? "(word_t)~(" : "(word_t)(");
+    if(in == end)
+        os << identity;
+    for(const net_t* p = in; p != end; p++) {
+        if(p != in)
+            os << op;
+        cg_operand(os, sim, *p, first, i);
+    }
+    os << ")";
+}
+
+void simulate_codegen(std::ostream& os, const simulator_t* sim, size_t gates_per_function) {
+
+    if(sim->engine != simulate_engine_t::levelized)
+        throw std::runtime_error("only the levelized simulation engine can be compiled");
+    if(sim->logic != simulate_logic_t::two_state)
+        throw std::runtime_error("only two state simulation can be compiled");
+
+    const bool wide = sim->width == simulate_width_t::parallel64;
+    const uint32_t n_gates = (uint32_t)sim->types.size();
+    const size_t n_ff = sim->ff_q.size();
+    const uint32_t per = (uint32_t)std::max(gates_per_function, (size_t)1ul);
+
+    os << "// generated from a netlist of " << netlist_gate_count(*sim->nl) << " gates for "
+       << simulator_patterns(sim) << " pattern(s) at once, do not edit\n\n"
+       << "#include <stddef.h>\n"
+       << "#include <stdint.h>\n\n"
+       << "typedef " << (wide ? "uint64_t" : "uint8_t") << " word_t;\n\n"
+       << "static const word_t zeros = (word_t)0u;\n"
+       << "static const word_t ones  = (word_t)~(word_t)0u;\n\n"
+       << "static inline size_t differing(word_t a, word_t b) {\n"
+       << (wide ? "    return (size_t)__builtin_popcountll(a ^ b);\n" : "    return (size_t)((a ^ b) & 1u);\n")
+       << "}\n";
+
+    // levelized gates, every one once in order. the outputs are locals
+    // first so later gates of the same function read registers
+    size_t n_levels = 0ul;
+    for(uint32_t first = 0u; first < sim->loop_first; first += per, n_levels++) {
+        const uint32_t last = std::min(first + per, sim->loop_first);
+
+        os << "\nstatic void levels_" << n_levels << "(word_t* v) {\n";
+        for(uint32_t i = first; i < last; i++) {
+            const net_t out = sim->gate_slot + i;
+            os << "    const word_t n" << out << " = ";
+            cg_gate(os, sim, i, first);
+            os << ";\n    v[" << out << "] = n" << out << ";\n";
+        }
+        os << "}\n";
+    }
+
+    // gates on or behind a loop. each pass sees the outputs of the gates
+    // before it in the same pass, like the interpreter
+    size_t n_loops = 0ul;
+    for(uint32_t first = sim->loop_first; first < n_gates; first += per, n_loops++) {
+        const uint32_t last = std::min(first + per, n_gates);
+
+        os << "\nstatic word_t loops_" << n_loops << "(word_t* v) {\n"
+           << "    word_t changed = zeros, r;\n";
+        for(uint32_t i = first; i < last; i++) {
+            const net_t out = sim->gate_slot + i;
+            os << "    r = ";
+            cg_gate(os, sim, i, i);
+            os << ";\n    changed |= r ^ v[" << out << "];\n    v[" << out << "] = r;\n";
+        }
+        os << "    return changed;\n}\n";
+    }
+
+    // flipflops, sampled all together before any of them changes
+    size_t n_clocks = 0ul;
+    for(size_t first = 0ul; first < n_ff; first += per, n_clocks++) {
+        const size_t last = std::min(first + (size_t)per, n_ff);
+
+        os << "\nstatic void sample_" << n_clocks << "(const word_t* v, uint64_t* last, uint64_t* next) {\n"
+           << "    uint64_t clk, edge;\n";
+        for(size_t i = first; i < last; i++)
+            os << "    clk = v[" << sim->ff_clk[i] << "]; edge = clk & ~last[" << i << "]; next[" << i << "] = (edge & v["
+               << sim->ff_d[i] << "]) | (~edge & v[" << sim->ff_q[i] << "]); last[" << i << "] = clk;\n";
+        os << "}\n";
+
+        os << "\nstatic size_t commit_" << n_clocks << "(word_t* v, const uint64_t* next) {\n"
+           << "    size_t updates = 0u;\n";
+        for(size_t i = first; i < last; i++)
+            os << "    updates += differing((word_t)next[" << i << "], v[" << sim->ff_q[i] << "]); v["
+               << sim->ff_q[i] << "] = (word_t)next[" << i << "];\n";
+        os << "    return updates;\n}\n";
+    }
+
+    const uint32_t n_loop_gates = n_gates - sim->loop_first;
+
+    os << "\nextern \"C\" uint64_t chdl_shape(void) {\n"
+       << "    return 0x" << std::hex << simulate_codegen_shape(sim) << std::dec << "ul;\n"
+       << "}\n";
+
+    os << "\nextern \"C\" int chdl_settle(void* p, size_t* gate_evals) {\n"
+       << "    word_t* v = (word_t*)p;\n";
+    for(size_t k = 0ul; k < n_levels; k++)
+        os << "    levels_" << k << "(v);\n";
+    os << "    *gate_evals += " << sim->loop_first << "u;\n"
+       << "    for(size_t pass = 0u; pass <= " << n_loop_gates << "u; pass++) {\n"
+       << "        word_t changed = zeros;\n";
+    for(size_t k = 0ul; k < n_loops; k++)
+        os << "        changed |= loops_" << k << "(v);\n";
+    os << "        *gate_evals += " << n_loop_gates << "u;\n"
+       << "        if(changed == zeros)\n"
+       << "            return 1;\n"
+       << "    }\n"
+       << "    return 0;\n"
+       << "}\n";
+
+    os << "\nextern \"C\" size_t chdl_clock(void* p, uint64_t* last, uint64_t* next) {\n"
+       << "    word_t* v = (word_t*)p;\n"
+       << "    size_t updates = 0u;\n";
+    for(size_t k = 0ul; k < n_clocks; k++)
+        os << "    sample_" << k << "(v, last, next);\n";
+    for(size_t k = 0ul; k < n_clocks; k++)
+        os << "    updates += commit_" << k << "(v, next);\n";
+    os << "    return updates;\n"
+       << "}\n";
+}
+
+//
+// one shell word holding s as it is, a ' inside becomes '\''
+//
+static std::string cg_shell_quote(const std::string& s) {
+    std::string quoted = "'";
+    for(char c : s) {
+        if(c == '\'')
+            quoted += "'\\''";
+        else
+            quoted.push_back(c);
+    }
+    return quoted + "'";
+}
+
+simulate_compile_stats_t simulate_compile(simulator_t* sim, const std::string& path, const std::string& compiler, const std::string& flags) {
+
+    simulate_compile_stats_t stats;
+    const std::string cpp = path + ".cpp";
+    const std::string so  = path + ".so";
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::ofstream out(cpp);
+        if(!out)
+            throw std::runtime_error("can not write '" + cpp + "'");
+        simulate_codegen(out, sim);
+        stats.source_bytes = (size_t)out.tellp();
+        if(!out)
+            throw std::runtime_error("can not write '" + cpp + "'");
+    }
+    stats.generate_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    // compiler and flags may be several words, like CXX="ccache g++"
+    const std::string cmd = compiler + " " + flags + " -shared -fPIC -o " + cg_shell_quote(so) + " " + cg_shell_quote(cpp);
+    const int status = system(cmd.c_str());
+    if(status != 0) {
+        std::string why;
+        if(status == -1)
+            why = "can not run the shell, " + std::string(strerror(errno));
+        else if(WIFSIGNALED(status))
+            why = "killed by signal " + std::to_string(WTERMSIG(status));
+        else
+            why = "exit status " + std::to_string(WEXITSTATUS(status));
+        throw std::runtime_error("building the compiled simulation failed (" + why + ") : " + cmd);
+    }
+    stats.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    simulate_load(sim, so);
+    return stats;
+}
+
+void simulate_load(simulator_t* sim, const std::string& so_path) {
+
+    // dlopen searches the library path for names without a slash
+    const std::string path = so_path.find('/') == std::string::npos ? "./" + so_path : so_path;
+
+    void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if(handle == NULL)
+        throw std::runtime_error("can not load '" + so_path + "' : " + dlerror());
+
+    auto shape  = (uint64_t (*)(void))dlsym(handle, "chdl_shape");
+    auto settle = (int (*)(void*, size_t*))dlsym(handle, "chdl_settle");
+    auto clock  = (size_t (*)(void*, uint64_t*, uint64_t*))dlsym(handle, "chdl_clock");
+
+    if(shape == NULL || settle == NULL || clock == NULL || shape() != simulate_codegen_shape(sim)) {
+        dlclose(handle);
+        throw std::runtime_error("'" + so_path + "' was not built for this simulator");
+    }
+
+    simulate_unload(sim);
+    sim->compiled        = handle;
+    sim->compiled_settle = settle;
+    sim->compiled_clock  = clock;
+}
+
+void simulate_unload(simulator_t* sim) {
+    if(sim->compiled != NULL)
+        dlclose(sim->compiled);
+    sim->compiled        = NULL;
+    sim->compiled_settle = NULL;
+    sim->compiled_clock  = NULL;
+}
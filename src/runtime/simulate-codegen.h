@@ -0,0 +1,66 @@
+#pragma once
+
+#include <src/runtime/simulate.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <iostream>
+
+//
+// ahead of time compiled simulation. the levelized gates of a simulator
+// become one C++ translation unit, straight line code with every gate a
+// bitwise expression on a local, no dispatch and no fanin lookups. the
+// system compiler builds it into a shared object that is loaded back into
+// the simulator, which goes on working through the same poke, peek and eval
+// calls
+//
+// the generated code reads and writes the net array of the simulator, with
+// the simulator's net numbers, so the flipflop state stays where the
+// interpreter keeps it and a simulator can switch between the two at any
+// time. a compiled model is for one simulator width and runs on the calling
+// thread, the event engine can not be compiled
+//
+
+//
+// the source for sim, which must use the levelized engine and two state
+// logic. the gates are split over functions of at most gates_per_function
+// gates each
+//
+void simulate_codegen(std::ostream& os, const simulator_t* sim, size_t gates_per_function = 128ul);
+
+//
+// hash of everything the generated code depends on, the gates, the net
+// numbers and the width. a model only loads into a simulator it matches
+//
+uint64_t simulate_codegen_shape(const simulator_t* sim);
+
+struct simulate_compile_stats_t {
+    size_t source_bytes = 0ul;
+    double generate_ms  = 0.0;
+    double build_ms     = 0.0;
+};
+
+//
+// writes the source for sim to <path>.cpp, builds <path>.so with compiler
+// and flags and loads it. the command goes through the shell, compiler and
+// flags as they are and both paths quoted. throws std::runtime_error with
+// the exit status if the build fails
+//
+simulate_compile_stats_t simulate_compile(
+        simulator_t* sim,
+        const std::string& path,
+        const std::string& compiler = "c++",
+        const std::string& flags    = "-O1");
+
+//
+// loads a model built earlier. throws std::runtime_error if it does not load
+// or was built for a different simulator
+//
+void simulate_load(simulator_t* sim, const std::string& so_path);
+
+//
+// back to the interpreter
+//
+void simulate_unload(simulator_t* sim);
@@ -0,0 +1,352 @@
+#include <src/runtime/simulate-simd.h>
+#include <src/runtime/netlist.h>
+#include <src/error-util.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+
+#if defined(__x86_64__)
+#   define SIMULATE_SIMD_X86 1
+#   include <immintrin.h>
+#endif
+
+//
+// the operation of each gate type. every one knows how to combine two words
+// and, on x86, two AVX2 or AVX-512 vectors. the inverting gate types flip the
+// result afterwards
+//
+
+struct op_and_t {
+    template<typename W>
+    static inline W apply(W a, W b) { return a & b; }
+
+#ifdef SIMULATE_SIMD_X86
+    __attribute__((target("avx2")))
+    static inline __m256i apply(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+
+    __attribute__((target("avx512f")))
+    static inline __m512i apply(__m512i a, __m512i b) { return _mm512_and_si512(a, b); }
+#endif
+};
+
+struct op_or_t {
+    template<typename W>
+    static inline W apply(W a, W b) { return a | b; }
+
+#ifdef SIMULATE_SIMD_X86
+    __attribute__((target("avx2")))
+    static inline __m256i apply(__m256i a, __m256i b) { return _mm256_or_si256(a, b); }
+
+    __attribute__((target("avx512f")))
+    static inline __m512i apply(__m512i a, __m512i b) { return _mm512_or_si512(a, b); }
+#endif
+};
+
+struct op_xor_t {
+    template<typename W>
+    static inline W apply(W a, W b) { return a ^ b; }
+
+#ifdef SIMULATE_SIMD_X86
+    __attribute__((target("avx2")))
+    static inline __m256i apply(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+
+    __attribute__((target("avx512f")))
+    static inline __m512i apply(__m512i a, __m512i b) { return _mm512_xor_si512(a, b); }
+#endif
+};
+
+template<class op_t, bool invert, typename W>
+static void run2_scalar(W* v, const net_t* fanin, net_t out, size_t n) {
+    for(size_t i = 0ul; i < n; i++) {
+        const W r = op_t::apply(v[fanin[2ul * i]], v[fanin[2ul * i + 1ul]]);
+        v[out + i] = invert ? (W)~r : r;
+    }
+}
+
+template<typename W>
+static void run_not_scalar(W* v, const net_t* fanin, net_t out, size_t n) {
+    for(size_t i = 0ul; i < n; i++)
+        v[out + i] = (W)~v[fanin[i]];
+}
+
+#ifdef SIMULATE_SIMD_X86
+
+//
+// the fanin of 4 gates is a0 b0 a1 b1 a2 b2 a3 b3, the permute puts the a
+// indices in the low half and the b indices in the high half
+//
+template<class op_t, bool invert>
+__attribute__((target("avx2")))
+static void run2_avx2(uint64_t* v, const net_t* fanin, net_t out, size_t n) {
+
+    const long long* base = (const long long*)v;
+    const __m256i split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i ones  = _mm256_set1_epi64x(-1ll);
+
+    size_t i = 0ul;
+    for(; i + 4ul <= n; i += 4ul) {
+        const __m256i idx = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i*)(fanin + 2ul * i)), split);
+        const __m256i a   = _mm256_i32gather_epi64(base, _mm256_castsi256_si128(idx), 8);
+        const __m256i b   = _mm256_i32gather_epi64(base, _mm256_extracti128_si256(idx, 1), 8);
+        __m256i r = op_t::apply(a, b);
+        if(invert)
+            r = _mm256_xor_si256(r, ones);
+        _mm256_storeu_si256((__m256i*)(v + out + i), r);
+    }
+
+    run2_scalar<op_t, invert, uint64_t>(v, fanin + 2ul * i, out + (net_t)i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void run_not_avx2(uint64_t* v, const net_t* fanin, net_t out, size_t n) {
+
+    const long long* base = (const long long*)v;
+    const __m256i ones = _mm256_set1_epi64x(-1ll);
+
+    size_t i = 0ul;
+    for(; i + 4ul <= n; i += 4ul) {
+        const __m128i idx = _mm_loadu_si128((const __m128i*)(fanin + i));
+        const __m256i a   = _mm256_i32gather_epi64(base, idx, 8);
+        _mm256_storeu_si256((__m256i*)(v + out + i), _mm256_xor_si256(a, ones));
+    }
+
+    run_not_scalar<uint64_t>(v, fanin + i, out + (net_t)i, n - i);
+}
+
+template<class op_t, bool invert>
+__attribute__((target("avx512f")))
+static void run2_avx512(uint64_t* v, const net_t* fanin, net_t out, size_t n) {
+
+    const __m512i split = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    const __m512i ones  = _mm512_set1_epi64(-1ll);
+
+    size_t i = 0ul;
+    for(; i + 8ul <= n; i += 8ul) {
+        const __m512i idx = _mm512_permutexvar_epi32(split, _mm512_loadu_si512((const void*)(fanin + 2ul * i)));
+        const __m512i a   = _mm512_i32gather_epi64(_mm512_castsi512_si256(idx), (const void*)v, 8);
+        const __m512i b   = _mm512_i32gather_epi64(_mm512_extracti64x4_epi64(idx, 1), (const void*)v, 8);
+        __m512i r = op_t::apply(a, b);
+        if(invert)
+            r = _mm512_xor_si512(r, ones);
+        _mm512_storeu_si512((void*)(v + out + i), r);
+    }
+
+    run2_avx2<op_t, invert>(v, fanin + 2ul * i, out + (net_t)i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void run_not_avx512(uint64_t* v, const net_t* fanin, net_t out, size_t n) {
+
+    const __m512i ones = _mm512_set1_epi64(-1ll);
+
+    size_t i = 0ul;
+    for(; i + 8ul <= n; i += 8ul) {
+        const __m256i idx = _mm256_loadu_si256((const __m256i*)(fanin + i));
+        const __m512i a   = _mm512_i32gather_epi64(idx, (const void*)v, 8);
+        _mm512_storeu_si512((void*)(v + out + i), _mm512_xor_si512(a, ones));
+    }
+
+    run_not_avx2(v, fanin + i, out + (net_t)i, n - i);
+}
+
+#endif // SIMULATE_SIMD_X86
+
+typedef void (*run_fn_t)(uint64_t*, const net_t*, net_t, size_t);
+
+struct kernel_table_t {
+    simulate_simd_level_t level;
+    run_fn_t run2[gate_type_count];
+    run_fn_t run_not;
+};
+
+#define SIMULATE_KERNELS(run2, run_not)                                     \
+    {   NULL,                                                               \
+        run2<op_and_t, false>, run2<op_and_t, true>,                        \
+        run2<op_or_t,  false>, run2<op_or_t,  true>,                        \
+        run2<op_xor_t, false>, run2<op_xor_t, true>,                        \
+        NULL,                                                               \
+        run2<op_and_t, false>, run2<op_or_t,  false> },                     \
+    run_not
+
+template<class op_t, bool invert>
+static void run2_portable(uint64_t* v, const net_t* fanin, net_t out, size_t n) {
+    run2_scalar<op_t, invert, uint64_t>(v, fanin, out, n);
+}
+
+static kernel_table_t kernel_table_for(simulate_simd_level_t level) {
+
+    // entries follow gate_type_t : not and nand or nor xor xnor flipflop tristate bus
+    static_assert(static_cast<int>(gate_type_t::bus) == 9, "kernel tables follow gate_type_t");
+
+    kernel_table_t t;
+    switch(level) {
+#ifdef SIMULATE_SIMD_X86
+    case simulate_simd_level_t::avx512:
+        t = { level, SIMULATE_KERNELS(run2_avx512, run_not_avx512) };
+        break;
+    case simulate_simd_level_t::avx2:
+        t = { level, SIMULATE_KERNELS(run2_avx2, run_not_avx2) };
+        break;
+#endif
+    default:
+        t = { simulate_simd_level_t::scalar, SIMULATE_KERNELS(run2_portable, run_not_scalar<uint64_t>) };
+        break;
+    }
+    return t;
+}
+
+#undef SIMULATE_KERNELS
+
+static simulate_simd_level_t best_supported_level(void) {
+#ifdef SIMULATE_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return simulate_simd_level_t::avx512;
+    if(__builtin_cpu_supports("avx2"))
+        return simulate_simd_level_t::avx2;
+#endif
+    return simulate_simd_level_t::scalar;
+}
+
+static kernel_table_t current_table = kernel_table_for(best_supported_level());
+
+void simulate_run2(gate_type_t type, uint64_t* v, const net_t* fanin, net_t out, size_t n) {
+    current_table.run2[static_cast<int>(type)](v, fanin, out, n);
+}
+
+void simulate_run_not(uint64_t* v, const net_t* fanin, net_t out, size_t n) {
+    current_table.run_not(v, fanin, out, n);
+}
+
+void simulate_run2(gate_type_t type, uint8_t* v, const net_t* fanin, net_t out, size_t n) {
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(type) {
+    case gate_type_t::and_:
+    case gate_type_t::tristate: run2_scalar<op_and_t, false, uint8_t>(v, fanin, out, n); break;
+    case gate_type_t::nand:     run2_scalar<op_and_t, true,  uint8_t>(v, fanin, out, n); break;
+    case gate_type_t::or_:
+    case gate_type_t::bus:      run2_scalar<op_or_t,  false, uint8_t>(v, fanin, out, n); break;
+    case gate_type_t::nor_:     run2_scalar<op_or_t,  true,  uint8_t>(v, fanin, out, n); break;
+    case gate_type_t::xor_:     run2_scalar<op_xor_t, false, uint8_t>(v, fanin, out, n); break;
+    case gate_type_t::xnor_:    run2_scalar<op_xor_t, true,  uint8_t>(v, fanin, out, n); break;
+    default:
+        INTERNAL_ERR();
+    }
+    #pragma GCC diagnostic pop
+}
+
+void simulate_run_not(uint8_t* v, const net_t* fanin, net_t out, size_t n) {
+    run_not_scalar<uint8_t>(v, fanin, out, n);
+}
+
+simulate_simd_level_t simulate_simd_select(simulate_simd_level_t level) {
+    const simulate_simd_level_t best = best_supported_level();
+    if(static_cast<int>(level) > static_cast<int>(best))
+        level = best;
+
+    current_table = kernel_table_for(level);
+    return current_table.level;
+}
+
+simulate_simd_level_t simulate_simd_level(void) {
+    return current_table.level;
+}
+
+const std::string simulate_simd_level_name(simulate_simd_level_t level) {
+    switch(level) {
+    case simulate_simd_level_t::scalar: return "scalar";
+    case simulate_simd_level_t::avx2:   return "avx2";
+    case simulate_simd_level_t::avx512: return "avx512";
+    default: return "unknown";
+    }
+}
+
+bool simulate_simd_check(std::ostream& os) {
+
+    // inputs come from the first n_inputs words, the outputs go after them.
+    // everything fits in the first level cache so the rates are those of the
+    // kernels, not of memory
+    const size_t n_inputs = 1024ul;
+    const size_t n_gates  = 1021ul; // not a multiple of any vector width, the tails run too
+    const size_t repeat   = 2000ul;
+
+    uint64_t rng = 0x2545f4914f6cdd1dul;
+    auto random_word = [&rng](void) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    };
+
+    std::vector<uint64_t> v(n_inputs + n_gates);
+    for(size_t i = 0ul; i < n_inputs; i++)
+        v[i] = random_word();
+
+    std::vector<net_t> fanin(2ul * n_gates);
+    for(net_t& n : fanin)
+        n = (net_t)(random_word() % n_inputs);
+
+    const gate_type_t types[] = {
+        gate_type_t::not_, gate_type_t::and_, gate_type_t::nand, gate_type_t::or_, gate_type_t::nor_,
+        gate_type_t::xor_, gate_type_t::xnor_, gate_type_t::tristate, gate_type_t::bus };
+
+    const simulate_simd_level_t best = best_supported_level();
+    const kernel_table_t saved = current_table;
+
+    bool ok = true;
+
+    os << "simulate kernels, " << simulate_simd_level_name(saved.level) << " selected, M gates/s for 64 patterns each\n";
+    os << "    type    ";
+    for(int l = 0; l <= static_cast<int>(best); l++)
+        os << std::setw(10) << simulate_simd_level_name(static_cast<simulate_simd_level_t>(l));
+    os << "\n" << std::fixed << std::setprecision(1);
+
+    for(gate_type_t type : types) {
+
+        std::vector<uint64_t> expected;
+
+        os << "    " << std::left << std::setw(8) << gate_type_name(type) << std::right;
+
+        for(int l = 0; l <= static_cast<int>(best); l++) {
+            current_table = kernel_table_for(static_cast<simulate_simd_level_t>(l));
+
+            auto run = [&](void) {
+                if(type == gate_type_t::not_)
+                    simulate_run_not(v.data(), fanin.data(), (net_t)n_inputs, n_gates);
+                else
+                    simulate_run2(type, v.data(), fanin.data(), (net_t)n_inputs, n_gates);
+            };
+
+            memset(v.data() + n_inputs, 0, n_gates * sizeof(uint64_t));
+            run();
+
+            const std::vector<uint64_t> out(v.begin() + n_inputs, v.end());
+            if(l == 0)
+                expected = out;
+
+            const auto start = std::chrono::steady_clock::now();
+            for(size_t r = 0ul; r < repeat; r++)
+                run();
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if(out != expected) {
+                os << std::setw(10) << "MISMATCH";
+                ok = false;
+            } else {
+                os << std::setw(10) << (ms > 0.0 ? n_gates * repeat / (ms * 1000.0) : 0.0);
+            }
+        }
+        os << "\n";
+    }
+
+    os << std::defaultfloat;
+    current_table = saved;
+    return ok;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <src/runtime/netlist.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <iostream>
+
+//
+// kernels for runs of gates of one type, used by the simulator for the gates
+// of a level. gate i of a run reads v[fanin[2i]] and v[fanin[2i + 1]] (just
+// v[fanin[i]] for not) and writes v[out + i]. no gate of a run may read the
+// output of another one of the same run
+//
+// the 64 pattern kernels gather the inputs of 4 (AVX2) or 8 (AVX-512) gates
+// into one vector register and store their outputs with one vector store.
+// the best level is chosen from cpuid at startup, other targets use the
+// portable versions. the one pattern kernels are always portable
+//
+
+enum class simulate_simd_level_t {
+    scalar,
+    avx2,
+    avx512,
+};
+
+//
+// and, nand, or, nor, xor, xnor, tristate (data & enable) and bus with
+// exactly two inputs each
+//
+void simulate_run2(gate_type_t type, uint64_t* v, const net_t* fanin, net_t out, size_t n);
+void simulate_run2(gate_type_t type, uint8_t* v, const net_t* fanin, net_t out, size_t n);
+
+void simulate_run_not(uint64_t* v, const net_t* fanin, net_t out, size_t n);
+void simulate_run_not(uint8_t* v, const net_t* fanin, net_t out, size_t n);
+
+//
+// best level is chosen automatically. forcing a level the cpu does not support
+// falls back to the best supported one. returns the level actually in use
+//
+simulate_simd_level_t simulate_simd_select(simulate_simd_level_t level);
+simulate_simd_level_t simulate_simd_level(void);
+const std::string simulate_simd_level_name(simulate_simd_level_t level);
+
+//
+// runs every kernel the cpu supports on the same random gates, compares the
+// outputs with the portable kernel and prints the rate of each one per gate
+// type. returns false if any output differs. leaves the selected level alone
+//
+bool simulate_simd_check(std::ostream& os);
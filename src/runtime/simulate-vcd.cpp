@@ -0,0 +1,508 @@
+#include <src/runtime/simulate-vcd.h>
+#include <src/runtime/simulate.h>
+#include <src/runtime/netlist.h>
+#include <src/thread-pool.h>
+#include <src/error-util.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+
+//
+// threads only share the formatting once a sample has this many bits to look at
+//
+static const size_t vcd_team_grain = 4096ul;
+
+//
+// output buffers
+//
+
+static void vcd_write(simulate_vcd_t* vcd) {
+
+    std::unique_lock<std::mutex> guard(vcd->lock);
+    for(;;) {
+        vcd->work.wait(guard, [vcd] { return !vcd->full.empty() || vcd->closing; });
+        if(vcd->full.empty())
+            return;
+
+        std::vector<char> b = std::move(vcd->full.front());
+        vcd->full.pop_front();
+
+        guard.unlock();
+        const bool ok = fwrite(b.data(), 1ul, b.size(), vcd->file) == b.size();
+        b.clear();
+        guard.lock();
+
+        if(!ok && vcd->error.empty())
+            vcd->error = "writing the value change dump failed";
+        vcd->spare.push_back(std::move(b));
+        vcd->freed.notify_one();
+    }
+}
+
+static void vcd_hand_off(simulate_vcd_t* vcd) {
+    {
+        std::lock_guard<std::mutex> guard(vcd->lock);
+        vcd->full.push_back(std::move(vcd->buffer));
+    }
+    vcd->buffer = std::vector<char>();
+    vcd->stats.buffers++;
+    vcd->work.notify_one();
+}
+
+static void vcd_take_buffer(simulate_vcd_t* vcd) {
+
+    std::unique_lock<std::mutex> guard(vcd->lock);
+    if(vcd->spare.empty() && vcd->allocated < vcd->opts.buffers) {
+        vcd->allocated++;
+        guard.unlock();
+        vcd->buffer.reserve(vcd->opts.buffer_bytes);
+        return;
+    }
+
+    if(vcd->spare.empty()) {
+        vcd->stats.stalls++;
+        vcd->freed.wait(guard, [vcd] { return !vcd->spare.empty(); });
+    }
+    vcd->buffer = std::move(vcd->spare.back());
+    vcd->spare.pop_back();
+}
+
+static void vcd_append(simulate_vcd_t* vcd, const char* p, size_t n) {
+
+    vcd->stats.bytes += n;
+    while(n > 0ul) {
+        if(vcd->buffer.capacity() == 0ul)
+            vcd_take_buffer(vcd);
+
+        const size_t k = std::min(n, vcd->buffer.capacity() - vcd->buffer.size());
+        vcd->buffer.insert(vcd->buffer.end(), p, p + k);
+        p += k;
+        n -= k;
+
+        if(vcd->buffer.size() == vcd->buffer.capacity())
+            vcd_hand_off(vcd);
+    }
+}
+
+static void vcd_append(simulate_vcd_t* vcd, const std::string& s) {
+    vcd_append(vcd, s.data(), s.size());
+}
+
+//
+// signals
+//
+
+struct vcd_select_t {
+    const simulator_t* sim;
+    std::vector<simulate_vcd_var_t>* vars;
+    std::vector<net_t>* bits;
+    std::vector<std::vector<uint32_t> > children; // scopes in each scope
+    std::vector<std::vector<uint32_t> > gates;    // gates built by each scope
+    std::vector<uint8_t> on_path;                 // scope leads to the subtree, subtree only
+    uint32_t root = 0u;                           // of the subtree
+};
+
+static void vcd_add_var(vcd_select_t& v, const std::string& scope, const std::string& name, netlist_span_t nets) {
+
+    simulate_vcd_var_t var;
+    var.scope = scope;
+    var.name  = name;
+    var.width = (uint32_t)nets.size();
+    v.vars->push_back(var);
+
+    for(net_t n : nets)
+        v.bits->push_back(v.sim->net_slots[n]);
+}
+
+static void vcd_add_ports(vcd_select_t& v, const std::string& scope, uint32_t s) {
+    const netlist_t& nl = *v.sim->nl;
+    if(s == 0u) {
+        for(const netlist_port_t& port : nl.ports)
+            vcd_add_var(v, scope, port.name, netlist_port_nets(nl, port));
+        return;
+    }
+    for(uint32_t p = nl.scopes[s].first_port; p < nl.scopes[s].last_port; p++)
+        vcd_add_var(v, scope, nl.scope_ports[p].name, netlist_scope_port_nets(nl, nl.scope_ports[p]));
+}
+
+static std::string vcd_scope_name(const netlist_t& nl, uint32_t s) {
+    return nl.scopes.empty() ? std::string("top") : nl.scopes[s].name;
+}
+
+//
+// scope s and what is selected below it. with selected false only the way
+// to the subtree is followed
+//
+static void vcd_add_scope(vcd_select_t& v, const std::string& parent, uint32_t s, bool selected) {
+
+    const netlist_t& nl = *v.sim->nl;
+    const std::string scope = parent.empty() ? vcd_scope_name(nl, s) : parent + "." + vcd_scope_name(nl, s);
+
+    if(selected) {
+        vcd_add_ports(v, scope, s);
+        for(uint32_t g : v.gates[s]) {
+            const net_t out = netlist_gate_output(nl, g);
+            vcd_add_var(v, scope, std::string(gate_type_name(netlist_gate_type(nl, g))) + "_" + std::to_string(g), { &out, &out + 1 });
+        }
+    }
+
+    for(uint32_t c : v.children[s]) {
+        if(selected)
+            vcd_add_scope(v, scope, c, true);
+        else if(v.on_path[c])
+            vcd_add_scope(v, scope, c, c == v.root);
+    }
+}
+
+void simulate_vcd_select(const simulator_t* sim, const simulate_vcd_options_t& opts, std::vector<simulate_vcd_var_t>& vars, std::vector<net_t>& bits) {
+
+    const netlist_t& nl = *sim->nl;
+    const size_t n_scopes = std::max(nl.scopes.size(), (size_t)1ul);
+
+    vars.clear();
+    bits.clear();
+
+    vcd_select_t v;
+    v.sim  = sim;
+    v.vars = &vars;
+    v.bits = &bits;
+    v.children.resize(n_scopes);
+    v.gates.resize(n_scopes);
+
+    // parents come before their children
+    for(uint32_t s = 1u; s < nl.scopes.size(); s++)
+        v.children[nl.scopes[s].parent].push_back(s);
+
+    if(opts.select == simulate_vcd_select_t::ports) {
+        vcd_add_ports(v, vcd_scope_name(nl, 0u), 0u);
+        return;
+    }
+
+    std::vector<uint32_t> gate_scopes;
+    netlist_gate_scopes(nl, gate_scopes);
+    for(uint32_t g = 0u; g < netlist_gate_count(nl); g++)
+        v.gates[gate_scopes[g]].push_back(g);
+
+    // the subtree is found name by name from the top
+    uint32_t& root = v.root;
+    if(opts.select == simulate_vcd_select_t::subtree) {
+        size_t start = 0ul;
+        bool found = false;
+        for(;;) {
+            const size_t dot = opts.scope.find('.', start);
+            const std::string name = opts.scope.substr(start, dot == std::string::npos ? std::string::npos : dot - start);
+
+            found = false;
+            if(start == 0ul)
+                found = !nl.scopes.empty() && nl.scopes[0].name == name;
+            else
+                for(uint32_t c : v.children[root])
+                    if(nl.scopes[c].name == name) {
+                        root  = c;
+                        found = true;
+                        break;
+                    }
+
+            if(!found || dot == std::string::npos)
+                break;
+            start = dot + 1ul;
+        }
+        if(!found)
+            throw std::runtime_error("there is no scope '" + opts.scope + "' to dump");
+
+        v.on_path.assign(n_scopes, 0u);
+        for(uint32_t s = root; s != 0u; s = nl.scopes[s].parent)
+            v.on_path[s] = 1u;
+        v.on_path[0] = 1u;
+    }
+
+    vcd_add_scope(v, "", 0u, opts.select == simulate_vcd_select_t::all || root == 0u);
+}
+
+std::string simulate_vcd_id(size_t i) {
+    // base 94 over the printable characters
+    std::string id;
+    do {
+        id.push_back((char)('!' + i % 94ul));
+        i /= 94ul;
+    } while(i > 0ul);
+    return id;
+}
+
+std::string simulate_vcd_header(const std::vector<simulate_vcd_var_t>& vars, const std::string& timescale) {
+
+    std::string text = "$version crappy-hdl $end\n$timescale " + timescale + " $end\n";
+
+    // scopes open around the last var, the next one closes what it does not share
+    std::vector<std::string> open;
+    for(size_t i = 0ul; i < vars.size(); i++) {
+        const simulate_vcd_var_t& var = vars[i];
+
+        std::vector<std::string> path;
+        for(size_t start = 0ul; ; ) {
+            const size_t dot = var.scope.find('.', start);
+            path.push_back(var.scope.substr(start, dot == std::string::npos ? std::string::npos : dot - start));
+            if(dot == std::string::npos)
+                break;
+            start = dot + 1ul;
+        }
+
+        size_t shared = 0ul;
+        while(shared < open.size() && shared < path.size() && open[shared] == path[shared])
+            shared++;
+        for(size_t k = shared; k < open.size(); k++)
+            text += "$upscope $end\n";
+        for(size_t k = shared; k < path.size(); k++)
+            text += "$scope module " + path[k] + " $end\n";
+        open.swap(path);
+
+        text += "$var wire " + std::to_string(var.width) + " " + simulate_vcd_id(i) + " " + var.name;
+        if(var.width > 1u)
+            text += " [" + std::to_string(var.width - 1u) + ":0]";
+        text += " $end\n";
+    }
+    for(size_t k = 0ul; k < open.size(); k++)
+        text += "$upscope $end\n";
+
+    return text + "$enddefinitions $end\n";
+}
+
+void simulate_vcd_open(simulate_vcd_t* vcd, const simulator_t* sim, const std::string& path, const simulate_vcd_options_t& opts) {
+
+    if(vcd->writer.joinable())
+        throw std::runtime_error("the value change dump is already open");
+    if(opts.pattern >= simulator_patterns(sim))
+        throw std::runtime_error("there is no pattern " + std::to_string(opts.pattern) + " to dump");
+
+    vcd->sim  = sim;
+    vcd->opts = opts;
+    vcd->opts.buffers      = std::max(opts.buffers, (size_t)2ul);
+    vcd->opts.buffer_bytes = std::max(opts.buffer_bytes, (size_t)4096ul);
+    vcd->dumped = false;
+    vcd->time   = 0ul;
+    vcd->stats  = simulate_vcd_stats_t();
+
+    std::vector<simulate_vcd_var_t> vars;
+    simulate_vcd_select(sim, opts, vars, vcd->bits);
+
+    vcd->signals.clear();
+    vcd->ids.clear();
+    vcd->id_offsets.assign(1ul, 0u);
+    uint32_t first = 0u;
+    for(size_t i = 0ul; i < vars.size(); i++) {
+        simulate_vcd_signal_t signal;
+        signal.first = first;
+        signal.width = vars[i].width;
+        vcd->signals.push_back(signal);
+        first += signal.width;
+
+        const std::string id = simulate_vcd_id(i);
+        vcd->ids.insert(vcd->ids.end(), id.begin(), id.end());
+        vcd->id_offsets.push_back((uint32_t)vcd->ids.size());
+    }
+
+    vcd->last.assign(vcd->bits.size(), 0u);
+    vcd->stats.signals = vcd->signals.size();
+    vcd->stats.bits    = vcd->bits.size();
+
+    // the signals split into teams of about as many bits each
+    const size_t teams = sim->pool != NULL && vcd->bits.size() >= 2ul * vcd_team_grain
+            ? std::min(thread_pool_size(sim->pool), vcd->bits.size() / vcd_team_grain) : 1ul;
+
+    vcd->team_offsets.assign(1ul, 0u);
+    size_t bits = 0ul;
+    for(uint32_t i = 0u; i < vcd->signals.size(); i++) {
+        bits += vcd->signals[i].width;
+        if(bits * teams >= vcd->bits.size() * vcd->team_offsets.size() && vcd->team_offsets.size() < teams)
+            vcd->team_offsets.push_back(i + 1u);
+    }
+    vcd->team_offsets.push_back((uint32_t)vcd->signals.size());
+    vcd->team_out.assign(vcd->team_offsets.size() - 1ul, std::vector<char>(4096ul));
+    vcd->team_used.assign(vcd->team_out.size(), 0ul);
+    vcd->team_changes.assign(vcd->team_out.size(), 0ul);
+
+    vcd->file = fopen(path.c_str(), "wb");
+    if(vcd->file == NULL)
+        throw std::runtime_error("can not create '" + path + "'");
+    setvbuf(vcd->file, NULL, _IONBF, 0ul);
+
+    vcd->buffer = std::vector<char>();
+    vcd->full.clear();
+    vcd->spare.clear();
+    vcd->allocated = 0ul;
+    vcd->closing   = false;
+    vcd->error.clear();
+    vcd->writer = std::thread(vcd_write, vcd);
+
+    vcd_append(vcd, simulate_vcd_header(vars, opts.timescale));
+}
+
+//
+// samples
+//
+
+static const char vcd_chars[4] = { '0', '1', 'x', 'z' };
+
+//
+// compares the signals of one team with the last sample and formats the ones
+// that changed, all of them with every set
+//
+template<bool wide, bool four_state>
+static void vcd_format(simulate_vcd_t* vcd, size_t team, bool every) {
+
+    const simulator_t* sim = vcd->sim;
+    const size_t p = vcd->opts.pattern;
+
+    std::vector<char>& out = vcd->team_out[team];
+    size_t used    = 0ul;
+    size_t changes = 0ul;
+
+    for(uint32_t i = vcd->team_offsets[team]; i < vcd->team_offsets[team + 1ul]; i++) {
+        const simulate_vcd_signal_t signal = vcd->signals[i];
+        const net_t* nets = vcd->bits.data() + signal.first;
+        uint8_t* last     = vcd->last.data() + signal.first;
+
+        bool changed = every;
+        for(uint32_t b = 0u; b < signal.width; b++) {
+            const net_t n = nets[b];
+            uint8_t code;
+            if(wide)
+                code = (uint8_t)(((sim->words[n] >> p) & 1ul) | (four_state ? ((sim->unknown_words[n] >> p) & 1ul) << 1 : 0ul));
+            else
+                code = (uint8_t)((sim->values[n] & 1u) | (four_state ? (sim->unknowns[n] & 1u) << 1 : 0u));
+            changed |= code != last[b];
+            last[b] = code;
+        }
+        if(!changed)
+            continue;
+
+        const char* id      = vcd->ids.data() + vcd->id_offsets[i];
+        const size_t id_len = vcd->id_offsets[i + 1u] - vcd->id_offsets[i];
+        const size_t need   = signal.width + id_len + 3ul;
+        if(used + need > out.size())
+            out.resize(std::max(out.size() * 2ul, used + need));
+
+        char* o = out.data() + used;
+        if(signal.width == 1u) {
+            *o++ = vcd_chars[last[0]];
+        } else {
+            *o++ = 'b';
+            for(uint32_t b = signal.width; b-- > 0u; )
+                *o++ = vcd_chars[last[b]];
+            *o++ = ' ';
+        }
+        for(size_t k = 0ul; k < id_len; k++)
+            *o++ = id[k];
+        *o++ = '\n';
+
+        used = (size_t)(o - out.data());
+        changes++;
+    }
+
+    vcd->team_used[team]    = used;
+    vcd->team_changes[team] = changes;
+}
+
+static void vcd_format(simulate_vcd_t* vcd, size_t team, bool every) {
+    const bool wide = vcd->sim->width == simulate_width_t::parallel64;
+    const bool four = vcd->sim->logic == simulate_logic_t::four_state;
+    if(wide)
+        four ? vcd_format<true, true>(vcd, team, every) : vcd_format<true, false>(vcd, team, every);
+    else
+        four ? vcd_format<false, true>(vcd, team, every) : vcd_format<false, false>(vcd, team, every);
+}
+
+void simulate_vcd_sample(simulate_vcd_t* vcd, uint64_t time) {
+
+    if(!vcd->writer.joinable())
+        throw std::runtime_error("the value change dump is not open");
+    if(vcd->dumped && time < vcd->time)
+        throw std::runtime_error("value change dump time " + std::to_string(time) + " is before " + std::to_string(vcd->time));
+
+    const auto start = std::chrono::steady_clock::now();
+    const bool every = !vcd->dumped;
+    const size_t teams = vcd->team_out.size();
+
+    if(teams > 1ul)
+        thread_pool_parallel_for(vcd->sim->pool, teams, [vcd, every](size_t t) { vcd_format(vcd, t, every); });
+    else
+        vcd_format(vcd, 0ul, every);
+
+    size_t changes = 0ul;
+    for(size_t t = 0ul; t < teams; t++)
+        changes += vcd->team_changes[t];
+
+    if(changes > 0ul || every) {
+        vcd_append(vcd, "#" + std::to_string(time) + "\n");
+        if(every)
+            vcd_append(vcd, "$dumpvars\n");
+        for(size_t t = 0ul; t < teams; t++)
+            vcd_append(vcd, vcd->team_out[t].data(), vcd->team_used[t]);
+        if(every)
+            vcd_append(vcd, "$end\n");
+    }
+
+    vcd->dumped = true;
+    vcd->time   = time;
+    vcd->stats.samples++;
+    vcd->stats.changes += changes;
+    vcd->stats.sample_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void simulate_vcd_close(simulate_vcd_t* vcd) {
+
+    if(!vcd->writer.joinable())
+        return;
+
+    const auto start = std::chrono::steady_clock::now();
+    if(!vcd->buffer.empty())
+        vcd_hand_off(vcd);
+    {
+        std::lock_guard<std::mutex> guard(vcd->lock);
+        vcd->closing = true;
+    }
+    vcd->work.notify_one();
+    vcd->writer.join();
+
+    if(fclose(vcd->file) != 0 && vcd->error.empty())
+        vcd->error = "writing the value change dump failed";
+    vcd->file = NULL;
+    vcd->full.clear();
+    vcd->spare.clear();
+    vcd->stats.close_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if(!vcd->error.empty())
+        throw std::runtime_error(vcd->error);
+}
+
+simulate_vcd_t::~simulate_vcd_t() {
+    // an exception went past the owner, the writer still has to stop
+    if(this->writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->closing = true;
+        }
+        this->work.notify_one();
+        this->writer.join();
+    }
+    if(this->file != NULL)
+        fclose(this->file);
+}
+
+std::ostream& operator<<(std::ostream& os, const simulate_vcd_stats_t& stats) {
+    const double ms = stats.sample_ms + stats.close_ms;
+    os << "    vcd : " << stats.signals << " signals, " << stats.bits << " bits, " << stats.samples << " samples, "
+       << stats.changes << " value changes, " << stats.bytes / 1024ul << " KB in " << stats.buffers << " buffers, "
+       << stats.stalls << " stalls\n"
+       << "    vcd time : " << std::fixed << std::setprecision(1) << stats.sample_ms << " ms sampling, "
+       << stats.close_ms << " ms draining, " << (ms > 0.0 ? stats.changes / (ms * 1000.0) : 0.0)
+       << " M value changes/s\n" << std::defaultfloat;
+    return os;
+}
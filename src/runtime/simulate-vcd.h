@@ -0,0 +1,150 @@
+#pragma once
+
+#include <src/runtime/simulate.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <mutex>
+#include <deque>
+#include <string>
+#include <vector>
+#include <thread>
+#include <condition_variable>
+
+//
+// value change dump of a simulation, one sample after every simulator_eval
+// the caller wants in the waveform. a sample compares the selected signals
+// with the last one and formats the ones that changed. that is the part that
+// costs, so with a thread pool (the one of the simulator) the signals are
+// split over its threads, each formats into a buffer of its own. the pieces
+// are copied in order into large output buffers and every full one goes to
+// a background thread that writes it out, the simulation never waits for
+// the file unless all buffers are in flight
+//
+// the scopes are the instance tree of the netlist, named like adder_3 (see
+// netlist_scope_t). a scope holds the ports of its instance and one signal
+// per gate its module body built, named after the gate type and id like
+// xor_152. with four state logic the values are 0, 1, x and z
+//
+
+enum class simulate_vcd_select_t {
+    ports,   // the ports of the top level module
+    subtree, // every signal of one scope and the scopes below it
+    all,     // every signal of every scope
+};
+
+struct simulate_vcd_options_t {
+    simulate_vcd_select_t select = simulate_vcd_select_t::ports;
+    std::string scope;           // subtree only, scope names from the top joined by dots, like cpu.alu_0
+    size_t pattern = 0ul;        // of the 64 patterns of the parallel width
+    size_t buffer_bytes = 1ul << 22;
+    size_t buffers      = 4ul;   // output buffers, written or waiting to be written
+    std::string timescale = "1ns";
+};
+
+struct simulate_vcd_stats_t {
+    size_t signals   = 0ul;
+    size_t bits      = 0ul;
+    size_t samples   = 0ul;
+    size_t changes   = 0ul; // value changes written, a vector counts once
+    size_t bytes     = 0ul;
+    size_t buffers   = 0ul; // handed to the writer thread
+    size_t stalls    = 0ul; // times a sample waited for a buffer
+    double sample_ms = 0.0; // spent in simulate_vcd_sample
+    double close_ms  = 0.0; // waiting for the writer in simulate_vcd_close
+};
+
+//
+// a selected signal, name in scope, where scope is the names from the top
+// joined by dots
+//
+struct simulate_vcd_var_t {
+    std::string scope;
+    std::string name;
+    uint32_t width = 0u;
+};
+
+//
+// bits [first, first + width) of bits, bit 0 first. the identifier code is
+// ids[id_offsets[i] .. id_offsets[i + 1])
+//
+struct simulate_vcd_signal_t {
+    uint32_t first = 0u;
+    uint32_t width = 0u;
+};
+
+struct simulate_vcd_t {
+    const simulator_t* sim = NULL;
+    simulate_vcd_options_t opts;
+
+    std::vector<simulate_vcd_signal_t> signals;
+    std::vector<net_t>    bits;       // simulator nets
+    std::vector<uint8_t>  last;       // per bit, value | unknown << 1 at the last sample
+    std::vector<uint32_t> id_offsets = { 0u };
+    std::vector<char>     ids;
+    bool     dumped = false;          // the first sample dumps every signal
+    uint64_t time   = 0ul;
+
+    // signals [team_offsets[t], team_offsets[t + 1]) are formatted by thread t
+    // into the first team_used[t] bytes of team_out[t]
+    std::vector<uint32_t> team_offsets;
+    std::vector<std::vector<char> > team_out;
+    std::vector<size_t> team_used;
+    std::vector<size_t> team_changes;
+
+    // output. the caller fills buffer, full ones wait in full for the writer
+    // thread, which hands them back through spare
+    FILE* file = NULL;
+    std::vector<char> buffer;
+    std::deque<std::vector<char> > full;
+    std::vector<std::vector<char> > spare;
+    size_t allocated = 0ul;
+    bool closing = false;
+    std::string error;
+    std::mutex lock;
+    std::condition_variable work;  // full buffers or closing, for the writer
+    std::condition_variable freed; // a spare buffer, for the caller
+    std::thread writer;
+
+    simulate_vcd_stats_t stats;
+
+    ~simulate_vcd_t();
+};
+
+//
+// writes the header for the signals opts selects from sim to path and starts
+// the writer thread. sim has to be initialized and outlive the dump. throws
+// std::runtime_error if the file can not be created, the pattern does not
+// exist or there is no such scope
+//
+void simulate_vcd_open(simulate_vcd_t* vcd, const simulator_t* sim, const std::string& path, const simulate_vcd_options_t& opts = simulate_vcd_options_t());
+
+//
+// the signals as of the last simulator_eval at time, which must not go
+// backwards. only changes are written, a time without any is left out
+//
+void simulate_vcd_sample(simulate_vcd_t* vcd, uint64_t time);
+
+//
+// writes what is left and waits for the writer thread. throws
+// std::runtime_error if a write failed
+//
+void simulate_vcd_close(simulate_vcd_t* vcd);
+
+std::ostream& operator<<(std::ostream& os, const simulate_vcd_stats_t& stats);
+
+//
+// the pieces, for other waveform formats. the signals opts selects from sim
+// in the order they are dumped and the simulator nets of their bits, bit 0
+// of each first. throws std::runtime_error if there is no such scope
+//
+void simulate_vcd_select(const simulator_t* sim, const simulate_vcd_options_t& opts, std::vector<simulate_vcd_var_t>& vars, std::vector<net_t>& bits);
+
+//
+// everything up to $enddefinitions for vars, var i has identifier code
+// simulate_vcd_id(i). vars of a scope have to be next to each other
+//
+std::string simulate_vcd_header(const std::vector<simulate_vcd_var_t>& vars, const std::string& timescale);
+std::string simulate_vcd_id(size_t i);
@@ -0,0 +1,1069 @@
+#include <src/runtime/simulate.h>
+#include <src/runtime/netlist.h>
+#include <src/error-util.h>
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <algorithm>
+
+// fewest gates of a level worth giving a thread of its own
+static const uint32_t sim_partition_grain = 512u;
+
+//
+// event engine, gate i is due delays[i] from now
+//
+static inline void sim_schedule(simulator_t* sim, uint32_t i) {
+    const uint64_t at = sim->time + sim->delays[i];
+    if(sim->scheduled[i] == at + 1ul)
+        return;
+    sim->scheduled[i] = at + 1ul;
+    sim->wheel[at & (sim->wheel.size() - 1ul)].push_back(i);
+    sim->pending++;
+}
+
+static inline void sim_schedule_fanout(simulator_t* sim, net_t n) {
+    for(uint32_t k = sim->fanout_offsets[n]; k < sim->fanout_offsets[n + 1u]; k++)
+        sim_schedule(sim, sim->fanout[k]);
+}
+
+//
+// drops everything scheduled and sizes the wheel for the current delays
+//
+static void sim_reset_wheel(simulator_t* sim) {
+
+    uint32_t longest = 1u;
+    for(uint32_t d : sim->delays)
+        longest = std::max(longest, d);
+
+    size_t size = 2ul;
+    while(size <= longest)
+        size *= 2ul;
+
+    sim->wheel.clear();
+    sim->wheel.resize(size);
+    sim->scheduled.assign(sim->types.size(), 0ul);
+    sim->pending = 0ul;
+}
+
+void simulator_init(
+        simulator_t* sim, const netlist_t& nl, simulate_width_t width, simulate_engine_t engine, thread_pool_t* pool, simulate_logic_t logic) {
+
+    if(logic == simulate_logic_t::four_state && engine != simulate_engine_t::levelized)
+        throw std::runtime_error("four state simulation needs the levelized engine");
+
+    const size_t n_gates = netlist_gate_count(nl);
+
+    sim->nl = &nl;
+
+    std::vector<uint32_t> order;
+    const size_t ordered = netlist_order_gates(nl, order);
+
+    auto is_flipflop = [&](uint32_t g) { return netlist_gate_type(nl, g) == gate_type_t::flipflop; };
+
+    //
+    // a gate reading only inputs, constants and flipflops is on level 0,
+    // any other one level past the highest of the gates it reads
+    //
+    std::vector<uint32_t> level(n_gates, 0u);
+    std::vector<uint32_t> level_sizes;
+
+    for(size_t i = 0ul; i < ordered; i++) {
+        const uint32_t g = order[i];
+        if(is_flipflop(g))
+            continue;
+
+        uint32_t l = 0u;
+        for(net_t n : netlist_gate_fanin(nl, g)) {
+            const int64_t d = netlist_net_driver(nl, n);
+            if(d >= 0 && !is_flipflop((uint32_t)d))
+                l = std::max(l, level[d] + 1u);
+        }
+        level[g] = l;
+
+        if(l >= level_sizes.size())
+            level_sizes.resize(l + 1u, 0u);
+        level_sizes[l]++;
+    }
+
+    std::vector<uint32_t> level_offsets(1ul, 0u);
+    for(uint32_t n : level_sizes)
+        level_offsets.push_back(level_offsets.back() + n);
+    sim->levels = (uint32_t)level_sizes.size();
+
+    auto kernel = [&](uint32_t g) {
+        const size_t n = nl.fanin_offsets[g + 1u] - nl.fanin_offsets[g];
+        return n == (netlist_gate_type(nl, g) == gate_type_t::not_ ? 1ul : 2ul);
+    };
+
+    std::vector<uint32_t> placed(order.size());
+    {
+        std::vector<uint32_t> cursor(level_offsets.begin(), level_offsets.end() - 1);
+        for(size_t i = 0ul; i < ordered; i++)
+            if(!is_flipflop(order[i]))
+                placed[cursor[level[order[i]]]++] = order[i];
+    }
+
+    sim->loop_first = level_offsets.back();
+
+    //
+    // partitions. a gate goes to the partition most of the gates it reads
+    // are in, or the first one with room when it reads none. a partition
+    // takes at most its share of a level, but never less than
+    // sim_partition_grain gates, a level too small to split is not worth a
+    // barrier
+    //
+    const size_t threads = pool != NULL && engine == simulate_engine_t::levelized ? thread_pool_size(pool) : 1ul;
+
+    std::vector<uint32_t> part(n_gates, 0u);
+    std::vector<uint32_t> phase_of(sim->levels, 0u);
+    sim->phases = 1ul;
+    sim->cross_nets = 0ul;
+
+    if(threads > 1ul) {
+        std::vector<uint32_t> load(threads);
+        std::vector<uint32_t> votes(threads);
+
+        for(uint32_t l = 0u; l < sim->levels; l++) {
+            const uint32_t cap = std::max((uint32_t)((level_sizes[l] + threads - 1ul) / threads), sim_partition_grain);
+            std::fill(load.begin(), load.end(), 0u);
+
+            for(uint32_t i = level_offsets[l]; i < level_offsets[l + 1u]; i++) {
+                const uint32_t g = placed[i];
+
+                std::fill(votes.begin(), votes.end(), 0u);
+                for(net_t n : netlist_gate_fanin(nl, g)) {
+                    const int64_t d = netlist_net_driver(nl, n);
+                    if(d >= 0 && !is_flipflop((uint32_t)d))
+                        votes[part[d]]++;
+                }
+
+                size_t best = threads;
+                for(size_t q = 0ul; q < threads; q++)
+                    if(load[q] < cap && (best == threads || votes[q] > votes[best]))
+                        best = q;
+
+                part[g] = (uint32_t)best;
+                load[best]++;
+            }
+        }
+
+        // a phase ends before the first level reading the output of another
+        // partition from the same phase
+        std::vector<uint8_t> crossing(n_gates, 0u);
+        uint32_t phase_level = 0u;
+
+        for(uint32_t l = 0u; l < sim->levels; l++) {
+            bool barrier = false;
+            for(uint32_t i = level_offsets[l]; i < level_offsets[l + 1u]; i++) {
+                const uint32_t g = placed[i];
+                for(net_t n : netlist_gate_fanin(nl, g)) {
+                    const int64_t d = netlist_net_driver(nl, n);
+                    if(d < 0 || is_flipflop((uint32_t)d) || part[d] == part[g])
+                        continue;
+                    crossing[d] = 1u;
+                    barrier = barrier || level[d] >= phase_level;
+                }
+            }
+
+            if(barrier) {
+                phase_level = l;
+                sim->phases++;
+            }
+            phase_of[l] = (uint32_t)sim->phases - 1u;
+        }
+
+        for(uint8_t c : crossing)
+            sim->cross_nets += c;
+    }
+
+    // one partition holding every gate runs on the calling thread
+    sim->pool    = pool;
+    sim->threads = 1ul;
+    for(uint32_t i = 0u; i < sim->loop_first; i++)
+        if(part[placed[i]] != 0u)
+            sim->threads = threads;
+    if(sim->threads == 1ul)
+        sim->phases = 1ul;
+
+    // within a partition and level the gates of one type go together, those
+    // a kernel can take first
+    auto key = [&](uint32_t g) {
+        return std::make_tuple(sim->threads > 1ul ? phase_of[level[g]] : 0u, part[g], level[g], nl.gate_types[g], !kernel(g));
+    };
+    std::stable_sort(placed.begin(), placed.begin() + sim->loop_first, [&](uint32_t a, uint32_t b) { return key(a) < key(b); });
+
+    size_t n_comb = sim->loop_first;
+    for(size_t i = ordered; i < order.size(); i++)
+        placed[n_comb++] = order[i];
+    placed.resize(n_comb);
+
+    sim->runs.clear();
+    sim->team_offsets.assign(sim->phases * sim->threads + 1ul, 0u);
+    for(uint32_t i = 0u; i < sim->loop_first; i++) {
+        const uint32_t g = placed[i];
+        if(i == 0u || key(g) != key(placed[i - 1u])) {
+            simulate_run_t run;
+            run.type   = nl.gate_types[g];
+            run.kernel = kernel(g);
+            run.first  = i;
+            sim->runs.push_back(run);
+            sim->team_offsets[std::get<0>(key(g)) * sim->threads + std::get<1>(key(g)) + 1ul]++;
+        }
+        sim->runs.back().last = i + 1u;
+    }
+    for(size_t t = 1ul; t < sim->team_offsets.size(); t++)
+        sim->team_offsets[t] += sim->team_offsets[t - 1ul];
+
+    //
+    // new net numbers, see simulator_t
+    //
+    std::vector<net_t> slot(nl.net_count);
+    for(net_t n = 0u; n < nl.first_gate_net; n++)
+        slot[n] = n;
+
+    net_t next = nl.first_gate_net;
+    for(uint32_t g = 0u; g < n_gates; g++)
+        if(is_flipflop(g))
+            slot[netlist_gate_output(nl, g)] = next++;
+
+    sim->gate_slot = next;
+    for(uint32_t g : placed)
+        slot[netlist_gate_output(nl, g)] = next++;
+
+    sim->port_slots.clear();
+    for(net_t n : nl.port_nets)
+        sim->port_slots.push_back(slot[n]);
+
+    sim->types.clear();
+    sim->fanin.clear();
+    sim->fanin_offsets.assign(1ul, 0u);
+    sim->types.reserve(n_comb);
+    sim->fanin_offsets.reserve(n_comb + 1ul);
+    sim->gate_ids = placed;
+
+    for(uint32_t g : placed) {
+        sim->types.push_back(nl.gate_types[g]);
+        for(net_t n : netlist_gate_fanin(nl, g))
+            sim->fanin.push_back(slot[n]);
+        sim->fanin_offsets.push_back((uint32_t)sim->fanin.size());
+    }
+
+    sim->ff_d.clear();
+    sim->ff_clk.clear();
+    sim->ff_q.clear();
+    for(uint32_t g = 0u; g < n_gates; g++) {
+        if(!is_flipflop(g))
+            continue;
+        const netlist_span_t in = netlist_gate_fanin(nl, g);
+        sim->ff_d.push_back(slot[in[0]]);
+        sim->ff_clk.push_back(slot[in[1]]);
+        sim->ff_q.push_back(slot[netlist_gate_output(nl, g)]);
+    }
+    sim->net_slots.swap(slot);
+
+    sim->compiled        = NULL;
+    sim->compiled_settle = NULL;
+    sim->compiled_clock  = NULL;
+
+    sim->engine = engine;
+    sim->fanout_offsets.clear();
+    sim->fanout.clear();
+    sim->delays.clear();
+    sim->changed.clear();
+    sim->time = 0ul;
+
+    if(engine == simulate_engine_t::event) {
+        sim->fanout_offsets.assign(nl.net_count + 1ul, 0u);
+        for(net_t n : sim->fanin)
+            sim->fanout_offsets[n + 1u]++;
+        for(size_t n = 0ul; n < nl.net_count; n++)
+            sim->fanout_offsets[n + 1ul] += sim->fanout_offsets[n];
+
+        sim->fanout.resize(sim->fanin.size());
+        std::vector<uint32_t> cursor(sim->fanout_offsets.begin(), sim->fanout_offsets.end() - 1);
+        for(uint32_t i = 0u; i < n_comb; i++)
+            for(uint32_t k = sim->fanin_offsets[i]; k < sim->fanin_offsets[i + 1u]; k++)
+                sim->fanout[cursor[sim->fanin[k]]++] = i;
+
+        sim->delays.assign(n_comb, 1u);
+        sim_reset_wheel(sim);
+
+        // nothing is known about the outputs yet, every gate goes once
+        for(uint32_t i = 0u; i < n_comb; i++)
+            sim_schedule(sim, i);
+    }
+
+    sim->width = width;
+    sim->logic = logic;
+    const bool four = logic == simulate_logic_t::four_state;
+
+    if(width == simulate_width_t::parallel64) {
+        sim->values.clear();
+        sim->unknowns.clear();
+        sim->words.assign(nl.net_count, 0ul);
+        sim->words[net_const1] = ~0ul;
+        sim->unknown_words.assign(four ? nl.net_count : 0ul, four ? ~0ul : 0ul);
+    } else {
+        sim->words.clear();
+        sim->unknown_words.clear();
+        sim->values.assign(nl.net_count, 0u);
+        sim->values[net_const1] = 0xffu;
+        sim->unknowns.assign(four ? nl.net_count : 0ul, four ? 0xffu : 0u);
+    }
+
+    // everything starts out as X, but the constants and inputs are known
+    // and the nets nothing drives are Z
+    if(four) {
+        std::vector<uint8_t> known(nl.first_gate_net, 0u);
+        known[net_const0] = known[net_const1] = 1u;
+        for(const netlist_port_t& port : nl.ports)
+            for(uint32_t i = 0u; i < port.width && !port.is_output; i++)
+                if(nl.port_nets[port.first + i] < nl.first_gate_net)
+                    known[nl.port_nets[port.first + i]] = 1u;
+
+        for(net_t n = 0u; n < nl.first_gate_net; n++) {
+            if(width == simulate_width_t::parallel64) {
+                sim->unknown_words[n] = known[n] ? 0ul : ~0ul;
+                sim->words[n] |= known[n] ? 0ul : ~0ul;
+            } else {
+                sim->unknowns[n] = known[n] ? 0u : 0xffu;
+                sim->values[n] |= known[n] ? 0u : 0xffu;
+            }
+        }
+    }
+
+    sim->ff_next.assign(sim->ff_q.size(), 0ul);
+    sim->ff_next_unknown.assign(four ? sim->ff_q.size() : 0ul, 0ul);
+    sim->stats = simulate_stats_t();
+
+    // settle with every input at 0 so the first clocks poked are not edges,
+    // a clock reading 1 already rises here
+    sim->ff_clk_last.assign(sim->ff_q.size(), 0ul);
+    sim->ff_clk_last_unknown.assign(four ? sim->ff_q.size() : 0ul, 0ul);
+    simulator_eval(sim);
+    sim->stats = simulate_stats_t();
+}
+
+void simulator_set_delays(simulator_t* sim, const std::vector<uint32_t>& gate_delays) {
+
+    if(sim->engine != simulate_engine_t::event)
+        return;
+    if(gate_delays.size() != netlist_gate_count(*sim->nl))
+        throw std::runtime_error("expected a delay for each of the " + std::to_string(netlist_gate_count(*sim->nl)) + " gates");
+
+    for(size_t i = 0ul; i < sim->types.size(); i++)
+        sim->delays[i] = std::max(gate_delays[sim->gate_ids[i]], 1u);
+
+    // the wheel is empty between evaluations, its size may change
+    sim_reset_wheel(sim);
+}
+
+const netlist_port_t& simulator_port(const simulator_t* sim, const std::string& name) {
+    for(const netlist_port_t& port : sim->nl->ports)
+        if(port.name == name)
+            return port;
+    throw std::runtime_error("no port named '" + name + "' in the netlist");
+}
+
+//
+// net of an input bit that pokes may change, 0 for a bit tied to a constant
+//
+static net_t sim_input_net(const simulator_t* sim, const netlist_port_t& port, size_t bit) {
+
+    if(port.is_output)
+        throw std::runtime_error("port '" + port.name + "' is an output, it can not be set");
+    if(bit >= port.width)
+        throw std::runtime_error("port '" + port.name + "' has no bit " + std::to_string(bit));
+
+    const net_t n = sim->port_slots[port.first + bit];
+    return n > net_const1 && n < sim->nl->first_gate_net ? n : net_const0;
+}
+
+static net_t sim_port_net(const simulator_t* sim, const netlist_port_t& port, size_t bit) {
+    if(bit >= port.width)
+        throw std::runtime_error("port '" + port.name + "' has no bit " + std::to_string(bit));
+    return sim->port_slots[port.first + bit];
+}
+
+void simulator_poke(simulator_t* sim, const netlist_port_t& port, uint64_t value) {
+    for(size_t i = 0ul; i < port.width; i++)
+        simulator_poke_bit(sim, port, i, i < 64ul && ((value >> i) & 1ul));
+}
+
+void simulator_poke_bit(simulator_t* sim, const netlist_port_t& port, size_t bit, bool value) {
+    simulator_poke_lanes(sim, port, bit, value ? ~0ul : 0ul);
+}
+
+uint64_t simulator_peek(const simulator_t* sim, const netlist_port_t& port) {
+    uint64_t value = 0ul;
+    for(size_t i = 0ul; i < port.width && i < 64ul; i++)
+        value |= (simulator_peek_lanes(sim, port, i) & 1ul) << i;
+    return value;
+}
+
+bool simulator_peek_bit(const simulator_t* sim, const netlist_port_t& port, size_t bit) {
+    return (simulator_peek_lanes(sim, port, bit) & 1ul) != 0ul;
+}
+
+void simulator_poke_lanes(simulator_t* sim, const netlist_port_t& port, size_t bit, uint64_t lanes) {
+    simulator_poke_state(sim, port, bit, lanes, 0ul);
+}
+
+uint64_t simulator_peek_lanes(const simulator_t* sim, const netlist_port_t& port, size_t bit) {
+
+    const net_t n = sim_port_net(sim, port, bit);
+
+    if(sim->width == simulate_width_t::parallel64)
+        return sim->words[n];
+    return sim->values[n] & 1u;
+}
+
+void simulator_poke_state(simulator_t* sim, const netlist_port_t& port, size_t bit, uint64_t value, uint64_t unknown) {
+
+    const bool four = sim->logic == simulate_logic_t::four_state;
+    if(!four && unknown != 0ul)
+        throw std::runtime_error("port '" + port.name + "' can only be set to X or Z in a four state simulation");
+
+    const net_t n = sim_input_net(sim, port, bit);
+    if(n == net_const0)
+        return;
+
+    bool changed;
+    if(sim->width == simulate_width_t::parallel64) {
+        changed = sim->words[n] != value;
+        sim->words[n] = value;
+        if(four)
+            sim->unknown_words[n] = unknown;
+    } else {
+        const uint8_t v = (value & 1ul) ? 0xffu : 0u;
+        changed = sim->values[n] != v;
+        sim->values[n] = v;
+        if(four)
+            sim->unknowns[n] = (unknown & 1ul) ? 0xffu : 0u;
+    }
+
+    if(changed && sim->engine == simulate_engine_t::event)
+        sim->changed.push_back(n);
+}
+
+void simulator_peek_state(const simulator_t* sim, const netlist_port_t& port, size_t bit, uint64_t* value, uint64_t* unknown) {
+
+    const net_t n = sim_port_net(sim, port, bit);
+    const bool four = sim->logic == simulate_logic_t::four_state;
+
+    if(sim->width == simulate_width_t::parallel64) {
+        *value   = sim->words[n];
+        *unknown = four ? sim->unknown_words[n] : 0ul;
+    } else {
+        *value   = sim->values[n] & 1u;
+        *unknown = four ? sim->unknowns[n] & 1u : 0ul;
+    }
+}
+
+char simulator_peek_char(const simulator_t* sim, const netlist_port_t& port, size_t bit, size_t pattern) {
+    uint64_t value, unknown;
+    simulator_peek_state(sim, port, bit, &value, &unknown);
+    return "01xz"[((value >> pattern) & 1ul) | (((unknown >> pattern) & 1ul) << 1)];
+}
+
+//
+// a[i] bit j and a[j] bit i trade places
+//
+static void sim_transpose64(uint64_t* a) {
+    uint64_t m = 0x00000000fffffffful;
+    for(size_t j = 32ul; j != 0ul; j >>= 1, m ^= m << j) {
+        for(size_t k = 0ul; k < 64ul; k = ((k | j) + 1ul) & ~j) {
+            const uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k]     ^= t << j;
+            a[k | j] ^= t;
+        }
+    }
+}
+
+void simulator_poke_patterns(simulator_t* sim, const netlist_port_t& port, const uint64_t* patterns) {
+
+    if(sim->width != simulate_width_t::parallel64) {
+        simulator_poke(sim, port, patterns[0]);
+        return;
+    }
+
+    uint64_t lanes[64];
+    for(size_t k = 0ul; k < 64ul; k++)
+        lanes[k] = patterns[k];
+    sim_transpose64(lanes);
+
+    for(size_t i = 0ul; i < port.width && i < 64ul; i++)
+        simulator_poke_lanes(sim, port, i, lanes[i]);
+}
+
+void simulator_peek_patterns(const simulator_t* sim, const netlist_port_t& port, uint64_t* patterns) {
+
+    if(sim->width != simulate_width_t::parallel64) {
+        patterns[0] = simulator_peek(sim, port);
+        return;
+    }
+
+    uint64_t lanes[64] = {};
+    for(size_t i = 0ul; i < port.width && i < 64ul; i++)
+        lanes[i] = sim->words[sim->port_slots[port.first + i]];
+    sim_transpose64(lanes);
+
+    for(size_t k = 0ul; k < 64ul; k++)
+        patterns[k] = lanes[k];
+}
+
+//
+// W is uint8_t holding 0x00 or 0xff for one pattern, or uint64_t for 64
+//
+template<typename W>
+static inline W sim_gate(gate_type_t type, const W* v, const net_t* in, const net_t* end) {
+
+    W r;
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(type) {
+    case gate_type_t::not_:
+        return (W)~v[in[0]];
+    case gate_type_t::and_:
+    case gate_type_t::nand:
+        r = (W)~(W)0u;
+        for(; in != end; in++)
+            r &= v[*in];
+        return type == gate_type_t::nand ? (W)~r : r;
+    case gate_type_t::or_:
+    case gate_type_t::nor_:
+    case gate_type_t::bus:
+        r = (W)0u;
+        for(; in != end; in++)
+            r |= v[*in];
+        return type == gate_type_t::nor_ ? (W)~r : r;
+    case gate_type_t::xor_:
+    case gate_type_t::xnor_:
+        r = (W)0u;
+        for(; in != end; in++)
+            r ^= v[*in];
+        return type == gate_type_t::xnor_ ? (W)~r : r;
+    case gate_type_t::tristate:
+        return v[in[0]] & v[in[1]];
+    default:
+        INTERNAL_ERR();
+    }
+    #pragma GCC diagnostic pop
+}
+
+//
+// patterns in which the words differ
+//
+static inline size_t sim_lanes_differing(uint8_t a, uint8_t b) {
+    return (a ^ b) & 1u;
+}
+
+static inline size_t sim_lanes_differing(uint64_t a, uint64_t b) {
+    return (size_t)__builtin_popcountll(a ^ b);
+}
+
+//
+// runs [first, last)
+//
+template<typename W>
+static void sim_eval_runs(const simulator_t* sim, W* v, uint32_t first, uint32_t last) {
+
+    const net_t* fanin = sim->fanin.data();
+    const uint32_t* offsets = sim->fanin_offsets.data();
+
+    for(uint32_t r = first; r < last; r++) {
+        const simulate_run_t& run = sim->runs[r];
+        const gate_type_t type = static_cast<gate_type_t>(run.type);
+        const net_t* in = fanin + offsets[run.first];
+        const net_t out = sim->gate_slot + run.first;
+
+        if(run.kernel && type == gate_type_t::not_)
+            simulate_run_not(v, in, out, run.last - run.first);
+        else if(run.kernel)
+            simulate_run2(type, v, in, out, run.last - run.first);
+        else
+            for(uint32_t i = run.first; i < run.last; i++)
+                v[sim->gate_slot + i] = sim_gate<W>(type, v, fanin + offsets[i], fanin + offsets[i + 1u]);
+    }
+}
+
+//
+// every thread of the team waits here until all of them arrived. the last
+// one to arrive starts the next generation, the writes of every thread
+// before the barrier are seen by all of them after it
+//
+static void sim_barrier(simulator_t* sim) {
+
+    const uint32_t generation = sim->barrier_generation.load(std::memory_order_acquire);
+
+    if(sim->barrier_arrived.fetch_add(1u, std::memory_order_acq_rel) + 1u == sim->threads) {
+        sim->barrier_arrived.store(0u, std::memory_order_relaxed);
+        sim->barrier_generation.store(generation + 1u, std::memory_order_release);
+        return;
+    }
+
+    // more threads than cores would spin away the time slice of the one
+    // everybody waits for
+    for(size_t spins = 0ul; sim->barrier_generation.load(std::memory_order_acquire) == generation; spins++)
+        if(spins >= 4096ul)
+            std::this_thread::yield();
+}
+
+template<typename W>
+static void sim_eval_levels(simulator_t* sim, W* v) {
+
+    if(sim->threads == 1ul) {
+        sim_eval_runs<W>(sim, v, 0u, (uint32_t)sim->runs.size());
+    } else {
+        // the end of the team is the barrier after the last phase
+        thread_pool_run_team(sim->pool, [sim, v](size_t t) {
+            for(size_t p = 0ul; p < sim->phases; p++) {
+                if(p > 0ul)
+                    sim_barrier(sim);
+                const size_t k = p * sim->threads + t;
+                sim_eval_runs<W>(sim, v, sim->team_offsets[k], sim->team_offsets[k + 1ul]);
+            }
+        });
+    }
+
+    sim->stats.gate_evals += sim->loop_first;
+}
+
+//
+// gates [first, last), returns true if any output changed
+//
+template<typename W>
+static bool sim_eval_gates(simulator_t* sim, W* v, uint32_t first, uint32_t last) {
+
+    const net_t* fanin = sim->fanin.data();
+    const uint32_t* offsets = sim->fanin_offsets.data();
+
+    W changed = (W)0u;
+    for(uint32_t i = first; i < last; i++) {
+        const W r = sim_gate<W>(static_cast<gate_type_t>(sim->types[i]), v, fanin + offsets[i], fanin + offsets[i + 1u]);
+        changed |= r ^ v[sim->gate_slot + i];
+        v[sim->gate_slot + i] = r;
+    }
+
+    sim->stats.gate_evals += last - first;
+    return changed != (W)0u;
+}
+
+//
+// returns false if a loop kept changing
+//
+template<typename W>
+static bool sim_eval_combinational(simulator_t* sim, W* v) {
+
+    sim_eval_levels<W>(sim, v);
+
+    // every pass settles at least one more gate of an acyclic tail, a loop
+    // that is still changing after that oscillates
+    const uint32_t last = (uint32_t)sim->types.size();
+    for(uint32_t pass = sim->loop_first; pass <= last; pass++)
+        if(!sim_eval_gates<W>(sim, v, sim->loop_first, last))
+            return true;
+    return false;
+}
+
+//
+// event engine. runs the wheel until nothing is due, returns false if it
+// was still going after every gate could have changed once per delay
+//
+template<typename W>
+static bool sim_eval_events(simulator_t* sim, W* v) {
+
+    const net_t* fanin = sim->fanin.data();
+    const uint32_t* offsets = sim->fanin_offsets.data();
+    const size_t mask = sim->wheel.size() - 1ul;
+
+    const uint64_t start = sim->time;
+    const uint64_t limit = start + (sim->types.size() + 1ul) * sim->wheel.size();
+
+    sim->stats.settles++;
+
+    for(net_t n : sim->changed)
+        sim_schedule_fanout(sim, n);
+    sim->changed.clear();
+
+    uint64_t last_event = start;
+
+    while(sim->pending > 0ul) {
+
+        if(sim->time > limit) {
+            sim_reset_wheel(sim);
+            return false;
+        }
+
+        std::vector<uint32_t>& bucket = sim->wheel[sim->time & mask];
+
+        // gates scheduled from here land in later buckets, every delay is
+        // at least 1 and less than the size of the wheel
+        for(uint32_t i : bucket) {
+            const W r = sim_gate<W>(static_cast<gate_type_t>(sim->types[i]), v, fanin + offsets[i], fanin + offsets[i + 1u]);
+            const net_t out = sim->gate_slot + i;
+            if(r != v[out]) {
+                v[out] = r;
+                sim_schedule_fanout(sim, out);
+            }
+        }
+
+        if(!bucket.empty())
+            last_event = sim->time;
+
+        sim->stats.gate_evals += bucket.size();
+        sim->pending -= bucket.size();
+        bucket.clear();
+        sim->time++;
+    }
+
+    sim->stats.settle_time = std::max(sim->stats.settle_time, (size_t)(last_event - start));
+    return true;
+}
+
+template<typename W>
+static bool sim_settle(simulator_t* sim, W* v) {
+    if(sim->compiled_settle != NULL)
+        return sim->compiled_settle(v, &sim->stats.gate_evals) != 0;
+    if(sim->engine == simulate_engine_t::event)
+        return sim_eval_events<W>(sim, v);
+    return sim_eval_combinational<W>(sim, v);
+}
+
+//
+// every flipflop whose clock rose takes its d input, all of them sampled
+// before any changes. returns the flipflops that changed, per pattern
+//
+template<typename W>
+static size_t sim_clock(simulator_t* sim, W* v) {
+
+    const size_t n_ff = sim->ff_q.size();
+
+    for(size_t i = 0ul; i < n_ff; i++) {
+        const uint64_t clk  = v[sim->ff_clk[i]];
+        const uint64_t edge = clk & ~sim->ff_clk_last[i];
+        sim->ff_next[i] = (edge & v[sim->ff_d[i]]) | (~edge & v[sim->ff_q[i]]);
+        sim->ff_clk_last[i] = clk;
+    }
+
+    size_t updates = 0ul;
+    for(size_t i = 0ul; i < n_ff; i++) {
+        const W next = (W)sim->ff_next[i];
+        const size_t differing = sim_lanes_differing(next, v[sim->ff_q[i]]);
+        if(differing == 0ul)
+            continue;
+        updates += differing;
+        v[sim->ff_q[i]] = next;
+        if(sim->engine == simulate_engine_t::event)
+            sim_schedule_fanout(sim, sim->ff_q[i]);
+    }
+
+    return updates;
+}
+
+template<typename W>
+static void sim_eval(simulator_t* sim, W* v) {
+
+    const size_t n_ff = sim->ff_q.size();
+
+    bool settled = sim_settle<W>(sim, v);
+
+    // a chain of flipflops clocking each other settles one flipflop per pass
+    for(size_t pass = 0ul; pass <= n_ff; pass++) {
+
+        const size_t updates = sim->compiled_clock != NULL ?
+                sim->compiled_clock(v, sim->ff_clk_last.data(), sim->ff_next.data()) : sim_clock<W>(sim, v);
+        if(updates == 0ul)
+            break;
+
+        sim->stats.flipflop_updates += updates;
+        settled = sim_settle<W>(sim, v) && settled;
+
+        if(pass == n_ff)
+            settled = false;
+    }
+
+    if(!settled)
+        sim->stats.unsettled++;
+}
+
+//
+// four state logic, see simulate_logic_t. every function works on the value
+// plane v and the unknown plane u of the same nets. a pattern of a net is
+// known 1 where v & ~u and known 0 where ~v & ~u
+//
+
+//
+// the bus kernel. a driver that is Z leaves the bus alone, one that is X or
+// disagrees with another makes it X, the bus is Z while all of them are
+//
+template<typename W>
+static inline void sim_bus4(const W* v, const W* u, const net_t* in, const net_t* end, W& ov, W& ou) {
+
+    W any0 = (W)0u, any1 = (W)0u, anyx = (W)0u, allz = (W)~(W)0u;
+    for(; in != end; in++) {
+        const W a = v[*in], b = u[*in];
+        any0 |= (W)(~a & ~b);
+        any1 |= (W)(a & ~b);
+        anyx |= (W)(~a & b);
+        allz &= (W)(a & b);
+    }
+
+    const W conflict = (W)(anyx | (any0 & any1));
+    ov = (W)((any1 & ~conflict) | allz);
+    ou = (W)(conflict | allz);
+}
+
+template<typename W>
+static inline void sim_gate4(gate_type_t type, const W* v, const W* u, const net_t* in, const net_t* end, W& ov, W& ou) {
+
+    W one, zero, invert = (W)0u;
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wswitch-enum"
+    switch(type) {
+    case gate_type_t::not_:
+        ov = (W)(~v[in[0]] & ~u[in[0]]);
+        ou = u[in[0]];
+        return;
+    case gate_type_t::nand:
+        invert = (W)~(W)0u; // fall through
+    case gate_type_t::and_:
+        // 1 if every input is, 0 if any input is
+        one = (W)~(W)0u, zero = (W)0u;
+        for(; in != end; in++) {
+            one  &= (W)(v[*in] & ~u[*in]);
+            zero |= (W)(~v[*in] & ~u[*in]);
+        }
+        break;
+    case gate_type_t::nor_:
+        invert = (W)~(W)0u; // fall through
+    case gate_type_t::or_:
+        one = (W)0u, zero = (W)~(W)0u;
+        for(; in != end; in++) {
+            one  |= (W)(v[*in] & ~u[*in]);
+            zero &= (W)(~v[*in] & ~u[*in]);
+        }
+        break;
+    case gate_type_t::xnor_:
+        invert = (W)~(W)0u; // fall through
+    case gate_type_t::xor_:
+        // unknown if any input is
+        one = (W)0u, zero = (W)0u;
+        for(; in != end; in++) {
+            one  ^= v[*in];
+            zero |= u[*in];
+        }
+        ov = (W)((one ^ invert) & ~zero);
+        ou = zero;
+        return;
+    case gate_type_t::tristate: {
+        // data while enabled, Z while disabled, X when the enable is not known
+        const W on  = (W)(v[in[1]] & ~u[in[1]]);
+        const W off = (W)(~v[in[1]] & ~u[in[1]]);
+        ov = (W)((on & v[in[0]] & ~u[in[0]]) | off);
+        ou = (W)((on & u[in[0]]) | off | u[in[1]]);
+        return;
+    }
+    case gate_type_t::bus:
+        sim_bus4<W>(v, u, in, end, ov, ou);
+        return;
+    default:
+        INTERNAL_ERR();
+    }
+    #pragma GCC diagnostic pop
+
+    ov = (W)((invert & zero) | (~invert & one));
+    ou = (W)(~one & ~zero);
+}
+
+//
+// gates [first, last) of one type. the type is a template argument so the
+// switch of sim_gate4 folds away
+//
+template<typename W, gate_type_t type>
+static void sim_run4(const simulator_t* sim, W* v, W* u, uint32_t first, uint32_t last) {
+
+    const net_t* fanin = sim->fanin.data();
+    const uint32_t* offsets = sim->fanin_offsets.data();
+
+    for(uint32_t i = first; i < last; i++)
+        sim_gate4<W>(type, v, u, fanin + offsets[i], fanin + offsets[i + 1u], v[sim->gate_slot + i], u[sim->gate_slot + i]);
+}
+
+template<typename W>
+static void sim_eval_runs4(const simulator_t* sim, W* v, W* u, uint32_t first, uint32_t last) {
+
+    for(uint32_t r = first; r < last; r++) {
+        const simulate_run_t& run = sim->runs[r];
+
+        #pragma GCC diagnostic push
+        #pragma GCC diagnostic ignored "-Wswitch-enum"
+        switch(static_cast<gate_type_t>(run.type)) {
+        case gate_type_t::not_:     sim_run4<W, gate_type_t::not_>(sim, v, u, run.first, run.last);     break;
+        case gate_type_t::and_:     sim_run4<W, gate_type_t::and_>(sim, v, u, run.first, run.last);     break;
+        case gate_type_t::nand:     sim_run4<W, gate_type_t::nand>(sim, v, u, run.first, run.last);     break;
+        case gate_type_t::or_:      sim_run4<W, gate_type_t::or_>(sim, v, u, run.first, run.last);      break;
+        case gate_type_t::nor_:     sim_run4<W, gate_type_t::nor_>(sim, v, u, run.first, run.last);     break;
+        case gate_type_t::xor_:     sim_run4<W, gate_type_t::xor_>(sim, v, u, run.first, run.last);     break;
+        case gate_type_t::xnor_:    sim_run4<W, gate_type_t::xnor_>(sim, v, u, run.first, run.last);    break;
+        case gate_type_t::tristate: sim_run4<W, gate_type_t::tristate>(sim, v, u, run.first, run.last); break;
+        case gate_type_t::bus:      sim_run4<W, gate_type_t::bus>(sim, v, u, run.first, run.last);      break;
+        default:
+            INTERNAL_ERR();
+        }
+        #pragma GCC diagnostic pop
+    }
+}
+
+//
+// four state sim_settle, returns false if a loop kept changing
+//
+template<typename W>
+static bool sim_settle4(simulator_t* sim, W* v, W* u) {
+
+    if(sim->threads == 1ul) {
+        sim_eval_runs4<W>(sim, v, u, 0u, (uint32_t)sim->runs.size());
+    } else {
+        thread_pool_run_team(sim->pool, [sim, v, u](size_t t) {
+            for(size_t p = 0ul; p < sim->phases; p++) {
+                if(p > 0ul)
+                    sim_barrier(sim);
+                const size_t k = p * sim->threads + t;
+                sim_eval_runs4<W>(sim, v, u, sim->team_offsets[k], sim->team_offsets[k + 1ul]);
+            }
+        });
+    }
+    sim->stats.gate_evals += sim->loop_first;
+
+    const net_t* fanin = sim->fanin.data();
+    const uint32_t* offsets = sim->fanin_offsets.data();
+    const uint32_t last = (uint32_t)sim->types.size();
+
+    for(uint32_t pass = sim->loop_first; pass <= last; pass++) {
+        W changed = (W)0u;
+        for(uint32_t i = sim->loop_first; i < last; i++) {
+            W ov, ou;
+            sim_gate4<W>(static_cast<gate_type_t>(sim->types[i]), v, u, fanin + offsets[i], fanin + offsets[i + 1u], ov, ou);
+            changed |= (W)((ov ^ v[sim->gate_slot + i]) | (ou ^ u[sim->gate_slot + i]));
+            v[sim->gate_slot + i] = ov;
+            u[sim->gate_slot + i] = ou;
+        }
+        sim->stats.gate_evals += last - sim->loop_first;
+        if(changed == (W)0u)
+            return true;
+    }
+    return false;
+}
+
+//
+// four state sim_clock. a clock that went from known 0 to known 1 rose, one
+// that might have (an unknown before or after) makes the flipflop X unless d
+// and q are the same known value
+//
+template<typename W>
+static size_t sim_clock4(simulator_t* sim, W* v, W* u) {
+
+    const size_t n_ff = sim->ff_q.size();
+
+    for(size_t i = 0ul; i < n_ff; i++) {
+        const uint64_t cv = v[sim->ff_clk[i]], cu = u[sim->ff_clk[i]];
+        const uint64_t lv = sim->ff_clk_last[i], lu = sim->ff_clk_last_unknown[i];
+        const uint64_t dv = v[sim->ff_d[i]], du = u[sim->ff_d[i]];
+        const uint64_t qv = v[sim->ff_q[i]], qu = u[sim->ff_q[i]];
+
+        const uint64_t rise  = ~lv & ~lu & cv & ~cu;
+        const uint64_t maybe = ~(lv & ~lu) & (cv | cu) & ~rise;
+        const uint64_t same  = ~du & ~qu & ~(dv ^ qv);
+        const uint64_t hold  = ~rise & ~(maybe & ~same);
+
+        sim->ff_next[i]         = (rise & dv & ~du) | (hold & qv);
+        sim->ff_next_unknown[i] = (rise & du) | (maybe & ~same) | (hold & qu);
+        sim->ff_clk_last[i]         = cv;
+        sim->ff_clk_last_unknown[i] = cu;
+    }
+
+    size_t updates = 0ul;
+    for(size_t i = 0ul; i < n_ff; i++) {
+        const W nv = (W)sim->ff_next[i], nu = (W)sim->ff_next_unknown[i];
+        const net_t q = sim->ff_q[i];
+        updates += sim_lanes_differing((W)((nv ^ v[q]) | (nu ^ u[q])), (W)0u);
+        v[q] = nv;
+        u[q] = nu;
+    }
+
+    return updates;
+}
+
+template<typename W>
+static void sim_eval4(simulator_t* sim, W* v, W* u) {
+
+    const size_t n_ff = sim->ff_q.size();
+
+    bool settled = sim_settle4<W>(sim, v, u);
+
+    for(size_t pass = 0ul; pass <= n_ff; pass++) {
+        const size_t updates = sim_clock4<W>(sim, v, u);
+        if(updates == 0ul)
+            break;
+
+        sim->stats.flipflop_updates += updates;
+        settled = sim_settle4<W>(sim, v, u) && settled;
+
+        if(pass == n_ff)
+            settled = false;
+    }
+
+    if(!settled)
+        sim->stats.unsettled++;
+}
+
+void simulator_eval(simulator_t* sim) {
+
+    sim->stats.evals++;
+
+    if(sim->logic == simulate_logic_t::four_state) {
+        if(sim->width == simulate_width_t::parallel64)
+            sim_eval4<uint64_t>(sim, sim->words.data(), sim->unknown_words.data());
+        else
+            sim_eval4<uint8_t>(sim, sim->values.data(), sim->unknowns.data());
+        return;
+    }
+
+    if(sim->width == simulate_width_t::parallel64)
+        sim_eval<uint64_t>(sim, sim->words.data());
+    else
+        sim_eval<uint8_t>(sim, sim->values.data());
+}
+
+std::ostream& operator<<(std::ostream& os, const simulator_t& sim) {
+
+    const size_t n_loop = sim.types.size() - sim.loop_first;
+
+    os << "simulate : " << simulator_level_count(&sim) << " levels, " << sim.runs.size() << " runs, " << sim.loop_first << " gates in levels, "
+       << n_loop << " on loops, " << sim.ff_q.size() << " flipflops, " << simulator_patterns(&sim) << " patterns at once\n";
+    if(sim.threads > 1ul)
+        os << "    threads : " << sim.threads << " partitions, " << sim.phases << " phases between barriers, "
+           << sim.cross_nets << " nets read by another partition\n";
+    os << "    " << sim.stats.evals << " evals, " << sim.stats.gate_evals << " gate evaluations, "
+       << sim.stats.flipflop_updates << " flipflop updates";
+    if(sim.stats.unsettled > 0ul)
+        os << ", " << sim.stats.unsettled << " evals did not settle";
+    os << "\n";
+
+    if(sim.engine == simulate_engine_t::event) {
+        const size_t levelized = sim.stats.settles * sim.types.size();
+        os << "    events : " << sim.stats.gate_evals << " processed, "
+           << (levelized > sim.stats.gate_evals ? levelized - sim.stats.gate_evals : 0ul)
+           << " gates skipped against a full pass per settle, longest settle " << sim.stats.settle_time << " time units\n";
+    }
+
+    return os;
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include <src/runtime/netlist.h>
+#include <src/runtime/simulate-simd.h>
+#include <src/thread-pool.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <iostream>
+
+//
+// two state, zero delay simulation of a finalized netlist. the combinational
+// gates are sorted into levels once, a gate only reads nets of lower levels,
+// and every evaluation runs the levels in order over one flat array holding
+// the value of each net
+//
+// flipflops are state, their output nets keep their value while the
+// combinational logic is evaluated. when the clock of a flipflop goes from 0
+// to 1 it takes the value its d input had just before the edge, all flipflops
+// clocked at the same time sample together. a flipflop clocked by another
+// flipflop (a ripple counter) updates in the same simulator_eval
+//
+// a tristate reads as data while enabled and 0 otherwise, a bus is the or of
+// its tristates. undriven nets read 0
+//
+// gates on a combinational loop are evaluated after the levels, again and
+// again until they stop changing
+//
+// within a level the gates of one type that have two inputs (one for not)
+// form a run, evaluated by one call of a simulate-simd.h kernel. the
+// simulator numbers the nets so the outputs of a run are consecutive
+//
+// the parallel width runs 64 independent patterns at once. every net holds a
+// 64 bit word, bit k belongs to pattern k, and one bitwise operation
+// evaluates a gate for all of them. flipflops keep separate state per
+// pattern. evaluation takes about as long as for one pattern, pokes and
+// peeks of single values go to every pattern and come from pattern 0
+//
+// given a thread pool the levelized engine splits the levels over its
+// threads. every gate belongs to the partition of one thread, mostly the one
+// its inputs come from, so a cone tends to stay on one thread. consecutive
+// levels form a phase as long as no gate reads a gate of another partition
+// from the same phase, the threads only meet at a barrier between phases.
+// every gate still reads the same values as with one thread, the results
+// are the same bit for bit
+//
+
+enum class simulate_width_t {
+    scalar,     // one pattern, a byte per net
+    parallel64, // 64 patterns, a 64 bit word per net
+};
+
+//
+// four state logic keeps a second plane next to the values, a set bit in it
+// means the value of the net is not known. a pattern of a net is
+//
+//     0 : value 0, unknown 0      X : value 0, unknown 1
+//     1 : value 1, unknown 0      Z : value 1, unknown 1
+//
+// every gate is a few bitwise operations over both planes, without branches,
+// so both widths work the same. gates read Z as X. a tristate drives its
+// data while enabled, Z while disabled and X if the enable is not known. a
+// bus is Z while every tristate on it is, the one value driven if the others
+// are Z or agree, and X otherwise. undriven nets are Z, flipflops start out
+// as X and take X when their clock might have risen and d differs from q.
+// inputs still start at 0
+//
+// a netlist swept for two states has lost the flipflops that never leave 0
+// there, they would be X here. sweep with four_state for this logic, the
+// driver does with --sim-4state
+//
+// only the levelized engine, not compiled, has four states. twice the
+// memory and about three times the operations per gate, but it stays
+// within 1.5 times the time of two states on the designs measured, loads
+// and the walk over the runs cost the same
+//
+enum class simulate_logic_t {
+    two_state,
+    four_state,
+};
+
+//
+// the event engine only evaluates gates that read a net which changed. it
+// keeps a timing wheel, a ring of buckets one time unit apart each holding
+// the gates due at that time, so scheduling is a push onto a bucket. a gate
+// is evaluated its delay after one of its inputs changed, with the inputs
+// it sees then, and when its output changes the gates reading it are
+// scheduled in turn. flipflops still sample once the logic has settled, so
+// delays decide the order of events and the settle time but not the
+// results, which are the same as the levelized engine's for any design
+// without combinational loops
+//
+enum class simulate_engine_t {
+    levelized, // every gate once per evaluation, in level order
+    event,     // only the gates behind a changed net, through the timing wheel
+};
+
+struct simulate_stats_t {
+    size_t evals            = 0ul; // simulator_eval calls
+    size_t gate_evals       = 0ul; // combinational gates evaluated, once for all patterns
+    size_t flipflop_updates = 0ul; // flipflops that took a new value on a clock edge, per pattern
+    size_t unsettled        = 0ul; // evals where a loop or clock chain never stopped changing
+
+    // event engine
+    size_t settles     = 0ul; // times the logic was settled, a levelized pass each
+    size_t settle_time = 0ul; // longest settle in time units
+};
+
+//
+// gates [first, last) of one level, all of the same type
+//
+struct simulate_run_t {
+    uint8_t  type   = 0u;
+    bool     kernel = false; // every gate has two inputs, one for not
+    uint32_t first  = 0u;
+    uint32_t last   = 0u;
+};
+
+struct simulator_t {
+    const netlist_t* nl = NULL;
+    simulate_width_t  width  = simulate_width_t::scalar;
+    simulate_engine_t engine = simulate_engine_t::levelized;
+    simulate_logic_t  logic  = simulate_logic_t::two_state;
+
+    // the simulator numbers nets its own way. nets no gate drives keep their
+    // number, the flipflop outputs come next and the outputs of the
+    // combinational gates last, in the order below. all net numbers from here
+    // on are these, port_slots[i] stands for nl->port_nets[i] and net_slots[n]
+    // for net n of the netlist
+    std::vector<net_t> port_slots;
+    std::vector<net_t> net_slots;
+    net_t gate_slot = 0u; // output of gate i
+
+    // combinational gates in level order. gate i has type types[i] and reads
+    // fanin[fanin_offsets[i] .. fanin_offsets[i + 1])
+    std::vector<uint8_t>  types;
+    std::vector<uint32_t> fanin_offsets = { 0u };
+    std::vector<net_t>    fanin;
+    std::vector<uint32_t> gate_ids; // gate of the netlist each one stands for
+
+    // gates [0, loop_first) are levelized, the gates on or behind a loop
+    // follow them
+    uint32_t levels     = 0u;
+    uint32_t loop_first = 0u;
+
+    // the levelized gates split into runs, in order. they are sorted by
+    // phase, partition, level and type. the runs of partition t in phase p
+    // are [team_offsets[p * threads + t], team_offsets[p * threads + t + 1])
+    std::vector<simulate_run_t> runs;
+    std::vector<uint32_t> team_offsets = { 0u };
+    thread_pool_t* pool = NULL;
+    size_t threads    = 1ul;
+    size_t phases     = 1ul;
+    size_t cross_nets = 0ul; // gate outputs read by another partition
+    std::atomic<uint32_t> barrier_arrived { 0u };
+    std::atomic<uint32_t> barrier_generation { 0u };
+
+    // a compiled model from simulate-codegen.h, used in place of the runs,
+    // the loop gates and the flipflop loop when set. v is values or words
+    void* compiled = NULL; // dlopen handle
+    int    (*compiled_settle)(void* v, size_t* gate_evals) = NULL;
+    size_t (*compiled_clock)(void* v, uint64_t* clk_last, uint64_t* next) = NULL;
+
+    // flipflop i is driven by ff_d[i] and ff_clk[i] and drives ff_q[i].
+    // ff_clk_last is the clock seen by the last evaluation
+    std::vector<net_t>    ff_d;
+    std::vector<net_t>    ff_clk;
+    std::vector<net_t>    ff_q;
+    std::vector<uint64_t> ff_clk_last;
+    std::vector<uint64_t> ff_clk_last_unknown; // four state only
+    std::vector<uint64_t> ff_next; // scratch
+    std::vector<uint64_t> ff_next_unknown;
+
+    // value of every net, only the one for the width is used. a scalar
+    // value is 0x00 or 0xff so the same bitwise operations work on both
+    std::vector<uint8_t>  values;
+    std::vector<uint64_t> words;
+
+    // unknown plane of the four state logic, for the same width
+    std::vector<uint8_t>  unknowns;
+    std::vector<uint64_t> unknown_words;
+
+    // event engine only. the gates reading net n are
+    // fanout[fanout_offsets[n] .. fanout_offsets[n + 1]), delays[i] is the
+    // delay of gate i. the wheel has a power of two buckets, more than the
+    // longest delay, bucket t & (size - 1) holds the gates due at time t.
+    // scheduled[i] is the last time gate i was scheduled for, plus one.
+    // changed holds the inputs poked since the last evaluation
+    std::vector<uint32_t> fanout_offsets;
+    std::vector<uint32_t> fanout;
+    std::vector<uint32_t> delays;
+    std::vector<std::vector<uint32_t> > wheel;
+    std::vector<uint64_t> scheduled;
+    std::vector<net_t>    changed;
+    uint64_t time    = 0ul;
+    size_t   pending = 0ul; // gates in the wheel
+
+    simulate_stats_t stats;
+};
+
+//
+// builds the levels for nl, which must outlive the simulator. every input
+// starts at 0, every flipflop at 0, or X with four state logic, and the
+// clocks are taken as they are with all inputs at 0. every clock is last
+// seen as 0 before that, so one that reads 1 with the inputs at 0 (tied to
+// true, say) rises then and its flipflop takes d
+//
+// the levelized engine partitions the levels for the threads of pool, which
+// must outlive the simulator too and be idle during simulator_eval. without
+// a pool, or with gates too few to be worth splitting, it runs on the
+// calling thread. the event engine ignores the pool
+//
+// a compiled model has to be unloaded before initializing the simulator
+// again. throws std::runtime_error for four state logic with the event engine
+//
+void simulator_init(
+        simulator_t* sim,
+        const netlist_t& nl,
+        simulate_width_t width   = simulate_width_t::scalar,
+        simulate_engine_t engine = simulate_engine_t::levelized,
+        thread_pool_t* pool      = NULL,
+        simulate_logic_t logic   = simulate_logic_t::two_state);
+
+//
+// delay of every gate for the event engine, indexed by netlist gate id (the
+// entries of flipflops are not used). every gate has a delay of 1 until
+// this is called, delays below 1 count as 1. takes effect at the next
+// simulator_eval, the levelized engine ignores it
+//
+void simulator_set_delays(simulator_t* sim, const std::vector<uint32_t>& gate_delays);
+
+//
+// patterns simulated at once, 1 or 64
+//
+inline size_t simulator_patterns(const simulator_t* sim) {
+    return sim->width == simulate_width_t::parallel64 ? 64ul : 1ul;
+}
+
+inline size_t simulator_level_count(const simulator_t* sim) {
+    return sim->levels;
+}
+
+//
+// port of the top level module by name, throws std::runtime_error if there is none
+//
+const netlist_port_t& simulator_port(const simulator_t* sim, const std::string& name);
+
+//
+// the two state calls below work with four state logic too. a poke sets
+// known values, a peek returns the value plane, X reads as 0 and Z as 1
+//
+
+//
+// sets the bits of an input port, bit 0 of value goes to bit 0 of the port.
+// bits past 64 are set to 0. the new values take effect at the next
+// simulator_eval. nets of the port that are tied to a constant are left alone
+//
+void simulator_poke(simulator_t* sim, const netlist_port_t& port, uint64_t value);
+void simulator_poke_bit(simulator_t* sim, const netlist_port_t& port, size_t bit, bool value);
+
+//
+// bits of any port as of the last simulator_eval, at most the first 64
+//
+uint64_t simulator_peek(const simulator_t* sim, const netlist_port_t& port);
+bool simulator_peek_bit(const simulator_t* sim, const netlist_port_t& port, size_t bit);
+
+//
+// one bit of a port in every pattern at once, bit k of lanes is pattern k.
+// the scalar width only uses bit 0
+//
+void simulator_poke_lanes(simulator_t* sim, const netlist_port_t& port, size_t bit, uint64_t lanes);
+uint64_t simulator_peek_lanes(const simulator_t* sim, const netlist_port_t& port, size_t bit);
+
+//
+// both planes of one bit of a port, see simulate_logic_t. with two state
+// logic unknown has to be 0 and comes back 0
+//
+void simulator_poke_state(simulator_t* sim, const netlist_port_t& port, size_t bit, uint64_t value, uint64_t unknown);
+void simulator_peek_state(const simulator_t* sim, const netlist_port_t& port, size_t bit, uint64_t* value, uint64_t* unknown);
+
+//
+// '0', '1', 'x' or 'z' for one bit of a port in one pattern
+//
+char simulator_peek_char(const simulator_t* sim, const netlist_port_t& port, size_t bit, size_t pattern = 0ul);
+
+//
+// batches. patterns[k] is the value of the port in pattern k, bit 0 of the
+// port in bit 0, for the first 64 bits of the port. there are
+// simulator_patterns of them
+//
+void simulator_poke_patterns(simulator_t* sim, const netlist_port_t& port, const uint64_t* patterns);
+void simulator_peek_patterns(const simulator_t* sim, const netlist_port_t& port, uint64_t* patterns);
+
+//
+// evaluates the combinational logic for the current inputs, then updates
+// the flipflops whose clock rose and evaluates again, until no flipflop
+// changes
+//
+void simulator_eval(simulator_t* sim);
+
+std::ostream& operator<<(std::ostream& os, const simulator_t& sim);
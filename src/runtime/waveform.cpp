@@ -0,0 +1,980 @@
+#include <src/runtime/waveform.h>
+#include <src/runtime/simulate-vcd.h>
+#include <src/runtime/simulate.h>
+#include <src/error-util.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <queue>
+#include <sstream>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iomanip>
+#include <utility>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+
+static const char     wave_magic[8]    = { 'C', 'H', 'D', 'L', 'W', 'A', 'V', 'E' };
+static const char     wave_end_magic[8] = { 'C', 'H', 'D', 'L', 'W', 'E', 'N', 'D' };
+static const uint32_t wave_version     = 1u;
+static const uint32_t wave_four_state  = 1u;
+
+static const char wave_chars[4] = { '0', '1', 'x', 'z' };
+
+//
+// bytes
+//
+
+static void wave_put_u32(std::vector<uint8_t>& out, uint32_t x) {
+    for(size_t i = 0ul; i < 4ul; i++, x >>= 8)
+        out.push_back((uint8_t)x);
+}
+
+static void wave_put_u64(std::vector<uint8_t>& out, uint64_t x) {
+    for(size_t i = 0ul; i < 8ul; i++, x >>= 8)
+        out.push_back((uint8_t)x);
+}
+
+static void wave_put_string(std::vector<uint8_t>& out, const std::string& s) {
+    wave_put_u32(out, (uint32_t)s.size());
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+static void wave_put_varint(std::vector<uint8_t>& out, uint64_t x) {
+    while(x >= 0x80ul) {
+        out.push_back((uint8_t)(x | 0x80ul));
+        x >>= 7;
+    }
+    out.push_back((uint8_t)x);
+}
+
+//
+// reads with bounds checks, a short read throws
+//
+struct wave_input_t {
+    const uint8_t* p;
+    const uint8_t* end;
+};
+
+[[noreturn]] static void wave_corrupt(void) {
+    throw std::runtime_error("waveform file is corrupt or cut short");
+}
+
+static uint64_t wave_get(wave_input_t& in, size_t bytes) {
+    if((size_t)(in.end - in.p) < bytes)
+        wave_corrupt();
+    uint64_t x = 0ul;
+    for(size_t i = 0ul; i < bytes; i++)
+        x |= (uint64_t)*in.p++ << (8ul * i);
+    return x;
+}
+
+static std::string wave_get_string(wave_input_t& in) {
+    const size_t n = (size_t)wave_get(in, 4ul);
+    if((size_t)(in.end - in.p) < n)
+        wave_corrupt();
+    std::string s((const char*)in.p, n);
+    in.p += n;
+    return s;
+}
+
+static uint64_t wave_get_varint(wave_input_t& in) {
+    uint64_t x = 0ul;
+    for(unsigned shift = 0u; shift < 64u; shift += 7u) {
+        if(in.p == in.end)
+            wave_corrupt();
+        const uint8_t b = *in.p++;
+        x |= (uint64_t)(b & 0x7fu) << shift;
+        if((b & 0x80u) == 0u)
+            return x;
+    }
+    wave_corrupt();
+}
+
+//
+// block compression, see the top of waveform.h
+//
+
+static inline uint32_t wave_load32(const uint8_t* p) {
+    uint32_t x;
+    memcpy(&x, p, 4ul);
+    return x;
+}
+
+static void wave_put_length(std::vector<uint8_t>& out, size_t n) {
+    for(; n >= 255ul; n -= 255ul)
+        out.push_back(255u);
+    out.push_back((uint8_t)n);
+}
+
+static void wave_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t n_literals, size_t offset, size_t match) {
+    const size_t extra = match > 0ul ? match - 4ul : 0ul;
+    out.push_back((uint8_t)(std::min(n_literals, (size_t)15ul) << 4 | std::min(extra, (size_t)15ul)));
+    if(n_literals >= 15ul)
+        wave_put_length(out, n_literals - 15ul);
+    out.insert(out.end(), literals, literals + n_literals);
+    if(match == 0ul)
+        return;
+    out.push_back((uint8_t)offset);
+    out.push_back((uint8_t)(offset >> 8));
+    if(extra >= 15ul)
+        wave_put_length(out, extra - 15ul);
+}
+
+static void wave_compress(const uint8_t* in, size_t n, std::vector<uint8_t>& out) {
+
+    // position + 1 of the last 4 bytes with each hash, 0 for none
+    uint32_t table[4096];
+    memset(table, 0, sizeof(table));
+
+    out.clear();
+    size_t anchor = 0ul;
+    size_t i = 0ul;
+    while(i + 4ul <= n) {
+        const uint32_t seq = wave_load32(in + i);
+        const uint32_t h   = (seq * 2654435761u) >> 20;
+        const size_t cand  = table[h];
+        table[h] = (uint32_t)(i + 1ul);
+
+        if(cand == 0ul || i - (cand - 1ul) > 0xfffful || wave_load32(in + cand - 1ul) != seq) {
+            i++;
+            continue;
+        }
+
+        const size_t from = cand - 1ul;
+        size_t match = 4ul;
+        while(i + match < n && in[from + match] == in[i + match])
+            match++;
+
+        wave_sequence(out, in + anchor, i - anchor, i - from, match);
+        i += match;
+        anchor = i;
+    }
+    wave_sequence(out, in + anchor, n - anchor, 0ul, 0ul);
+}
+
+static void wave_decompress(const uint8_t* in, size_t n, std::vector<uint8_t>& out, size_t raw_bytes) {
+
+    wave_input_t src = { in, in + n };
+    out.clear();
+    out.reserve(raw_bytes);
+
+    auto length = [&src](size_t len) {
+        if(len == 15ul) {
+            uint8_t b;
+            do {
+                b = (uint8_t)wave_get(src, 1ul);
+                len += b;
+            } while(b == 255u);
+        }
+        return len;
+    };
+
+    while(src.p != src.end) {
+        const uint8_t token = (uint8_t)wave_get(src, 1ul);
+
+        const size_t literals = length(token >> 4);
+        if((size_t)(src.end - src.p) < literals || out.size() + literals > raw_bytes)
+            wave_corrupt();
+        out.insert(out.end(), src.p, src.p + literals);
+        src.p += literals;
+        if(src.p == src.end)
+            break;
+
+        const size_t offset = (size_t)wave_get(src, 2ul);
+        const size_t match  = length(token & 0x0fu) + 4ul;
+        if(offset == 0ul || offset > out.size() || out.size() + match > raw_bytes)
+            wave_corrupt();
+
+        // the match may overlap what it copies
+        const size_t from = out.size() - offset;
+        for(size_t k = 0ul; k < match; k++)
+            out.push_back(out[from + k]);
+    }
+
+    if(out.size() != raw_bytes)
+        wave_corrupt();
+}
+
+//
+// writing
+//
+
+static void wave_write(waveform_writer_t* w, const void* p, size_t n) {
+    if(fwrite(p, 1ul, n, w->file) != n)
+        w->failed = true;
+    w->offset += n;
+}
+
+static void wave_flush_block(waveform_writer_t* w, waveform_writer_signal_t& sig) {
+
+    if(sig.changes == 0u)
+        return;
+
+    wave_compress(sig.raw.data(), sig.raw.size(), w->scratch);
+    const bool stored = w->scratch.size() >= sig.raw.size();
+    const std::vector<uint8_t>& data = stored ? sig.raw : w->scratch;
+
+    waveform_block_t block;
+    block.first_time = sig.block_time;
+    block.last_time  = sig.last_time;
+    block.offset     = w->offset;
+    block.bytes      = (uint32_t)data.size();
+    block.raw_bytes  = (uint32_t)sig.raw.size();
+    block.changes    = sig.changes;
+    sig.blocks.push_back(block);
+
+    wave_write(w, data.data(), data.size());
+
+    w->stats.blocks++;
+    w->stats.raw_bytes += sig.raw.size();
+    sig.raw.clear();
+    sig.changes = 0u;
+}
+
+void waveform_open(waveform_writer_t* w, const std::string& path, bool four_state, const std::string& timescale) {
+
+    if(w->file != NULL)
+        throw std::runtime_error("the waveform is already open");
+
+    w->file = fopen(path.c_str(), "wb");
+    if(w->file == NULL)
+        throw std::runtime_error("can not create '" + path + "'");
+
+    w->failed     = false;
+    w->four_state = four_state;
+    w->offset     = 0ul;
+    w->time       = 0ul;
+    w->sampled    = false;
+    w->signals.clear();
+    w->sim   = NULL;
+    w->stats = waveform_stats_t();
+
+    std::vector<uint8_t> header(wave_magic, wave_magic + 8);
+    wave_put_u32(header, wave_version);
+    wave_put_u32(header, four_state ? wave_four_state : 0u);
+    wave_put_string(header, timescale);
+    wave_write(w, header.data(), header.size());
+}
+
+uint32_t waveform_add_signal(waveform_writer_t* w, const std::string& scope, const std::string& name, uint32_t width) {
+
+    if(width == 0u)
+        throw std::runtime_error("waveform signal '" + name + "' has no bits");
+
+    waveform_writer_signal_t sig;
+    sig.info.scope = scope;
+    sig.info.name  = name;
+    sig.info.width = width;
+    sig.last.assign(2ul * ((width + 63ul) / 64ul), 0ul);
+    sig.xored.assign(sig.last.size(), 0ul);
+    w->signals.push_back(sig);
+    return (uint32_t)w->signals.size() - 1u;
+}
+
+//
+// the change of a single bit signal to value | unknown << 1, which differs
+// from the last one
+//
+static inline void wave_change_bit(waveform_writer_t* w, waveform_writer_signal_t& sig, uint64_t time, uint64_t code) {
+
+    if(sig.changes == 0u) {
+        sig.block_time = time;
+        sig.last_time  = time;
+    }
+    wave_put_varint(sig.raw, (time - sig.last_time) << 2 | code);
+
+    sig.last[0]   = code & 1ul;
+    sig.last[1]   = code >> 1;
+    sig.valued    = true;
+    sig.last_time = time;
+    sig.changes++;
+    w->stats.changes++;
+
+    if(sig.raw.size() >= w->block_bytes)
+        wave_flush_block(w, sig);
+}
+
+void waveform_change(waveform_writer_t* w, uint32_t signal, uint64_t time, const uint64_t* value, const uint64_t* unknown) {
+
+    waveform_writer_signal_t& sig = w->signals[signal];
+    const uint32_t width = sig.info.width;
+    const size_t words   = (width + 63ul) / 64ul;
+
+    // bits past the width are left out, they are not part of the value
+    auto mask = [width](size_t k) {
+        const size_t bits = std::min((size_t)width - 64ul * k, (size_t)64ul);
+        return bits == 64ul ? ~0ul : (1ul << bits) - 1ul;
+    };
+    auto unknown_word = [&](size_t k) {
+        return unknown != NULL && w->four_state ? unknown[k] & mask(k) : 0ul;
+    };
+
+    bool same = sig.valued;
+    for(size_t k = 0ul; k < words && same; k++)
+        same = (value[k] & mask(k)) == sig.last[k] && unknown_word(k) == sig.last[words + k];
+    if(same)
+        return;
+
+    if(sig.valued && time < sig.last_time)
+        throw std::runtime_error("waveform time " + std::to_string(time) + " is before " + std::to_string(sig.last_time));
+
+    if(width == 1u) {
+        wave_change_bit(w, sig, time, (value[0] & 1ul) | unknown_word(0ul) << 1);
+        return;
+    }
+
+    for(size_t k = 0ul; k < words; k++) {
+        sig.last[k]         = value[k] & mask(k);
+        sig.last[words + k] = unknown_word(k);
+    }
+
+    if(sig.changes == 0u) {
+        sig.block_time = time;
+        sig.last_time  = time;
+        std::fill(sig.xored.begin(), sig.xored.end(), 0ul);
+    }
+    wave_put_varint(sig.raw, time - sig.last_time);
+    const size_t bytes = (width + 7ul) / 8ul;
+    for(size_t plane = 0ul; plane < (w->four_state ? 2ul : 1ul); plane++) {
+        const uint64_t* now = sig.last.data() + plane * words;
+        uint64_t* before    = sig.xored.data() + plane * words;
+        for(size_t j = 0ul; j < bytes; j++)
+            sig.raw.push_back((uint8_t)((now[j / 8ul] ^ before[j / 8ul]) >> (8ul * (j % 8ul))));
+        std::copy(now, now + words, before);
+    }
+
+    sig.valued    = true;
+    sig.last_time = time;
+    sig.changes++;
+    w->stats.changes++;
+
+    if(sig.raw.size() >= w->block_bytes)
+        wave_flush_block(w, sig);
+}
+
+void waveform_close(waveform_writer_t* w) {
+
+    if(w->file == NULL)
+        return;
+
+    for(waveform_writer_signal_t& sig : w->signals)
+        wave_flush_block(w, sig);
+
+    const uint64_t footer_offset = w->offset;
+
+    std::vector<uint8_t> footer;
+    wave_put_u32(footer, (uint32_t)w->signals.size());
+    uint32_t first_block = 0u;
+    for(const waveform_writer_signal_t& sig : w->signals) {
+        wave_put_string(footer, sig.info.scope);
+        wave_put_string(footer, sig.info.name);
+        wave_put_u32(footer, sig.info.width);
+        wave_put_u32(footer, first_block);
+        wave_put_u32(footer, (uint32_t)sig.blocks.size());
+        first_block += (uint32_t)sig.blocks.size();
+    }
+
+    wave_put_u64(footer, first_block);
+    for(const waveform_writer_signal_t& sig : w->signals) {
+        for(const waveform_block_t& b : sig.blocks) {
+            wave_put_u64(footer, b.first_time);
+            wave_put_u64(footer, b.last_time);
+            wave_put_u64(footer, b.offset);
+            wave_put_u32(footer, b.bytes);
+            wave_put_u32(footer, b.raw_bytes);
+            wave_put_u32(footer, b.changes);
+        }
+    }
+    wave_put_u64(footer, w->time);
+
+    wave_put_u64(footer, footer_offset);
+    footer.insert(footer.end(), wave_end_magic, wave_end_magic + 8);
+    wave_write(w, footer.data(), footer.size());
+
+    if(fclose(w->file) != 0)
+        w->failed = true;
+    w->file = NULL;
+    w->stats.bytes = w->offset;
+
+    // the index of a closed file is no use to anyone
+    w->signals.clear();
+    w->signals.shrink_to_fit();
+
+    if(w->failed)
+        throw std::runtime_error("writing the waveform failed");
+}
+
+waveform_writer_t::~waveform_writer_t() {
+    if(this->file != NULL)
+        fclose(this->file);
+}
+
+void waveform_open_simulator(waveform_writer_t* w, const simulator_t* sim, const std::string& path, const simulate_vcd_options_t& opts) {
+
+    if(opts.pattern >= simulator_patterns(sim))
+        throw std::runtime_error("there is no pattern " + std::to_string(opts.pattern) + " to record");
+
+    std::vector<simulate_vcd_var_t> vars;
+    std::vector<net_t> bits;
+    simulate_vcd_select(sim, opts, vars, bits);
+
+    waveform_open(w, path, sim->logic == simulate_logic_t::four_state, opts.timescale);
+    for(const simulate_vcd_var_t& var : vars)
+        waveform_add_signal(w, var.scope, var.name, var.width);
+
+    w->sim     = sim;
+    w->pattern = opts.pattern;
+    w->bits.swap(bits);
+}
+
+template<bool wide, bool four_state>
+static void wave_sample(waveform_writer_t* w, uint64_t time) {
+
+    const simulator_t* sim = w->sim;
+    const size_t p = w->pattern;
+    const net_t* nets = w->bits.data();
+
+    for(uint32_t s = 0u; s < w->signals.size(); s++) {
+        waveform_writer_signal_t& sig = w->signals[s];
+        const uint32_t width = sig.info.width;
+        const size_t words   = (width + 63ul) / 64ul;
+
+        // most signals are single bits that did not change
+        if(width == 1u && sig.valued) {
+            const net_t n = *nets;
+            const uint64_t v = wide ? (sim->words[n] >> p) & 1ul : sim->values[n] & 1ul;
+            const uint64_t u = !four_state ? 0ul : wide ? (sim->unknown_words[n] >> p) & 1ul : sim->unknowns[n] & 1ul;
+            nets++;
+            if(v != sig.last[0] || u != sig.last[1])
+                wave_change_bit(w, sig, time, v | u << 1);
+            continue;
+        }
+
+        w->now.assign(2ul * words, 0ul);
+        uint64_t* value   = w->now.data();
+        uint64_t* unknown = value + words;
+
+        for(uint32_t b = 0u; b < width; b++) {
+            const net_t n = nets[b];
+            const uint64_t v = wide ? (sim->words[n] >> p) & 1ul : sim->values[n] & 1ul;
+            value[b / 64u] |= v << (b % 64u);
+            if(four_state) {
+                const uint64_t u = wide ? (sim->unknown_words[n] >> p) & 1ul : sim->unknowns[n] & 1ul;
+                unknown[b / 64u] |= u << (b % 64u);
+            }
+        }
+        nets += width;
+
+        waveform_change(w, s, time, value, unknown);
+    }
+}
+
+void waveform_sample(waveform_writer_t* w, uint64_t time) {
+
+    if(w->sim == NULL || w->file == NULL)
+        throw std::runtime_error("the waveform is not recording a simulation");
+    if(w->sampled && time < w->time)
+        throw std::runtime_error("waveform time " + std::to_string(time) + " is before " + std::to_string(w->time));
+
+    const auto start = std::chrono::steady_clock::now();
+
+    const bool wide = w->sim->width == simulate_width_t::parallel64;
+    if(wide)
+        w->four_state ? wave_sample<true, true>(w, time) : wave_sample<true, false>(w, time);
+    else
+        w->four_state ? wave_sample<false, true>(w, time) : wave_sample<false, false>(w, time);
+
+    w->sampled = true;
+    w->time    = time;
+    w->stats.samples++;
+    w->stats.sample_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//
+// reading
+//
+
+static void wave_read_at(waveform_reader_t* r, uint64_t offset, size_t n, std::vector<uint8_t>& out) {
+    out.resize(n);
+    if(fseek(r->file, (long)offset, SEEK_SET) != 0 || fread(out.data(), 1ul, n, r->file) != n)
+        wave_corrupt();
+}
+
+void waveform_read_open(waveform_reader_t* r, const std::string& path) {
+
+    waveform_read_close(r);
+
+    r->file = fopen(path.c_str(), "rb");
+    if(r->file == NULL)
+        throw std::runtime_error("can not open '" + path + "'");
+
+    r->signals.clear();
+    r->blocks.clear();
+    r->bytes_read  = 0ul;
+    r->blocks_read = 0ul;
+
+    if(fseek(r->file, 0l, SEEK_END) != 0)
+        throw std::runtime_error("can not read '" + path + "'");
+    const long size = ftell(r->file);
+    if(size < 36l)
+        throw std::runtime_error("'" + path + "' is not a waveform file");
+
+    std::vector<uint8_t> bytes;
+    wave_read_at(r, 0ul, 20ul, bytes);
+    if(memcmp(bytes.data(), wave_magic, 8ul) != 0)
+        throw std::runtime_error("'" + path + "' is not a waveform file");
+
+    wave_input_t in = { bytes.data() + 8, bytes.data() + bytes.size() };
+    if(wave_get(in, 4ul) != wave_version)
+        throw std::runtime_error("'" + path + "' is a waveform file of another version");
+    r->four_state = (wave_get(in, 4ul) & wave_four_state) != 0ul;
+
+    // the header and the 16 bytes at the end are all the file has to hold,
+    // a length past that would be allocated before the read fails
+    const uint64_t timescale = wave_get(in, 4ul);
+    if(timescale > (uint64_t)size - 36ul)
+        wave_corrupt();
+    wave_read_at(r, 20ul, (size_t)timescale, bytes);
+    r->timescale.assign(bytes.begin(), bytes.end());
+
+    wave_read_at(r, (uint64_t)size - 16ul, 16ul, bytes);
+    if(memcmp(bytes.data() + 8, wave_end_magic, 8ul) != 0)
+        throw std::runtime_error("'" + path + "' is cut short, it has no footer");
+    in = { bytes.data(), bytes.data() + 8 };
+    const uint64_t footer_offset = wave_get(in, 8ul);
+    if(footer_offset < 20ul + timescale || footer_offset > (uint64_t)size - 16ul)
+        wave_corrupt();
+
+    wave_read_at(r, footer_offset, (size_t)((uint64_t)size - 16ul - footer_offset), bytes);
+    in = { bytes.data(), bytes.data() + bytes.size() };
+
+    // a signal takes at least 20 bytes of the footer
+    const uint64_t n_signals = wave_get(in, 4ul);
+    if(n_signals > (uint64_t)(in.end - in.p) / 20ul)
+        wave_corrupt();
+    r->signals.resize((size_t)n_signals);
+    for(waveform_signal_t& sig : r->signals) {
+        sig.scope       = wave_get_string(in);
+        sig.name        = wave_get_string(in);
+        sig.width       = (uint32_t)wave_get(in, 4ul);
+        sig.first_block = (uint32_t)wave_get(in, 4ul);
+        sig.blocks      = (uint32_t)wave_get(in, 4ul);
+        if(sig.width == 0u)
+            wave_corrupt();
+    }
+
+    const uint64_t n_blocks = wave_get(in, 8ul);
+    if(n_blocks > (uint64_t)(in.end - in.p) / 36ul)
+        wave_corrupt();
+    r->blocks.resize((size_t)n_blocks);
+    for(waveform_block_t& b : r->blocks) {
+        b.first_time = wave_get(in, 8ul);
+        b.last_time  = wave_get(in, 8ul);
+        b.offset     = wave_get(in, 8ul);
+        b.bytes      = (uint32_t)wave_get(in, 4ul);
+        b.raw_bytes  = (uint32_t)wave_get(in, 4ul);
+        b.changes    = (uint32_t)wave_get(in, 4ul);
+        if(b.offset > footer_offset || b.bytes > footer_offset - b.offset)
+            wave_corrupt();
+    }
+    r->end_time = wave_get(in, 8ul);
+
+    for(const waveform_signal_t& sig : r->signals)
+        if((uint64_t)sig.first_block + sig.blocks > n_blocks)
+            wave_corrupt();
+}
+
+void waveform_read_close(waveform_reader_t* r) {
+    if(r->file != NULL)
+        fclose(r->file);
+    r->file = NULL;
+}
+
+waveform_reader_t::~waveform_reader_t() {
+    waveform_read_close(this);
+}
+
+int64_t waveform_find(const waveform_reader_t* r, const std::string& path) {
+    for(size_t i = 0ul; i < r->signals.size(); i++) {
+        const waveform_signal_t& sig = r->signals[i];
+        if(path.size() == sig.scope.size() + 1ul + sig.name.size() && path.compare(0, sig.scope.size(), sig.scope) == 0 &&
+                path[sig.scope.size()] == '.' && path.compare(sig.scope.size() + 1ul, std::string::npos, sig.name) == 0)
+            return (int64_t)i;
+    }
+    return -1l;
+}
+
+//
+// walks the changes of one signal, a block at a time. value and unknown are
+// the planes after the last change returned
+//
+struct wave_cursor_t {
+    uint32_t width = 0u;
+    uint32_t block = 0u; // next block to load
+    uint32_t end   = 0u;
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> packed;
+    wave_input_t in = { NULL, NULL };
+    uint32_t left = 0u; // changes still in the loaded block
+    uint64_t time = 0ul;
+    std::vector<uint64_t> value;
+    std::vector<uint64_t> unknown;
+};
+
+static void wave_cursor(waveform_reader_t* r, wave_cursor_t& c, uint32_t signal, uint32_t first_block) {
+    const waveform_signal_t& sig = r->signals[signal];
+    c.width = sig.width;
+    c.block = first_block;
+    c.end   = sig.first_block + sig.blocks;
+    c.left  = 0u;
+    c.value.assign((sig.width + 63ul) / 64ul, 0ul);
+    c.unknown.assign(c.value.size(), 0ul);
+}
+
+static bool wave_next(waveform_reader_t* r, wave_cursor_t& c) {
+
+    if(c.left == 0u) {
+        if(c.block == c.end)
+            return false;
+
+        const waveform_block_t& b = r->blocks[c.block++];
+        if(b.bytes == b.raw_bytes) {
+            wave_read_at(r, b.offset, b.bytes, c.raw);
+        } else {
+            wave_read_at(r, b.offset, b.bytes, c.packed);
+            wave_decompress(c.packed.data(), c.packed.size(), c.raw, b.raw_bytes);
+        }
+        r->bytes_read += b.bytes;
+        r->blocks_read++;
+
+        c.in   = { c.raw.data(), c.raw.data() + c.raw.size() };
+        c.left = b.changes;
+        c.time = b.first_time;
+        std::fill(c.value.begin(), c.value.end(), 0ul);
+        std::fill(c.unknown.begin(), c.unknown.end(), 0ul);
+        if(c.left == 0u)
+            wave_corrupt();
+    }
+
+    if(c.width == 1u) {
+        const uint64_t x = wave_get_varint(c.in);
+        c.time      += x >> 2;
+        c.value[0]   = x & 1ul;
+        c.unknown[0] = (x >> 1) & 1ul;
+    } else {
+        c.time += wave_get_varint(c.in);
+        const size_t bytes = (c.width + 7ul) / 8ul;
+        for(size_t plane = 0ul; plane < (r->four_state ? 2ul : 1ul); plane++) {
+            uint64_t* words = plane == 0ul ? c.value.data() : c.unknown.data();
+            for(size_t j = 0ul; j < bytes; j++)
+                words[j / 8ul] ^= wave_get(c.in, 1ul) << (8ul * (j % 8ul));
+        }
+    }
+
+    c.left--;
+    return true;
+}
+
+static void wave_format(const wave_cursor_t& c, std::string& out) {
+    out.resize(c.width);
+    for(uint32_t b = 0u; b < c.width; b++) {
+        const uint64_t v = (c.value[b / 64u] >> (b % 64u)) & 1ul;
+        const uint64_t u = (c.unknown[b / 64u] >> (b % 64u)) & 1ul;
+        out[c.width - 1u - b] = wave_chars[v | u << 1];
+    }
+}
+
+//
+// the block of signal that holds its value at time, the one with the last
+// change at or before it. -1 before the first change
+//
+static int64_t wave_block_at(const waveform_reader_t* r, uint32_t signal, uint64_t time) {
+    const waveform_signal_t& sig = r->signals[signal];
+    const waveform_block_t* first = r->blocks.data() + sig.first_block;
+    const waveform_block_t* last  = first + sig.blocks;
+    const waveform_block_t* after = std::upper_bound(first, last, time,
+            [](uint64_t t, const waveform_block_t& b) { return t < b.first_time; });
+    return after == first ? -1l : (int64_t)(after - r->blocks.data()) - 1l;
+}
+
+std::string waveform_value_at(waveform_reader_t* r, uint32_t signal, uint64_t time) {
+    std::vector<waveform_change_t> changes;
+    waveform_changes(r, signal, time, time, changes);
+    return changes[0].value;
+}
+
+void waveform_changes(waveform_reader_t* r, uint32_t signal, uint64_t from, uint64_t to, std::vector<waveform_change_t>& changes) {
+
+    const waveform_signal_t& sig = r->signals[signal];
+
+    changes.clear();
+    waveform_change_t start;
+    start.time  = from;
+    start.value = std::string(sig.width, 'x');
+    changes.push_back(start);
+
+    const int64_t block = wave_block_at(r, signal, from);
+
+    wave_cursor_t c;
+    wave_cursor(r, c, signal, block < 0l ? sig.first_block : (uint32_t)block);
+
+    while(wave_next(r, c)) {
+        if(c.time > to)
+            break;
+        if(c.time <= from) {
+            wave_format(c, changes[0].value);
+            continue;
+        }
+        waveform_change_t change;
+        change.time = c.time;
+        wave_format(c, change.value);
+        changes.push_back(change);
+    }
+}
+
+void waveform_to_vcd(waveform_reader_t* r, std::ostream& os) {
+
+    std::vector<simulate_vcd_var_t> vars(r->signals.size());
+    for(size_t i = 0ul; i < vars.size(); i++) {
+        vars[i].scope = r->signals[i].scope;
+        vars[i].name  = r->signals[i].name;
+        vars[i].width = r->signals[i].width;
+    }
+    os << simulate_vcd_header(vars, r->timescale);
+
+    // every signal walks its own blocks, the next change of any of them
+    // comes first, ties in signal order like simulate_vcd_sample
+    std::vector<wave_cursor_t> cursors(r->signals.size());
+    typedef std::pair<uint64_t, uint32_t> due_t;
+    std::priority_queue<due_t, std::vector<due_t>, std::greater<due_t> > due;
+
+    for(uint32_t s = 0u; s < cursors.size(); s++) {
+        wave_cursor(r, cursors[s], s, r->signals[s].first_block);
+        if(wave_next(r, cursors[s]))
+            due.push({ cursors[s].time, s });
+    }
+
+    // the changes at the first time are the $dumpvars
+    std::string out;
+    std::string value;
+    bool started = false;
+    uint64_t time       = 0ul;
+    uint64_t first_time = 0ul;
+
+    while(!due.empty()) {
+        const due_t next = due.top();
+        due.pop();
+
+        if(!started) {
+            out += "#" + std::to_string(next.first) + "\n$dumpvars\n";
+        } else if(next.first != time) {
+            if(time == first_time)
+                out += "$end\n";
+            out += "#" + std::to_string(next.first) + "\n";
+        }
+        if(!started)
+            first_time = next.first;
+        started = true;
+        time    = next.first;
+
+        wave_cursor_t& c = cursors[next.second];
+        wave_format(c, value);
+        if(c.width > 1u)
+            out += "b" + value + " ";
+        else
+            out += value;
+        out += simulate_vcd_id(next.second);
+        out += "\n";
+
+        if(wave_next(r, c))
+            due.push({ c.time, next.second });
+
+        if(out.size() >= (1ul << 20)) {
+            os.write(out.data(), (std::streamsize)out.size());
+            out.clear();
+        }
+    }
+    if(started && time == first_time)
+        out += "$end\n";
+    os.write(out.data(), (std::streamsize)out.size());
+}
+
+//
+// checking. the changes of every signal as the dump has them
+//
+static bool wave_parse_vcd(const waveform_reader_t* r, const std::string& vcd, std::vector<std::vector<waveform_change_t> >& changes) {
+
+    std::unordered_map<std::string, uint32_t> ids;
+    for(uint32_t s = 0u; s < r->signals.size(); s++)
+        ids[simulate_vcd_id(s)] = s;
+    changes.assign(r->signals.size(), std::vector<waveform_change_t>());
+
+    const std::string defs = "$enddefinitions $end\n";
+    size_t at = vcd.find(defs);
+    if(at == std::string::npos)
+        return false;
+    at += defs.size();
+
+    uint64_t time = 0ul;
+    while(at < vcd.size()) {
+        size_t eol = vcd.find('\n', at);
+        if(eol == std::string::npos)
+            eol = vcd.size();
+        const std::string line = vcd.substr(at, eol - at);
+        at = eol + 1ul;
+
+        if(line.empty() || line[0] == '$')
+            continue;
+        if(line[0] == '#') {
+            time = strtoull(line.c_str() + 1, NULL, 10);
+            continue;
+        }
+
+        waveform_change_t change;
+        change.time = time;
+        std::string id;
+        if(line[0] == 'b') {
+            const size_t space = line.find(' ');
+            if(space == std::string::npos)
+                return false;
+            change.value = line.substr(1ul, space - 1ul);
+            id = line.substr(space + 1ul);
+        } else {
+            change.value = line.substr(0ul, 1ul);
+            id = line.substr(1ul);
+        }
+
+        const auto it = ids.find(id);
+        if(it == ids.end())
+            return false;
+        changes[it->second].push_back(change);
+    }
+    return true;
+}
+
+//
+// value of a signal at time from its changes
+//
+static const std::string& wave_value_in(const std::vector<waveform_change_t>& changes, uint64_t time, const std::string& unknown) {
+    const auto after = std::upper_bound(changes.begin(), changes.end(), time,
+            [](uint64_t t, const waveform_change_t& c) { return t < c.time; });
+    return after == changes.begin() ? unknown : (after - 1)->value;
+}
+
+static void wave_changes_in(const std::vector<waveform_change_t>& changes, uint64_t from, uint64_t to, const std::string& unknown, std::vector<waveform_change_t>& out) {
+    out.clear();
+    waveform_change_t start;
+    start.time  = from;
+    start.value = wave_value_in(changes, from, unknown);
+    out.push_back(start);
+    for(const waveform_change_t& c : changes)
+        if(c.time > from && c.time <= to)
+            out.push_back(c);
+}
+
+static bool wave_same_changes(const std::vector<waveform_change_t>& a, const std::vector<waveform_change_t>& b) {
+    if(a.size() != b.size())
+        return false;
+    for(size_t i = 0ul; i < a.size(); i++)
+        if(a[i].time != b[i].time || a[i].value != b[i].value)
+            return false;
+    return true;
+}
+
+bool waveform_check(std::ostream& os, waveform_reader_t* r, const std::string& vcd) {
+
+    std::ostringstream converted;
+    waveform_to_vcd(r, converted);
+    if(converted.str() != vcd) {
+        os << "    wave check : the waveform converted to a value change dump differs from the dump\n";
+        return false;
+    }
+
+    std::vector<std::vector<waveform_change_t> > expected;
+    if(!wave_parse_vcd(r, vcd, expected)) {
+        os << "    wave check : can not read the value change dump\n";
+        return false;
+    }
+
+    uint64_t rng = 0x2545f4914f6cdd1dul;
+    auto random_below = [&rng](uint64_t n) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng % n;
+    };
+
+    // at most this many changes of a signal are seeked to, spread over it
+    const size_t max_seeks = 32ul;
+
+    size_t seeks = 0ul, ranges = 0ul;
+    std::vector<waveform_change_t> got, want;
+
+    for(uint32_t s = 0u; s < r->signals.size(); s++) {
+        const waveform_signal_t& sig = r->signals[s];
+        const std::vector<waveform_change_t>& changes = expected[s];
+        const std::string unknown(sig.width, 'x');
+        const std::string path = sig.scope + "." + sig.name;
+
+        waveform_changes(r, s, 0ul, r->end_time, got);
+        wave_changes_in(changes, 0ul, r->end_time, unknown, want);
+        ranges++;
+        if(!wave_same_changes(got, want)) {
+            os << "    wave check : " << path << " extracted whole has " << got.size() << " values, the dump " << want.size() << "\n";
+            return false;
+        }
+
+        std::vector<uint64_t> times;
+        const size_t step = std::max((size_t)1ul, changes.size() / max_seeks);
+        for(size_t i = 0ul; i < changes.size(); i += step) {
+            times.push_back(changes[i].time);
+            if(changes[i].time > 0ul)
+                times.push_back(changes[i].time - 1ul);
+        }
+        for(size_t i = 0ul; i < 8ul; i++)
+            times.push_back(random_below(r->end_time + 2ul));
+
+        for(uint64_t t : times) {
+            seeks++;
+            const std::string value = waveform_value_at(r, s, t);
+            if(value != wave_value_in(changes, t, unknown)) {
+                os << "    wave check : " << path << " at " << t << " is " << value << ", the dump has "
+                   << wave_value_in(changes, t, unknown) << "\n";
+                return false;
+            }
+        }
+
+        for(size_t i = 0ul; i < 4ul; i++) {
+            uint64_t from = random_below(r->end_time + 2ul);
+            uint64_t to   = random_below(r->end_time + 2ul);
+            if(from > to)
+                std::swap(from, to);
+            ranges++;
+            waveform_changes(r, s, from, to, got);
+            wave_changes_in(changes, from, to, unknown, want);
+            if(!wave_same_changes(got, want)) {
+                os << "    wave check : " << path << " from " << from << " to " << to << " has " << got.size()
+                   << " values, the dump " << want.size() << "\n";
+                return false;
+            }
+        }
+    }
+
+    os << "    wave check : " << r->signals.size() << " signals, the converted dump is the same, "
+       << seeks << " seeks and " << ranges << " ranges agree with it\n";
+    return true;
+}
+
+std::ostream& operator<<(std::ostream& os, const waveform_stats_t& stats) {
+    os << "    wave : " << stats.samples << " samples, " << stats.changes << " value changes, " << stats.blocks << " blocks, "
+       << stats.raw_bytes / 1024ul << " KB of changes in " << stats.bytes / 1024ul << " KB, "
+       << std::fixed << std::setprecision(1) << stats.sample_ms << " ms sampling\n" << std::defaultfloat;
+    return os;
+}
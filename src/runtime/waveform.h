@@ -0,0 +1,208 @@
+#pragma once
+
+#include <src/runtime/simulate.h>
+#include <src/runtime/simulate-vcd.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//
+// binary waveform file. every signal has its own list of changes, cut into
+// blocks of a few KB that are compressed one by one, and the footer has the
+// time range and file offset of every block of every signal. reading the
+// value of one signal at some time reads one block, extracting it over a
+// time range reads the blocks covering the range, nothing else of the file
+//
+//     header : "CHDLWAVE", u32 version, u32 flags (bit 0 four state),
+//              u32 length and the timescale
+//     blocks : compressed change lists, in the order they filled up
+//     footer : u32 signal count, per signal the scope, the name (u32 length
+//              and the bytes each), u32 width, u32 first block, u32 blocks.
+//              u64 block count, per block u64 first time, u64 last time,
+//              u64 offset, u32 bytes, u32 raw bytes, u32 changes, the blocks
+//              of a signal next to each other in time order. u64 time of
+//              the last sample
+//     trailer : u64 offset of the footer, "CHDLWEND"
+//
+// everything is little endian. a change is a varint of the time since the
+// change before it in the same block (0 for the first) and the new value.
+// a single bit signal packs both in one varint, time << 2 | value | unknown
+// << 1. a wider one has the value plane after the time, xor the value before
+// it in the block, ceil(width / 8) bytes bit 0 first, then the unknown plane
+// the same way if the file is four state. the first change of a block xors
+// with 0, so every block decodes on its own
+//
+// blocks are compressed with a small lz77 in the style of lz4. a sequence is
+// a token, literal length in the high nibble and match length - 4 in the
+// low one, 15 meaning more follows in bytes of 255 and a last one below,
+// the literals, then a u16 offset back into the output. the last sequence
+// has only literals. a block that does not get smaller is stored as it is,
+// bytes equal to raw bytes
+//
+
+struct waveform_block_t {
+    uint64_t first_time = 0ul;
+    uint64_t last_time  = 0ul;
+    uint64_t offset     = 0ul;
+    uint32_t bytes      = 0u;
+    uint32_t raw_bytes  = 0u;
+    uint32_t changes    = 0u;
+};
+
+struct waveform_signal_t {
+    std::string scope; // names from the top joined by dots
+    std::string name;
+    uint32_t width       = 0u;
+    uint32_t first_block = 0u; // into the blocks of a reader
+    uint32_t blocks      = 0u;
+};
+
+struct waveform_stats_t {
+    size_t samples   = 0ul;
+    size_t changes   = 0ul;
+    size_t blocks    = 0ul;
+    size_t raw_bytes = 0ul; // change lists before compressing
+    size_t bytes     = 0ul; // the file
+    double sample_ms = 0.0;
+};
+
+//
+// writing. a signal being written keeps its open block, the values it had at
+// the last sample and the index of its blocks so far
+//
+struct waveform_writer_signal_t {
+    waveform_signal_t info;
+    std::vector<uint8_t>  raw;
+    std::vector<uint64_t> last;  // value plane, then unknown plane, per 64 bits
+    std::vector<uint64_t> xored; // value in the open block the next change xors with
+    bool     valued       = false; // has changed at least once
+    uint64_t block_time   = 0ul;
+    uint64_t last_time    = 0ul;
+    uint32_t changes      = 0u;
+    std::vector<waveform_block_t> blocks;
+};
+
+struct waveform_writer_t {
+    FILE* file = NULL;
+    bool failed = false; // a write did not go through
+    bool four_state = false;
+    size_t block_bytes = 4096ul; // a block is compressed once it has this many raw bytes
+    uint64_t offset = 0ul;
+    uint64_t time   = 0ul;
+    bool sampled    = false;
+    std::vector<waveform_writer_signal_t> signals;
+    std::vector<uint8_t> scratch;
+
+    // fed from a simulator, see waveform_open_simulator
+    const simulator_t* sim = NULL;
+    size_t pattern = 0ul;
+    std::vector<net_t> bits;   // of the signals in order
+    std::vector<uint64_t> now; // planes of one signal at the sample
+
+    waveform_stats_t stats;
+
+    ~waveform_writer_t();
+};
+
+//
+// creates path. throws std::runtime_error if it can not
+//
+void waveform_open(waveform_writer_t* w, const std::string& path, bool four_state, const std::string& timescale = "1ns");
+
+//
+// adds a signal before the first change, returns its index
+//
+uint32_t waveform_add_signal(waveform_writer_t* w, const std::string& scope, const std::string& name, uint32_t width);
+
+//
+// signal takes a new value at time, which must not be before its last
+// change. value and unknown hold the planes, bit 0 first, 64 bits a word.
+// unknown may be NULL for a known value. a value equal to the last one is
+// not a change and left out
+//
+void waveform_change(waveform_writer_t* w, uint32_t signal, uint64_t time, const uint64_t* value, const uint64_t* unknown);
+
+//
+// compresses the open blocks and writes the footer. throws
+// std::runtime_error if a write failed
+//
+void waveform_close(waveform_writer_t* w);
+
+//
+// the signals opts selects from sim, in the order and with the names of
+// simulate-vcd.h, four state if sim is. waveform_sample adds their values as
+// of the last simulator_eval at time
+//
+void waveform_open_simulator(waveform_writer_t* w, const simulator_t* sim, const std::string& path, const simulate_vcd_options_t& opts = simulate_vcd_options_t());
+void waveform_sample(waveform_writer_t* w, uint64_t time);
+
+//
+// reading. only the footer is read when opening, blocks when asked for
+//
+struct waveform_reader_t {
+    FILE* file = NULL;
+    bool four_state = false;
+    std::string timescale;
+    uint64_t end_time = 0ul;
+    std::vector<waveform_signal_t> signals;
+    std::vector<waveform_block_t>  blocks;
+
+    size_t bytes_read  = 0ul; // blocks only
+    size_t blocks_read = 0ul;
+
+    ~waveform_reader_t();
+};
+
+//
+// a value as '0', '1', 'x' and 'z', the highest bit first like in a VCD
+//
+struct waveform_change_t {
+    uint64_t time = 0ul;
+    std::string value;
+};
+
+//
+// throws std::runtime_error if path is not a waveform file or is cut short
+//
+void waveform_read_open(waveform_reader_t* r, const std::string& path);
+void waveform_read_close(waveform_reader_t* r);
+
+//
+// signal by scope and name joined by a dot, like adder.full_adder_3.sum. -1
+// if there is none
+//
+int64_t waveform_find(const waveform_reader_t* r, const std::string& path);
+
+//
+// value of signal at time, all x before its first change. reads one block
+//
+std::string waveform_value_at(waveform_reader_t* r, uint32_t signal, uint64_t time);
+
+//
+// the changes of signal in [from, to], after the value it has at from,
+// which comes first with time from. reads the blocks covering the range
+//
+void waveform_changes(waveform_reader_t* r, uint32_t signal, uint64_t from, uint64_t to, std::vector<waveform_change_t>& changes);
+
+//
+// the whole file as a value change dump, like simulate-vcd.h would have
+// written it
+//
+void waveform_to_vcd(waveform_reader_t* r, std::ostream& os);
+
+//
+// holds r against vcd, the value change dump simulate-vcd.h wrote of the
+// same run and signals. r converted with waveform_to_vcd has to be vcd byte
+// for byte. every signal extracted whole, seeked to its changes, to just
+// before them and to random times, and extracted over random ranges has to
+// give what the changes in vcd say. prints what was checked and the first
+// difference, returns false if there is one
+//
+bool waveform_check(std::ostream& os, waveform_reader_t* r, const std::string& vcd);
+
+std::ostream& operator<<(std::ostream& os, const waveform_stats_t& stats);
@@ -17,7 +17,7 @@ void parse_arg_list(
         token_iterator_t& titer,
         const token_iterator_t& tend) {
 
-    token_t& tok = *titer;
+    token_t tok  = *titer;
     if(tok.type == token_type_t::keyword_void) {
         titer++;
         // titer now points to what should be closing paren
@@ -29,9 +29,9 @@ void parse_arg_list(
 
     while(true) {
 
-        token_t& arg_name = *titer++;
-        token_t& colon    = *titer++;
-        token_t& arg_type = *titer++;
+        token_t arg_name  = *titer++;
+        token_t colon     = *titer++;
+        token_t arg_type  = *titer++;
 
         if(arg_name.type != token_type_t::variable_name)
             throw_parse_error("Expected variable name, found " + lexer_token_desc(arg_name, p.src), p.filename, p.src, arg_name);
@@ -45,7 +45,7 @@ void parse_arg_list(
         // valid argument (possibly)
         module_desc_add_argument_desc(modptr, p, arg_name, arg_type);
 
-        token_t& after_arg = *titer++;
+        token_t after_arg  = *titer++;
         if(after_arg.type == token_type_t::comma) {
             continue;
         } else if(after_arg.type == token_type_t::rparen) {
@@ -57,7 +57,7 @@ void parse_arg_list(
 }
 
 static void parse_expect_rparen(runtime_env_t* rtenv, parse_info_t& p, token_iterator_t& titer, const token_iterator_t& tend) {
-    token_t& tok = *titer++;
+    token_t tok  = *titer++;
     if(tok.type != token_type_t::rparen)
         throw_parse_error("Expected closing paren, found " + lexer_token_desc(tok, p.src), p.filename, p.src, tok);
 }
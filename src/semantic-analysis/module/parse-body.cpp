@@ -12,9 +12,12 @@ void parse_body(
         token_iterator_t& titer,
         const token_iterator_t& tend) {
 
+    // shared by every statement in the body
+    shunting_stack_t shunt_stack;
+
     while(modptr->scope_levels > 0 && titer < tend) {
 
-        token_t& first_token = *titer++;
+        token_t first_token  = *titer++;
         switch(first_token.type) {
         case token_type_t::keyword_local:
         case token_type_t::keyword_ref:
@@ -24,8 +27,8 @@ void parse_body(
         case token_type_t::keyword_out:
         {
             titer--;
-            shunting_stack_t shunt_stack;
-            process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, { token_type_t::semicolon }, shunt_behavior_after);            
+            shunt_stack.clear();
+            process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, token_type_set(token_type_t::semicolon), shunt_behavior_after);
             break;
         }
 
@@ -65,16 +68,19 @@ void parse_body(
             pinfo.for_type.body_tag         = module_desc_alloc_jump_label(modptr);
             p.scope.push_back(pinfo);
 
+            // the loop variable lives in the scope closed by the matching `end'
+            opc::push_scope_for(modptr);
+
             { // initialization
-                shunting_stack_t shunt_stack;
-                process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, { token_type_t::semicolon }, shunt_behavior_after);
+                shunt_stack.clear();
+                process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, token_type_set(token_type_t::semicolon), shunt_behavior_after);
             }
 
             module_desc_define_jump_label(modptr, pinfo.for_type.condition_tag, modptr->bytecode.size());
 
             { // condition
-                shunting_stack_t shunt_stack;
-                process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, { token_type_t::semicolon }, shunt_behavior_before);
+                shunt_stack.clear();
+                process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, token_type_set(token_type_t::semicolon), shunt_behavior_before);
                 shunting_yard_eval_semicolon(rtenv, modptr, p, titer, tend, shunt_stack);
 
                 opc::jump_on_true(modptr, pinfo.for_type.body_tag);
@@ -86,8 +92,8 @@ void parse_body(
             module_desc_define_jump_label(modptr, pinfo.for_type.afterthought_tag, modptr->bytecode.size());
 
             { // afterthought
-                shunting_stack_t shunt_stack;
-                process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, { token_type_t::keyword_start }, shunt_behavior_before);
+                shunt_stack.clear();
+                process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, token_type_set(token_type_t::keyword_start), shunt_behavior_before);
                 shunting_yard_eval_semicolon(rtenv, modptr, p, titer, tend, shunt_stack);
                 opc::clear_stack(modptr);
                 opc::jump_exe(modptr, pinfo.for_type.condition_tag);
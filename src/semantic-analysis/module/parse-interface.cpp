@@ -28,14 +28,14 @@ void parse_interface(
     while(titer < tend) {
         switch(current_state) {
         case expect_in_out: {
-            token_t& inout = *titer++;
+            token_t inout  = *titer++;
 
             if(inout.type == token_type_t::keyword_start) {
-                std::cout << *modptr << std::flush;
+                p.os << *modptr << std::flush;
                 return;
             }
 
-            token_t& colon = *titer++;
+            token_t colon  = *titer++;
             
             if(inout.type != token_type_t::keyword_in && inout.type != token_type_t::keyword_out)
                 throw_parse_error("Expected 'in' or 'out', found " + lexer_token_desc(inout, p.src), p.filename, p.src, inout);
@@ -50,8 +50,8 @@ void parse_interface(
             break;
         }
         case iterate_elements: {
-            token_t& name       = *titer++;
-            token_t& namefollow = *titer++;
+            token_t name        = *titer++;
+            token_t namefollow  = *titer++;
 
             if(name.type != token_type_t::variable_name)
                 throw_parse_error("Expected variable name, found " + lexer_token_desc(name, p.src), p.filename, p.src, name);
@@ -79,11 +79,12 @@ void parse_interface(
                         opc::push_out_ref(modptr, std::get<1>(tup));
 
                 // requires extra processing
+                const token_iterator_t size_expr = titer;
                 shunting_stack_t shunt_stack;
                 namefollow.type = token_type_t::interface_ref;
                 shunt_stack.op_stack.push_back(namefollow);
 
-                process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, { token_type_t::rbracket }, shunt_behavior_after);
+                process_shunting_yard(rtenv, modptr, p, titer, tend, shunt_stack, token_type_set(token_type_t::rbracket), shunt_behavior_after);
 
                 while(shunt_stack.op_stack.size() > 0ul) {
                     token_t t = shunt_stack.op_stack.back();
@@ -94,15 +95,15 @@ void parse_interface(
                     shunt_stack.op_stack.pop_back();
                 }
 
-                if((titer - 1)->type != token_type_t::rbracket || shunt_stack.eval_stack.size() != 1ul)
-                    throw_parse_error("Invalid size expression starting at " + lexer_token_desc(*((&namefollow) + 1), p.src), p.filename, p.src, *((&namefollow) + 1));
+                if((*(titer - 1)).type != token_type_t::rbracket || shunt_stack.eval_stack.size() != 1ul)
+                    throw_parse_error("Invalid size expression starting at " + lexer_token_desc(*size_expr, p.src), p.filename, p.src, *size_expr);
 
                 shunt_stack.eval_stack.clear();
 
                 //opc::set_interface_size(modptr);
                 opc::clear_stack(modptr);
 
-                token_t& after_arr = *titer++;
+                token_t after_arr  = *titer++;
                 if(after_arr.type == token_type_t::comma) {
                     ; // nothing, let parsing continue as normal
                 } else if(after_arr.type == token_type_t::semicolon) {
@@ -6,6 +6,8 @@
 #include <src/lexer.h>
 #include <src/error-util.h>
 #include <src/bytecode-data/disassemble.h>
+#include <src/bytecode-data/link.h>
+#include <src/bytecode-data/optimize.h>
 #include <src/runtime/runtime-env.h>
 #include <src/runtime/module-desc.h>
 
@@ -15,7 +17,7 @@ void parse_module(
         token_iterator_t& titer,
         const token_iterator_t& tend) {
 
-    token_t& modulename = *titer++;
+    token_t modulename  = *titer++;
     string_t modnamestr = lexer_token_value(modulename, p.src);
 
     if(modulename.type != token_type_t::variable_name) {
@@ -25,7 +27,7 @@ void parse_module(
 
     module_desc_t* mod = runtime_env_create_new_module(rtenv, modnamestr, p, modulename);
 
-    token_t& openparen = *titer++;
+    token_t openparen  = *titer++;
     if(openparen.type != token_type_t::lparen) {
         throw_parse_error(
             "Expecting open paren '(', found " + lexer_token_desc(openparen, p.src), p.filename, p.src, openparen);
@@ -34,7 +36,13 @@ void parse_module(
     parse_arg_list(rtenv, mod, p, titer, tend);
     parse_interface(rtenv, mod, p, titer, tend);
     parse_body(rtenv, mod, p, titer, tend);
+    link_bytecode(mod);
 
-    disassemble_bytecode(std::cout, mod);
+    if(p.opts.optimize) {
+        const optimize_stats_t stats = optimize_bytecode(mod);
+        p.os << '\n' << stats;
+    }
+
+    disassemble_bytecode(p.os, mod);
 }
 
@@ -6,22 +6,27 @@
 #include <iostream>
 #include <string>
 
-parse_info_t::parse_info_t(src_t& src, const std::string& filename, std::vector<token_t>& tkns)
-        : src(src), filename(filename), tkns(tkns)
+parse_info_t::parse_info_t(src_t& src, const std::string& filename, token_buffer_t& tkns, std::ostream& os, const parse_options_t& opts)
+        : src(src), filename(filename), tkns(tkns), os(os), opts(opts)
 {
     ;
 }
 
-void parser_analyze(runtime_env_t* rtenv, src_t& src, const std::string& filename, std::vector<token_t>& tkns) {
+void parser_analyze(
+        runtime_env_t* rtenv,
+        src_t& src,
+        const std::string& filename,
+        token_buffer_t& tkns,
+        std::ostream& os,
+        const parse_options_t& opts) {
 
-    parse_info_t pinfo(src, filename, tkns);
+    parse_info_t pinfo(src, filename, tkns, os, opts);
 
     token_iterator_t tokeniter = tkns.begin();
     const token_iterator_t tokenend = tkns.end();
 
     while(tokeniter < tokenend) {
-        const token_t& tok = *tokeniter++;
-        const std::string str = lexer_token_value(tok, src);
+        const token_t tok = *tokeniter++;
 
         switch(tok.type) {
         case token_type_t::keyword_module:
@@ -6,6 +6,7 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <iostream>
 
 enum class parse_scope_type_t : int {
     for_loop,
@@ -42,13 +43,19 @@ struct parse_scope_info_t {
     };
 };
 
+struct parse_options_t {
+    bool optimize = true; // run optimize_bytecode on every module
+};
+
 struct parse_info_t {
 
-    parse_info_t(src_t& src, const std::string& filename, std::vector<token_t>& tkns);
+    parse_info_t(src_t& src, const std::string& filename, token_buffer_t& tkns, std::ostream& os, const parse_options_t& opts);
 
     src_t& src;
     const std::string& filename;
-    std::vector<token_t>& tkns;
+    token_buffer_t& tkns;
+    std::ostream& os; // module listings go here instead of straight to stdout
+    parse_options_t opts;
 
     std::map<size_t, long int> branch_targets; // target .second is negative if it hasnt been evaluated yet
     std::vector<parse_scope_info_t> scope;
@@ -58,4 +65,13 @@ struct parse_info_t {
 // perform semantic analysis
 // also the code gen stage
 //
-void parser_analyze(struct runtime_env_t* rtenv, src_t& src, const std::string& filename, std::vector<token_t>& tkns);
+// all state lives in the parse_info_t created for this call, so different files
+// can be parsed at the same time as long as each gets its own runtime_env_t
+//
+void parser_analyze(
+        struct runtime_env_t* rtenv,
+        src_t& src,
+        const std::string& filename,
+        token_buffer_t& tkns,
+        std::ostream& os,
+        const parse_options_t& opts = parse_options_t());
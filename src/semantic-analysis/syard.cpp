@@ -4,58 +4,81 @@
 #include <src/lexer.h>
 #include <src/error-util.h>
 
-#include <set>
-#include <map>
 #include <iostream>
-#include <functional>
 
 enum assoc_t {
     assoc_left_to_right,
     assoc_right_to_left,
 };
 
-//typedef std::pair<int, assoc_t> assoc_entry_t;
+typedef void (*opc_emit_fn_t)(struct module_desc_t*);
 
 struct assoc_entry_t {
-    int     first;
-    assoc_t second;
-    std::function<void(struct module_desc_t*)>
-            third;
+    int           precedence; // 0 for tokens that are not operators
+    assoc_t       assoc;
+    opc_emit_fn_t emit;
 };
 
-static const std::map<token_type_t, struct assoc_entry_t> precedence_table = {
+//
+// dense table indexed by token_type_t, built at compile time. looking up an
+// operator is a single load instead of a tree walk
+//
+struct precedence_table_t {
+    assoc_entry_t entry[256];
+};
 
-    { token_type_t::period,         { 60, assoc_left_to_right, opc::operator_::get_field }}, // .
+static constexpr precedence_table_t make_precedence_table(void) {
+    precedence_table_t t = {};
 
-    { token_type_t::unary_negative, { 45, assoc_right_to_left, opc::operator_::unary_negate }}, // -
-    { token_type_t::invert,         { 45, assoc_right_to_left, opc::operator_::binary_not }},   // ~
+    struct init_t {
+        token_type_t  type;
+        assoc_entry_t entry;
+    };
 
-    { token_type_t::divide,         { 40, assoc_left_to_right, opc::operator_::divide   }}, // /
-    { token_type_t::star,           { 40, assoc_left_to_right, opc::operator_::multiply }}, // *
-    { token_type_t::minus,          { 35, assoc_left_to_right, opc::operator_::subtract }}, // -
-    { token_type_t::plus,           { 35, assoc_left_to_right, opc::operator_::add      }}, // +
+    const init_t operators[] = {
+        { token_type_t::period,         { 60, assoc_left_to_right, opc::operator_::get_field }}, // .
 
-    { token_type_t::less_than,      { 30, assoc_left_to_right, opc::operator_::cmp_lt }}, // <
-    { token_type_t::less_eq,        { 30, assoc_left_to_right, opc::operator_::cmp_le }}, // <=
-    { token_type_t::greater_than,   { 30, assoc_left_to_right, opc::operator_::cmp_gt }}, // >
-    { token_type_t::greater_eq,     { 30, assoc_left_to_right, opc::operator_::cmp_ge }}, // >=
+        { token_type_t::unary_negative, { 45, assoc_right_to_left, opc::operator_::unary_negate }}, // -
+        { token_type_t::invert,         { 45, assoc_right_to_left, opc::operator_::binary_not }},   // ~
 
-    { token_type_t::equiv,          { 25, assoc_left_to_right, opc::UNIMPLEMENTED }}, // ==
-    { token_type_t::not_equiv,      { 25, assoc_left_to_right, opc::UNIMPLEMENTED }}, // !=
+        { token_type_t::divide,         { 40, assoc_left_to_right, opc::operator_::divide   }}, // /
+        { token_type_t::star,           { 40, assoc_left_to_right, opc::operator_::multiply }}, // *
+        { token_type_t::minus,          { 35, assoc_left_to_right, opc::operator_::subtract }}, // -
+        { token_type_t::plus,           { 35, assoc_left_to_right, opc::operator_::add      }}, // +
 
-    { token_type_t::ampersand,      { 20, assoc_left_to_right, opc::operator_::binary_and }}, //  &
-    { token_type_t::caret,          { 15, assoc_left_to_right, opc::operator_::binary_xor }}, //  ^
-    { token_type_t::pipe,           { 10, assoc_left_to_right, opc::operator_::binary_or  }}, //  |
-    { token_type_t::colon,          {  7, assoc_left_to_right, opc::operator_::range_desc }}, // begin:end, [begin, end)
-    { token_type_t::assign,         {  5, assoc_right_to_left, opc::operator_::assign }}, //  =
-};
+        { token_type_t::less_than,      { 30, assoc_left_to_right, opc::operator_::cmp_lt }}, // <
+        { token_type_t::less_eq,        { 30, assoc_left_to_right, opc::operator_::cmp_le }}, // <=
+        { token_type_t::greater_than,   { 30, assoc_left_to_right, opc::operator_::cmp_gt }}, // >
+        { token_type_t::greater_eq,     { 30, assoc_left_to_right, opc::operator_::cmp_ge }}, // >=
+
+        { token_type_t::equiv,          { 25, assoc_left_to_right, opc::UNIMPLEMENTED }}, // ==
+        { token_type_t::not_equiv,      { 25, assoc_left_to_right, opc::UNIMPLEMENTED }}, // !=
+
+        { token_type_t::ampersand,      { 20, assoc_left_to_right, opc::operator_::binary_and }}, //  &
+        { token_type_t::caret,          { 15, assoc_left_to_right, opc::operator_::binary_xor }}, //  ^
+        { token_type_t::pipe,           { 10, assoc_left_to_right, opc::operator_::binary_or  }}, //  |
+        { token_type_t::colon,          {  7, assoc_left_to_right, opc::operator_::range_desc }}, // begin:end, [begin, end)
+        { token_type_t::assign,         {  5, assoc_right_to_left, opc::operator_::assign }}, //  =
+    };
+
+    for(const init_t& op : operators)
+        t.entry[(size_t)op.type] = op.entry;
+
+    return t;
+}
+
+static constexpr precedence_table_t precedence_table = make_precedence_table();
+
+static inline const assoc_entry_t& precedence_of(token_type_t t) {
+    return precedence_table.entry[(size_t)t];
+}
 
 static const bool is_unary_operator(token_type_t t);
 
 static const bool is_binary_operator(token_type_t t);
 
 const bool token_is_operator(token_type_t t) {
-    return precedence_table.find(t) != precedence_table.end();
+    return precedence_of(t).precedence > 0;
 }
 
 void process_shunting_yard(
@@ -65,15 +88,15 @@ void process_shunting_yard(
         token_iterator_t& titer,
         const token_iterator_t& tend,
         shunting_stack_t& shunt_stack,
-        const std::set<token_type_t>& end_types,
+        token_type_set_t end_types,
         shunt_behavior_t shunt_behavior) {
 
     while(titer < tend) {
-        token_t& tok = *titer++;
+        token_t tok  = *titer++;
 
         //std::cout << "op stack size : " << shunt_stack.op_stack.size() << std::endl;
         
-        if(shunt_behavior == shunt_behavior_before && end_types.find(tok.type) != end_types.end())
+        if(shunt_behavior == shunt_behavior_before && token_type_set_has(end_types, tok.type))
             return;
 
         //std::cout << lexer_token_desc(tok, p.src) << std::endl;
@@ -89,7 +112,7 @@ void process_shunting_yard(
                 token_t c = shunt_stack.op_stack.back();
                 if(token_is_operator(c.type)) {
                     shunting_yard_eval_operator(rtenv, modptr, p, titer, tend, shunt_stack, c);
-                    precedence_table.at(c.type).third(modptr);
+                    precedence_of(c.type).emit(modptr);
                     shunt_stack.op_stack.pop_back();
                 } else {
                     break;
@@ -98,10 +121,14 @@ void process_shunting_yard(
             break;
 
         case token_type_t::variable_name: {
-            std::string val = lexer_token_value(tok, p.src);
-            auto pr         = module_desc_get_idx_of_string(modptr, val);
-            if(pr.first == false && (*(titer-2)).type != token_type_t::period)
-                throw_parse_error("local variable with name `" + val + "' does not exist in module `" + modptr->name + "'", p.filename, p.src, tok);
+            auto pr = module_desc_get_idx_of_symbol(modptr, tok.sym);
+            if(pr.first == false) {
+                if((*(titer-2)).type != token_type_t::period)
+                    throw_parse_error("local variable with name `" + lexer_token_value(tok, p.src) + "' does not exist in module `" + modptr->name + "'", p.filename, p.src, tok);
+
+                // field of another module, the name is only needed when it is looked up
+                pr.second = module_desc_add_symbol_constant(modptr, tok.sym);
+            }
 
             opc::push_local(modptr, pr.second);
             shunt_stack.eval_stack.push_back(eval_token_t::variable_reference);
@@ -125,13 +152,17 @@ void process_shunting_yard(
 
         case token_type_t::keyword_ref: {
             token_t local_name = *titer++;
-            token_t& expect_assign = *titer;
+            if(local_name.type != token_type_t::variable_name)
+                throw_parse_error("Expecting variable name, found " + lexer_token_desc(local_name, p.src),
+                        p.filename, p.src, local_name);
+
+            token_t expect_assign  = *titer;
             if(expect_assign.type != token_type_t::assign)
                 throw_parse_error(
                         "Expecting `=', found " + lexer_token_desc(expect_assign, p.src),
                         p.filename, p.src, expect_assign);
 
-            size_t local_idx = module_desc_add_string_constant(modptr, lexer_token_value(local_name, p.src));
+            size_t local_idx = module_desc_add_symbol_constant(modptr, local_name.sym);
             opc::push_new_local_ref(modptr, local_idx);
             shunt_stack.eval_stack.push_back(eval_token_t::variable_reference);
             break;
@@ -143,14 +174,14 @@ void process_shunting_yard(
             // local varname : typespec;
             // local varname : typespec = ...;
 
-            token_t& varname = *titer++;
+            token_t varname  = *titer++;
             if(varname.type != token_type_t::variable_name)
                 throw_parse_error("Expecting variable name, found " + lexer_token_desc(varname, p.src),
                         p.filename, p.src, varname);
 
-            size_t varname_idx = module_desc_add_string_constant(modptr, lexer_token_value(varname, p.src));
+            size_t varname_idx = module_desc_add_symbol_constant(modptr, varname.sym);
 
-            token_t& assign_or_colon = *titer++;
+            token_t assign_or_colon  = *titer++;
             if(assign_or_colon.type == token_type_t::assign) {
                 opc::push_new_local_any(modptr, varname_idx);
                 shunt_stack.op_stack.push_back(assign_or_colon); // assign operator
@@ -164,7 +195,7 @@ void process_shunting_yard(
                         p.filename, p.src, assign_or_colon);
             }
 
-            token_t& typespec = *titer++;
+            token_t typespec  = *titer++;
 
             if(typespec.type == token_type_t::keyword_integer) {         opc::push_new_local_integer(modptr, varname_idx);
             } else if(typespec.type == token_type_t::keyword_uinteger) { opc::push_new_local_uinteger(modptr, varname_idx);
@@ -178,7 +209,7 @@ void process_shunting_yard(
 
             shunt_stack.eval_stack.push_back(eval_token_t::variable_reference);            
 
-            token_t& semic_or_assign = *titer++;
+            token_t semic_or_assign  = *titer++;
 
             if(semic_or_assign.type == token_type_t::semicolon) {
                 titer--;
@@ -210,17 +241,17 @@ void process_shunting_yard(
                         "Module instance must be part of assignment to local",
                         p.filename, p.src, tok);
 
-            token_t& expect_dot = *titer++;
+            token_t expect_dot  = *titer++;
             if(expect_dot.type != token_type_t::period)
                 throw_parse_error("Expecting `.', found " + lexer_token_desc(expect_dot, p.src),
                         p.filename, p.src, expect_dot);
 
-            token_t& module_name = *titer++;
+            token_t module_name  = *titer++;
 
             if(module_name.type != token_type_t::variable_name)
                 throw_parse_error("Expecting module name, found " + lexer_token_desc(module_name, p.src), p.filename, p.src, module_name);
 
-            token_t& expect_lparen = *titer++;
+            token_t expect_lparen  = *titer++;
 
             if(expect_lparen.type != token_type_t::lparen)
                 throw_parse_error("Expecting `(', found " + lexer_token_desc(expect_lparen, p.src), p.filename, p.src, expect_lparen);
@@ -237,17 +268,17 @@ void process_shunting_yard(
         case token_type_t::keyword_in:
         case token_type_t::keyword_out:
         {
-            token_t& expect_dot = *titer++;
+            token_t expect_dot  = *titer++;
             if(expect_dot.type != token_type_t::period)
                 throw_parse_error("Expecting `.', found " + lexer_token_desc(expect_dot, p.src),
                         p.filename, p.src, expect_dot);
 
-            token_t& in_name = *titer++;
+            token_t in_name  = *titer++;
             if(in_name.type != token_type_t::variable_name)
                 throw_parse_error("Expecting variable name, found " + lexer_token_desc(in_name, p.src),
                         p.filename, p.src, in_name);
 
-            size_t idx = module_desc_add_string_constant(modptr, lexer_token_value(in_name, p.src));
+            size_t idx = module_desc_add_symbol_constant(modptr, in_name.sym);
             tok.type == token_type_t::keyword_in ?
                     opc::push_in_ref(modptr, idx) :
                     opc::push_out_ref(modptr, idx);
@@ -257,6 +288,13 @@ void process_shunting_yard(
         }
 
         case token_type_t::lbracket:
+            // field access binds tighter than indexing, a.b[i] indexes a.b
+            while(shunt_stack.op_stack.size() > 0ul && shunt_stack.op_stack.back().type == token_type_t::period) {
+                shunting_yard_eval_operator(rtenv, modptr, p, titer, tend, shunt_stack, shunt_stack.op_stack.back());
+                precedence_of(token_type_t::period).emit(modptr);
+                shunt_stack.op_stack.pop_back();
+            }
+
             opc::push_arr_sentinal(modptr);
             shunt_stack.eval_stack.push_back(eval_token_t::arr_access_sentinal);
             shunt_stack.op_stack.push_back(tok);
@@ -270,7 +308,7 @@ void process_shunting_yard(
             break;
 
         case token_type_t::bit_literal: {
-            size_t idx = module_desc_add_string_constant(modptr, lexer_token_value(tok, p.src));
+            size_t idx = module_desc_add_symbol_constant(modptr, tok.sym);
             opc::push_bit_literal(modptr, idx);
             shunt_stack.eval_stack.push_back(eval_token_t::variable_reference);
             break;
@@ -283,7 +321,7 @@ void process_shunting_yard(
         case token_type_t::function: {
             shunt_stack.op_stack.push_back(tok);
             opc::push_fn_args_sentinal(modptr);
-            token_t& next_token = *titer++;
+            token_t next_token  = *titer++;
             if(next_token.type != token_type_t::lparen)
                 throw_parse_error("Expecting '(', found " + lexer_token_desc(next_token, p.src), p.filename, p.src, next_token);
             shunt_stack.eval_stack.push_back(eval_token_t::function_arg_sentinal);
@@ -295,15 +333,7 @@ void process_shunting_yard(
                 token_t t = shunt_stack.op_stack.back();
                 if(token_is_operator(t.type)) {
                     shunting_yard_eval_operator(rtenv, modptr, p, titer, tend, shunt_stack, t);
-                    auto iter = precedence_table.find(t.type);
-                    if(iter == precedence_table.end()) {
-                        throw_parse_error(
-                                "INTERNAL ERROR : OPERATOR " + lexer_token_desc(t, p.src) + 
-                                    " MISSING FROM PRECENDENCE TABLE",
-                                p.filename, p.src, t);
-                    } else {
-                        iter->second.third(modptr); // <-- generate opcode
-                    }
+                    precedence_of(t.type).emit(modptr); // <-- generate opcode
                     shunt_stack.op_stack.pop_back();
                 } else {
                     break;
@@ -320,10 +350,9 @@ void process_shunting_yard(
                 break;
 
             case token_type_t::module_ref: {
-                std::cout << "rparen matched to module_reference\n";
+                p.os << "rparen matched to module_reference\n";
 
-                string_t modulename = lexer_token_value(t, p.src);
-                size_t mname_idx = module_desc_add_string_constant(modptr, modulename);
+                size_t mname_idx = module_desc_add_symbol_constant(modptr, t.sym);
 
                 opc::module_call(modptr, mname_idx);
                 shunt_stack.op_stack.pop_back();
@@ -350,12 +379,11 @@ void process_shunting_yard(
             }
 
             case token_type_t::function: {
-                string_t fname = lexer_token_value(t, p.src);
-                auto tup = lexer_token_is_function(fname);
-                if(!std::get<0>(tup))
+                // function type was resolved when the token was lexed
+                if(t.fn == function_type_t::UNKNOWN)
                     INTERNAL_ERR();
 
-                opc::function_call(modptr, std::get<2>(tup));
+                opc::function_call(modptr, t.fn);
 
                 while(
                         shunt_stack.eval_stack.size() > 0ul &&
@@ -447,7 +475,7 @@ void process_shunting_yard(
                 default:
                     if(token_is_operator(t.type)) {
                         shunting_yard_eval_operator(rtenv, modptr, p, titer, tend, shunt_stack, t);
-                        precedence_table.at(t.type).third(modptr);
+                        precedence_of(t.type).emit(modptr);
                         shunt_stack.op_stack.pop_back();
                     } else {
                         throw_parse_error("Unknown type when evaluating closing bracket " + lexer_token_desc(t, p.src), p.filename, p.src, t);
@@ -465,9 +493,7 @@ void process_shunting_yard(
 
             //std::cout << "operator : " << lexer_token_desc(tok, p.src) << std::endl;
 
-            auto cur_prec = precedence_table.find(tok.type);
-            if(cur_prec == precedence_table.end())
-                throw_parse_error("Unknown operator " + lexer_token_desc(tok, p.src), p.filename, p.src, tok);
+            const assoc_entry_t& cur_prec = precedence_of(tok.type);
 
             while(shunt_stack.op_stack.size() > 0ul) {
                 token_t t = shunt_stack.op_stack.back();
@@ -477,13 +503,11 @@ void process_shunting_yard(
                         !token_is_operator(t.type))
                     break;
 
-                auto t_prec = precedence_table.find(t.type);
-                if(t_prec == precedence_table.end())
-                    throw_parse_error("Unknown operator " + lexer_token_desc(t, p.src), p.filename, p.src, t);
+                const assoc_entry_t& t_prec = precedence_of(t.type);
 
-                if(t_prec->second.first > cur_prec->second.first) {
+                if(t_prec.precedence > cur_prec.precedence) {
                     shunting_yard_eval_operator(rtenv, modptr, p, titer, tend, shunt_stack, t);
-                    t_prec->second.third(modptr); // <-- actual bytecode generation
+                    t_prec.emit(modptr); // <-- actual bytecode generation
                     shunt_stack.op_stack.pop_back();
                 } else {
                     break;
@@ -500,7 +524,7 @@ void process_shunting_yard(
 
         //shunting_yard_print_eval_stack(shunt_stack, p.src);
 
-        if(shunt_behavior == shunt_behavior_after && end_types.find(tok.type) != end_types.end())
+        if(shunt_behavior == shunt_behavior_after && token_type_set_has(end_types, tok.type))
             return;
     }
 }
@@ -517,7 +541,7 @@ void shunting_yard_eval_semicolon(
         token_t c = shunt_stack.op_stack.back();
         if(token_is_operator(c.type)) {
             shunting_yard_eval_operator(rtenv, modptr, p, titer, tend, shunt_stack, c);
-            precedence_table.at(c.type).third(modptr);
+            precedence_of(c.type).emit(modptr);
             shunt_stack.op_stack.pop_back();
         } else {
             throw_parse_error("Expecting operator, found " + lexer_token_desc(c, p.src),
@@ -535,20 +559,6 @@ void shunting_yard_eval_operator(
         shunting_stack_t& shunt_stack,
         const token_t& t) {
 
-    static const std::map<token_type_t, opcode_t> opcode_map = {
-        { token_type_t::period,       opcode_t::operator_get_field },
-        { token_type_t::divide,       opcode_t::operator_divide    },
-        { token_type_t::star,         opcode_t::operator_multiply  },
-        { token_type_t::plus,         opcode_t::operator_add       },
-        { token_type_t::minus,        opcode_t::operator_subtract  },
-        { token_type_t::assign,       opcode_t::operator_assign    },
-        { token_type_t::greater_than, opcode_t::operator_cmp_gt    },
-        { token_type_t::greater_eq,   opcode_t::operator_cmp_ge    },
-        { token_type_t::less_than,    opcode_t::operator_cmp_lt    },
-        { token_type_t::less_eq,      opcode_t::operator_cmp_le    },
-        { token_type_t::colon,        opcode_t::operator_range_desc },
-    };
-
     //std::cout << "eval operator " << lexer_token_desc(t, p.src) << std::endl;
 
     #pragma GCC diagnostic push
@@ -5,7 +5,8 @@
 #include <src/runtime/module-desc.h>
 #include <src/runtime/runtime-env.h>
 
-#include <set>
+#include <stdint.h>
+
 #include <vector>
 #include <utility>
 
@@ -19,9 +20,33 @@ enum eval_token_t {
     arr_access_sentinal,
 };
 
+//
+// small set of token types, one bit per token_type_t
+//
+typedef uint64_t token_type_set_t;
+
+static_assert((size_t)token_type_t::module_ref < 64ul, "token_type_t no longer fits in token_type_set_t");
+
+constexpr token_type_set_t token_type_set(token_type_t t) {
+    return 1ull << (size_t)t;
+}
+
+constexpr bool token_type_set_has(token_type_set_t set, token_type_t t) {
+    return (set & token_type_set(t)) != 0ull;
+}
+
+//
+// callers that parse many statements keep one of these around and clear it
+// between statements so the vectors keep their capacity
+//
 struct shunting_stack_t {
     std::vector<token_t> op_stack;
     std::vector<eval_token_t> eval_stack;
+
+    void clear(void) {
+        this->op_stack.clear();
+        this->eval_stack.clear();
+    }
 };
 
 enum shunt_behavior_t {
@@ -36,7 +61,7 @@ void process_shunting_yard(
         token_iterator_t& titer,
         const token_iterator_t& tend,
         shunting_stack_t& shunt_stack,
-        const std::set<token_type_t>& end_types,
+        token_type_set_t end_types,
         shunt_behavior_t shunt_behavior);
 
 void shunting_yard_eval_operator(
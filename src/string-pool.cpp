@@ -0,0 +1,178 @@
+#include <src/string-pool.h>
+#include <src/error-util.h>
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <new>
+
+static const size_t string_pool_default_chunk = 64ul * 1024ul;
+static const size_t string_pool_initial_index = 64ul; // power of two
+
+static uint32_t string_pool_hash(const char* str, size_t len) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for(size_t i = 0ul; i < len; i++) {
+        h ^= (uint8_t)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+string_pool_shard_t::string_pool_shard_t(void)
+        : chunk_used(0ul), chunk_size(0ul), count(0ul), index(string_pool_initial_index, 0u) {
+    for(size_t i = 0ul; i < string_pool_max_pages; i++)
+        this->pages[i] = NULL;
+}
+
+string_pool_shard_t::~string_pool_shard_t() {
+    for(char* c : this->chunks)
+        free(c);
+    for(size_t i = 0ul; i < string_pool_max_pages && this->pages[i] != NULL; i++)
+        free(this->pages[i]);
+}
+
+string_pool_t* global_string_pool(void) {
+    static string_pool_t pool;
+    return &pool;
+}
+
+static inline string_pool_entry_t& string_pool_entry(string_pool_shard_t* shard, size_t slot) {
+    return shard->pages[slot >> string_pool_page_bits][slot & (string_pool_page_size - 1ul)];
+}
+
+static inline const string_pool_entry_t& string_pool_entry(string_pool_t* pool, symbol_t sym) {
+    if(sym == symbol_none)
+        INTERNAL_ERR();
+
+    string_pool_shard_t* shard = &pool->shards[sym & (string_pool_shards - 1ul)];
+    return string_pool_entry(shard, sym >> string_pool_shard_bits);
+}
+
+static const char* string_pool_store(string_pool_shard_t* shard, const char* str, size_t len) {
+
+    if(shard->chunks.size() == 0ul || shard->chunk_used + len > shard->chunk_size) {
+        // oversized strings get a chunk to themselves
+        const size_t sz = len > string_pool_default_chunk ? len : string_pool_default_chunk;
+        char* c = (char*)malloc(sz > 0ul ? sz : 1ul);
+        if(c == NULL)
+            throw std::bad_alloc();
+
+        shard->chunks.push_back(c);
+        shard->chunk_used = 0ul;
+        shard->chunk_size = sz;
+    }
+
+    char* dst = shard->chunks.back() + shard->chunk_used;
+    memcpy(dst, str, len);
+    shard->chunk_used += len;
+    return dst;
+}
+
+static void string_pool_grow_index(string_pool_shard_t* shard) {
+    std::vector<uint32_t> index(shard->index.size() * 2ul, 0u);
+    const size_t mask = index.size() - 1ul;
+
+    for(size_t i = 0ul; i < shard->count; i++) {
+        size_t slot = (string_pool_entry(shard, i).hash >> string_pool_shard_bits) & mask;
+        while(index[slot] != 0u)
+            slot = (slot + 1ul) & mask;
+        index[slot] = i + 1u;
+    }
+
+    shard->index.swap(index);
+}
+
+//
+// returns the index slot holding str, or the empty slot where it would be inserted
+//
+static size_t string_pool_probe(string_pool_shard_t* shard, const char* str, size_t len, uint32_t h) {
+    const size_t mask = shard->index.size() - 1ul;
+    size_t slot = (h >> string_pool_shard_bits) & mask;
+
+    while(true) {
+        const uint32_t entry = shard->index[slot];
+        if(entry == 0u)
+            return slot;
+
+        const string_pool_entry_t& e = string_pool_entry(shard, entry - 1u);
+        if(e.hash == h && e.len == len && memcmp(e.ptr, str, len) == 0)
+            return slot;
+
+        slot = (slot + 1ul) & mask;
+    }
+}
+
+static inline symbol_t string_pool_make_symbol(size_t shard_idx, size_t slot) {
+    return (symbol_t)((slot << string_pool_shard_bits) | shard_idx);
+}
+
+symbol_t string_pool_intern(string_pool_t* pool, const char* str, size_t len) {
+
+    const uint32_t h = string_pool_hash(str, len);
+    const size_t shard_idx = h & (string_pool_shards - 1ul);
+    string_pool_shard_t* shard = &pool->shards[shard_idx];
+
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    size_t slot = string_pool_probe(shard, str, len, h);
+
+    if(shard->index[slot] != 0u)
+        return string_pool_make_symbol(shard_idx, shard->index[slot] - 1u);
+
+    const size_t n = shard->count;
+    const size_t page = n >> string_pool_page_bits;
+    if(page >= string_pool_max_pages)
+        INTERNAL_ERR();
+
+    if(shard->pages[page] == NULL) {
+        shard->pages[page] = (string_pool_entry_t*)malloc(string_pool_page_size * sizeof(string_pool_entry_t));
+        if(shard->pages[page] == NULL)
+            throw std::bad_alloc();
+    }
+
+    string_pool_entry_t& e = string_pool_entry(shard, n);
+    e.ptr  = string_pool_store(shard, str, len);
+    e.len  = len;
+    e.hash = h;
+    shard->count++;
+
+    // keep load factor at or below one half
+    if(shard->count * 2ul > shard->index.size()) {
+        string_pool_grow_index(shard);
+    } else {
+        shard->index[slot] = n + 1u;
+    }
+
+    return string_pool_make_symbol(shard_idx, n);
+}
+
+symbol_t string_pool_intern(string_pool_t* pool, const std::string& str) {
+    return string_pool_intern(pool, str.data(), str.size());
+}
+
+symbol_t string_pool_find(string_pool_t* pool, const char* str, size_t len) {
+    const uint32_t h = string_pool_hash(str, len);
+    const size_t shard_idx = h & (string_pool_shards - 1ul);
+    string_pool_shard_t* shard = &pool->shards[shard_idx];
+
+    std::lock_guard<std::mutex> guard(shard->lock);
+
+    const uint32_t entry = shard->index[string_pool_probe(shard, str, len, h)];
+    return entry == 0u ? symbol_none : string_pool_make_symbol(shard_idx, entry - 1u);
+}
+
+const char* string_pool_str(string_pool_t* pool, symbol_t sym) {
+    return string_pool_entry(pool, sym).ptr;
+}
+
+size_t string_pool_len(string_pool_t* pool, symbol_t sym) {
+    return string_pool_entry(pool, sym).len;
+}
+
+const std::string string_pool_string(string_pool_t* pool, symbol_t sym) {
+    const string_pool_entry_t& e = string_pool_entry(pool, sym);
+    return std::string(e.ptr, e.len);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+//
+// every identifier is interned exactly once. a symbol is a small integer that
+// stays valid (and keeps pointing at the same bytes) for the life of the program,
+// so symbols can be compared and hashed instead of strings
+//
+typedef uint32_t symbol_t;
+
+const symbol_t symbol_none = ~0u;
+
+//
+// the pool is split into shards picked by the low bits of the string hash so
+// several lexer threads can intern at once. each shard has its own lock, arena
+// and index. a symbol encodes (slot-in-shard << shard_bits) | shard, and the
+// per-symbol data sits in pages that are never moved, so turning a symbol back
+// into a string never takes a lock
+//
+const size_t string_pool_shard_bits = 6ul;
+const size_t string_pool_shards     = 1ul << string_pool_shard_bits;
+const size_t string_pool_page_bits  = 12ul;
+const size_t string_pool_page_size  = 1ul << string_pool_page_bits;
+const size_t string_pool_max_pages  = 4096ul; // per shard
+
+struct string_pool_entry_t {
+    const char* ptr;
+    uint32_t    len;
+    uint32_t    hash;
+};
+
+struct string_pool_shard_t {
+
+    string_pool_shard_t(void);
+    ~string_pool_shard_t();
+
+    std::mutex lock; // held for insertion and lookup by string
+
+    // string bytes live in fixed-size arena chunks that are never moved
+    std::vector<char*> chunks;
+    size_t chunk_used;
+    size_t chunk_size;
+
+    // per-symbol data, indexed by slot-in-shard
+    size_t count;
+    string_pool_entry_t* pages[string_pool_max_pages];
+
+    // open addressing hash index. slot holds slot-in-shard+1, 0 is empty
+    std::vector<uint32_t> index;
+};
+
+struct string_pool_t {
+    string_pool_shard_t shards[string_pool_shards];
+};
+
+//
+// the pool shared by the lexer, parser and module descriptors
+//
+string_pool_t* global_string_pool(void);
+
+//
+// safe to call from several threads at once
+//
+symbol_t string_pool_intern(string_pool_t* pool, const char* str, size_t len);
+symbol_t string_pool_intern(string_pool_t* pool, const std::string& str);
+
+//
+// returns symbol_none if the string has never been interned
+//
+symbol_t string_pool_find(string_pool_t* pool, const char* str, size_t len);
+
+//
+// sym must have been returned by this pool
+//
+const char* string_pool_str(string_pool_t* pool, symbol_t sym);
+size_t string_pool_len(string_pool_t* pool, symbol_t sym);
+const std::string string_pool_string(string_pool_t* pool, symbol_t sym);
@@ -0,0 +1,198 @@
+#include <src/thread-pool.h>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+
+// which queue the running thread pushes to. threads outside the pool use 0
+static thread_local const thread_pool_t* tls_pool  = NULL;
+static thread_local size_t               tls_queue = 0ul;
+
+static size_t thread_pool_own_queue(const thread_pool_t* pool) {
+    return tls_pool == pool ? tls_queue : 0ul;
+}
+
+//
+// runs one task, the newest of the own queue or else the oldest of another
+// queue. false if there was nothing to run
+//
+static bool thread_pool_run_one(thread_pool_t* pool) {
+
+    if(pool->queued.load() == 0ul)
+        return false;
+
+    const size_t n   = pool->queues.size();
+    const size_t own = thread_pool_own_queue(pool);
+
+    std::function<void()> task;
+
+    for(size_t k = 0ul; k < n && !task; k++) {
+        thread_pool_queue_t& q = *pool->queues[(own + k) % n];
+        std::lock_guard<std::mutex> guard(q.lock);
+
+        if(q.tasks.empty())
+            continue;
+
+        if(k == 0ul) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        } else {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+    }
+
+    if(!task)
+        return false;
+
+    pool->queued--;
+    task();
+    return true;
+}
+
+static void thread_pool_drain(thread_pool_t* pool) {
+    while(true) {
+        const size_t i = pool->next_idx.fetch_add(1ul);
+        if(i >= pool->job_size)
+            return;
+
+        try {
+            (*pool->job)(i);
+        }
+        catch(...) {
+            std::lock_guard<std::mutex> guard(pool->lock);
+            if(!pool->error)
+                pool->error = std::current_exception();
+        }
+    }
+}
+
+static void thread_pool_worker(thread_pool_t* pool, size_t queue) {
+
+    tls_pool  = pool;
+    tls_queue = queue;
+
+    unsigned long seen = 0ul;
+
+    std::unique_lock<std::mutex> lk(pool->lock);
+    while(true) {
+        pool->work_cv.wait(lk, [&] { return pool->shutdown || pool->generation != seen || pool->queued.load() > 0ul; });
+        if(pool->shutdown)
+            return;
+
+        if(pool->generation == seen) {
+            lk.unlock();
+            while(thread_pool_run_one(pool))
+                ;
+            lk.lock();
+            continue;
+        }
+
+        seen = pool->generation;
+
+        lk.unlock();
+        thread_pool_drain(pool);
+        lk.lock();
+
+        if(--pool->active == 0ul)
+            pool->done_cv.notify_all();
+    }
+}
+
+size_t thread_pool_hardware_threads(void) {
+    const size_t n = std::thread::hardware_concurrency();
+    return n == 0ul ? 1ul : n;
+}
+
+thread_pool_t::thread_pool_t(size_t nthreads) : next_idx(0ul), queued(0ul) {
+    if(nthreads == 0ul)
+        nthreads = thread_pool_hardware_threads();
+
+    for(size_t i = 0ul; i < nthreads; i++)
+        this->queues.emplace_back(new thread_pool_queue_t);
+
+    for(size_t i = 1ul; i < nthreads; i++)
+        this->workers.emplace_back(thread_pool_worker, this, i);
+}
+
+thread_pool_t::~thread_pool_t() {
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        this->shutdown = true;
+    }
+    this->work_cv.notify_all();
+
+    for(std::thread& t : this->workers)
+        t.join();
+}
+
+size_t thread_pool_size(const thread_pool_t* pool) {
+    return pool->workers.size() + 1ul;
+}
+
+void thread_pool_parallel_for(thread_pool_t* pool, size_t n, const std::function<void(size_t)>& fn) {
+
+    if(n == 0ul)
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(pool->lock);
+        pool->job      = &fn;
+        pool->job_size = n;
+        pool->next_idx = 0ul;
+        pool->active   = pool->workers.size();
+        pool->error    = nullptr;
+        pool->generation++;
+    }
+    pool->work_cv.notify_all();
+
+    thread_pool_drain(pool);
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lk(pool->lock);
+        pool->done_cv.wait(lk, [&] { return pool->active == 0ul; });
+        pool->job = NULL;
+        error = pool->error;
+        pool->error = nullptr;
+    }
+
+    if(error)
+        std::rethrow_exception(error);
+}
+
+void thread_pool_run_team(thread_pool_t* pool, const std::function<void(size_t)>& fn) {
+    // a thread only takes another index once its call returned, and a call
+    // waiting on the others can not return before every index is taken, so
+    // the calls that wait each get their own thread
+    thread_pool_parallel_for(pool, thread_pool_size(pool), fn);
+}
+
+void thread_pool_spawn(thread_pool_t* pool, std::function<void()> fn) {
+
+    thread_pool_queue_t& q = *pool->queues[thread_pool_own_queue(pool)];
+    {
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.tasks.push_back(std::move(fn));
+    }
+    pool->queued++;
+
+    if(pool->workers.empty())
+        return;
+
+    // a worker checks queued with the pool lock held before it sleeps
+    { std::lock_guard<std::mutex> guard(pool->lock); }
+    pool->work_cv.notify_one();
+}
+
+void thread_pool_wait_until(thread_pool_t* pool, const std::function<bool()>& ready) {
+    while(!ready()) {
+        // whatever ready() waits for is running on another thread
+        if(!thread_pool_run_one(pool))
+            std::this_thread::yield();
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <deque>
+#include <memory>
+
+//
+// fixed set of worker threads that sleep until handed a batch of indices. the
+// calling thread works on the batch too, so a pool of size 1 runs everything
+// inline with no extra threads
+//
+// the pool also runs individual tasks. every thread has its own deque of
+// tasks, it pushes and pops its newest tasks at the back while threads that
+// run out of work steal the oldest ones from the front of the others
+//
+struct thread_pool_queue_t {
+    std::mutex lock;
+    std::deque<std::function<void()> > tasks;
+};
+
+struct thread_pool_t {
+
+    // nthreads counts the calling thread, 0 means one per hardware thread
+    thread_pool_t(size_t nthreads = 0ul);
+    ~thread_pool_t();
+
+    std::vector<std::thread> workers;
+
+    std::mutex lock;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+
+    // current batch
+    const std::function<void(size_t)>* job = NULL;
+    size_t job_size = 0ul;
+    std::atomic<size_t> next_idx;
+    size_t active = 0ul;         // workers still inside the current batch
+    unsigned long generation = 0ul;
+    bool shutdown = false;
+
+    std::exception_ptr error;    // first exception thrown by the batch
+
+    // one per thread, the calling thread (or any thread outside the pool) uses queues[0]
+    std::vector<std::unique_ptr<thread_pool_queue_t> > queues;
+    std::atomic<size_t> queued;  // tasks in all queues
+};
+
+size_t thread_pool_hardware_threads(void);
+
+//
+// total threads used by the pool including the caller
+//
+size_t thread_pool_size(const thread_pool_t* pool);
+
+//
+// calls fn(i) for every i in [0, n) spread over the pool and returns when all of
+// them are done. order of calls is unspecified. if any call throws, the rest of
+// the batch still runs and the first exception is rethrown here
+//
+void thread_pool_parallel_for(thread_pool_t* pool, size_t n, const std::function<void(size_t)>& fn);
+
+//
+// calls fn(i) once for every thread i of the pool, all of them at the same
+// time, so the calls may wait on each other (a spinning barrier). the pool
+// must have nothing else to do, a thread busy with a task would never join
+//
+void thread_pool_run_team(thread_pool_t* pool, const std::function<void(size_t)>& fn);
+
+//
+// queues fn on the deque of the calling thread. fn must not throw
+//
+void thread_pool_spawn(thread_pool_t* pool, std::function<void()> fn);
+
+//
+// runs queued tasks, its own or stolen ones, until ready() returns true. for
+// waiting on tasks from inside a task without tying up a thread
+//
+void thread_pool_wait_until(thread_pool_t* pool, const std::function<bool()>& ready);